@@ -0,0 +1,7 @@
+/** @type {import('jest').Config} */
+module.exports = {
+  testEnvironment: 'node',
+  roots: ['<rootDir>/tests'],
+  // Transpile only: unit tests cover the pure lib modules and don't need prisma generate
+  transform: { '^.+\\.ts$': ['ts-jest', { isolatedModules: true }] },
+};
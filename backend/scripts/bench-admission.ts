@@ -0,0 +1,57 @@
+/**
+ * Admission control under a flood
+ *   npx tsx scripts/bench-admission.ts
+ * Simulates a fleet where 1% of devices are stuck in a send loop and reports
+ * admission decisions/s and how much well-behaved traffic gets through.
+ */
+import { AdmissionController } from '../src/lib/admission';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '10000');
+const BAD_FRACTION = parseFloat(process.env.BENCH_BAD_FRACTION || '0.01');
+const SIM_SECONDS = parseInt(process.env.BENCH_SECONDS || '600');
+const BAD_RPS = parseInt(process.env.BENCH_BAD_RPS || '50'); // requests/s per misbehaving node
+
+const controller = new AdmissionController(60, 12, Number.MAX_SAFE_INTEGER, 2000);
+const badCount = Math.max(1, Math.round(DEVICES * BAD_FRACTION));
+const ids = Array.from({ length: DEVICES }, (_, i) => `device-${i}`);
+
+let good = { sent: 0, admitted: 0 };
+let bad = { sent: 0, admitted: 0 };
+let decisions = 0;
+
+const started = process.hrtime.bigint();
+const t0 = Date.now();
+for (let sec = 0; sec < SIM_SECONDS; sec++) {
+  const now = t0 + sec * 1000;
+  // Well-behaved nodes: one reading per minute, spread across the minute
+  for (let i = badCount; i < DEVICES; i++) {
+    if ((i + sec) % 60 !== 0) continue;
+    good.sent++;
+    decisions++;
+    const r = controller.admit(ids[i], now);
+    if (r.admitted) {
+      good.admitted++;
+      controller.release();
+    }
+  }
+  // Misbehaving nodes ignore Retry-After entirely
+  for (let i = 0; i < badCount; i++) {
+    for (let k = 0; k < BAD_RPS; k++) {
+      bad.sent++;
+      decisions++;
+      const r = controller.admit(ids[i], now + k);
+      if (r.admitted) {
+        bad.admitted++;
+        controller.release();
+      }
+    }
+  }
+}
+const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+console.log(`devices=${DEVICES} misbehaving=${badCount} (${BAD_RPS} req/s each) simulated=${SIM_SECONDS}s`);
+console.log(`admission decisions: ${Math.round(decisions / seconds)} /s (${decisions} total in ${seconds.toFixed(2)}s)`);
+console.log(`well-behaved: ${good.admitted}/${good.sent} admitted (${((good.admitted / good.sent) * 100).toFixed(2)}%)`);
+console.log(`misbehaving:  ${bad.admitted}/${bad.sent} admitted (${((bad.admitted / bad.sent) * 100).toFixed(2)}%)`);
+console.log(`load reaching handlers: ${Math.round((good.admitted + bad.admitted) / SIM_SECONDS)} req/s ` +
+  `vs ${Math.round((good.sent + bad.sent) / SIM_SECONDS)} req/s offered; buckets tracked=${controller.buckets.size}`);
@@ -0,0 +1,129 @@
+/**
+ * Device authentication under a forged-traffic flood
+ *   npx tsx scripts/bench-auth.ts
+ * Pushes a mix of forged and genuine readings through normalizeIngest() with
+ * stored per-device keys (device row loaded before the signature check) and with
+ * derived keys (signature checked first, no lookup for rejects). Device lookups go
+ * through the same positive cache as ingest-pipeline's findDevice(); misses cost a
+ * query on a simulated connection pool. Reports verify-and-reject throughput and
+ * how many queries the flood caused.
+ */
+import crypto from 'crypto';
+import type { Device } from '@prisma/client';
+import { normalizeIngest, DeviceAuth } from '../src/lib/ingest-core';
+import { deriveDeviceKey, generateAPIKey } from '../src/lib/hmac';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '2000');
+const REQUESTS = parseInt(process.env.BENCH_REQUESTS || '100000');
+const GENUINE_FRACTION = parseFloat(process.env.BENCH_GENUINE_FRACTION || '0.01');
+const CONCURRENCY = parseInt(process.env.BENCH_CONCURRENCY || '256');
+const DB_POOL = parseInt(process.env.BENCH_DB_POOL || '10');       // Prisma's default connection limit
+const DB_LATENCY_MS = parseFloat(process.env.BENCH_DB_LATENCY_MS || '1');
+
+const MASTER = crypto.randomBytes(32).toString('hex');
+
+type Flood = 'forged-unknown-id' | 'forged-known-id' | 'unsigned';
+const FLOODS: Flood[] = ['forged-unknown-id', 'forged-known-id', 'unsigned'];
+
+function makeDevices(derived: boolean): Device[] {
+  return Array.from({ length: DEVICES }, (_, i) => {
+    const id = crypto.randomUUID();
+    return {
+      id,
+      deviceKey: derived ? deriveDeviceKey(MASTER, id) : generateAPIKey(`device-${i}`, 'bench-salt'),
+      altitude: null,
+      firmwareVersion: '1.2.0',
+    } as unknown as Device;
+  });
+}
+
+function reading(deviceId: string, seq: number, key: string | null): string {
+  const payload = {
+    device_id: deviceId,
+    firmware_version: '1.2.0',
+    timestamp: 1760000000 + seq * 60,
+    sensors: { mq135_raw: 71.4, iaq_score: 88.5 + (seq % 13), co2_equiv: 612.3, temperature: 27.4, humidity: 54.2 },
+    meta: { uptime_ms: 3600000 + seq, rssi: -61, boot_id: '9f2c01ab', seq },
+  };
+  if (key === null) return JSON.stringify(payload);
+  return JSON.stringify({ ...payload, signature: crypto.createHmac('sha256', key).update(JSON.stringify(payload)).digest('hex') });
+}
+
+// Pre-built traffic so only decode + verify + lookup are timed
+function traffic(devices: Device[], flood: Flood): string[] {
+  const bogusKey = crypto.randomBytes(16).toString('hex');
+  return Array.from({ length: REQUESTS }, (_, i) => {
+    const device = devices[i % devices.length];
+    if (i % Math.round(1 / GENUINE_FRACTION) === 0) return reading(device.id, i, device.deviceKey);
+    switch (flood) {
+      case 'forged-unknown-id': return reading(crypto.randomUUID(), i, bogusKey);
+      case 'forged-known-id': return reading(device.id, i, bogusKey);
+      case 'unsigned': return reading(device.id, i, null);
+    }
+  });
+}
+
+// findDevice() stand-in: positive cache in front of a pool of DB_POOL connections
+function simulatedLookup(devices: Device[]) {
+  const rows = new Map(devices.map((d) => [d.id, d]));
+  const cache = new Map<string, Device>(rows);  // Fleet already warm in the cache
+  let queries = 0;
+  let busy = 0;
+  const waiting: (() => void)[] = [];
+
+  async function query(id: string): Promise<Device | null> {
+    queries++;
+    if (busy >= DB_POOL) await new Promise<void>((resolve) => waiting.push(resolve));
+    busy++;
+    await new Promise((resolve) => setTimeout(resolve, DB_LATENCY_MS));
+    busy--;
+    waiting.shift()?.();
+    return rows.get(id) ?? null;
+  }
+
+  return {
+    resolve: (id: string) => cache.get(id) ?? query(id),
+    queries: () => queries,
+  };
+}
+
+async function run(label: string, payloads: string[], devices: Device[], auth?: DeviceAuth) {
+  const lookup = simulatedLookup(devices);
+  const counts = { accepted: 0, rejected: 0 };
+  let next = 0;
+
+  const started = process.hrtime.bigint();
+  await Promise.all(Array.from({ length: CONCURRENCY }, async () => {
+    while (next < payloads.length) {
+      const r = await normalizeIngest(JSON.parse(payloads[next++]), lookup.resolve, auth);
+      if (r.ok) counts.accepted++;
+      else counts.rejected++;
+    }
+  }));
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+  console.log(
+    `  ${label.padEnd(22)} ${Math.round(payloads.length / seconds).toString().padStart(8)} req/s  ` +
+    `accepted ${counts.accepted.toString().padStart(5)}  rejected ${counts.rejected.toString().padStart(6)}  ` +
+    `DB queries ${lookup.queries().toString().padStart(6)}`
+  );
+}
+
+(async () => {
+  console.log(
+    `Auth flood: ${REQUESTS} requests, ${(GENUINE_FRACTION * 100).toFixed(1)}% genuine, ${DEVICES} devices, ` +
+    `concurrency ${CONCURRENCY}, DB pool ${DB_POOL} x ${DB_LATENCY_MS} ms`
+  );
+  const stored = makeDevices(false);
+  const derived = makeDevices(true);
+
+  // Warm up JIT on the CPU-only path
+  await run('(warm-up)', traffic(derived, 'forged-known-id').slice(0, 20000), derived, { masterKey: MASTER, allowLegacyKeys: false });
+
+  for (const flood of FLOODS) {
+    console.log(`\n${flood}`);
+    await run('stored keys', traffic(stored, flood), stored);
+    await run('derived keys', traffic(derived, flood), derived, { masterKey: MASTER, allowLegacyKeys: false });
+    await run('derived + legacy', traffic(derived, flood), derived, { masterKey: MASTER, allowLegacyKeys: true });
+  }
+})();
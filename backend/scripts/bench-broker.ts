@@ -0,0 +1,200 @@
+/**
+ * Edge broker capacity: connections and message throughput
+ *   npx tsx scripts/bench-broker.ts
+ *   BENCH_BROKER_URL=mqtt://localhost:1883 npx tsx scripts/bench-broker.ts   (e.g. Mosquitto, same load)
+ * Without BENCH_BROKER_URL an in-process MqttBroker is started (and its heap
+ * and RSS per connection reported). Scenarios:
+ *   connections  open BENCH_CONNECTIONS idle clients, each subscribed to its own command topic
+ *   fan-in       BENCH_PUBLISHERS publishers on per-device topics -> one `#` subscriber (QoS 0 and 1)
+ *   fan-out      one publisher -> BENCH_SUBSCRIBERS subscribers of the same topic (QoS 0)
+ */
+import net from 'net';
+import { MqttBroker } from '../src/lib/mqtt-broker';
+import { MqttClient } from '../src/lib/mqtt-client';
+import { encodePacket, PacketParser } from '../src/lib/mqtt-codec';
+
+const EXTERNAL = process.env.BENCH_BROKER_URL;
+const CONNECTIONS = parseInt(process.env.BENCH_CONNECTIONS || '2000');
+const MESSAGES = parseInt(process.env.BENCH_MESSAGES || '100000');
+const PUBLISHERS = parseInt(process.env.BENCH_PUBLISHERS || '8');
+const SUBSCRIBERS = parseInt(process.env.BENCH_SUBSCRIBERS || '50');
+const WINDOW = parseInt(process.env.BENCH_PUBLISH_WINDOW || '100');
+const PREFIX = `bench-${process.pid}`;
+
+const PAYLOAD = Buffer.from(
+  JSON.stringify({
+    device_id: 'bench-device',
+    timestamp: 1760000000,
+    sensors: { mq135_raw: 71.4, iaq_score: 88.5, co2_equiv: 612.3, temperature: 27.41, humidity: 54.2, pressure_hpa: 1008.7 },
+    meta: { uptime_ms: 3600000, rssi: -61, free_heap: 182344 },
+    signature: 'f'.repeat(64),
+  })
+);
+
+const mb = (bytes: number) => (bytes / 1024 / 1024).toFixed(1);
+
+function connected(client: MqttClient): Promise<void> {
+  return new Promise((resolve) => {
+    client.once('connect', resolve);
+    client.connect();
+  });
+}
+
+// Bare socket client: CONNECT + SUBSCRIBE, resolves on SUBACK (keeps the bench side light)
+function idleClient(host: string, port: number, i: number): Promise<net.Socket> {
+  return new Promise((resolve, reject) => {
+    const socket = net.connect(port, host);
+    const parser = new PacketParser();
+    socket.on('error', reject);
+    socket.on('connect', () => {
+      socket.write(encodePacket({ type: 'connect', clientId: `${PREFIX}-idle-${i}`, keepalive: 0, clean: true }));
+      socket.write(encodePacket({ type: 'subscribe', messageId: 1, subscriptions: [{ topic: `${PREFIX}/commands/${i}`, qos: 1 }] }));
+    });
+    socket.on('data', (chunk) => {
+      if (parser.push(chunk).some((p) => p.type === 'suback')) resolve(socket);
+    });
+  });
+}
+
+async function connections(host: string, port: number, broker: MqttBroker | null) {
+  global.gc?.();
+  const heapBefore = process.memoryUsage().heapUsed;
+  const rssBefore = process.memoryUsage().rss;
+  const sockets: net.Socket[] = [];
+  const started = process.hrtime.bigint();
+  for (let i = 0; i < CONNECTIONS; i += 200) {
+    const batch = Array.from({ length: Math.min(200, CONNECTIONS - i) }, (_, j) => idleClient(host, port, i + j));
+    sockets.push(...(await Promise.all(batch)));
+  }
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  global.gc?.();
+  const mem = process.memoryUsage();
+  console.log(`connections: ${sockets.length} connected + subscribed in ${seconds.toFixed(2)} s (${Math.round(sockets.length / seconds)}/s)`);
+  if (broker) {
+    // Both ends of every socket live in this process, so this is an upper bound for the broker side
+    const heapPer = (mem.heapUsed - heapBefore) / sockets.length;
+    const rssPer = (mem.rss - rssBefore) / sockets.length;
+    console.log(`  broker reports ${broker.stats.connections} clients; heap +${mb(mem.heapUsed - heapBefore)} MB (${(heapPer / 1024).toFixed(1)} KB/conn), rss +${mb(mem.rss - rssBefore)} MB (${(rssPer / 1024).toFixed(1)} KB/conn, both ends)`);
+  }
+  return sockets;
+}
+
+async function fanIn(url: string, qos: 0 | 1) {
+  const subscriber = new MqttClient({ url, clientId: `${PREFIX}-sink-${qos}` });
+  let received = 0;
+  let resolveDone: () => void;
+  const done = new Promise<void>((r) => (resolveDone = r));
+  subscriber.on('message', (msg) => {
+    msg.ack();
+    if (++received === MESSAGES) resolveDone();
+  });
+  subscriber.subscribe(`${PREFIX}/fanin-${qos}/#`, qos);
+  await connected(subscriber);
+  await new Promise((r) => setTimeout(r, 100));
+
+  const publishers = await Promise.all(
+    Array.from({ length: PUBLISHERS }, async (_, p) => {
+      const client = new MqttClient({ url, clientId: `${PREFIX}-pub-${qos}-${p}` });
+      await connected(client);
+      return client;
+    })
+  );
+
+  let sent = 0;
+  const started = process.hrtime.bigint();
+  await Promise.all(
+    publishers.map(async (client, p) => {
+      const inFlight = new Set<Promise<void>>();
+      for (let i = p; i < MESSAGES; i += PUBLISHERS) {
+        const topic = `${PREFIX}/fanin-${qos}/device-${i % 1000}`;
+        if (qos === 0) {
+          client.publish(topic, PAYLOAD, 0);
+          // QoS 0 has no acks to pace on: hold the same window against what the sink has seen
+          sent++;
+          while (sent - received > WINDOW * PUBLISHERS) await new Promise((r) => setImmediate(r));
+          continue;
+        }
+        const pending = client.publish(topic, PAYLOAD, 1);
+        inFlight.add(pending);
+        pending.then(() => inFlight.delete(pending));
+        if (inFlight.size >= WINDOW) await Promise.race(inFlight);
+      }
+      await Promise.all(inFlight);
+    })
+  );
+  // QoS 0 may be dropped under backpressure: stop waiting once the sink goes quiet
+  let last = -1;
+  while (received < MESSAGES && received !== last) {
+    last = received;
+    await Promise.race([done, new Promise((r) => setTimeout(r, 1000))]);
+  }
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  console.log(`fan-in QoS ${qos}: ${PUBLISHERS} publishers -> 1 subscriber, ${received}/${MESSAGES} delivered, ${Math.round(received / seconds)} msg/s`);
+  await Promise.all([subscriber, ...publishers].map((c) => c.end()));
+}
+
+async function fanOut(url: string) {
+  const perSubscriber = Math.max(1, Math.floor(MESSAGES / SUBSCRIBERS));
+  const expected = perSubscriber * SUBSCRIBERS;
+  let received = 0;
+  let resolveDone: () => void;
+  const done = new Promise<void>((r) => (resolveDone = r));
+  const subscribers = await Promise.all(
+    Array.from({ length: SUBSCRIBERS }, async (_, s) => {
+      const client = new MqttClient({ url, clientId: `${PREFIX}-fanout-${s}` });
+      client.on('message', () => {
+        if (++received === expected) resolveDone();
+      });
+      client.subscribe(`${PREFIX}/fanout/+`, 0);
+      await connected(client);
+      return client;
+    })
+  );
+  await new Promise((r) => setTimeout(r, 200));
+
+  const publisher = new MqttClient({ url, clientId: `${PREFIX}-fanout-pub` });
+  await connected(publisher);
+  const started = process.hrtime.bigint();
+  for (let i = 0; i < perSubscriber; i++) {
+    publisher.publish(`${PREFIX}/fanout/device-${i % 100}`, PAYLOAD, 0);
+    if (i % 50 === 0) await new Promise((r) => setImmediate(r));
+  }
+  let last = -1;
+  while (received < expected && received !== last) {
+    last = received;
+    await Promise.race([done, new Promise((r) => setTimeout(r, 1000))]);
+  }
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  console.log(`fan-out QoS 0: 1 publisher -> ${SUBSCRIBERS} subscribers, ${received}/${expected} delivered, ${Math.round(received / seconds)} deliveries/s`);
+  await Promise.all([publisher, ...subscribers].map((c) => c.end()));
+}
+
+async function main() {
+  let broker: MqttBroker | null = null;
+  let url = EXTERNAL;
+  if (!url) {
+    broker = new MqttBroker({ maxBufferedBytes: 8 * 1024 * 1024 });
+    await broker.listen(0, '127.0.0.1');
+    url = `mqtt://127.0.0.1:${broker.port}`;
+  }
+  const { hostname, port } = new URL(url);
+  console.log(`broker ${EXTERNAL ?? 'in-process MqttBroker'} (${url}), payload ${PAYLOAD.length} B`);
+
+  const idle = await connections(hostname, parseInt(port || '1883'), broker);
+  // Throughput runs with the idle fleet still connected
+  await fanIn(url, 0);
+  await fanIn(url, 1);
+  await fanOut(url);
+
+  idle.forEach((s) => s.destroy());
+  if (broker) {
+    const s = broker.stats;
+    console.log(`broker totals: in ${s.messagesIn}, out ${s.messagesOut}, dropped ${s.dropped}`);
+    await broker.close();
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,92 @@
+/**
+ * Dashboard reading cache: memory and query latency
+ *   npx tsx scripts/bench-cache.ts
+ * Fills a ReadingRingCache with a full 24 h window for a large fleet, then times
+ * "latest for these devices" (a city page) and "last N hours for a device" (a
+ * device page) against it. Reports typed-array and measured heap bytes per device.
+ */
+import crypto from 'crypto';
+import { ReadingRingCache } from '../src/lib/reading-ring';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '100000');
+const BUCKET_MIN = parseInt(process.env.BENCH_BUCKET_MIN || '5');
+const READINGS_PER_BUCKET = parseInt(process.env.BENCH_READINGS_PER_BUCKET || '1');
+const CITY_SIZE = parseInt(process.env.BENCH_CITY_SIZE || '500');
+const QUERIES = parseInt(process.env.BENCH_QUERIES || '20000');
+
+const WINDOW_MS = 24 * 60 * 60 * 1000;
+const bucketMs = BUCKET_MIN * 60_000;
+const now = Date.now();
+
+function percentile(sorted: number[], p: number): number {
+  return sorted[Math.min(sorted.length - 1, Math.floor(sorted.length * p))];
+}
+
+function timeQueries(label: string, n: number, query: (i: number) => unknown) {
+  for (let i = 0; i < Math.min(n, 2000); i++) query(i);
+  const samples: number[] = [];
+  let sink = 0;
+  for (let i = 0; i < n; i++) {
+    const t = process.hrtime.bigint();
+    const r = query(i) as unknown[];
+    samples.push(Number(process.hrtime.bigint() - t) / 1000);
+    sink += r.length;
+  }
+  samples.sort((a, b) => a - b);
+  console.log(
+    `  ${label.padEnd(30)} p50 ${percentile(samples, 0.5).toFixed(1).padStart(7)} µs  ` +
+    `p99 ${percentile(samples, 0.99).toFixed(1).padStart(7)} µs  (${(sink / n).toFixed(0)} rows/query)`
+  );
+}
+
+const ids = Array.from({ length: DEVICES }, () => crypto.randomUUID());
+
+global.gc?.();
+const heapBefore = process.memoryUsage();
+const cache = new ReadingRingCache({ bucketMs, windowMs: WINDOW_MS });
+
+// A day of readings, bucket by bucket across the fleet as the ingest stream would deliver them
+const started = process.hrtime.bigint();
+let records = 0;
+const firstBucket = Math.floor((now - WINDOW_MS) / bucketMs) + 1;
+const lastBucket = Math.floor(now / bucketMs);
+for (let b = firstBucket; b <= lastBucket; b++) {
+  for (let r = 0; r < READINGS_PER_BUCKET; r++) {
+    const at = b * bucketMs + Math.floor((r * bucketMs) / READINGS_PER_BUCKET);
+    for (let d = 0; d < DEVICES; d++) {
+      const wave = Math.sin((b + d) / 24);
+      cache.record(ids[d], at, {
+        aqi: 80 + 40 * wave,
+        iaq: 95 + 50 * wave,
+        temperature: 27 + 4 * wave,
+        humidity: 55 - 10 * wave,
+        pressureHpa: 1008.5,
+      });
+      records++;
+    }
+  }
+}
+const fillSeconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+global.gc?.();
+const heapAfter = process.memoryUsage();
+const measured = heapAfter.heapUsed + heapAfter.arrayBuffers - heapBefore.heapUsed - heapBefore.arrayBuffers;
+
+console.log(`Reading cache: ${DEVICES} devices, ${cache.slots} x ${BUCKET_MIN} min buckets, ${READINGS_PER_BUCKET} reading(s)/bucket`);
+console.log(`  fill: ${records} readings in ${fillSeconds.toFixed(2)} s (${Math.round(records / fillSeconds)} readings/s)`);
+console.log(
+  `  memory: ${cache.bytesPerDevice} B/device in typed arrays, ` +
+  `${Math.round(measured / DEVICES)} B/device measured incl. index and growth slack` +
+  `${global.gc ? '' : ' (run with --expose-gc for a stable figure)'}, ${(measured / 1e6).toFixed(0)} MB total`
+);
+
+const cities = Array.from({ length: 64 }, (_, c) =>
+  Array.from({ length: CITY_SIZE }, (_, i) => ids[(c * 7919 + i * 104729) % DEVICES])
+);
+
+console.log(`\nQueries (${QUERIES} each)`);
+timeQueries(`latest x ${CITY_SIZE} (city page)`, Math.max(1, Math.floor(QUERIES / 10)), (i) =>
+  cities[i % cities.length].map((id) => cache.latestFor(id)));
+timeQueries('latest x 1', QUERIES, (i) => [cache.latestFor(ids[(i * 7919) % DEVICES])]);
+timeQueries('last 1 h (device page)', QUERIES, (i) => cache.recent(ids[(i * 7919) % DEVICES], now - 3_600_000, now));
+timeQueries('last 24 h (device page)', QUERIES, (i) => cache.recent(ids[(i * 7919) % DEVICES], now - WINDOW_MS, now));
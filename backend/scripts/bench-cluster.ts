@@ -0,0 +1,100 @@
+/**
+ * Ingest cluster ownership and rebalancing cost
+ *   npx tsx scripts/bench-cluster.ts
+ * Builds an in-process cluster of ClusterMembership views over a simulated
+ * fleet, then applies membership changes (join, leave, replace) and reports
+ * how many devices changed owner versus the ideal and versus mod-N hashing,
+ * how many redirects nodes pay to re-learn their owner, and the handoff load
+ * (exact duplicate checks) on the instances that picked devices up.
+ */
+import { ClusterMembership, ClusterNode, RendezvousRing } from '../src/lib/cluster';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '100000');
+const NODES = parseInt(process.env.BENCH_NODES || '8');
+const READINGS_PER_MIN = parseFloat(process.env.BENCH_READINGS_PER_MIN || '1');
+const HANDOFF_HOURS = parseInt(process.env.BENCH_HANDOFF_HOURS || '24');
+
+const node = (i: number): ClusterNode => ({ id: `ingest-${i}`, url: `http://ingest-${i}:3000` });
+const ids = Array.from({ length: DEVICES }, (_, i) => `AERO-${(i * 2654435761) % 1e9}-${i}`);
+
+function ownersOf(ring: RendezvousRing): string[] {
+  return ids.map((id) => ring.owner(id)!.id);
+}
+
+function modN(nodes: ClusterNode[]): string[] {
+  const sorted = [...nodes].sort((a, b) => (a.id < b.id ? -1 : 1));
+  return ids.map((id) => {
+    let h = 0;
+    for (let i = 0; i < id.length; i++) h = (Math.imul(h, 31) + id.charCodeAt(i)) >>> 0;
+    return sorted[h % sorted.length].id;
+  });
+}
+
+function moved(a: string[], b: string[]): number {
+  let n = 0;
+  for (let i = 0; i < a.length; i++) if (a[i] !== b[i]) n++;
+  return n;
+}
+
+function balance(owners: string[]): string {
+  const counts = new Map<string, number>();
+  for (const o of owners) counts.set(o, (counts.get(o) || 0) + 1);
+  const values = [...counts.values()];
+  const mean = owners.length / values.length;
+  return `min ${Math.min(...values)}, max ${Math.max(...values)} (max/mean ${(Math.max(...values) / mean).toFixed(3)})`;
+}
+
+// --- Lookup cost ------------------------------------------------------------
+let nodes = Array.from({ length: NODES }, (_, i) => node(i));
+const ring = new RendezvousRing(nodes);
+let sink = 0;
+for (let i = 0; i < 50_000; i++) sink += ring.ownerIndex(ids[i % DEVICES]);
+const lookups = 2_000_000;
+const t0 = process.hrtime.bigint();
+for (let i = 0; i < lookups; i++) sink += ring.ownerIndex(ids[i % DEVICES]);
+const lookupNs = Number(process.hrtime.bigint() - t0) / lookups;
+
+console.log(`cluster: ${NODES} nodes, ${DEVICES} devices`);
+console.log(`owner lookup: ${lookupNs.toFixed(0)} ns/op (${sink > 0 ? 'ok' : ''})`);
+console.log(`devices per node: ${balance(ownersOf(ring))}`);
+
+// --- Membership changes -------------------------------------------------------
+const readingsInWindow = READINGS_PER_MIN * 60 * HANDOFF_HOURS;
+
+function change(label: string, next: ClusterNode[]) {
+  const before = ownersOf(new RendezvousRing(nodes));
+  const after = ownersOf(new RendezvousRing(next));
+  const beforeMod = modN(nodes);
+  const afterMod = modN(next);
+
+  // Simulate each instance's view: count devices it now owns but did not before
+  const now = Date.now();
+  const views = new Map(nodes.concat(next).map((n) => [n.id, new ClusterMembership(n.id, nodes, HANDOFF_HOURS * 3600_000)]));
+  const t = process.hrtime.bigint();
+  for (const v of views.values()) v.update(next, now);
+  const acquired = new Map<string, number>();
+  for (let i = 0; i < DEVICES; i++) {
+    const v = views.get(after[i])!;
+    if (v.recentlyAcquired(ids[i], now)) acquired.set(after[i], (acquired.get(after[i]) || 0) + 1);
+  }
+  const scanMs = Number(process.hrtime.bigint() - t) / 1e6;
+
+  const m = moved(before, after);
+  const ideal = label.startsWith('join')
+    ? DEVICES / next.length
+    : label.startsWith('leave')
+      ? DEVICES / nodes.length
+      : (2 * DEVICES) / (nodes.length + 1);
+  const busiest = Math.max(0, ...acquired.values());
+
+  console.log(`\n${label}: ${nodes.length} -> ${next.length} nodes`);
+  console.log(`  moved: ${m} (${((m / DEVICES) * 100).toFixed(2)}%), ideal ~${Math.round(ideal)}; mod-N would move ${moved(beforeMod, afterMod)}`);
+  console.log(`  redirects to re-learn owners: ${m} (one per moved device)`);
+  console.log(`  handoff exact checks: ${Math.round(m * readingsInWindow)} over ${HANDOFF_HOURS}h, busiest node ${busiest} devices (${(busiest * READINGS_PER_MIN / 60).toFixed(1)}/s)`);
+  console.log(`  balance after: ${balance(after)}; ownership diff over all views ${scanMs.toFixed(1)} ms`);
+  nodes = next;
+}
+
+change('join', [...nodes, node(NODES)]);
+change('leave', nodes.filter((n) => n.id !== 'ingest-3'));
+change('replace', [...nodes.filter((n) => n.id !== 'ingest-5'), node(NODES + 1)]);
@@ -0,0 +1,95 @@
+/**
+ * Cold-tier storage and range-read cost
+ *   npx tsx scripts/bench-compaction.ts            # synthetic device-year
+ *   BENCH_DB=1 npx tsx scripts/bench-compaction.ts # also measure the hot table in DATABASE_URL
+ * Encodes a year of one-minute readings as device-day segments and reports
+ * bytes per reading, storage per device-year and decode latency for 1/30-day
+ * range reads. With BENCH_DB, compares against the measurements table's
+ * on-disk size per row and a 30-day range query on it.
+ */
+import { encodeSegment, decodeSegment, ColdRow } from '../src/lib/columnar-segment';
+
+const DAYS = parseInt(process.env.BENCH_DAYS || '365');
+const PER_DAY = 1440;
+
+function syntheticDay(day: number): ColdRow[] {
+  const t0 = Date.UTC(2024, 0, 1) + day * 86_400_000;
+  return Array.from({ length: PER_DAY }, (_, i) => {
+    const iaq = Math.round((80 + 40 * Math.sin((i / PER_DAY) * 2 * Math.PI) + (Math.random() - 0.5) * 10) * 100) / 100;
+    const aqi = Math.round(Math.max(0, (iaq - 50) * 0.8));
+    return {
+      measuredAt: new Date(t0 + i * 60_000 + Math.floor(Math.random() * 300)),
+      mq135Raw: 1800 + Math.round(iaq * 3),
+      iaqScore: iaq,
+      co2Equiv: Math.round((400 + iaq * 2.5) * 10) / 10,
+      temperature: Math.round((24 + 4 * Math.sin((i / PER_DAY) * 2 * Math.PI)) * 100) / 100,
+      humidity: Math.round((55 + (Math.random() - 0.5) * 4) * 100) / 100,
+      pressureHpa: Math.round((1009 + (Math.random() - 0.5)) * 100) / 100,
+      altitudeM: 216,
+      pm25Estimated: null,
+      pm25Api: null,
+      pm10Api: null,
+      uvIndex: null,
+      aqiCalculated: aqi,
+      aqiCategory: aqi <= 50 ? 'good' : aqi <= 100 ? 'moderate' : 'unhealthy_for_sensitive_groups',
+      rssi: -60 - Math.floor(Math.random() * 10),
+      uptime: BigInt(day * 86_400_000 + i * 60_000),
+      qualityFlags: { sensor_warmed_up: true, dht22_valid: true, bmp180_valid: true, mq135_in_range: true, overall_valid: true, neighborhood_outlier: false },
+      externalData: {},
+    };
+  });
+}
+
+function time<T>(fn: () => T): [T, number] {
+  const started = process.hrtime.bigint();
+  const out = fn();
+  return [out, Number(process.hrtime.bigint() - started) / 1e6];
+}
+
+async function main() {
+  let bytes = 0;
+  let encodeMs = 0;
+  const segments: Buffer[] = [];
+  for (let d = 0; d < DAYS; d++) {
+    const rows = syntheticDay(d);
+    const [seg, ms] = time(() => encodeSegment(rows));
+    encodeMs += ms;
+    bytes += seg.length;
+    segments.push(seg);
+  }
+
+  // Round trip must be exact
+  const check = syntheticDay(0);
+  const decoded = decodeSegment(encodeSegment(check));
+  const exact = decoded.every((r, i) => r.iaqScore === check[i].iaqScore && r.measuredAt.getTime() === check[i].measuredAt.getTime());
+
+  const readings = DAYS * PER_DAY;
+  const [, oneDayMs] = time(() => decodeSegment(segments[0]));
+  const [, monthMs] = time(() => segments.slice(0, 30).forEach((s) => decodeSegment(s)));
+
+  console.log(`device-year: ${readings} readings in ${DAYS} segments, round trip exact=${exact}`);
+  console.log(`cold tier: ${(bytes / readings).toFixed(1)} B/reading, ${(bytes / 1024 / 1024).toFixed(2)} MB per device-year`);
+  console.log(`encode: ${(encodeMs / DAYS).toFixed(2)} ms/segment; decode 1 day: ${oneDayMs.toFixed(2)} ms, 30 days: ${monthMs.toFixed(1)} ms`);
+
+  if (!process.env.BENCH_DB) return;
+  const { db } = await import('../src/lib/db');
+  const [{ size, rows }] = await db.$queryRaw<{ size: bigint; rows: bigint }[]>`
+    SELECT pg_total_relation_size('measurements') AS size, (SELECT count(*) FROM measurements) AS rows`;
+  const perRow = Number(size) / Math.max(1, Number(rows));
+  console.log(`hot table: ${perRow.toFixed(0)} B/reading incl. indexes, ${((perRow * 525_600) / 1024 / 1024).toFixed(1)} MB per device-year`);
+
+  const device = await db.measurement.findFirst({ select: { deviceId: true }, orderBy: { measuredAt: 'desc' } });
+  if (device) {
+    const started = process.hrtime.bigint();
+    const hot = await db.measurement.findMany({
+      where: { deviceId: device.deviceId, measuredAt: { gte: new Date(Date.now() - 30 * 86_400_000) } },
+    });
+    console.log(`hot 30-day range query: ${hot.length} rows in ${(Number(process.hrtime.bigint() - started) / 1e6).toFixed(1)} ms`);
+  }
+  await db.$disconnect();
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,55 @@
+/**
+ * Replay filter throughput and false-positive rate
+ *   npx tsx scripts/bench-dedup.ts
+ * Feeds a day of fleet traffic through ReplayFilter, re-sends a fraction of it
+ * (as flushBuffer() does after a timed-out POST), then probes with never-seen
+ * keys to measure how often the exact DB check would run needlessly.
+ */
+import { ReplayFilter } from '../src/lib/dedup-filter';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '2000');
+const HOURS = parseInt(process.env.BENCH_HOURS || '24');
+const REPLAY_FRACTION = parseFloat(process.env.BENCH_REPLAY_FRACTION || '0.02');
+const PROBES = parseInt(process.env.BENCH_PROBES || '1000000');
+
+const filter = new ReplayFilter({
+  windowMs: 24 * 60 * 60 * 1000,
+  partitions: parseInt(process.env.DEDUP_PARTITIONS || '24'),
+  slotsPerPartition: parseInt(process.env.DEDUP_PARTITION_SLOTS || '131072'),
+}, 0);
+
+const ids = Array.from({ length: DEVICES }, (_, i) => `device-${i}`);
+let checks = 0;
+let replays = 0;
+let replaysCaught = 0;
+
+const started = process.hrtime.bigint();
+// One reading per device per minute
+for (let minute = 0; minute < HOURS * 60; minute++) {
+  const now = minute * 60_000;
+  for (let d = 0; d < DEVICES; d++) {
+    const key = ReplayFilter.key(ids[d], now, minute);
+    checks++;
+    filter.checkAndInsert(key, now);
+    if (Math.random() < REPLAY_FRACTION) {
+      replays++;
+      checks++;
+      if (filter.checkAndInsert(key, now + 30_000)) replaysCaught++;
+    }
+  }
+}
+const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+// Probe keys that were never inserted; every hit would be a wasted exact lookup
+const probeNow = HOURS * 60 * 60_000;
+const hitsBefore = filter.stats.hits;
+for (let i = 0; i < PROBES; i++) {
+  filter.checkAndInsert(ReplayFilter.key(`probe-${i}`, probeNow, i), probeNow);
+}
+const falsePositives = filter.stats.hits - hitsBefore;
+
+console.log(`devices=${DEVICES} simulated=${HOURS}h replay fraction=${REPLAY_FRACTION}`);
+console.log(`checks: ${Math.round(checks / seconds)} /s (${checks} in ${seconds.toFixed(2)}s)`);
+console.log(`replays caught: ${replaysCaught}/${replays}`);
+console.log(`false positives: ${falsePositives}/${PROBES} (${((falsePositives / PROBES) * 100).toFixed(4)}%)`);
+console.log(`memory: ${(filter.memoryBytes / 1024 / 1024).toFixed(2)} MB fixed, rotations=${filter.stats.rotations} saturations=${filter.stats.saturations}`);
@@ -0,0 +1,28 @@
+/**
+ * Downsampling throughput
+ *   npx tsx scripts/bench-downsample.ts
+ * Reduces a year of one-minute readings to chart size with LTTB and min/max buckets.
+ */
+import { lttb, minMaxBuckets } from '../src/lib/downsample';
+
+const N = parseInt(process.env.BENCH_POINTS || '525600');
+const TARGET = parseInt(process.env.BENCH_TARGET || '500');
+
+const xs = new Float64Array(N);
+const ys = new Float64Array(N);
+const t0 = Date.UTC(2024, 0, 1);
+for (let i = 0; i < N; i++) {
+  xs[i] = t0 + i * 60_000;
+  // Daily cycle, noise and occasional spikes
+  ys[i] = 80 + 30 * Math.sin((i / 1440) * 2 * Math.PI) + (Math.random() - 0.5) * 10 + (i % 9973 === 0 ? 200 : 0);
+}
+
+for (const [name, fn] of [['lttb', lttb], ['minmax', minMaxBuckets]] as const) {
+  fn(xs, ys, TARGET); // Warm up
+  const runs = 20;
+  const started = process.hrtime.bigint();
+  let out = 0;
+  for (let r = 0; r < runs; r++) out = fn(xs, ys, TARGET).length;
+  const ms = Number(process.hrtime.bigint() - started) / 1e6 / runs;
+  console.log(`${name}: ${N} -> ${out} points in ${ms.toFixed(2)} ms (${Math.round(N / ms / 1000)}M points/s)`);
+}
@@ -0,0 +1,532 @@
+/**
+ * End-to-end pipeline: simulated nodes to stored, queryable readings
+ *   npx tsx scripts/bench-e2e.ts                                   (starts the API on BENCH_PORT)
+ *   BENCH_API_URL=http://localhost:3000/api/v1 npx tsx scripts/bench-e2e.ts
+ * Needs DATABASE_URL. Bench devices (`bench-e2e-<n>`) are provisioned on first
+ * run and their readings deleted afterwards (BENCH_KEEP=true keeps them).
+ * Each simulated node runs the firmware loop: sample, serialize, HMAC sign,
+ * POST, with the offline ring buffer, 500 ms flush spacing and Retry-After
+ * backoff. The sampling interval is compressed (BENCH_INTERVAL_MS vs 60 s).
+ * Scenarios (BENCH_SCENARIOS):
+ *   steady  every node reports once per interval
+ *   flush   nodes go offline for BENCH_OFFLINE_INTERVALS, then all reconnect and flush at once
+ *   burst   every node reports BENCH_BURST_FACTOR x faster for the middle third of the run
+ *   alert   the flush outage plus BENCH_ALERTS_PER_NODE air-quality alerts per node while
+ *           online; nodes check every BENCH_ALERT_CHECK_MS and send alerts on the priority
+ *           path, ahead of sampling and of buffered records (firmware checkAlerts/sendAlerts)
+ *   alert-legacy  same alerts, reported only by the next regular reading (no priority path)
+ * Reports acked readings/s, latency from send to ack, to the live event
+ * (SSE /public/live) and to queryable in Postgres (sampled probes), client CPU
+ * per stage, and server CPU and RSS per reading when the server pid is known.
+ * Alert scenarios also report latency from alert onset to ack and to the live event.
+ */
+import { spawn, ChildProcess } from 'child_process';
+import crypto from 'crypto';
+import fs from 'fs';
+import http from 'http';
+import path from 'path';
+import { db } from '../src/lib/db';
+
+const NODES = parseInt(process.env.BENCH_NODES || '200');
+const DURATION_S = parseFloat(process.env.BENCH_DURATION_S || '30');
+const INTERVAL_MS = parseInt(process.env.BENCH_INTERVAL_MS || '1000');
+const FLUSH_SPACING_MS = parseInt(process.env.BENCH_FLUSH_SPACING_MS || '500');
+const OFFLINE_INTERVALS = parseInt(process.env.BENCH_OFFLINE_INTERVALS || '10');
+const BURST_FACTOR = parseFloat(process.env.BENCH_BURST_FACTOR || '10');
+const PROBE_EVERY = parseInt(process.env.BENCH_PROBE_EVERY || '20');
+const ALERTS_PER_NODE = parseInt(process.env.BENCH_ALERTS_PER_NODE || '3');
+// Firmware checks every 5 s against a 60 s sample interval; keep that ratio under compression
+const ALERT_CHECK_MS = parseInt(process.env.BENCH_ALERT_CHECK_MS || String(Math.max(1, Math.round(INTERVAL_MS / 12))));
+const SCENARIOS = (process.env.BENCH_SCENARIOS || 'steady,flush,burst,alert,alert-legacy').split(',');
+const PORT = parseInt(process.env.BENCH_PORT || '3901');
+const API = process.env.BENCH_API_URL || `http://127.0.0.1:${PORT}/api/v1`;
+const KEEP = process.env.BENCH_KEEP === 'true';
+const OFFLINE_BUFFER_SIZE = 50;
+const REQUEST_TIMEOUT_MS = 10_000;
+
+interface Device {
+  id: string;
+  deviceKey: string;
+}
+
+interface Reading {
+  body: string;
+  key: string; // deviceId|measuredAt, matches live events
+  sentAt: bigint;
+  offline?: boolean; // Buffered while the link was down
+  alert?: Alert;
+}
+
+interface Alert {
+  onset: bigint; // hrtime of the air-quality event, not of its detection
+  duringFlush: boolean; // Node had a backlog at onset
+}
+
+class Stats {
+  generated = 0;
+  acked = 0;
+  duplicates = 0;
+  throttled = 0;
+  rejected = 0;
+  failed = 0;
+  ackMs: number[] = [];
+  liveMs: number[] = [];
+  queryMs: number[] = [];
+  alerts = 0;
+  alertAckMs: number[] = [];
+  alertFlushAckMs: number[] = [];
+  alertLiveMs: number[] = [];
+  stageNs = { sample: 0n, serialize: 0n, sign: 0n };
+  maxBacklog = 0;
+  offlinePending = 0;
+  drainedAt = 0;
+}
+
+const sleep = (ms: number, wake?: Promise<void>) =>
+  new Promise<void>((resolve) => {
+    const t = setTimeout(resolve, Math.max(0, ms));
+    wake?.then(() => {
+      clearTimeout(t);
+      resolve();
+    });
+  });
+
+const pct = (values: number[], q: number) => {
+  if (values.length === 0) return '-';
+  const sorted = [...values].sort((a, b) => a - b);
+  return sorted[Math.min(sorted.length - 1, Math.floor(q * sorted.length))].toFixed(1);
+};
+
+// ---------------------------------------------------------------------------
+// Live events: one SSE stream, matched against readings in flight
+// ---------------------------------------------------------------------------
+const inFlight = new Map<string, { sentAt: bigint; stats: Stats; alert?: Alert }>();
+
+function openLiveStream(): Promise<http.ClientRequest> {
+  return new Promise((resolve, reject) => {
+    const req = http.get(`${API}/public/live`, (res) => {
+      let buf = '';
+      res.setEncoding('utf8');
+      res.on('data', (chunk: string) => {
+        buf += chunk;
+        let end: number;
+        while ((end = buf.indexOf('\n\n')) >= 0) {
+          const event = buf.slice(0, end);
+          buf = buf.slice(end + 2);
+          if (!event.startsWith('data: ')) continue;
+          const data = JSON.parse(event.slice(6));
+          const key = `${data.deviceId}|${data.measuredAt}`;
+          const pending = inFlight.get(key);
+          if (!pending) continue;
+          const now = process.hrtime.bigint();
+          pending.stats.liveMs.push(Number(now - pending.sentAt) / 1e6);
+          if (pending.alert) pending.stats.alertLiveMs.push(Number(now - pending.alert.onset) / 1e6);
+          inFlight.delete(key);
+        }
+      });
+      resolve(req);
+    });
+    req.on('error', reject);
+  });
+}
+
+// ---------------------------------------------------------------------------
+// Simulated node (firmware/src/main.cpp loop)
+// ---------------------------------------------------------------------------
+const ingestUrl = new URL(`${API}/ingest`);
+
+class SimNode {
+  private seq = 0;
+  private lastTs = 0;
+  private readonly bootId = crypto.randomBytes(4).toString('hex');
+  private readonly agent = new http.Agent({ keepAlive: true, maxSockets: 1 });
+  private buffer: Reading[] = [];
+  private backoffUntil = 0;
+  // Alerts: scheduled onsets, the priority queue, and detected-but-unsent onsets (legacy)
+  private onsets: number[] = [];
+  private priority: Reading[] = [];
+  private detected: Alert[] = [];
+  private fastPath = false;
+  private checkTimer: NodeJS.Timeout | null = null;
+  private alertWaiters: (() => void)[] = [];
+
+  constructor(readonly device: Device) {}
+
+  // Quick check every ALERT_CHECK_MS. With the fast path an onset becomes a compact alert
+  // on the priority queue at once; without it the next regular reading carries it.
+  startAlerts(onsets: number[], fastPath: boolean, stats: Stats) {
+    this.onsets = onsets.sort((a, b) => a - b);
+    this.fastPath = fastPath;
+    this.checkTimer = setInterval(() => {
+      while (this.onsets.length > 0 && this.onsets[0] <= Date.now()) {
+        const onsetMs = this.onsets.shift()!;
+        const alert = {
+          onset: process.hrtime.bigint() - BigInt(Math.round((Date.now() - onsetMs) * 1e6)),
+          duringFlush: this.buffer.length > 0,
+        };
+        stats.alerts++;
+        if (!fastPath) {
+          this.detected.push(alert);
+          continue;
+        }
+        this.priority.push(this.alertReading(alert, stats));
+        for (const wake of this.alertWaiters.splice(0)) wake();
+      }
+    }, ALERT_CHECK_MS);
+  }
+
+  stopAlerts() {
+    if (this.checkTimer) clearInterval(this.checkTimer);
+    this.checkTimer = null;
+    this.onsets = [];
+    this.priority = [];
+    this.detected = [];
+    for (const wake of this.alertWaiters.splice(0)) wake();
+  }
+
+  // Resolves when the next alert is queued (fast path only)
+  alertQueued(): Promise<void> | undefined {
+    if (!this.fastPath || !this.checkTimer) return undefined;
+    return new Promise((resolve) => this.alertWaiters.push(resolve));
+  }
+
+  private sign(payload: object): string {
+    const unsigned = JSON.stringify(payload);
+    const signature = crypto.createHmac('sha256', this.device.deviceKey).update(unsigned).digest('hex');
+    return `${unsigned.slice(0, -1)},"signature":"${signature}"}`;
+  }
+
+  // Compact priority payload (firmware transmitAlert)
+  private alertReading(alert: Alert, stats: Stats): Reading {
+    const ts = (this.lastTs = Math.max(Date.now(), this.lastTs + 1));
+    const body = this.sign({
+      device_id: this.device.id,
+      timestamp: ts,
+      sensors: { iaq_score: 162.5, co2_equiv: 1240 },
+      meta: { boot_id: this.bootId, seq: this.seq++, alert: 'category:POOR' },
+    });
+    stats.generated++;
+    return { body, key: `${this.device.id}|${new Date(ts).toISOString()}`, sentAt: 0n, alert };
+  }
+
+  async sendAlerts(stats: Stats, online: boolean) {
+    while (this.priority.length > 0 && online && Date.now() >= this.backoffUntil) {
+      if (!(await this.post(this.priority[0], stats))) return;
+      this.priority.shift();
+    }
+  }
+
+  sample(stats: Stats): Reading {
+    const t0 = process.hrtime.bigint();
+    // Unique ms timestamps per device so each reading has its own measuredAt
+    const ts = (this.lastTs = Math.max(Date.now(), this.lastTs + 1));
+    const phase = (ts / 3_600_000) % 24;
+    const sensors = {
+      mq135_raw: Math.round((70 + 8 * Math.sin(phase) + Math.random() * 2) * 100) / 100,
+      iaq_score: Math.round((90 + 40 * Math.sin(phase) + Math.random() * 5) * 100) / 100,
+      co2_equiv: Math.round((600 + Math.random() * 40) * 100) / 100,
+      temperature: Math.round((27 + Math.random()) * 100) / 100,
+      humidity: Math.round((54 + Math.random() * 3) * 100) / 100,
+      pressure_hpa: 1008.7,
+      altitude_m: 216.5,
+    };
+    const t1 = process.hrtime.bigint();
+    const payload = {
+      device_id: this.device.id,
+      firmware_version: 'BENCH-E2E',
+      timestamp: ts,
+      sensors,
+      meta: { uptime_ms: ts, rssi: -61, free_heap: 182344, boot_id: this.bootId, seq: this.seq++ },
+    };
+    const unsigned = JSON.stringify(payload);
+    const t2 = process.hrtime.bigint();
+    const signature = crypto.createHmac('sha256', this.device.deviceKey).update(unsigned).digest('hex');
+    const body = `${unsigned.slice(0, -1)},"signature":"${signature}"}`;
+    const t3 = process.hrtime.bigint();
+    // Without the priority path an alert is first reported by the next regular reading
+    const alert = this.detected.shift();
+    stats.stageNs.sample += t1 - t0;
+    stats.stageNs.serialize += t2 - t1;
+    stats.stageNs.sign += t3 - t2;
+    stats.generated++;
+    return { body, key: `${this.device.id}|${new Date(ts).toISOString()}`, sentAt: 0n, alert };
+  }
+
+  private post(reading: Reading, stats: Stats): Promise<boolean> {
+    reading.sentAt = process.hrtime.bigint();
+    inFlight.set(reading.key, { sentAt: reading.sentAt, stats, alert: reading.alert });
+    return new Promise((resolve) => {
+      const req = http.request(
+        ingestUrl,
+        { method: 'POST', agent: this.agent, headers: { 'Content-Type': 'application/json' }, timeout: REQUEST_TIMEOUT_MS },
+        (res) => {
+          let text = '';
+          res.setEncoding('utf8');
+          res.on('data', (c) => (text += c));
+          res.on('end', () => {
+            const status = res.statusCode ?? 0;
+            if (status === 200 || status === 201) {
+              const now = process.hrtime.bigint();
+              stats.ackMs.push(Number(now - reading.sentAt) / 1e6);
+              if (reading.alert) {
+                const ms = Number(now - reading.alert.onset) / 1e6;
+                stats.alertAckMs.push(ms);
+                if (reading.alert.duringFlush) stats.alertFlushAckMs.push(ms);
+              }
+              if (status === 200) {
+                // Duplicates are not re-published live
+                stats.duplicates++;
+                inFlight.delete(reading.key);
+              } else if (++stats.acked % PROBE_EVERY === 0) probe(JSON.parse(text).measurement_id, reading.sentAt, stats);
+              resolve(true);
+              return;
+            }
+            inFlight.delete(reading.key);
+            if (status === 429 || status === 503) {
+              stats.throttled++;
+              const retryAfter = parseInt(String(res.headers['retry-after'] ?? '30'));
+              this.backoffUntil = Date.now() + retryAfter * 1000;
+            } else {
+              stats.rejected++;
+            }
+            resolve(false);
+          });
+        }
+      );
+      req.on('timeout', () => req.destroy(new Error('timeout')));
+      req.on('error', () => {
+        inFlight.delete(reading.key);
+        stats.failed++;
+        resolve(false);
+      });
+      req.end(reading.body);
+    });
+  }
+
+  private bufferData(reading: Reading, stats: Stats, online: boolean) {
+    if (this.buffer.length >= OFFLINE_BUFFER_SIZE && this.buffer.shift()!.offline) stats.offlinePending--;
+    if (!online) {
+      reading.offline = true;
+      stats.offlinePending++;
+    }
+    this.buffer.push(reading);
+    stats.maxBacklog = Math.max(stats.maxBacklog, this.buffer.length);
+  }
+
+  // One loop iteration: priority alerts, sample, transmit or buffer, flush the buffer after a success
+  async tick(stats: Stats, online: boolean) {
+    await this.sendAlerts(stats, online);
+    const reading = this.sample(stats);
+    const sent = online && Date.now() >= this.backoffUntil && (await this.post(reading, stats));
+    if (!sent) {
+      this.bufferData(reading, stats, online);
+      return;
+    }
+    while (this.buffer.length > 0 && online && Date.now() >= this.backoffUntil) {
+      // Alerts raised during the flush go before the next buffered record
+      await this.sendAlerts(stats, online);
+      if (!(await this.post(this.buffer[0], stats))) break;
+      if (this.buffer.shift()!.offline && --stats.offlinePending === 0) stats.drainedAt = Date.now();
+      // Flush spacing, during which a new alert still goes out at once
+      const until = Date.now() + FLUSH_SPACING_MS;
+      while (Date.now() < until) {
+        await sleep(until - Date.now(), this.alertQueued());
+        await this.sendAlerts(stats, online);
+      }
+    }
+  }
+}
+
+// Queryable: poll Postgres for the acked id
+async function probe(id: string, sentAt: bigint, stats: Stats) {
+  const deadline = Date.now() + 30_000;
+  while (Date.now() < deadline) {
+    const found = await db.measurement.findUnique({ where: { id }, select: { id: true } });
+    if (found) {
+      stats.queryMs.push(Number(process.hrtime.bigint() - sentAt) / 1e6);
+      return;
+    }
+    await sleep(10);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Server under test
+// ---------------------------------------------------------------------------
+function procCpuMs(pid: number): number {
+  const fields = fs.readFileSync(`/proc/${pid}/stat`, 'utf8').split(') ')[1].split(' ');
+  return ((Number(fields[11]) + Number(fields[12])) * 1000) / 100; // utime + stime, 100 Hz ticks
+}
+
+function procRssMb(pid: number): number {
+  const match = /VmRSS:\s+(\d+)/.exec(fs.readFileSync(`/proc/${pid}/status`, 'utf8'));
+  return match ? Number(match[1]) / 1024 : 0;
+}
+
+async function startServer(): Promise<ChildProcess> {
+  const server = spawn(process.execPath, ['--import', 'tsx', 'src/index.ts'], {
+    cwd: path.join(__dirname, '..'),
+    env: {
+      ...process.env,
+      PORT: String(PORT),
+      SERVER_WORKERS: '1',
+      ENABLE_JOBS: 'false',
+      ENABLE_TELEGRAM: 'false',
+      MQTT_URL: '',
+      LOG_LEVEL: 'warn',
+      // Admission sized for the compressed cadence (plus burst and flush headroom)
+      INGEST_DEVICE_BURST: String(OFFLINE_BUFFER_SIZE * 2),
+      INGEST_DEVICE_RATE_PER_MIN: String(Math.ceil((60_000 / INTERVAL_MS) * BURST_FACTOR * 2)),
+    },
+    stdio: ['ignore', 'inherit', 'inherit'],
+  });
+  const deadline = Date.now() + 30_000;
+  while (Date.now() < deadline) {
+    const up = await new Promise<boolean>((resolve) =>
+      http
+        .get(`${API}/public/openapi.yaml`, (res) => {
+          res.resume();
+          resolve(true);
+        })
+        .on('error', () => resolve(false))
+    );
+    if (up) return server;
+    await sleep(250);
+  }
+  server.kill();
+  throw new Error('API did not start');
+}
+
+async function provision(): Promise<Device[]> {
+  const existing = await db.device.findMany({ where: { name: { startsWith: 'bench-e2e-' } }, select: { id: true, name: true, deviceKey: true } });
+  const byName = new Map(existing.map((d) => [d.name, d]));
+  const devices: Device[] = [];
+  for (let i = 0; i < NODES; i++) {
+    const name = `bench-e2e-${i}`;
+    let device = byName.get(name);
+    if (!device) {
+      device = await db.device.create({
+        data: { name, deviceKey: crypto.randomBytes(24).toString('base64url'), areaName: 'bench-e2e', active: true },
+        select: { id: true, name: true, deviceKey: true },
+      });
+    }
+    devices.push({ id: device.id, deviceKey: device.deviceKey });
+  }
+  return devices;
+}
+
+// ---------------------------------------------------------------------------
+// Scenarios
+// ---------------------------------------------------------------------------
+async function runScenario(name: string, nodes: SimNode[], serverPid: number | null) {
+  const stats = new Stats();
+  const durationMs = DURATION_S * 1000;
+  const startedAt = new Date();
+  const start = Date.now();
+  const cpuBefore = serverPid ? procCpuMs(serverPid) : 0;
+  const clientCpuBefore = process.cpuUsage();
+
+  // Scenario shape as a function of elapsed time
+  const offlineFrom = durationMs / 3;
+  const offlineUntil = offlineFrom + OFFLINE_INTERVALS * INTERVAL_MS;
+  const withOutage = name === 'flush' || name.startsWith('alert');
+  const online = (t: number) => !withOutage || t < offlineFrom || t >= offlineUntil;
+  const interval = (t: number) => (name === 'burst' && t >= durationMs / 3 && t < (2 * durationMs) / 3 ? INTERVAL_MS / BURST_FACTOR : INTERVAL_MS);
+
+  // Everyone wakes at once when the link comes back (mass reconnect)
+  let reconnect!: () => void;
+  const reconnected = new Promise<void>((r) => (reconnect = r));
+  const reconnectTimer = withOutage ? setTimeout(reconnect, offlineUntil) : null;
+
+  // Alert onsets while the node is online, uniformly over the run (some land in the drain)
+  if (name.startsWith('alert')) {
+    const onlineMs = durationMs - (offlineUntil - offlineFrom);
+    for (const node of nodes) {
+      const onsets = Array.from({ length: ALERTS_PER_NODE }, () => {
+        const t = Math.random() * onlineMs;
+        return start + (t < offlineFrom ? t : t + (offlineUntil - offlineFrom));
+      });
+      node.startAlerts(onsets, name === 'alert', stats);
+    }
+  }
+
+  await Promise.all(
+    nodes.map(async (node, i) => {
+      // Staggered first sample, like nodes booted at different times
+      await sleep((i / nodes.length) * INTERVAL_MS);
+      while (Date.now() - start < durationMs) {
+        const tickStart = Date.now();
+        const t = tickStart - start;
+        const wasOffline = !online(t);
+        await node.tick(stats, online(t));
+        // Idle until the next sample; a priority alert wakes the node early
+        const nextTick = tickStart + interval(t);
+        while (Date.now() < nextTick) {
+          const alertQueued = node.alertQueued();
+          const wake = wasOffline ? (alertQueued ? Promise.race([reconnected, alertQueued]) : reconnected) : alertQueued;
+          await sleep(nextTick - Date.now(), wake);
+          const nowOnline = online(Date.now() - start);
+          if (wasOffline && nowOnline) break;
+          await node.sendAlerts(stats, nowOnline);
+        }
+      }
+    })
+  );
+  for (const node of nodes) node.stopAlerts();
+  const wallS = (Date.now() - start) / 1000;
+  if (reconnectTimer) clearTimeout(reconnectTimer);
+
+  // Let live events and probes settle
+  const settle = Date.now() + 5000;
+  while (inFlight.size > 0 && Date.now() < settle) await sleep(50);
+  await sleep(1000);
+
+  const serverCpuMs = serverPid ? procCpuMs(serverPid) - cpuBefore : 0;
+  const clientCpu = process.cpuUsage(clientCpuBefore);
+  const stored = await db.measurement.count({ where: { deviceId: { in: nodes.map((n) => n.device.id) }, measuredAt: { gte: startedAt } } });
+  const us = (ns: bigint) => (Number(ns) / 1000 / Math.max(1, stats.generated)).toFixed(2);
+
+  console.log(`\n${name}: ${nodes.length} nodes, ${wallS.toFixed(1)} s, interval ${INTERVAL_MS} ms${name === 'burst' ? `, ${BURST_FACTOR}x burst` : ''}`);
+  console.log(`  generated ${stats.generated}, acked ${stats.acked} (${Math.round(stats.acked / wallS)}/s), stored ${stored}, duplicates ${stats.duplicates}, throttled ${stats.throttled}, rejected ${stats.rejected}, failed ${stats.failed}`);
+  console.log(`  send->ack p50 ${pct(stats.ackMs, 0.5)} ms p99 ${pct(stats.ackMs, 0.99)} ms | ->live p50 ${pct(stats.liveMs, 0.5)} ms p99 ${pct(stats.liveMs, 0.99)} ms | ->queryable p50 ${pct(stats.queryMs, 0.5)} ms p99 ${pct(stats.queryMs, 0.99)} ms (${stats.queryMs.length} probes)`);
+  if (withOutage) {
+    const drain = stats.drainedAt ? `${((stats.drainedAt - start - offlineUntil) / 1000).toFixed(1)} s` : 'not within the run';
+    console.log(`  offline ${OFFLINE_INTERVALS} intervals, peak backlog ${stats.maxBacklog}/node, offline readings all delivered ${drain} after reconnect`);
+  }
+  if (name.startsWith('alert')) {
+    const path = name === 'alert' ? `priority path, checked every ${ALERT_CHECK_MS} ms` : 'next regular reading';
+    console.log(`  alerts ${stats.alerts} (${path}): onset->ack p50 ${pct(stats.alertAckMs, 0.5)} ms p99 ${pct(stats.alertAckMs, 0.99)} ms | onset->live p50 ${pct(stats.alertLiveMs, 0.5)} ms p99 ${pct(stats.alertLiveMs, 0.99)} ms | during a flush (${stats.alertFlushAckMs.length}): onset->ack p50 ${pct(stats.alertFlushAckMs, 0.5)} ms p99 ${pct(stats.alertFlushAckMs, 0.99)} ms`);
+  }
+  console.log(`  node CPU/reading: sample ${us(stats.stageNs.sample)} µs, serialize ${us(stats.stageNs.serialize)} µs, sign ${us(stats.stageNs.sign)} µs; bench process ${((clientCpu.user + clientCpu.system) / 1000 / wallS).toFixed(0)} ms CPU/s`);
+  if (serverPid) {
+    const perReading = (serverCpuMs * 1000) / Math.max(1, stats.acked + stats.duplicates);
+    console.log(`  server CPU ${perReading.toFixed(0)} µs/reading (${(serverCpuMs / 1000 / wallS).toFixed(2)} cores), rss ${procRssMb(serverPid).toFixed(0)} MB`);
+  }
+}
+
+async function main() {
+  const devices = await provision();
+  let server: ChildProcess | null = null;
+  let serverPid = process.env.BENCH_SERVER_PID ? parseInt(process.env.BENCH_SERVER_PID) : null;
+  if (!process.env.BENCH_API_URL) {
+    server = await startServer();
+    serverPid = server.pid ?? null;
+  }
+  console.log(`API ${API}, ${NODES} nodes, scenarios ${SCENARIOS.join(', ')}`);
+
+  const live = await openLiveStream();
+  const nodes = devices.map((d) => new SimNode(d));
+  try {
+    for (const scenario of SCENARIOS) await runScenario(scenario, nodes, serverPid);
+  } finally {
+    live.destroy();
+    if (!KEEP) await db.measurement.deleteMany({ where: { deviceId: { in: devices.map((d) => d.id) } } });
+    server?.kill('SIGTERM');
+    await db.$disconnect();
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
@@ -0,0 +1,75 @@
+/**
+ * CSV export throughput
+ *   npx tsx scripts/bench-export.ts            # formatter only, synthetic rows
+ *   BENCH_DB=1 npx tsx scripts/bench-export.ts # full streamed export from DATABASE_URL
+ * Compares page formatting against the previous map().join() build and, with
+ * BENCH_DB, reports end-to-end MB/s and peak RSS for a streamed export.
+ */
+import { formatCsvRows, streamMeasurementsCsv, ExportRow } from '../src/lib/csv-export';
+import { db } from '../src/lib/db';
+
+const ROWS = parseInt(process.env.BENCH_ROWS || '500000');
+const PAGE = 5000;
+
+function syntheticRows(n: number): ExportRow[] {
+  const t0 = Date.UTC(2024, 0, 1);
+  return Array.from({ length: n }, (_, i) => ({
+    id: `m-${i}`,
+    measuredAt: new Date(t0 + i * 60_000),
+    deviceId: `device-${i % 50}`,
+    iaqScore: 50 + (i % 200) * 0.37,
+    co2Equiv: 400 + (i % 900) * 1.13,
+    temperature: 20 + (i % 100) / 7,
+    humidity: 40 + (i % 50) / 3,
+    pressureHpa: 1000 + (i % 30) / 9,
+    pm25Api: i % 5 === 0 ? null : 12.5 + (i % 40) / 11,
+    aqiCalculated: 40 + (i % 150),
+    aqiCategory: 'moderate',
+  }));
+}
+
+function legacyCsv(rows: ExportRow[]): string {
+  return rows
+    .map((m) => [
+      m.measuredAt.toISOString(), m.deviceId, m.iaqScore ?? '', m.co2Equiv ?? '', m.temperature ?? '',
+      m.humidity ?? '', m.pressureHpa ?? '', m.pm25Api ?? '', m.aqiCalculated ?? '', m.aqiCategory ?? '',
+    ].join(','))
+    .join('\n');
+}
+
+function time(label: string, fn: () => number) {
+  const started = process.hrtime.bigint();
+  const bytes = fn();
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  console.log(`${label}: ${Math.round(ROWS / seconds)} rows/s, ${(bytes / 1024 / 1024 / seconds).toFixed(1)} MB/s`);
+}
+
+async function main() {
+  if (!process.env.BENCH_DB) {
+    const rows = syntheticRows(ROWS);
+    time('legacy map/join', () => legacyCsv(rows).length);
+    time('paged formatter', () => {
+      let bytes = 0;
+      for (let i = 0; i < rows.length; i += PAGE) bytes += formatCsvRows(rows.slice(i, i + PAGE)).length;
+      return bytes;
+    });
+    return;
+  }
+
+  let bytes = 0;
+  let peakRss = 0;
+  const started = process.hrtime.bigint();
+  for await (const chunk of streamMeasurementsCsv({})) {
+    bytes += Buffer.byteLength(chunk);
+    peakRss = Math.max(peakRss, process.memoryUsage().rss);
+  }
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  console.log(`streamed ${(bytes / 1024 / 1024).toFixed(1)} MB in ${seconds.toFixed(2)}s ` +
+    `(${(bytes / 1024 / 1024 / seconds).toFixed(1)} MB/s), peak RSS ${(peakRss / 1024 / 1024).toFixed(0)} MB`);
+  await db.$disconnect();
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
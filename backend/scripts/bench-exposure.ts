@@ -0,0 +1,30 @@
+/**
+ * Fleet exposure analytics throughput
+ *   npx tsx scripts/bench-exposure.ts
+ * Computes a week of exposure metrics for every device (one-minute readings)
+ * and reports points/s; the health job does this once per device, not per subscriber.
+ */
+import { computeExposure } from '../src/lib/exposure';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '1000');
+const MINUTES = 7 * 24 * 60;
+
+const t0 = Date.UTC(2024, 0, 1);
+const ts = new Float64Array(MINUTES);
+for (let i = 0; i < MINUTES; i++) ts[i] = t0 + i * 60_000;
+const series = Array.from({ length: DEVICES }, (_, d) => {
+  const aqi = new Float64Array(MINUTES);
+  const base = 50 + (d % 40) * 3;
+  for (let i = 0; i < MINUTES; i++) aqi[i] = base + 40 * Math.sin((i / 1440) * 2 * Math.PI) + (Math.random() - 0.5) * 20;
+  return aqi;
+});
+
+const started = process.hrtime.bigint();
+let unhealthyHours = 0;
+for (const aqi of series) unhealthyHours += computeExposure(ts, aqi)!.hoursAbove[100];
+const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+const points = DEVICES * MINUTES;
+console.log(`devices=${DEVICES} points=${points} (7 days @ 1/min)`);
+console.log(`fleet week in ${(seconds * 1000).toFixed(0)} ms: ${Math.round(points / seconds / 1e6)}M points/s`);
+console.log(`mean hours above 100: ${(unhealthyHours / DEVICES).toFixed(1)}`);
@@ -0,0 +1,42 @@
+/**
+ * Holt-Winters fit/update/predict cost per device
+ *   npx tsx scripts/bench-forecast.ts
+ * Fits a week of hourly AQI for many devices, then applies one new hour
+ * incrementally (what the forecaster job does on later runs) and predicts 24 h.
+ */
+import { fitHoltWinters, updateState, forecastHoltWinters, rmse, HourlySeries } from '../src/lib/holt-winters';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '5000');
+const HOURS = 7 * 24;
+const startHour = Math.floor(Date.UTC(2024, 0, 1) / 3_600_000);
+
+function seriesFor(d: number, hours: number): HourlySeries {
+  const base = 60 + (d % 30) * 4;
+  const out: HourlySeries = { hours: [], values: [] };
+  for (let i = 0; i < hours; i++) {
+    out.hours.push(startHour + i);
+    out.values.push(base + 25 * Math.sin(((i % 24) / 24) * 2 * Math.PI) + (Math.random() - 0.5) * 10);
+  }
+  return out;
+}
+
+const data = Array.from({ length: DEVICES }, (_, d) => seriesFor(d, HOURS + 1));
+
+let started = process.hrtime.bigint();
+const states = data.map((s) => fitHoltWinters({ hours: s.hours.slice(0, HOURS), values: s.values.slice(0, HOURS) })!);
+const fitMs = Number(process.hrtime.bigint() - started) / 1e6;
+
+started = process.hrtime.bigint();
+states.forEach((st, d) => updateState(st, data[d].hours[HOURS], data[d].values[HOURS]));
+const updateMs = Number(process.hrtime.bigint() - started) / 1e6;
+
+started = process.hrtime.bigint();
+states.forEach((st) => forecastHoltWinters(st, 24));
+const predictMs = Number(process.hrtime.bigint() - started) / 1e6;
+
+const meanRmse = states.reduce((a, st) => a + rmse(st), 0) / DEVICES;
+console.log(`devices=${DEVICES} history=${HOURS}h`);
+console.log(`full fit:    ${(fitMs / DEVICES).toFixed(3)} ms/device (${fitMs.toFixed(0)} ms total)`);
+console.log(`incremental: ${((updateMs / DEVICES) * 1000).toFixed(2)} us/device`);
+console.log(`predict 24h: ${((predictMs / DEVICES) * 1000).toFixed(2)} us/device`);
+console.log(`one-step RMSE: ${meanRmse.toFixed(2)} AQI (noise amplitude 5)`);
@@ -0,0 +1,111 @@
+/**
+ * Ingest decode/normalize benchmark
+ *   npx tsx scripts/bench-ingest.ts
+ * Compares the firmware-shape fast path with the generic zod + num() path, and the
+ * single-call ingest core with the per-step normalization the route used to do.
+ */
+import crypto from 'crypto';
+import type { Device } from '@prisma/client';
+import { decodePayload, decodeGeneric } from '../src/lib/payload';
+import { normalizeIngest } from '../src/lib/ingest-core';
+import { verifyHMAC } from '../src/lib/hmac';
+import { calculateAQI, getAQICategory } from '../src/lib/aqi';
+
+const ITERATIONS = parseInt(process.env.BENCH_ITERATIONS || '200000');
+
+const DEVICE = {
+  id: 'a3f1c2d4-5b6e-4f70-8a9b-0c1d2e3f4a5b',
+  deviceKey: 'kGj3@z7P!qT9$L8rVb2mXyW4sN6fC1eH',
+  altitude: null,
+  firmwareVersion: '1.2.0',
+} as unknown as Device;
+
+function sign(message: string): string {
+  return crypto.createHmac('sha256', DEVICE.deviceKey).update(message).digest('hex');
+}
+
+function firmwarePayload(seq: number): string {
+  const payload = {
+    device_id: 'a3f1c2d4-5b6e-4f70-8a9b-0c1d2e3f4a5b',
+    firmware_version: '1.2.0',
+    timestamp: 1760000000 + seq * 60,
+    sensors: {
+      mq135_raw: 71.42 + (seq % 7),
+      iaq_score: 88.5 + (seq % 13),
+      co2_equiv: 612.3,
+      temperature: 27.41,
+      humidity: 54.2,
+      pressure_hpa: 1008.7,
+      altitude_m: 216.5,
+    },
+    meta: { uptime_ms: 3600000 + seq, rssi: -61, free_heap: 182344, boot_id: '9f2c01ab', seq },
+  };
+  return JSON.stringify({ ...payload, signature: sign(JSON.stringify(payload)) });
+}
+
+function legacyPayload(seq: number): string {
+  return JSON.stringify({
+    deviceId: 'a3f1c2d4-5b6e-4f70-8a9b-0c1d2e3f4a5b',
+    timestamp: String(1760000000 + seq * 60),
+    iaq: `${88 + (seq % 13)} IAQ`,
+    temperature: '27.4 °C',
+    humidity: '54 %',
+    pressure: '1008.7 hPa',
+  });
+}
+
+function bench(name: string, payloads: string[], decode: (body: unknown) => unknown) {
+  const bytes = payloads.reduce((n, p) => n + Buffer.byteLength(p), 0);
+  // Warm up JIT
+  for (let i = 0; i < 10000; i++) decode(JSON.parse(payloads[i % payloads.length]));
+
+  const started = process.hrtime.bigint();
+  let sink = 0;
+  for (let i = 0; i < ITERATIONS; i++) {
+    const d = decode(JSON.parse(payloads[i % payloads.length])) as any;
+    sink += d.iaq ?? 0;
+  }
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  const mbps = ((bytes / payloads.length) * ITERATIONS) / seconds / 1e6;
+  console.log(
+    `${name.padEnd(28)} ${Math.round(ITERATIONS / seconds).toString().padStart(9)} payloads/s ` +
+      `${mbps.toFixed(1).padStart(7)} MB/s  (${(seconds * 1e9 / ITERATIONS).toFixed(0)} ns/payload, sink=${sink > 0})`
+  );
+}
+
+// The per-request normalization steps the route performed before the ingest core
+function legacyNormalize(raw: unknown) {
+  const body = decodeGeneric(raw);
+  if (body.signature && !verifyHMAC(body.signedPayload(), body.signature, DEVICE.deviceKey)) throw new Error('bad signature');
+  let aqi: number | null = null;
+  if (body.pm25 !== null) aqi = calculateAQI(body.pm25, 'pm25');
+  else if (body.iaq !== null) aqi = calculateAQI(Math.max(0, (body.iaq - 50) * 0.5), 'pm25');
+  const category = aqi !== null ? getAQICategory(aqi).name.toLowerCase().replace(/\s+/g, '_') : null;
+  return { iaq: body.iaq, aqi, category };
+}
+
+async function benchAsync(name: string, payloads: string[], normalize: (body: unknown) => Promise<unknown> | unknown) {
+  for (let i = 0; i < 10000; i++) await normalize(JSON.parse(payloads[i % payloads.length]));
+  const started = process.hrtime.bigint();
+  for (let i = 0; i < ITERATIONS; i++) await normalize(JSON.parse(payloads[i % payloads.length]));
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  console.log(`${name.padEnd(28)} ${Math.round(ITERATIONS / seconds).toString().padStart(9)} req/s (CPU-only, no DB/network)`);
+}
+
+const firmware = Array.from({ length: 1024 }, (_, i) => firmwarePayload(i));
+const legacy = Array.from({ length: 1024 }, (_, i) => legacyPayload(i));
+
+console.log(`Decode benchmark (${ITERATIONS} iterations, JSON.parse included)`);
+bench('firmware / fast path', firmware, decodePayload);
+bench('firmware / generic path', firmware, decodeGeneric);
+bench('legacy flat / fallback', legacy, decodePayload);
+
+(async () => {
+  console.log(`\nNormalize benchmark (decode + HMAC verify + AQI)`);
+  await benchAsync('route steps (before)', firmware, legacyNormalize);
+  await benchAsync('ingest core', firmware, (body) =>
+    normalizeIngest(body, () => DEVICE).then((r) => {
+      if (!r.ok) throw new Error(r.error);
+    })
+  );
+})();
@@ -0,0 +1,137 @@
+/**
+ * MQTT ingest bridge throughput against a local broker
+ *   BENCH_MQTT_URL=mqtt://localhost:1883 npx tsx scripts/bench-mqtt.ts
+ * Publishers send signed firmware-shape readings for a simulated fleet at
+ * QoS 1 on per-device topics; consumers join one shared subscription (as the
+ * bridge does in each worker), process per device in order through the ingest
+ * CPU path (decode, HMAC verify, AQI; no DB write) and ack. Reports
+ * messages/s, per-message latency, ordering violations within a consumer and
+ * how many devices the broker split across consumers.
+ */
+import crypto from 'crypto';
+import type { Device } from '@prisma/client';
+import { MqttClient, MqttMessage } from '../src/lib/mqtt-client';
+import { normalizeIngest } from '../src/lib/ingest-core';
+
+const URL = process.env.BENCH_MQTT_URL || 'mqtt://localhost:1883';
+const MESSAGES = parseInt(process.env.BENCH_MESSAGES || '50000');
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '500');
+const PUBLISHERS = parseInt(process.env.BENCH_PUBLISHERS || '4');
+const CONSUMERS = parseInt(process.env.BENCH_CONSUMERS || '2');
+const WINDOW = parseInt(process.env.BENCH_PUBLISH_WINDOW || '200');
+const TOPIC = `aeroguard/bench-${process.pid}`;
+const DEVICE_KEY = 'kGj3@z7P!qT9$L8rVb2mXyW4sN6fC1eH';
+
+const devices = Array.from({ length: DEVICES }, (_, i) => ({
+  id: `bench-device-${i}`,
+  deviceKey: DEVICE_KEY,
+  altitude: null,
+  firmwareVersion: '1.2.0',
+})) as unknown as Device[];
+const byId = new Map(devices.map((d) => [d.id, d]));
+
+function reading(device: number, seq: number): string {
+  const payload = {
+    device_id: devices[device].id,
+    firmware_version: '1.2.0',
+    timestamp: 1760000000 + seq * 60,
+    sensors: { mq135_raw: 71.4, iaq_score: 88.5 + (seq % 13), co2_equiv: 612.3, temperature: 27.41, humidity: 54.2, pressure_hpa: 1008.7, altitude_m: 216.5 },
+    meta: { uptime_ms: 3600000 + seq, rssi: -61, free_heap: 182344, boot_id: '9f2c01ab', seq, sent_ns: '' },
+  };
+  payload.meta.sent_ns = process.hrtime.bigint().toString();
+  const signature = crypto.createHmac('sha256', DEVICE_KEY).update(JSON.stringify(payload)).digest('hex');
+  return JSON.stringify({ ...payload, signature });
+}
+
+function connected(client: MqttClient): Promise<void> {
+  return new Promise((resolve) => {
+    client.once('connect', resolve);
+    client.connect();
+  });
+}
+
+async function main() {
+  const consumerOf = new Map<string, Set<number>>();
+  const latenciesUs: number[] = [];
+  let processed = 0;
+  let invalid = 0;
+  let outOfOrder = 0;
+  let resolveDone: () => void;
+  const done = new Promise<void>((r) => (resolveDone = r));
+
+  // Consumers: same structure as services/mqtt-bridge.ts
+  const consumers: MqttClient[] = [];
+  for (let c = 0; c < CONSUMERS; c++) {
+    const client = new MqttClient({ url: URL, clientId: `bench-consumer-${process.pid}-${c}` });
+    const chains = new Map<string, Promise<void>>();
+    const lastSeq = new Map<string, number>();
+    client.on('message', (msg: MqttMessage) => {
+      const body = JSON.parse(msg.payload.toString('utf8'));
+      const deviceId = body.device_id as string;
+      const next = (chains.get(deviceId) ?? Promise.resolve()).then(async () => {
+        const result = await normalizeIngest(body, (id) => byId.get(id) ?? null);
+        if (!result.ok) invalid++;
+        const prev = lastSeq.get(deviceId) ?? -1;
+        if (body.meta.seq < prev) outOfOrder++;
+        lastSeq.set(deviceId, Math.max(prev, body.meta.seq));
+        if (!consumerOf.has(deviceId)) consumerOf.set(deviceId, new Set());
+        consumerOf.get(deviceId)!.add(c);
+        latenciesUs.push(Number(process.hrtime.bigint() - BigInt(body.meta.sent_ns)) / 1000);
+        msg.ack();
+        if (++processed === MESSAGES) resolveDone();
+      });
+      chains.set(deviceId, next);
+      next.finally(() => {
+        if (chains.get(deviceId) === next) chains.delete(deviceId);
+      });
+    });
+    client.subscribe(CONSUMERS > 1 ? `$share/bench/${TOPIC}/+` : `${TOPIC}/+`, 1);
+    await connected(client);
+    consumers.push(client);
+  }
+  // Let SUBACKs land before publishing
+  await new Promise((r) => setTimeout(r, 200));
+
+  const publishers = await Promise.all(
+    Array.from({ length: PUBLISHERS }, async (_, p) => {
+      const client = new MqttClient({ url: URL, clientId: `bench-publisher-${process.pid}-${p}` });
+      await connected(client);
+      return client;
+    })
+  );
+
+  const started = process.hrtime.bigint();
+  // Each publisher owns a slice of the fleet and sends its readings in seq order per device
+  await Promise.all(
+    publishers.map(async (client, p) => {
+      const inFlight = new Set<Promise<void>>();
+      for (let i = p; i < MESSAGES; i += PUBLISHERS) {
+        const device = (Math.floor(i / PUBLISHERS) * PUBLISHERS + p) % DEVICES;
+        const pending = client.publish(`${TOPIC}/${devices[device].id}`, reading(device, i), 1);
+        inFlight.add(pending);
+        pending.then(() => inFlight.delete(pending));
+        if (inFlight.size >= WINDOW) await Promise.race(inFlight);
+      }
+      await Promise.all(inFlight);
+    })
+  );
+  const published = process.hrtime.bigint();
+  await done;
+  const finished = process.hrtime.bigint();
+
+  latenciesUs.sort((a, b) => a - b);
+  const pct = (q: number) => (latenciesUs[Math.min(latenciesUs.length - 1, Math.floor(q * latenciesUs.length))] / 1000).toFixed(2);
+  const seconds = Number(finished - started) / 1e9;
+  console.log(`broker ${URL}: ${MESSAGES} messages, ${DEVICES} devices, ${PUBLISHERS} publishers, ${CONSUMERS} consumers (QoS 1)`);
+  console.log(`publish: ${Math.round(MESSAGES / (Number(published - started) / 1e9))} msg/s`);
+  console.log(`end to end: ${Math.round(MESSAGES / seconds)} msg/s, latency p50 ${pct(0.5)} ms, p99 ${pct(0.99)} ms`);
+  const split = [...consumerOf.values()].filter((s) => s.size > 1).length;
+  console.log(`rejected: ${invalid}, order violations within a consumer: ${outOfOrder}, devices split across consumers: ${split}`);
+
+  await Promise.all([...publishers, ...consumers].map((c) => c.end()));
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});
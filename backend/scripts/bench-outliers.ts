@@ -0,0 +1,57 @@
+/**
+ * Neighborhood outlier detection at ingest rate
+ *   npx tsx scripts/bench-outliers.ts
+ * Simulates a fleet grouped into areas, with a small share of nodes whose
+ * sensor reads far above its neighbors, and reports checks/s plus how many
+ * faulty and healthy readings were flagged.
+ */
+import { NeighborhoodMonitor } from '../src/lib/neighborhood-outliers';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '10000');
+const PER_AREA = parseInt(process.env.BENCH_PER_AREA || '12');
+const FAULTY = parseFloat(process.env.BENCH_FAULTY_FRACTION || '0.01');
+const MINUTES = parseInt(process.env.BENCH_MINUTES || '60');
+
+const monitor = new NeighborhoodMonitor({
+  windowMs: 30 * 60_000,
+  minNeighbors: 3,
+  zThreshold: 5,
+  minDeviation: { aqi: 50, iaq: 75 },
+});
+
+const faulty = new Set<number>();
+while (faulty.size < Math.round(DEVICES * FAULTY)) faulty.add(Math.floor(Math.random() * DEVICES));
+
+const ids = Array.from({ length: DEVICES }, (_, i) => `device-${i}`);
+const areaBase = Array.from({ length: Math.ceil(DEVICES / PER_AREA) }, () => 40 + Math.random() * 120);
+let faultyFlagged = 0;
+let faultySent = 0;
+let healthyFlagged = 0;
+let healthySent = 0;
+
+const t0 = Date.now();
+const started = process.hrtime.bigint();
+for (let m = 0; m < MINUTES; m++) {
+  for (let d = 0; d < DEVICES; d++) {
+    const area = Math.floor(d / PER_AREA);
+    // Area-wide swings (real pollution events) move every node together
+    const base = areaBase[area] * (1 + 0.3 * Math.sin(m / 10 + area));
+    const iaq = faulty.has(d) ? 480 : base + (Math.random() - 0.5) * 20;
+    const aqi = Math.max(0, (iaq - 50) * 0.8);
+    const v = monitor.check(`area-${area}`, ids[d], t0 + m * 60_000 + d, { aqi, iaq });
+    if (faulty.has(d)) {
+      faultySent++;
+      if (v.outlier) faultyFlagged++;
+    } else {
+      healthySent++;
+      if (v.outlier) healthyFlagged++;
+    }
+  }
+}
+const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+
+const checks = DEVICES * MINUTES;
+console.log(`devices=${DEVICES} (${PER_AREA}/area) faulty=${faulty.size} minutes=${MINUTES}`);
+console.log(`checks: ${Math.round(checks / seconds)} /s (${checks} in ${seconds.toFixed(2)}s)`);
+console.log(`faulty readings flagged:  ${faultyFlagged}/${faultySent} (${((faultyFlagged / faultySent) * 100).toFixed(1)}%)`);
+console.log(`healthy readings flagged: ${healthyFlagged}/${healthySent} (${((healthyFlagged / healthySent) * 100).toFixed(3)}%)`);
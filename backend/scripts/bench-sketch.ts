@@ -0,0 +1,50 @@
+/**
+ * Quantile sketch insert/merge throughput and accuracy
+ *   npx tsx scripts/bench-sketch.ts
+ * Builds one sketch per device (a day of one-minute AQI readings), merges them
+ * into an area sketch and compares its p50/p95/p99 with exact percentiles.
+ */
+import { QuantileSketch } from '../src/lib/quantile-sketch';
+
+const DEVICES = parseInt(process.env.BENCH_DEVICES || '1000');
+const READINGS = parseInt(process.env.BENCH_READINGS || '1440');
+
+// Log-normal-ish AQI with per-device baseline
+const values: Float64Array[] = Array.from({ length: DEVICES }, (_, d) => {
+  const base = 40 + (d % 20) * 5;
+  const arr = new Float64Array(READINGS);
+  for (let i = 0; i < READINGS; i++) arr[i] = Math.min(500, base * Math.exp((Math.random() - 0.5) * 1.2));
+  return arr;
+});
+
+let started = process.hrtime.bigint();
+const sketches = values.map((arr) => {
+  const s = new QuantileSketch();
+  for (let i = 0; i < arr.length; i++) s.add(arr[i]);
+  return s;
+});
+const insertSec = Number(process.hrtime.bigint() - started) / 1e9;
+
+started = process.hrtime.bigint();
+const encoded = sketches.map((s) => s.toBase64());
+const encodeSec = Number(process.hrtime.bigint() - started) / 1e9;
+
+started = process.hrtime.bigint();
+const area = new QuantileSketch();
+for (const e of encoded) area.merge(QuantileSketch.fromBase64(e));
+const mergeSec = Number(process.hrtime.bigint() - started) / 1e9;
+
+const all = Float64Array.from(values.flatMap((a) => Array.from(a))).sort();
+const exact = (q: number) => all[Math.floor(q * (all.length - 1))];
+
+const total = DEVICES * READINGS;
+const avgBytes = encoded.reduce((n, e) => n + Buffer.from(e, 'base64').length, 0) / encoded.length;
+console.log(`devices=${DEVICES} readings/device=${READINGS}`);
+console.log(`insert: ${Math.round(total / insertSec)} values/s`);
+console.log(`serialize: ${Math.round(DEVICES / encodeSec)} sketches/s, ${avgBytes.toFixed(0)} bytes each (vs ${READINGS * 8} raw)`);
+console.log(`decode+merge: ${Math.round(DEVICES / mergeSec)} sketches/s`);
+for (const q of [0.5, 0.95, 0.99]) {
+  const est = area.quantile(q)!;
+  const ref = exact(q);
+  console.log(`p${q * 100}: sketch=${est.toFixed(2)} exact=${ref.toFixed(2)} error=${((Math.abs(est - ref) / ref) * 100).toFixed(2)}%`);
+}
@@ -0,0 +1,190 @@
+/**
+ * Multi-core server scaling: echo and ingest
+ *   npx tsx scripts/bench-workers.ts
+ * For each worker count, forks that many Fastify workers on a shared port
+ * (node:cluster, as SERVER_WORKERS does) plus separate load-generator
+ * processes, then reports requests/s, requests/s per core and p50/p99 latency
+ * for an echo route and for the ingest CPU path (decode, HMAC verify, AQI)
+ * without the database write.
+ */
+import cluster from 'node:cluster';
+import { fork, ChildProcess } from 'child_process';
+import crypto from 'crypto';
+import http from 'http';
+import os from 'os';
+import type { Device } from '@prisma/client';
+
+const CORES = os.cpus().length;
+const WORKER_COUNTS = (process.env.BENCH_WORKERS || `1,${Math.max(1, Math.floor(CORES / 2))}`)
+  .split(',')
+  .map((n) => parseInt(n));
+const CONNECTIONS = parseInt(process.env.BENCH_CONNECTIONS || '64');
+const LOADERS = parseInt(process.env.BENCH_LOADERS || String(Math.max(1, Math.ceil(CORES / 2))));
+const DURATION_S = parseFloat(process.env.BENCH_DURATION_S || '5');
+const PORT = parseInt(process.env.BENCH_PORT || '3900');
+const ROLE = process.env.BENCH_ROLE || 'primary';
+
+const DEVICE = {
+  id: 'a3f1c2d4-5b6e-4f70-8a9b-0c1d2e3f4a5b',
+  deviceKey: 'kGj3@z7P!qT9$L8rVb2mXyW4sN6fC1eH',
+  altitude: null,
+  firmwareVersion: '1.2.0',
+} as unknown as Device;
+
+function firmwarePayload(seq: number): string {
+  const payload = {
+    device_id: DEVICE.id,
+    firmware_version: '1.2.0',
+    timestamp: 1760000000 + seq * 60,
+    sensors: {
+      mq135_raw: 71.42 + (seq % 7),
+      iaq_score: 88.5 + (seq % 13),
+      co2_equiv: 612.3,
+      temperature: 27.41,
+      humidity: 54.2,
+      pressure_hpa: 1008.7,
+      altitude_m: 216.5,
+    },
+    meta: { uptime_ms: 3600000 + seq, rssi: -61, free_heap: 182344, boot_id: '9f2c01ab', seq },
+  };
+  const signature = crypto.createHmac('sha256', DEVICE.deviceKey).update(JSON.stringify(payload)).digest('hex');
+  return JSON.stringify({ ...payload, signature });
+}
+
+// Latency histogram in 10 µs buckets (mergeable across load processes)
+const BUCKET_US = 10;
+
+function percentile(hist: Record<string, number>, q: number): number {
+  const entries = Object.entries(hist).map(([b, c]) => [Number(b), c] as const).sort((a, b) => a[0] - b[0]);
+  const total = entries.reduce((n, [, c]) => n + c, 0);
+  let seen = 0;
+  for (const [bucket, count] of entries) {
+    seen += count;
+    if (seen >= q * total) return ((bucket + 1) * BUCKET_US) / 1000;
+  }
+  return NaN;
+}
+
+// ---------------------------------------------------------------------------
+// Server worker
+// ---------------------------------------------------------------------------
+async function runServer() {
+  const { default: Fastify } = await import('fastify');
+  const { normalizeIngest } = await import('../src/lib/ingest-core');
+  const server = Fastify({ logger: false });
+  let served = 0;
+
+  server.post('/echo', async (request) => {
+    served++;
+    return request.body;
+  });
+  server.post('/ingest', async (request, reply) => {
+    served++;
+    const result = await normalizeIngest(request.body, () => DEVICE);
+    if (!result.ok) return reply.code(result.status).send({ error: result.error });
+    return reply.code(201).send({ success: true, measurement_id: result.reading.id });
+  });
+
+  process.on('message', (msg: any) => {
+    if (msg === 'stats') process.send!({ served });
+  });
+  await server.listen({ port: PORT, host: '127.0.0.1' });
+  process.send!('ready');
+}
+
+// ---------------------------------------------------------------------------
+// Load generator
+// ---------------------------------------------------------------------------
+async function runLoad() {
+  const path = process.env.BENCH_PATH!;
+  const connections = parseInt(process.env.BENCH_LOAD_CONNECTIONS!);
+  const agent = new http.Agent({ keepAlive: true, maxSockets: connections });
+  const bodies = Array.from({ length: 256 }, (_, i) => firmwarePayload(i));
+  const hist: Record<number, number> = {};
+  let done = 0;
+  let errors = 0;
+  const deadline = Date.now() + DURATION_S * 1000;
+
+  const one = (body: string) =>
+    new Promise<void>((resolve) => {
+      const t0 = process.hrtime.bigint();
+      const req = http.request(
+        { host: '127.0.0.1', port: PORT, path, method: 'POST', agent, headers: { 'content-type': 'application/json', 'content-length': Buffer.byteLength(body) } },
+        (res) => {
+          res.resume();
+          res.on('end', () => {
+            const us = Number(process.hrtime.bigint() - t0) / 1000;
+            const b = Math.floor(us / BUCKET_US);
+            hist[b] = (hist[b] || 0) + 1;
+            if (res.statusCode! >= 300) errors++;
+            done++;
+            resolve();
+          });
+        }
+      );
+      req.on('error', () => {
+        errors++;
+        resolve();
+      });
+      req.end(body);
+    });
+
+  await Promise.all(
+    Array.from({ length: connections }, async (_, c) => {
+      for (let i = c; Date.now() < deadline; i += connections) await one(bodies[i % bodies.length]);
+    })
+  );
+  agent.destroy();
+  process.send!({ done, errors, hist });
+}
+
+// ---------------------------------------------------------------------------
+// Orchestration
+// ---------------------------------------------------------------------------
+function once<T>(proc: { once(ev: 'message', fn: (m: any) => void): unknown }): Promise<T> {
+  return new Promise((resolve) => proc.once('message', resolve));
+}
+
+async function runCase(workers: number, path: string) {
+  const servers = Array.from({ length: workers }, () => cluster.fork({ BENCH_ROLE: 'server' }));
+  await Promise.all(servers.map((w) => once(w)));
+
+  const loaders: ChildProcess[] = Array.from({ length: LOADERS }, () =>
+    fork(__filename, [], {
+      env: { ...process.env, BENCH_ROLE: 'load', BENCH_PATH: path, BENCH_LOAD_CONNECTIONS: String(Math.ceil(CONNECTIONS / LOADERS)) },
+    })
+  );
+  const results = await Promise.all(loaders.map((l) => once<{ done: number; errors: number; hist: Record<string, number> }>(l)));
+
+  const perWorker = await Promise.all(
+    servers.map((w) => {
+      const p = once<{ served: number }>(w);
+      w.send('stats');
+      return p;
+    })
+  );
+  for (const w of servers) w.kill();
+  await Promise.all(servers.map((w) => new Promise((r) => w.once('exit', r))));
+
+  const hist: Record<string, number> = {};
+  for (const r of results) for (const [b, c] of Object.entries(r.hist)) hist[b] = (hist[b] || 0) + c;
+  const done = results.reduce((n, r) => n + r.done, 0);
+  const errors = results.reduce((n, r) => n + r.errors, 0);
+  const rps = done / DURATION_S;
+  console.log(
+    `${path.padEnd(8)} ${String(workers).padStart(2)} workers: ${Math.round(rps).toString().padStart(7)} req/s, ` +
+      `${Math.round(rps / workers).toString().padStart(6)} req/s/core, p50 ${percentile(hist, 0.5).toFixed(2)} ms, ` +
+      `p99 ${percentile(hist, 0.99).toFixed(2)} ms, errors ${errors}, split ${perWorker.map((w) => w.served).join('/')}`
+  );
+}
+
+async function main() {
+  console.log(`${CORES} cores, ${CONNECTIONS} keep-alive connections from ${LOADERS} load processes, ${DURATION_S}s per case`);
+  for (const path of ['/echo', '/ingest']) {
+    for (const workers of WORKER_COUNTS) await runCase(workers, path);
+  }
+}
+
+if (ROLE === 'server') runServer();
+else if (ROLE === 'load') runLoad();
+else main();
@@ -1,6 +1,7 @@
 import 'dotenv/config';
+import crypto from 'crypto';
 import { PrismaClient } from '@prisma/client';
-import { generateAPIKey } from '../src/lib/hmac';
+import { generateAPIKey, deriveDeviceKey } from '../src/lib/hmac';
 
 const prisma = new PrismaClient();
 
@@ -10,22 +11,32 @@ async function main() {
   const longitude = process.env.DEVICE_LNG ? Number(process.env.DEVICE_LNG) : null;
   const areaName = process.env.DEVICE_AREA || 'Rourkela';
   const salt = process.env.API_KEY_SALT || 'dev-salt';
+  // Derived keys: HMAC(master, device id), recomputed by ingest without a lookup
+  const masterKey = process.env.DEVICE_KEY_MASTER || '';
 
-  // If a device with the same name exists, reuse it
+  // If a device with the same name exists, reuse it (moving it onto its derived key)
   const existing = await prisma.device.findFirst({ where: { name } });
   if (existing) {
+    let deviceKey = existing.deviceKey;
+    const derived = masterKey ? deriveDeviceKey(masterKey, existing.id) : '';
+    if (derived && derived !== deviceKey) {
+      await prisma.device.update({ where: { id: existing.id }, data: { deviceKey: derived } });
+      deviceKey = derived;
+    }
     console.log(JSON.stringify({
-      message: 'Device already exists',
+      message: deviceKey === existing.deviceKey ? 'Device already exists' : 'Device re-keyed with derived key',
       device_id: existing.id,
-      device_key: existing.deviceKey,
+      device_key: deviceKey,
       name: existing.name,
     }, null, 2));
     return;
   }
 
-  const deviceKey = generateAPIKey(name, salt);
+  const id = crypto.randomUUID();
+  const deviceKey = masterKey ? deriveDeviceKey(masterKey, id) : generateAPIKey(name, salt);
   const created = await prisma.device.create({
     data: {
+      id,
       name,
       deviceKey,
       latitude: latitude ?? undefined,
@@ -1,12 +1,24 @@
 import dotenv from 'dotenv';
 dotenv.config();
 
+// Fastify's trustProxy: true, a hop count, or a list of proxy addresses
+function parseTrustProxy(value: string): boolean | number | string {
+  if (value === 'true') return true;
+  if (/^\d+$/.test(value)) return parseInt(value);
+  return value || false;
+}
+
 export const config = {
   // Server
   port: parseInt(process.env.PORT || '3000'),
   nodeEnv: process.env.NODE_ENV || 'development',
   logLevel: process.env.LOG_LEVEL || 'info',
   corsOrigin: process.env.CORS_ORIGIN || 'http://localhost:3000',
+  // Server processes sharing the port (0 = one per core); background jobs run on the first only
+  serverWorkers: parseInt(process.env.SERVER_WORKERS || '1'),
+  // Proxies trusted for X-Forwarded-For, so request.ip is the client: 'true', a hop count,
+  // or comma-separated addresses/CIDRs; empty = clients connect directly
+  trustProxy: parseTrustProxy(process.env.TRUST_PROXY || ''),
 
   // Database
   databaseUrl: process.env.DATABASE_URL!,
@@ -15,6 +27,9 @@ export const config = {
   // Security
   jwtSecret: process.env.JWT_SECRET!,
   apiKeySalt: process.env.API_KEY_SALT!,
+  // Device keys derived as HMAC(master, device id); empty = random keys looked up per device
+  deviceKeyMaster: process.env.DEVICE_KEY_MASTER || '',
+  deviceKeyAllowLegacy: process.env.DEVICE_KEY_ALLOW_LEGACY === 'true',
 
   // External APIs (optional for demo)
   openWeatherApiKey: process.env.OPENWEATHER_API_KEY, // made optional
@@ -40,6 +55,54 @@ export const config = {
   mlModelPath: process.env.ML_MODEL_PATH || './models',
   enableMlPredictions: process.env.ENABLE_ML_PREDICTIONS === 'true',
 
+  // Ingest batching
+  ingestBatchSize: parseInt(process.env.INGEST_BATCH_SIZE || '500'),
+  ingestBatchDelayMs: parseInt(process.env.INGEST_BATCH_DELAY_MS || '50'),
+
+  // Ingest admission control (per-device token bucket + global in-flight cap); each source
+  // address also has a ceiling, which is all that unverified requests get under a master key
+  ingestDeviceBurst: parseInt(process.env.INGEST_DEVICE_BURST || '60'),
+  ingestDeviceRatePerMin: parseFloat(process.env.INGEST_DEVICE_RATE_PER_MIN || '12'),
+  ingestSourceBurst: parseInt(process.env.INGEST_SOURCE_BURST || '600'),
+  ingestSourceRatePerMin: parseFloat(process.env.INGEST_SOURCE_RATE_PER_MIN || '1200'),
+  ingestMaxInFlight: parseInt(process.env.INGEST_MAX_INFLIGHT || '256'),
+  ingestOverloadRetryMs: parseInt(process.env.INGEST_OVERLOAD_RETRY_MS || '2000'),
+
+  // Replay duplicate filter (time-partitioned cuckoo filter)
+  dedupWindowHours: parseInt(process.env.DEDUP_WINDOW_HOURS || '24'),
+  dedupPartitions: parseInt(process.env.DEDUP_PARTITIONS || '24'),
+  dedupPartitionSlots: parseInt(process.env.DEDUP_PARTITION_SLOTS || '131072'),
+
+  // Neighborhood outlier detection at ingest
+  outlierWindowMin: parseInt(process.env.OUTLIER_WINDOW_MIN || '30'),
+  outlierMinNeighbors: parseInt(process.env.OUTLIER_MIN_NEIGHBORS || '3'),
+  outlierZThreshold: parseFloat(process.env.OUTLIER_Z_THRESHOLD || '5'),
+
+  // MQTT ingest bridge (disabled when MQTT_URL is empty); workers share one subscription group
+  mqttUrl: process.env.MQTT_URL || '',
+  mqttUsername: process.env.MQTT_USERNAME,
+  mqttPassword: process.env.MQTT_PASSWORD,
+  mqttTopic: process.env.MQTT_TOPIC || 'aeroguard/measurements',
+  mqttShareGroup: process.env.MQTT_SHARE_GROUP ?? 'aeroguard-ingest',
+  mqttMaxInFlight: parseInt(process.env.MQTT_MAX_INFLIGHT || '256'),
+
+  // Ingest cluster: "id=url,..." of every instance plus this instance's id (empty = single node).
+  // With CLUSTER_NODES_FILE set, SIGHUP reloads membership from that file.
+  clusterNodes: process.env.CLUSTER_NODES || '',
+  clusterSelf: process.env.CLUSTER_SELF || '',
+  clusterNodesFile: process.env.CLUSTER_NODES_FILE || '',
+
+  // Cold tier: raw readings older than this many days are compacted into segments (0 = off)
+  coldAfterDays: parseInt(process.env.COLD_AFTER_DAYS || '30'),
+
+  // Durable ingest log (disabled when INGEST_LOG_DIR is empty)
+  ingestLogDir: process.env.INGEST_LOG_DIR || '',
+  ingestLogSegmentMb: parseInt(process.env.INGEST_LOG_SEGMENT_MB || '64'),
+  ingestLogFsyncMs: parseInt(process.env.INGEST_LOG_FSYNC_MS || '5'),
+
+  // Dashboard reading cache: latest + 24 h of per-device buckets in memory (0 = query the DB)
+  readingCacheBucketMin: parseInt(process.env.READING_CACHE_BUCKET_MIN || '5'),
+
   // Jobs
   enableJobs: process.env.ENABLE_JOBS !== 'false',
 };
@@ -0,0 +1,93 @@
+/**
+ * AeroGuard Edge Broker
+ * Runs at a site gateway (Pi-class hardware): nodes publish to it over the LAN,
+ * readings are queued on disk and forwarded to the cloud broker whenever the
+ * backhaul is up. Standalone entrypoint: needs no database or API secrets.
+ */
+
+import dotenv from 'dotenv';
+import crypto from 'crypto';
+import { MqttBroker } from './lib/mqtt-broker';
+import { EdgeUplink } from './services/edge-uplink';
+
+dotenv.config();
+
+const list = (value: string) =>
+  value
+    .split(',')
+    .map((s) => s.trim())
+    .filter(Boolean);
+
+const edgeConfig = {
+  port: parseInt(process.env.EDGE_PORT || '1883'),
+  host: process.env.EDGE_HOST || '0.0.0.0',
+  username: process.env.EDGE_USERNAME || '',
+  password: process.env.EDGE_PASSWORD || '',
+  upstreamUrl: process.env.EDGE_UPSTREAM_URL || '',
+  upstreamUsername: process.env.EDGE_UPSTREAM_USERNAME || undefined,
+  upstreamPassword: process.env.EDGE_UPSTREAM_PASSWORD || undefined,
+  queueDir: process.env.EDGE_QUEUE_DIR || './edge-queue',
+  forwardTopics: list(process.env.EDGE_FORWARD_TOPICS || 'aeroguard/measurements/#'),
+  commandTopics: list(process.env.EDGE_COMMAND_TOPICS || 'aeroguard/commands/#'),
+  statsIntervalMs: parseInt(process.env.EDGE_STATS_INTERVAL_MS || '60000'),
+};
+
+function safeEqual(a: string, b: string): boolean {
+  const x = Buffer.from(a);
+  const y = Buffer.from(b);
+  return x.length === y.length && crypto.timingSafeEqual(x, y);
+}
+
+async function main() {
+  let uplink: EdgeUplink | null = null;
+
+  const broker = new MqttBroker({
+    authenticate: edgeConfig.username
+      ? (_clientId, username, password) =>
+          username === edgeConfig.username && !!password && safeEqual(password.toString('utf8'), edgeConfig.password)
+      : undefined,
+    persist: (topic, payload, qos) => uplink?.persist(topic, payload, qos),
+  });
+  broker.on('persist-error', (err) => console.error('[EDGE] Failed to queue message:', err));
+
+  if (edgeConfig.upstreamUrl) {
+    uplink = new EdgeUplink(broker, {
+      url: edgeConfig.upstreamUrl,
+      username: edgeConfig.upstreamUsername,
+      password: edgeConfig.upstreamPassword,
+      queueDir: edgeConfig.queueDir,
+      forwardFilters: edgeConfig.forwardTopics,
+      commandFilters: edgeConfig.commandTopics,
+      batchSize: 500,
+    });
+    await uplink.start();
+  } else {
+    console.warn('[EDGE] EDGE_UPSTREAM_URL not set, running as a local broker only');
+  }
+
+  await broker.listen(edgeConfig.port, edgeConfig.host);
+  console.log(`📡 Edge broker listening on ${edgeConfig.host}:${broker.port}`);
+
+  const statsTimer = setInterval(() => {
+    const s = broker.stats;
+    const queued = uplink
+      ? `, forwarded ${uplink.forwarded}, ${uplink.backlogBytes()} bytes queued, ${uplink.queue.stats.deadLettered} dead-lettered`
+      : '';
+    console.log(`[EDGE] ${s.connections} clients, ${s.subscriptions} subs, in ${s.messagesIn}, out ${s.messagesOut}, dropped ${s.dropped}${queued}`);
+  }, edgeConfig.statsIntervalMs);
+
+  const shutdown = async () => {
+    console.log('[EDGE] Shutting down...');
+    clearInterval(statsTimer);
+    await broker.close();
+    await uplink?.stop();
+    process.exit(0);
+  };
+  process.on('SIGTERM', shutdown);
+  process.on('SIGINT', shutdown);
+}
+
+main().catch((err) => {
+  console.error('[EDGE] Failed to start:', err);
+  process.exit(1);
+});
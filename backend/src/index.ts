@@ -1,11 +1,17 @@
 import Fastify from 'fastify';
+import cluster from 'node:cluster';
+import os from 'os';
 import cors from '@fastify/cors';
 import helmet from '@fastify/helmet';
 import rateLimit from '@fastify/rate-limit';
 import jwt from '@fastify/jwt';
 import { config } from './config';
 import { db } from './lib/db';
+import { measurementWriter, startWriterConsumer, ingestLog } from './lib/measurement-writer';
 import { startTelegramBot } from './services/telegram-bot';
+import { startPrimary } from './primary';
+import { startMqttBridge } from './services/mqtt-bridge';
+import type { MqttClient } from './lib/mqtt-client';
 
 // Routes
 import ingestRoutes from './routes/ingest';
@@ -16,7 +22,10 @@ import healthRoutes from './routes/health';
 import publicRoutes from './routes/public';
 import alertsRoutes from './routes/alerts';
 
+let mqttBridge: MqttClient | null = null;
+
 const server = Fastify({
+  trustProxy: config.trustProxy,
   logger: {
     level: config.logLevel,
     transport: {
@@ -79,9 +88,20 @@ async function start() {
     server.register(publicRoutes, { prefix: '/api/v1/public' });
     server.register(alertsRoutes, { prefix: '/api/v1/alerts' });
 
+    // Durable ingest log: open (recovering any torn tail) and start the DB writer consumer
+    if (ingestLog) {
+      await ingestLog.open();
+      startWriterConsumer(ingestLog);
+      server.log.info(`🧾 Ingest log enabled at ${config.ingestLogDir}`);
+    }
+
     // Start server
     await server.listen({ port: config.port, host: '0.0.0.0' });
-    server.log.info(`🚀 AeroGuard AI Backend running on port ${config.port}`);
+    const worker = cluster.isWorker ? ` (worker ${process.env.SERVER_WORKER_INDEX})` : '';
+    server.log.info(`🚀 AeroGuard AI Backend running on port ${config.port}${worker}`);
+
+    // MQTT ingest (nodes built with USE_MQTT); same pipeline as POST /ingest
+    mqttBridge = startMqttBridge(server.log);
 
     // Start Telegram bot (optional, non-blocking)
     startTelegramBot();
@@ -91,10 +111,12 @@ async function start() {
       const { startAggregator } = await import('./jobs/aggregator');
       const { startForecaster } = await import('./jobs/forecaster');
       const { startAlerts } = await import('./jobs/alerts');
+      const { startCompactor } = await import('./jobs/compactor');
 
       startAggregator();
       startForecaster();
       startAlerts();
+      startCompactor();
       server.log.info('📊 Background jobs started');
     }
 
@@ -108,11 +130,20 @@ async function start() {
 const shutdown = async (signal: string) => {
   server.log.info(`Received ${signal}, shutting down gracefully...`);
   await server.close();
+  await mqttBridge?.end();
+  await ingestLog?.close();
+  await measurementWriter.drain();
   await db.$disconnect();
   process.exit(0);
 };
 
-process.on('SIGTERM', () => shutdown('SIGTERM'));
-process.on('SIGINT', () => shutdown('SIGINT'));
+const workerCount = config.serverWorkers > 0 ? config.serverWorkers : os.cpus().length;
+
+if (cluster.isPrimary && workerCount > 1) {
+  startPrimary(workerCount);
+} else {
+  process.on('SIGTERM', () => shutdown('SIGTERM'));
+  process.on('SIGINT', () => shutdown('SIGINT'));
 
-start();
+  start();
+}
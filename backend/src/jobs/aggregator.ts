@@ -5,7 +5,10 @@
  */
 
 import cron from 'node-cron';
+import { Prisma } from '@prisma/client';
 import { db } from '../lib/db';
+import { QuantileSketch, mergeSketches } from '../lib/quantile-sketch';
+import { isPriorityAlert } from '../lib/ingest-core';
 
 /**
  * Start all aggregation cron jobs
@@ -34,109 +37,134 @@ export function startAggregator() {
   console.log('✅ Aggregation jobs scheduled');
 }
 
+interface AreaRollup {
+  sketch: QuantileSketch;
+  deviceIds: string[];
+  measurements: number;
+  sumSq: number;
+  temp: number[];
+  humidity: number[];
+  pressure: number[];
+}
+
+function average(values: number[]): number | null {
+  return values.length > 0 ? values.reduce((a, b) => a + b, 0) / values.length : null;
+}
+
 /**
- * 15-Minute Aggregation
- * Aggregates measurements into 15-minute buckets per area/device
+ * Roll measurements in [periodStart, periodEnd) up per area.
+ * Each area row stores one quantile sketch of its devices' readings (its size stays flat
+ * as the fleet grows), so percentiles over any set of buckets can be recomputed by
+ * merging instead of re-reading raw rows.
  */
-async function aggregate15MinRollup() {
-  try {
-    const now = new Date();
-    const periodStart = new Date(Math.floor(now.getTime() / (15 * 60 * 1000)) * (15 * 60 * 1000));
-    const periodEnd = new Date(periodStart.getTime() + 15 * 60 * 1000);
+async function rollupPeriod(periodStart: Date, periodEnd: Date, intervalType: string, extraStats: Prisma.InputJsonObject = {}) {
+  const devices = await db.device.findMany({
+    where: { active: true },
+    select: { id: true, latitude: true, longitude: true, areaName: true },
+  });
 
-    // Get all active devices
-    const devices = await db.device.findMany({
-      where: { active: true },
-      select: { id: true, latitude: true, longitude: true, areaName: true },
-    });
+  const areas = new Map<string, AreaRollup>();
 
-    let aggregatedCount = 0;
-
-    for (const device of devices) {
-      const measurements = await db.measurement.findMany({
-        where: {
-          deviceId: device.id,
-          measuredAt: {
-            gte: periodStart,
-            lt: periodEnd,
-          },
-          aqiCalculated: { not: null },
-        },
-        select: {
-          aqiCalculated: true,
-          temperature: true,
-          humidity: true,
-          pressureHpa: true,
+  for (const device of devices) {
+    const rows = await db.measurement.findMany({
+      where: {
+        deviceId: device.id,
+        measuredAt: {
+          gte: periodStart,
+          lt: periodEnd,
         },
-      });
-
-      if (measurements.length === 0) continue;
-
-      // Calculate statistics
-      const aqiValues = measurements.map(m => m.aqiCalculated!).sort((a, b) => a - b);
-      const tempValues = measurements.map(m => m.temperature).filter(t => t !== null) as number[];
-      const humValues = measurements.map(m => m.humidity).filter(h => h !== null) as number[];
-      const pressValues = measurements.map(m => m.pressureHpa).filter(p => p !== null) as number[];
-
-      const avgAqi = aqiValues.reduce((a, b) => a + b, 0) / aqiValues.length;
-      const maxAqi = Math.max(...aqiValues);
-      const minAqi = Math.min(...aqiValues);
-      const medianAqi = aqiValues[Math.floor(aqiValues.length / 2)];
-
-      const avgTemp = tempValues.length > 0 ? tempValues.reduce((a, b) => a + b, 0) / tempValues.length : null;
-      const avgHumidity = humValues.length > 0 ? humValues.reduce((a, b) => a + b, 0) / humValues.length : null;
-      const avgPressure = pressValues.length > 0 ? pressValues.reduce((a, b) => a + b, 0) / pressValues.length : null;
-
-      // Determine area grid (use areaName or lat/lng grid)
-      const areaGrid = device.areaName || `${device.latitude?.toFixed(2)},${device.longitude?.toFixed(2)}`;
-
-      // Upsert aggregate
-      await db.aggregate.upsert({
-        where: {
-          areaGrid_periodStart_intervalType: {
-            areaGrid,
-            periodStart,
-            intervalType: '15min',
-          },
+        aqiCalculated: { not: null },
+      },
+      select: {
+        aqiCalculated: true,
+        temperature: true,
+        humidity: true,
+        pressureHpa: true,
+        qualityFlags: true,
+      },
+    });
+    const measurements = rows.filter((m) => !isPriorityAlert(m.qualityFlags));
+
+    if (measurements.length === 0) continue;
+
+    // Determine area grid (use areaName or lat/lng grid)
+    const areaGrid = device.areaName || `${device.latitude?.toFixed(2)},${device.longitude?.toFixed(2)}`;
+    let area = areas.get(areaGrid);
+    if (!area) {
+      area = { sketch: new QuantileSketch(), deviceIds: [], measurements: 0, sumSq: 0, temp: [], humidity: [], pressure: [] };
+      areas.set(areaGrid, area);
+    }
+
+    for (const m of measurements) {
+      const aqi = m.aqiCalculated!;
+      area.sketch.add(aqi);
+      area.sumSq += aqi * aqi;
+      if (m.temperature !== null) area.temp.push(m.temperature);
+      if (m.humidity !== null) area.humidity.push(m.humidity);
+      if (m.pressureHpa !== null) area.pressure.push(m.pressureHpa);
+    }
+    area.deviceIds.push(device.id);
+    area.measurements += measurements.length;
+  }
+
+  for (const [areaGrid, area] of areas) {
+    const { sketch } = area;
+    const avgAqi = sketch.mean!;
+    const stdDeviation = Math.sqrt(Math.max(0, area.sumSq / sketch.count - avgAqi * avgAqi));
+
+    const row = {
+      avgAqi,
+      maxAqi: sketch.max,
+      minAqi: sketch.min,
+      medianAqi: sketch.quantile(0.5),
+      avgTemp: average(area.temp),
+      avgHumidity: average(area.humidity),
+      avgPressure: average(area.pressure),
+      deviceCount: area.deviceIds.length,
+      stats: {
+        ...extraStats,
+        measurements: area.measurements,
+        deviceIds: area.deviceIds,
+        percentiles: {
+          p25: sketch.quantile(0.25),
+          p50: sketch.quantile(0.5),
+          p75: sketch.quantile(0.75),
+          p95: sketch.quantile(0.95),
         },
-        create: {
+        stdDeviation,
+        sketch: sketch.toBase64(),
+      },
+    };
+
+    await db.aggregate.upsert({
+      where: {
+        areaGrid_periodStart_intervalType: {
           areaGrid,
           periodStart,
-          intervalType: '15min',
-          avgAqi,
-          maxAqi,
-          minAqi,
-          medianAqi,
-          avgTemp,
-          avgHumidity,
-          avgPressure,
-          deviceCount: 1,
-          stats: {
-            measurements: measurements.length,
-            deviceIds: [device.id],
-            stdDeviation: calculateStdDev(aqiValues, avgAqi),
-          },
+          intervalType,
         },
-        update: {
-          avgAqi,
-          maxAqi,
-          minAqi,
-          medianAqi,
-          avgTemp,
-          avgHumidity,
-          avgPressure,
-          stats: {
-            measurements: measurements.length,
-            deviceIds: [device.id],
-            stdDeviation: calculateStdDev(aqiValues, avgAqi),
-          },
-        },
-      });
+      },
+      create: { areaGrid, periodStart, intervalType, ...row },
+      update: row,
+    });
+  }
 
-      aggregatedCount++;
-    }
+  return { devices: devices.length, areas: areas.size };
+}
+
+/**
+ * 15-Minute Aggregation
+ * Aggregates measurements into 15-minute buckets per area
+ */
+async function aggregate15MinRollup() {
+  try {
+    const now = new Date();
+    const periodStart = new Date(Math.floor(now.getTime() / (15 * 60 * 1000)) * (15 * 60 * 1000));
+    const periodEnd = new Date(periodStart.getTime() + 15 * 60 * 1000);
 
-    console.log(`✓ 15-min aggregation completed: ${aggregatedCount} devices processed`);
+    const result = await rollupPeriod(periodStart, periodEnd, '15min');
+
+    console.log(`✓ 15-min aggregation completed: ${result.areas} areas from ${result.devices} devices`);
   } catch (error) {
     console.error('❌ Error in 15-min aggregation:', error);
   }
@@ -151,75 +179,9 @@ async function aggregateHourlyRollup() {
     const periodStart = new Date(now.getFullYear(), now.getMonth(), now.getDate(), now.getHours() - 1, 0, 0);
     const periodEnd = new Date(periodStart.getTime() + 60 * 60 * 1000);
 
-    const devices = await db.device.findMany({
-      where: { active: true },
-      select: { id: true, areaName: true, latitude: true, longitude: true },
-    });
-
-    let aggregatedCount = 0;
-
-    for (const device of devices) {
-      const measurements = await db.measurement.findMany({
-        where: {
-          deviceId: device.id,
-          measuredAt: {
-            gte: periodStart,
-            lt: periodEnd,
-          },
-          aqiCalculated: { not: null },
-        },
-        select: {
-          aqiCalculated: true,
-          temperature: true,
-          humidity: true,
-          pressureHpa: true,
-        },
-      });
-
-      if (measurements.length === 0) continue;
-
-      const aqiValues = measurements.map(m => m.aqiCalculated!).sort((a, b) => a - b);
-      const avgAqi = aqiValues.reduce((a, b) => a + b, 0) / aqiValues.length;
-      const maxAqi = Math.max(...aqiValues);
-      const minAqi = Math.min(...aqiValues);
-      const medianAqi = aqiValues[Math.floor(aqiValues.length / 2)];
-
-      const areaGrid = device.areaName || `${device.latitude?.toFixed(2)},${device.longitude?.toFixed(2)}`;
-
-      await db.aggregate.upsert({
-        where: {
-          areaGrid_periodStart_intervalType: {
-            areaGrid,
-            periodStart,
-            intervalType: '1hour',
-          },
-        },
-        create: {
-          areaGrid,
-          periodStart,
-          intervalType: '1hour',
-          avgAqi,
-          maxAqi,
-          minAqi,
-          medianAqi,
-          deviceCount: 1,
-          stats: {
-            measurements: measurements.length,
-            hour: periodStart.getHours(),
-          },
-        },
-        update: {
-          avgAqi,
-          maxAqi,
-          minAqi,
-          medianAqi,
-        },
-      });
-
-      aggregatedCount++;
-    }
+    const result = await rollupPeriod(periodStart, periodEnd, '1hour', { hour: periodStart.getHours() });
 
-    console.log(`✓ Hourly aggregation completed: ${aggregatedCount} devices processed`);
+    console.log(`✓ Hourly aggregation completed: ${result.areas} areas from ${result.devices} devices`);
   } catch (error) {
     console.error('❌ Error in hourly aggregation:', error);
   }
@@ -234,86 +196,9 @@ async function aggregateDailyRollup() {
     const periodStart = new Date(now.getFullYear(), now.getMonth(), now.getDate() - 1, 0, 0, 0);
     const periodEnd = new Date(periodStart.getTime() + 24 * 60 * 60 * 1000);
 
-    const devices = await db.device.findMany({
-      where: { active: true },
-      select: { id: true, areaName: true, latitude: true, longitude: true },
-    });
-
-    let aggregatedCount = 0;
-
-    for (const device of devices) {
-      const measurements = await db.measurement.findMany({
-        where: {
-          deviceId: device.id,
-          measuredAt: {
-            gte: periodStart,
-            lt: periodEnd,
-          },
-          aqiCalculated: { not: null },
-        },
-        select: {
-          aqiCalculated: true,
-          temperature: true,
-          humidity: true,
-          pressureHpa: true,
-        },
-      });
-
-      if (measurements.length === 0) continue;
-
-      const aqiValues = measurements.map(m => m.aqiCalculated!).sort((a, b) => a - b);
-      const avgAqi = aqiValues.reduce((a, b) => a + b, 0) / aqiValues.length;
-      const maxAqi = Math.max(...aqiValues);
-      const minAqi = Math.min(...aqiValues);
-      const medianAqi = aqiValues[Math.floor(aqiValues.length / 2)];
-
-      // Calculate percentiles
-      const p25 = aqiValues[Math.floor(aqiValues.length * 0.25)];
-      const p75 = aqiValues[Math.floor(aqiValues.length * 0.75)];
-      const p95 = aqiValues[Math.floor(aqiValues.length * 0.95)];
-
-      const areaGrid = device.areaName || `${device.latitude?.toFixed(2)},${device.longitude?.toFixed(2)}`;
-
-      await db.aggregate.upsert({
-        where: {
-          areaGrid_periodStart_intervalType: {
-            areaGrid,
-            periodStart,
-            intervalType: '1day',
-          },
-        },
-        create: {
-          areaGrid,
-          periodStart,
-          intervalType: '1day',
-          avgAqi,
-          maxAqi,
-          minAqi,
-          medianAqi,
-          deviceCount: 1,
-          stats: {
-            measurements: measurements.length,
-            percentiles: { p25, p75, p95 },
-            stdDeviation: calculateStdDev(aqiValues, avgAqi),
-          },
-        },
-        update: {
-          avgAqi,
-          maxAqi,
-          minAqi,
-          medianAqi,
-          stats: {
-            measurements: measurements.length,
-            percentiles: { p25, p75, p95 },
-            stdDeviation: calculateStdDev(aqiValues, avgAqi),
-          },
-        },
-      });
-
-      aggregatedCount++;
-    }
+    const result = await rollupPeriod(periodStart, periodEnd, '1day');
 
-    console.log(`✓ Daily aggregation completed: ${aggregatedCount} devices processed`);
+    console.log(`✓ Daily aggregation completed: ${result.areas} areas from ${result.devices} devices`);
 
     // Cleanup old aggregates (keep last 90 days)
     await cleanupOldAggregates();
@@ -323,14 +208,6 @@ async function aggregateDailyRollup() {
   }
 }
 
-/**
- * Calculate standard deviation
- */
-function calculateStdDev(values: number[], mean: number): number {
-  const variance = values.reduce((sum, val) => sum + Math.pow(val - mean, 2), 0) / values.length;
-  return Math.sqrt(variance);
-}
-
 /**
  * Cleanup old aggregate data
  */
@@ -347,4 +224,28 @@ async function cleanupOldAggregates() {
   });
 
   console.log(`✓ Cleaned up ${deleted.count} old aggregate records`);
-}
\ No newline at end of file
+}
+
+/**
+ * Percentiles over an area (or areas matching a name) by merging stored rollup sketches
+ */
+export async function areaQuantiles(
+  areaName: string,
+  intervalType: string,
+  since: Date,
+  quantiles: number[] = [0.5, 0.95]
+): Promise<{ count: number; values: Record<string, number | null> }> {
+  const rows = await db.aggregate.findMany({
+    where: {
+      areaGrid: { contains: areaName, mode: 'insensitive' },
+      intervalType,
+      periodStart: { gte: since },
+    },
+    select: { stats: true },
+  });
+
+  const merged = mergeSketches(rows.map((r) => (r.stats as any)?.sketch));
+  const values: Record<string, number | null> = {};
+  for (const q of quantiles) values[`p${Math.round(q * 100)}`] = merged.quantile(q);
+  return { count: merged.count, values };
+}
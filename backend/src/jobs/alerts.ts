@@ -58,6 +58,9 @@ async function evaluateAlerts() {
 
       if (!latestMeasurement) continue;
 
+      // Readings far from the neighborhood consensus are likely sensor faults
+      if ((latestMeasurement.qualityFlags as any)?.neighborhood_outlier) continue;
+
       // Evaluate thresholds
       const thresholds = sub.thresholds as any;
       let triggered = false;
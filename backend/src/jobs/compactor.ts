@@ -0,0 +1,120 @@
+/**
+ * Compaction Job
+ * Moves raw readings older than COLD_AFTER_DAYS into compressed columnar
+ * device-day segments and deletes the originals. Rollups are untouched.
+ * Runs: daily
+ */
+
+import cron from 'node-cron';
+import { db } from '../lib/db';
+import { config } from '../config';
+import { coldCutoff } from '../lib/cold-store';
+import { encodeSegment, decodeSegment } from '../lib/columnar-segment';
+
+const DAY_MS = 24 * 60 * 60 * 1000;
+
+// Fields kept in the cold tier (row id and createdAt are dropped)
+const coldSelect = {
+  id: true,
+  measuredAt: true,
+  mq135Raw: true,
+  iaqScore: true,
+  co2Equiv: true,
+  temperature: true,
+  humidity: true,
+  pressureHpa: true,
+  altitudeM: true,
+  pm25Estimated: true,
+  pm25Api: true,
+  pm10Api: true,
+  uvIndex: true,
+  aqiCalculated: true,
+  aqiCategory: true,
+  externalData: true,
+  qualityFlags: true,
+  rssi: true,
+  uptime: true,
+} as const;
+
+export function startCompactor() {
+  if (config.coldAfterDays <= 0) return;
+
+  // Daily at 02:30, after the daily rollup
+  cron.schedule('30 2 * * *', async () => {
+    console.log(`[${new Date().toISOString()}] Running cold-tier compaction...`);
+    await compactColdReadings();
+  });
+
+  console.log('✅ Compaction job scheduled');
+}
+
+/**
+ * Compact one device-day. Late readings for an already compacted day are merged
+ * into its existing segment. Readings referenced by alerts stay hot.
+ */
+async function compactDeviceDay(deviceId: string, dayStart: Date) {
+  const dayEnd = new Date(dayStart.getTime() + DAY_MS);
+  const rows = await db.measurement.findMany({
+    where: { deviceId, measuredAt: { gte: dayStart, lt: dayEnd }, alerts: { none: {} } },
+    select: coldSelect,
+  });
+  if (rows.length === 0) return { rows: 0, stored: 0, bytes: 0 };
+
+  const existing = await db.measurementSegment.findUnique({
+    where: { deviceId_periodStart: { deviceId, periodStart: dayStart } },
+  });
+  const merged = [...(existing ? decodeSegment(existing.data) : []), ...rows];
+  const data = encodeSegment(merged);
+
+  // Segment write and delete commit together, so a crash never loses or duplicates rows
+  await db.$transaction([
+    db.measurementSegment.upsert({
+      where: { deviceId_periodStart: { deviceId, periodStart: dayStart } },
+      create: { deviceId, periodStart: dayStart, periodEnd: dayEnd, rowCount: merged.length, data },
+      update: { rowCount: merged.length, data },
+    }),
+    db.measurement.deleteMany({ where: { id: { in: rows.map((r) => r.id) } } }),
+  ]);
+
+  return { rows: rows.length, stored: merged.length, bytes: data.length };
+}
+
+export async function compactColdReadings(maxDeviceDays = 10_000) {
+  const cutoff = coldCutoff();
+  if (!cutoff) return;
+
+  const started = Date.now();
+  let deviceDays = 0;
+  let rowCount = 0;
+  let storedCount = 0;
+  let byteCount = 0;
+  let kept = 0;
+
+  try {
+    // Oldest hot reading first; each pass empties one device-day below the cutoff
+    while (deviceDays < maxDeviceDays) {
+      const oldest = await db.measurement.findFirst({
+        where: { measuredAt: { lt: cutoff }, alerts: { none: {} } },
+        orderBy: { measuredAt: 'asc' },
+        select: { deviceId: true, measuredAt: true },
+      });
+      if (!oldest) break;
+
+      const dayStart = new Date(Math.floor(oldest.measuredAt.getTime() / DAY_MS) * DAY_MS);
+      const result = await compactDeviceDay(oldest.deviceId, dayStart);
+      deviceDays++;
+      rowCount += result.rows;
+      storedCount += result.stored;
+      byteCount += result.bytes;
+    }
+
+    kept = await db.measurement.count({ where: { measuredAt: { lt: cutoff } } });
+    console.log(
+      `✓ Compaction completed: ${rowCount} readings from ${deviceDays} device-days into ` +
+        `${(byteCount / 1024).toFixed(0)} KB of segments (${storedCount ? (byteCount / storedCount).toFixed(1) : 0} B/reading), ` +
+        `${kept} alert-linked readings kept hot, ${Date.now() - started}ms`
+    );
+  } catch (error) {
+    console.error('❌ Error in compaction:', error);
+  }
+}
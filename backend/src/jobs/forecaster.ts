@@ -29,6 +29,7 @@ async function generateForecasts() {
     });
 
     let successCount = 0;
+    const timing = { devices: 0, fitMs: 0, predictMs: 0, incremental: 0 };
 
     for (const device of devices) {
       try {
@@ -37,20 +38,25 @@ async function generateForecasts() {
         if (!forecast) continue;
 
         // Store predictions
-        for (const pred of forecast.predictions) {
-          await db.prediction.create({
-            data: {
-              deviceId: device.id,
-              predictedFor: pred.timestamp,
-              aqiForecast: pred.aqi,
-              aqiCategory: pred.category,
-              confidence: forecast.confidence,
-              modelVersion: forecast.modelVersion,
-              features: {
-                lookback_hours: 24,
-              },
+        await db.prediction.createMany({
+          data: forecast.predictions.map((pred) => ({
+            deviceId: device.id,
+            predictedFor: pred.timestamp,
+            aqiForecast: pred.aqi,
+            aqiCategory: pred.category,
+            confidence: forecast.confidence,
+            modelVersion: forecast.modelVersion,
+            features: {
+              lookback_hours: 24,
             },
-          });
+          })),
+        });
+
+        if (forecast.timing) {
+          timing.devices++;
+          timing.fitMs += forecast.timing.fitMs;
+          timing.predictMs += forecast.timing.predictMs;
+          if (forecast.timing.incremental) timing.incremental++;
         }
 
         successCount++;
@@ -59,6 +65,14 @@ async function generateForecasts() {
       }
     }
 
+    if (timing.devices > 0) {
+      console.log(
+        `[FORECASTER] Holt-Winters: ${timing.devices} devices (${timing.incremental} incremental), ` +
+          `fit ${(timing.fitMs / timing.devices).toFixed(2)} ms/device (incl. query), ` +
+          `predict ${(timing.predictMs / timing.devices).toFixed(3)} ms/device`
+      );
+    }
+
     console.log(`[FORECASTER] Generated forecasts for ${successCount}/${devices.length} devices`);
   } catch (error) {
     console.error('[FORECASTER] Error in forecast job:', error);
@@ -5,7 +5,8 @@
 
 import cron from 'node-cron';
 import { db } from '../lib/db';
-import { analyzeHealthRisk } from '../ml/health-risk-model';
+import { loadAqiSeries, assessExposure } from '../ml/health-risk-model';
+import { computeExposure } from '../lib/exposure';
 
 export function startHealthAnalyzer() {
   // Run daily at 06:00
@@ -17,58 +18,69 @@ export function startHealthAnalyzer() {
   console.log('✅ Health analyzer job scheduled');
 }
 
+/**
+ * Exposure is computed once per device and fanned out to every subscriber of it
+ */
 async function generateHealthReports() {
   try {
-    // Get all users with active alert subscriptions
-    const users = await db.user.findMany({
-      where: { active: true },
-      include: {
-        alertSubs: {
-          where: { active: true, alertType: 'health_risk' },
-          include: { device: true },
-        },
+    const periodDays = 7;
+    const periodEnd = new Date();
+    const periodStart = new Date(periodEnd.getTime() - periodDays * 24 * 60 * 60 * 1000);
+
+    // Active health-risk subscriptions of active users, grouped by device
+    const subs = await db.alertSubscription.findMany({
+      where: {
+        active: true,
+        alertType: 'health_risk',
+        deviceId: { not: null },
+        user: { active: true },
       },
+      select: { userId: true, deviceId: true },
     });
 
-    let reportCount = 0;
+    const usersByDevice = new Map<string, Set<string>>();
+    for (const sub of subs) {
+      const users = usersByDevice.get(sub.deviceId!) ?? new Set<string>();
+      users.add(sub.userId);
+      usersByDevice.set(sub.deviceId!, users);
+    }
 
-    for (const user of users) {
-      for (const sub of user.alertSubs) {
-        if (!sub.deviceId) continue;
+    const started = Date.now();
+    let reportCount = 0;
 
-        const analysis = await analyzeHealthRisk({
-          deviceId: sub.deviceId,
-          userId: user.id,
-          periodDays: 7,
-        });
+    for (const [deviceId, userIds] of usersByDevice) {
+      const { ts, aqi } = await loadAqiSeries(deviceId, periodStart);
+      const exposure = computeExposure(ts, aqi);
+      if (!exposure) continue;
 
-        if (!analysis) continue;
+      const analysis = assessExposure(exposure, periodDays);
 
-        // Store health risk report
-        await db.healthRisk.create({
-          data: {
-            deviceId: sub.deviceId,
-            userId: user.id,
-            periodStart: new Date(Date.now() - 7 * 24 * 60 * 60 * 1000),
-            periodEnd: new Date(),
-            exposureScore: analysis.exposureScore,
-            asthmaRisk: analysis.diseaseRisks.asthma_risk,
-            copdRisk: analysis.diseaseRisks.copd_risk,
-            cardiovascularRisk: analysis.diseaseRisks.cardiovascular_risk,
-            allergyRisk: analysis.diseaseRisks.allergy_risk,
-            recommendations: analysis.recommendations,
-            avgAqi: analysis.stats.avgAqi,
-            peakAqi: analysis.stats.peakAqi,
-            hoursUnhealthy: analysis.stats.hoursUnhealthy,
-          },
-        });
+      // Store one health risk report per subscriber
+      const result = await db.healthRisk.createMany({
+        data: Array.from(userIds, (userId) => ({
+          deviceId,
+          userId,
+          periodStart,
+          periodEnd,
+          exposureScore: analysis.exposureScore,
+          asthmaRisk: analysis.diseaseRisks.asthma_risk,
+          copdRisk: analysis.diseaseRisks.copd_risk,
+          cardiovascularRisk: analysis.diseaseRisks.cardiovascular_risk,
+          allergyRisk: analysis.diseaseRisks.allergy_risk,
+          recommendations: analysis.recommendations,
+          avgAqi: analysis.stats.avgAqi,
+          peakAqi: analysis.stats.peakAqi,
+          hoursUnhealthy: analysis.stats.hoursUnhealthy,
+        })),
+      });
 
-        reportCount++;
-      }
+      reportCount += result.count;
     }
 
-    console.log(`[HEALTH] Generated ${reportCount} health reports`);
+    console.log(
+      `[HEALTH] Generated ${reportCount} health reports from ${usersByDevice.size} devices in ${Date.now() - started}ms`
+    );
   } catch (error) {
     console.error('[HEALTH] Error in health analyzer:', error);
   }
-}
\ No newline at end of file
+}
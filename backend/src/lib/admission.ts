@@ -0,0 +1,134 @@
+/**
+ * Ingest Admission Control
+ * Per-device token buckets plus a global in-flight limiter. Rejections carry a
+ * retry-after hint the firmware uses to back off instead of hammering the endpoint.
+ * With derived device keys, only requests whose device is authenticated up front draw
+ * on that device's bucket; the rest are charged to their source address, so forged ids
+ * can neither drain a real device's budget nor mint fresh buckets. Without them the
+ * claimed id is all there is, and a per-source ceiling bounds what one address can send.
+ */
+
+export type AdmissionResult =
+  | { admitted: true }
+  | { admitted: false; reason: 'device_rate' | 'source_rate' | 'overloaded'; retryAfterMs: number };
+
+interface Bucket {
+  tokens: number;
+  updatedAt: number;
+}
+
+export class TokenBuckets {
+  private buckets = new Map<string, Bucket>();
+  private readonly refillPerMs: number;
+
+  constructor(private readonly capacity: number, refillPerMinute: number) {
+    this.refillPerMs = refillPerMinute / 60_000;
+  }
+
+  /**
+   * Take one token for `key`. Returns 0 when admitted, otherwise ms until a token is available.
+   */
+  take(key: string, now = Date.now()): number {
+    let b = this.buckets.get(key);
+    if (!b) {
+      b = { tokens: this.capacity, updatedAt: now };
+      this.buckets.set(key, b);
+    } else {
+      b.tokens = Math.min(this.capacity, b.tokens + (now - b.updatedAt) * this.refillPerMs);
+      b.updatedAt = now;
+    }
+
+    if (b.tokens >= 1) {
+      b.tokens -= 1;
+      return 0;
+    }
+    return Math.ceil((1 - b.tokens) / this.refillPerMs);
+  }
+
+  /**
+   * Drop buckets that have refilled completely; they are indistinguishable from new ones
+   */
+  sweep(now = Date.now()) {
+    const fullAfterMs = this.capacity / this.refillPerMs;
+    for (const [key, b] of this.buckets) {
+      if (now - b.updatedAt >= fullAfterMs) this.buckets.delete(key);
+    }
+  }
+
+  get size(): number {
+    return this.buckets.size;
+  }
+}
+
+export class AdmissionController {
+  readonly buckets: TokenBuckets;
+  readonly sourceBuckets: TokenBuckets;
+  private inFlight = 0;
+
+  constructor(
+    capacity: number,
+    refillPerMinute: number,
+    private readonly maxInFlight: number,
+    private readonly overloadRetryMs: number,
+    sourceCapacity = capacity,
+    sourceRefillPerMinute = refillPerMinute
+  ) {
+    this.buckets = new TokenBuckets(capacity, refillPerMinute);
+    this.sourceBuckets = new TokenBuckets(sourceCapacity, sourceRefillPerMinute);
+  }
+
+  /**
+   * Admit a request from an authenticated `deviceId`. Admitted requests must call release() when done.
+   */
+  admit(deviceId: string, now = Date.now()): AdmissionResult {
+    return this.take(this.buckets, deviceId, 'device_rate', now);
+  }
+
+  /**
+   * Admit a request whose device could not be authenticated yet, charged to its source address
+   */
+  admitUnverified(source: string, now = Date.now()): AdmissionResult {
+    return this.take(this.sourceBuckets, source, 'source_rate', now);
+  }
+
+  /**
+   * Admit a request for a device id that cannot be authenticated at all (no derived keys):
+   * it draws on the claimed device's bucket and on its source address's ceiling. A device
+   * over its own rate is turned away before it spends its neighbors' shared ceiling.
+   */
+  admitClaimed(deviceId: string, source: string, now = Date.now()): AdmissionResult {
+    const first = this.take(this.buckets, deviceId, 'device_rate', now);
+    if (!first.admitted) return first;
+    const waitMs = this.sourceBuckets.take(source, now);
+    if (waitMs > 0) {
+      this.release();
+      return { admitted: false, reason: 'source_rate', retryAfterMs: waitMs };
+    }
+    return first;
+  }
+
+  sweep(now = Date.now()) {
+    this.buckets.sweep(now);
+    this.sourceBuckets.sweep(now);
+  }
+
+  release() {
+    if (this.inFlight > 0) this.inFlight--;
+  }
+
+  get active(): number {
+    return this.inFlight;
+  }
+
+  private take(buckets: TokenBuckets, key: string, reason: 'device_rate' | 'source_rate', now: number): AdmissionResult {
+    if (this.inFlight >= this.maxInFlight) {
+      return { admitted: false, reason: 'overloaded', retryAfterMs: this.overloadRetryMs };
+    }
+    const waitMs = buckets.take(key, now);
+    if (waitMs > 0) {
+      return { admitted: false, reason, retryAfterMs: waitMs };
+    }
+    this.inFlight++;
+    return { admitted: true };
+  }
+}
@@ -202,6 +202,19 @@ export function getAQICategory(aqi: number): {
   };
 }
 
+/**
+ * Get the stored category key (good, moderate, unhealthy_sensitive, ...) without
+ * building the full category metadata
+ */
+export function getAQICategoryKey(aqi: number): string {
+  if (aqi <= 50) return 'good';
+  if (aqi <= 100) return 'moderate';
+  if (aqi <= 150) return 'unhealthy_for_sensitive_groups';
+  if (aqi <= 200) return 'unhealthy';
+  if (aqi <= 300) return 'very_unhealthy';
+  return 'hazardous';
+}
+
 /**
  * Get health tip based on AQI category
  */
@@ -0,0 +1,126 @@
+/**
+ * Ingest Cluster Membership
+ * Rendezvous (highest-random-weight) hashing of device ids over the backend
+ * instances listed in CLUSTER_NODES. Each device has exactly one owner, so its
+ * per-device ingest state (replay filter, admission bucket, latest reading)
+ * stays in one process. Adding or removing a node only moves the devices that
+ * hash to it (~1/N of them); everything else keeps its owner.
+ */
+
+export interface ClusterNode {
+  id: string;
+  // Public base URL (scheme://host:port) nodes are redirected to
+  url: string;
+}
+
+// FNV-1a over UTF-16 code units; ids are short ASCII strings
+function fnv1a(s: string): number {
+  let h = 0x811c9dc5;
+  for (let i = 0; i < s.length; i++) {
+    h ^= s.charCodeAt(i);
+    h = Math.imul(h, 0x01000193);
+  }
+  return h >>> 0;
+}
+
+// murmur3 finalizer: spreads the combined hash so every bit matters
+function mix32(h: number): number {
+  h ^= h >>> 16;
+  h = Math.imul(h, 0x85ebca6b);
+  h ^= h >>> 13;
+  h = Math.imul(h, 0xc2b2ae35);
+  h ^= h >>> 16;
+  return h >>> 0;
+}
+
+/**
+ * Parse "id=url,id=url" (a bare url is its own id)
+ */
+export function parseClusterNodes(spec: string): ClusterNode[] {
+  return spec
+    .split(',')
+    .map((s) => s.trim())
+    .filter(Boolean)
+    .map((entry) => {
+      const eq = entry.indexOf('=');
+      const id = eq > 0 ? entry.slice(0, eq) : entry;
+      const url = (eq > 0 ? entry.slice(eq + 1) : entry).replace(/\/+$/, '');
+      return { id, url };
+    });
+}
+
+export class RendezvousRing {
+  readonly nodes: ClusterNode[];
+  private seeds: Uint32Array;
+
+  constructor(nodes: ClusterNode[]) {
+    // Sorted so every instance resolves ties identically regardless of list order
+    this.nodes = [...nodes].sort((a, b) => (a.id < b.id ? -1 : a.id > b.id ? 1 : 0));
+    this.seeds = Uint32Array.from(this.nodes.map((n) => fnv1a(n.id)));
+  }
+
+  ownerIndex(key: string): number {
+    const h = fnv1a(key);
+    let best = -1;
+    let bestScore = -1;
+    for (let i = 0; i < this.seeds.length; i++) {
+      const score = mix32(h ^ this.seeds[i]);
+      if (score > bestScore) {
+        bestScore = score;
+        best = i;
+      }
+    }
+    return best;
+  }
+
+  owner(key: string): ClusterNode | null {
+    const i = this.ownerIndex(key);
+    return i < 0 ? null : this.nodes[i];
+  }
+}
+
+/**
+ * This instance's view of the cluster. Devices acquired in the last `handoffMs`
+ * after a membership change have no local state yet; callers treat them as
+ * cold (exact duplicate checks) until the window has passed.
+ */
+export class ClusterMembership {
+  private ring: RendezvousRing;
+  private previous: RendezvousRing | null = null;
+  private changedAt = 0;
+
+  constructor(
+    readonly selfId: string,
+    nodes: ClusterNode[],
+    private readonly handoffMs: number
+  ) {
+    this.ring = new RendezvousRing(nodes);
+  }
+
+  get nodes(): ClusterNode[] {
+    return this.ring.nodes;
+  }
+
+  /**
+   * Null when this instance owns the device (or the cluster is empty)
+   */
+  redirectFor(deviceId: string): ClusterNode | null {
+    const owner = this.ring.owner(deviceId);
+    return owner && owner.id !== this.selfId ? owner : null;
+  }
+
+  owns(deviceId: string): boolean {
+    return this.redirectFor(deviceId) === null;
+  }
+
+  recentlyAcquired(deviceId: string, now = Date.now()): boolean {
+    if (!this.previous || now - this.changedAt >= this.handoffMs) return false;
+    return this.previous.owner(deviceId)?.id !== this.selfId && this.owns(deviceId);
+  }
+
+  update(nodes: ClusterNode[], now = Date.now()) {
+    this.previous = this.ring;
+    this.ring = new RendezvousRing(nodes);
+    this.changedAt = now;
+  }
+}
@@ -0,0 +1,125 @@
+/**
+ * Cold Measurement Store
+ * Reads compacted device-day segments back as measurement rows so range
+ * queries can span the hot table and the cold tier.
+ */
+
+import { db } from './db';
+import { config } from '../config';
+import { ColdRow, decodeSegment } from './columnar-segment';
+
+const DAY_MS = 24 * 60 * 60 * 1000;
+
+export type ColdMeasurement = ColdRow & { id: string; deviceId: string };
+
+export interface ColdQuery {
+  deviceId?: string;
+  start?: Date;
+  end?: Date;
+}
+
+/**
+ * Start of the UTC day before which readings live in the cold tier (null = tier disabled)
+ */
+export function coldCutoff(now = Date.now()): Date | null {
+  if (config.coldAfterDays <= 0) return null;
+  return new Date(Math.floor((now - config.coldAfterDays * DAY_MS) / DAY_MS) * DAY_MS);
+}
+
+/**
+ * Whether a query range can reach into the cold tier at all
+ */
+export function reachesCold(start?: Date): boolean {
+  const cutoff = coldCutoff();
+  return cutoff !== null && (!start || start < cutoff);
+}
+
+const SEGMENT_FETCH_BATCH = 32;
+
+/**
+ * Synthetic id of a cold row: segment, time, and position in the segment (several
+ * readings can share a timestamp, so the time alone is not unique)
+ */
+export function coldRowId(segmentId: string, measuredAt: Date, index: number): string {
+  return `${segmentId}:${measuredAt.getTime()}:${index}`;
+}
+
+/**
+ * Decoded segments overlapping the range, in periodStart order. Segment payloads are
+ * fetched a batch at a time so long ranges don't hold every blob in memory.
+ * `first` is the segment index of the earliest row kept (rows are stored time-sorted,
+ * so the range filter keeps a contiguous run).
+ */
+export async function* iterateColdSegments(
+  q: ColdQuery,
+  order: 'asc' | 'desc' = 'asc'
+): AsyncGenerator<{ id: string; deviceId: string; periodStart: Date; first: number; rows: ColdRow[] }> {
+  const metas = await db.measurementSegment.findMany({
+    where: {
+      deviceId: q.deviceId,
+      periodEnd: q.start ? { gt: q.start } : undefined,
+      periodStart: q.end ? { lte: q.end } : undefined,
+    },
+    orderBy: [{ periodStart: order }, { deviceId: 'asc' }],
+    select: { id: true },
+  });
+
+  for (let i = 0; i < metas.length; i += SEGMENT_FETCH_BATCH) {
+    const ids = metas.slice(i, i + SEGMENT_FETCH_BATCH).map((m) => m.id);
+    const batch = await db.measurementSegment.findMany({
+      where: { id: { in: ids } },
+      orderBy: [{ periodStart: order }, { deviceId: 'asc' }],
+    });
+    for (const seg of batch) {
+      const all = decodeSegment(seg.data);
+      const first = q.start ? all.findIndex((r) => r.measuredAt >= q.start!) : 0;
+      const rows = first < 0 ? [] : all.slice(first).filter((r) => !(q.end && r.measuredAt > q.end));
+      if (order === 'desc') rows.reverse();
+      yield { id: seg.id, deviceId: seg.deviceId, periodStart: seg.periodStart, first: Math.max(first, 0), rows };
+    }
+  }
+}
+
+/**
+ * Cold rows in range, ordered by measuredAt; stops decoding once `limit` rows are collected.
+ * Ids are synthetic (see coldRowId) since original row ids are not kept.
+ */
+export async function readColdMeasurements(
+  q: ColdQuery,
+  order: 'asc' | 'desc' = 'asc',
+  limit = Infinity
+): Promise<ColdMeasurement[]> {
+  const out: ColdMeasurement[] = [];
+  let lastDay: number | null = null;
+
+  for await (const seg of iterateColdSegments(q, order)) {
+    // Finish the current day first: other devices' segments for it may sort ahead
+    const day = seg.periodStart.getTime();
+    if (out.length >= limit && day !== lastDay) break;
+    lastDay = day;
+    seg.rows.forEach((row, i) => {
+      const index = seg.first + (order === 'asc' ? i : seg.rows.length - 1 - i);
+      out.push({ ...row, id: coldRowId(seg.id, row.measuredAt, index), deviceId: seg.deviceId });
+    });
+  }
+
+  // Segments are per device, so multi-device reads need a global time order
+  if (!q.deviceId) {
+    out.sort((a, b) =>
+      order === 'asc' ? a.measuredAt.getTime() - b.measuredAt.getTime() : b.measuredAt.getTime() - a.measuredAt.getTime()
+    );
+  }
+  return out.length > limit ? out.slice(0, limit) : out;
+}
+
+/**
+ * Look up one cold row by its synthetic id
+ */
+export async function findColdMeasurement(id: string): Promise<ColdMeasurement | null> {
+  const match = /^(.+):(\d+):(\d+)$/.exec(id);
+  if (!match) return null;
+  const segment = await db.measurementSegment.findUnique({ where: { id: match[1] } });
+  if (!segment) return null;
+  const row = decodeSegment(segment.data)[Number(match[3])];
+  return row && row.measuredAt.getTime() === Number(match[2]) ? { ...row, id, deviceId: segment.deviceId } : null;
+}
@@ -0,0 +1,310 @@
+/**
+ * Columnar Measurement Segments
+ * Cold-tier encoding for one device-day of raw readings: each field is stored
+ * as its own column (delta-encoded timestamps, scaled-integer deltas for
+ * decimals, dictionaries for repeated strings/JSON) and the whole buffer is
+ * deflated. Decimal columns fall back to raw float64 when scaling would lose
+ * precision, so round trips are exact.
+ */
+
+import zlib from 'zlib';
+
+const MAGIC = 0x41475331; // "AGS1"
+
+// Float columns, in storage order
+export const FLOAT_COLUMNS = [
+  'mq135Raw',
+  'iaqScore',
+  'co2Equiv',
+  'temperature',
+  'humidity',
+  'pressureHpa',
+  'altitudeM',
+  'pm25Estimated',
+  'pm25Api',
+  'pm10Api',
+  'uvIndex',
+  'aqiCalculated',
+] as const;
+
+type FloatColumn = (typeof FLOAT_COLUMNS)[number];
+
+export type ColdRow = { measuredAt: Date } & Record<FloatColumn, number | null> & {
+  rssi: number | null;
+  uptime: bigint | null;
+  aqiCategory: string | null;
+  externalData: unknown;
+  qualityFlags: unknown;
+};
+
+const enum FloatEncoding {
+  Scaled = 0,
+  Raw = 1,
+}
+
+// Decimal places tried for the scaled-integer encoding
+const SCALE = 100;
+
+// ---------------------------------------------------------------------------
+// Byte helpers
+// ---------------------------------------------------------------------------
+
+class Writer {
+  private buf = Buffer.alloc(4096);
+  private pos = 0;
+
+  private ensure(n: number) {
+    if (this.pos + n <= this.buf.length) return;
+    const next = Buffer.alloc(Math.max(this.buf.length * 2, this.pos + n));
+    this.buf.copy(next, 0, 0, this.pos);
+    this.buf = next;
+  }
+
+  u8(v: number) {
+    this.ensure(1);
+    this.buf[this.pos++] = v;
+  }
+
+  u32(v: number) {
+    this.ensure(4);
+    this.buf.writeUInt32LE(v, this.pos);
+    this.pos += 4;
+  }
+
+  f64(v: number) {
+    this.ensure(8);
+    this.buf.writeDoubleLE(v, this.pos);
+    this.pos += 8;
+  }
+
+  // Unsigned LEB128; values up to 2^53
+  varint(v: number) {
+    this.ensure(10);
+    while (v >= 0x80) {
+      this.buf[this.pos++] = (v % 0x80) | 0x80;
+      v = Math.floor(v / 0x80);
+    }
+    this.buf[this.pos++] = v;
+  }
+
+  zigzag(v: number) {
+    this.varint(v >= 0 ? v * 2 : -v * 2 - 1);
+  }
+
+  str(s: string) {
+    const bytes = Buffer.from(s, 'utf8');
+    this.varint(bytes.length);
+    this.ensure(bytes.length);
+    bytes.copy(this.buf, this.pos);
+    this.pos += bytes.length;
+  }
+
+  bitmap(bits: boolean[]) {
+    const bytes = Math.ceil(bits.length / 8);
+    this.ensure(bytes);
+    for (let i = 0; i < bytes; i++) {
+      let b = 0;
+      for (let k = 0; k < 8 && i * 8 + k < bits.length; k++) if (bits[i * 8 + k]) b |= 1 << k;
+      this.buf[this.pos++] = b;
+    }
+  }
+
+  finish(): Buffer {
+    return this.buf.subarray(0, this.pos);
+  }
+}
+
+class Reader {
+  private pos = 0;
+
+  constructor(private readonly buf: Buffer) {}
+
+  u8(): number {
+    return this.buf[this.pos++];
+  }
+
+  u32(): number {
+    const v = this.buf.readUInt32LE(this.pos);
+    this.pos += 4;
+    return v;
+  }
+
+  f64(): number {
+    const v = this.buf.readDoubleLE(this.pos);
+    this.pos += 8;
+    return v;
+  }
+
+  varint(): number {
+    let result = 0;
+    let scale = 1;
+    for (;;) {
+      const b = this.buf[this.pos++];
+      if (b === undefined) throw new Error('Truncated segment');
+      result += (b & 0x7f) * scale;
+      if (b < 0x80) return result;
+      scale *= 0x80;
+    }
+  }
+
+  zigzag(): number {
+    const v = this.varint();
+    return v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+  }
+
+  str(): string {
+    const len = this.varint();
+    const s = this.buf.toString('utf8', this.pos, this.pos + len);
+    this.pos += len;
+    return s;
+  }
+
+  bitmap(n: number): boolean[] {
+    const out = new Array<boolean>(n);
+    for (let i = 0; i < n; i++) out[i] = (this.buf[this.pos + (i >> 3)] & (1 << (i & 7))) !== 0;
+    this.pos += Math.ceil(n / 8);
+    return out;
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Column codecs
+// ---------------------------------------------------------------------------
+
+function writeNumbers(w: Writer, values: Array<number | null>) {
+  const present = values.map((v) => v !== null);
+  w.bitmap(present);
+  const nums = values.filter((v): v is number => v !== null);
+
+  const scaled = nums.map((v) => Math.round(v * SCALE));
+  const exact = scaled.every((s, i) => Number.isSafeInteger(s) && s / SCALE === nums[i]);
+  if (exact) {
+    w.u8(FloatEncoding.Scaled);
+    let prev = 0;
+    for (const s of scaled) {
+      w.zigzag(s - prev);
+      prev = s;
+    }
+  } else {
+    w.u8(FloatEncoding.Raw);
+    for (const v of nums) w.f64(v);
+  }
+}
+
+function readNumbers(r: Reader, n: number): Array<number | null> {
+  const present = r.bitmap(n);
+  const encoding = r.u8();
+  const out = new Array<number | null>(n);
+  let prev = 0;
+  for (let i = 0; i < n; i++) {
+    if (!present[i]) {
+      out[i] = null;
+    } else if (encoding === FloatEncoding.Scaled) {
+      prev += r.zigzag();
+      out[i] = prev / SCALE;
+    } else {
+      out[i] = r.f64();
+    }
+  }
+  return out;
+}
+
+// Strings (and serialized JSON) via a per-segment dictionary; index 0 = null
+function writeDictionary(w: Writer, values: Array<string | null>) {
+  const dict = new Map<string, number>();
+  const indices = values.map((v) => {
+    if (v === null) return 0;
+    let idx = dict.get(v);
+    if (idx === undefined) {
+      idx = dict.size + 1;
+      dict.set(v, idx);
+    }
+    return idx;
+  });
+  w.varint(dict.size);
+  for (const key of dict.keys()) w.str(key);
+  for (const idx of indices) w.varint(idx);
+}
+
+function readDictionary<T>(r: Reader, n: number, parse: (s: string) => T): Array<T | null> {
+  const size = r.varint();
+  // Each distinct entry is parsed once; rows sharing it share the value
+  const dict: T[] = [];
+  for (let i = 0; i < size; i++) dict.push(parse(r.str()));
+  const out = new Array<T | null>(n);
+  for (let i = 0; i < n; i++) {
+    const idx = r.varint();
+    out[i] = idx === 0 ? null : dict[idx - 1];
+  }
+  return out;
+}
+
+function jsonOrNull(v: unknown): string | null {
+  return v === null || v === undefined ? null : JSON.stringify(v);
+}
+
+// ---------------------------------------------------------------------------
+// Segment encode/decode
+// ---------------------------------------------------------------------------
+
+/**
+ * Encode rows (any order; stored sorted by measuredAt) into a compressed segment
+ */
+export function encodeSegment(input: ColdRow[]): Buffer {
+  const rows = [...input].sort((a, b) => a.measuredAt.getTime() - b.measuredAt.getTime());
+  const w = new Writer();
+  w.u32(MAGIC);
+  w.varint(rows.length);
+
+  let prevTs = 0;
+  for (const row of rows) {
+    const ts = row.measuredAt.getTime();
+    w.zigzag(ts - prevTs);
+    prevTs = ts;
+  }
+
+  for (const col of FLOAT_COLUMNS) writeNumbers(w, rows.map((r) => r[col]));
+  writeNumbers(w, rows.map((r) => r.rssi));
+  writeNumbers(w, rows.map((r) => (r.uptime !== null ? Number(r.uptime) : null)));
+  writeDictionary(w, rows.map((r) => r.aqiCategory));
+  writeDictionary(w, rows.map((r) => jsonOrNull(r.qualityFlags)));
+  writeDictionary(w, rows.map((r) => jsonOrNull(r.externalData)));
+
+  return zlib.deflateSync(w.finish(), { level: 9 });
+}
+
+export function decodeSegment(data: Buffer): ColdRow[] {
+  const r = new Reader(zlib.inflateSync(data));
+  if (r.u32() !== MAGIC) throw new Error('Not a measurement segment');
+  const n = r.varint();
+
+  const ts: number[] = [];
+  let prev = 0;
+  for (let i = 0; i < n; i++) {
+    prev += r.zigzag();
+    ts.push(prev);
+  }
+
+  const floats = {} as Record<FloatColumn, Array<number | null>>;
+  for (const col of FLOAT_COLUMNS) floats[col] = readNumbers(r, n);
+  const rssi = readNumbers(r, n);
+  const uptime = readNumbers(r, n);
+  const category = readDictionary(r, n, (v) => v);
+  const flags = readDictionary<unknown>(r, n, JSON.parse);
+  const external = readDictionary<unknown>(r, n, JSON.parse);
+
+  const rows: ColdRow[] = [];
+  for (let i = 0; i < n; i++) {
+    const row = {
+      measuredAt: new Date(ts[i]),
+      rssi: rssi[i],
+      uptime: uptime[i] !== null ? BigInt(uptime[i]!) : null,
+      aqiCategory: category[i],
+      qualityFlags: flags[i],
+      externalData: external[i],
+    } as ColdRow;
+    for (const col of FLOAT_COLUMNS) row[col] = floats[col][i];
+    rows.push(row);
+  }
+  return rows;
+}
@@ -0,0 +1,164 @@
+/**
+ * Streaming CSV Export
+ * Walks measurement history with keyset pagination on (measuredAt, id) and
+ * yields one CSV chunk per page, so memory stays bounded by the page size
+ * regardless of how many years or devices the export covers. Compacted
+ * (cold-tier) readings are decoded a day at a time and merged in by time.
+ */
+
+import { Prisma } from '@prisma/client';
+import { db } from './db';
+import type { ColdQuery } from './cold-store';
+
+export const CSV_HEADER =
+  'timestamp,device_id,iaq_score,co2_equiv,temperature,humidity,pressure_hpa,pm25_api,aqi_calculated,aqi_category\n';
+
+const exportSelect = {
+  id: true,
+  measuredAt: true,
+  deviceId: true,
+  iaqScore: true,
+  co2Equiv: true,
+  temperature: true,
+  humidity: true,
+  pressureHpa: true,
+  pm25Api: true,
+  aqiCalculated: true,
+  aqiCategory: true,
+} satisfies Prisma.MeasurementSelect;
+
+export type ExportRow = Prisma.MeasurementGetPayload<{ select: typeof exportSelect }>;
+
+// Number#toString already emits the shortest round-trip representation
+function numField(v: number | null): string {
+  return v === null ? '' : String(v);
+}
+
+function strField(v: string | null): string {
+  if (v === null) return '';
+  return /[",\n\r]/.test(v) ? `"${v.replace(/"/g, '""')}"` : v;
+}
+
+/**
+ * Format a page of rows into one CSV string (single concatenation, no per-row arrays)
+ */
+export function formatCsvRows(rows: ExportRow[]): string {
+  let out = '';
+  for (const m of rows) {
+    out +=
+      m.measuredAt.toISOString() + ',' +
+      strField(m.deviceId) + ',' +
+      numField(m.iaqScore) + ',' +
+      numField(m.co2Equiv) + ',' +
+      numField(m.temperature) + ',' +
+      numField(m.humidity) + ',' +
+      numField(m.pressureHpa) + ',' +
+      numField(m.pm25Api) + ',' +
+      numField(m.aqiCalculated) + ',' +
+      strField(m.aqiCategory) + '\n';
+  }
+  return out;
+}
+
+/**
+ * Hot rows in (measuredAt, id) order, fetched a page at a time with a keyset cursor
+ */
+async function* hotRows(where: Prisma.MeasurementWhereInput, limit: number, pageSize: number): AsyncGenerator<ExportRow> {
+  let cursor: { measuredAt: Date; id: string } | null = null;
+  let remaining = limit;
+
+  while (remaining > 0) {
+    const page: ExportRow[] = await db.measurement.findMany({
+      where: cursor
+        ? {
+            AND: [
+              where,
+              {
+                OR: [
+                  { measuredAt: { gt: cursor.measuredAt } },
+                  { measuredAt: cursor.measuredAt, id: { gt: cursor.id } },
+                ],
+              },
+            ],
+          }
+        : where,
+      orderBy: [{ measuredAt: 'asc' }, { id: 'asc' }],
+      take: Math.min(pageSize, remaining),
+      select: exportSelect,
+    });
+    yield* page;
+
+    remaining -= page.length;
+    if (page.length < pageSize) break;
+    const last = page[page.length - 1];
+    cursor = { measuredAt: last.measuredAt, id: last.id };
+  }
+}
+
+/**
+ * Cold rows in time order. Segments are per device and day, so each day's segments
+ * are collected and sorted together; days don't overlap, so that is a global order.
+ */
+async function* coldRows(cold: ColdQuery): AsyncGenerator<ExportRow> {
+  // Loaded lazily: the cold store reads config, which the formatter benchmark runs without
+  const { iterateColdSegments, coldRowId } = await import('./cold-store');
+  let day: ExportRow[] = [];
+  let dayStart: number | null = null;
+
+  for await (const seg of iterateColdSegments(cold)) {
+    if (seg.periodStart.getTime() !== dayStart) {
+      yield* day.sort((a, b) => a.measuredAt.getTime() - b.measuredAt.getTime());
+      day = [];
+      dayStart = seg.periodStart.getTime();
+    }
+    seg.rows.forEach((r, i) => day.push({ ...r, id: coldRowId(seg.id, r.measuredAt, seg.first + i), deviceId: seg.deviceId }));
+  }
+  yield* day.sort((a, b) => a.measuredAt.getTime() - b.measuredAt.getTime());
+}
+
+/**
+ * Yield the CSV header and then one chunk per page of matching measurements.
+ * `limit` caps the total row count (undefined = everything in range).
+ * Cold and hot rows are merged by time: readings that arrived late or are not compacted
+ * yet can sit in the hot table on either side of the cold cutoff.
+ */
+export async function* streamMeasurementsCsv(
+  where: Prisma.MeasurementWhereInput,
+  limit?: number,
+  cold?: ColdQuery,
+  pageSize = 5000
+): AsyncGenerator<string> {
+  yield CSV_HEADER;
+
+  const remaining = limit ?? Infinity;
+  const hot = hotRows(where, remaining, pageSize);
+  const coldIter = cold ? coldRows(cold) : null;
+
+  let h = await hot.next();
+  let c = coldIter ? await coldIter.next() : null;
+  let page: ExportRow[] = [];
+  let written = 0;
+
+  while (written < remaining) {
+    let row: ExportRow;
+    if (c && !c.done && (h.done || c.value.measuredAt <= h.value.measuredAt)) {
+      row = c.value;
+      c = await coldIter!.next();
+    } else if (!h.done) {
+      row = h.value;
+      h = await hot.next();
+    } else {
+      break;
+    }
+
+    page.push(row);
+    written++;
+    if (page.length >= pageSize) {
+      yield formatCsvRows(page);
+      page = [];
+    }
+  }
+  if (page.length > 0) yield formatCsvRows(page);
+  await hot.return(undefined);
+  if (coldIter) await coldIter.return(undefined);
+}
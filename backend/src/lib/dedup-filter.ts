@@ -0,0 +1,202 @@
+/**
+ * Replay Duplicate Filter
+ * Time-partitioned cuckoo filter over recently ingested reading keys. A miss
+ * means "definitely new"; a hit means "maybe seen" and the caller confirms it
+ * with an exact lookup, so only replays (and rare false positives) touch the DB.
+ *
+ * Memory is `partitions` cuckoo tables of `slotsPerPartition` 16-bit fingerprints
+ * each. The oldest partition is cleared on rotation. A partition that fills up before
+ * its time slot ends chains another table rather than evicting keys still in the window.
+ */
+
+const SLOTS_PER_BUCKET = 4;
+const MAX_KICKS = 500;
+
+// FNV-1a over UTF-16 code units with a caller-chosen offset basis
+function fnv1a(key: string, basis: number): number {
+  let h = basis;
+  for (let i = 0; i < key.length; i++) {
+    h ^= key.charCodeAt(i);
+    h = Math.imul(h, 0x01000193);
+  }
+  // Final avalanche (murmur3 fmix32) so low bits are usable as a bucket index
+  h ^= h >>> 16;
+  h = Math.imul(h, 0x85ebca6b);
+  h ^= h >>> 13;
+  h = Math.imul(h, 0xc2b2ae35);
+  h ^= h >>> 16;
+  return h >>> 0;
+}
+
+// Kick chain of the insert in progress, for undoing it when the table is full
+const kickSlots = new Int32Array(MAX_KICKS);
+const kickPrev = new Uint16Array(MAX_KICKS);
+
+class CuckooTable {
+  readonly slots: Uint16Array;
+  private readonly mask: number;
+  count = 0;
+
+  constructor(buckets: number) {
+    this.slots = new Uint16Array(buckets * SLOTS_PER_BUCKET);
+    this.mask = buckets - 1;
+  }
+
+  private alt(index: number, fp: number): number {
+    return (index ^ Math.imul(fp, 0x5bd1e995)) & this.mask;
+  }
+
+  private hasIn(bucket: number, fp: number): boolean {
+    const s = bucket * SLOTS_PER_BUCKET;
+    const slots = this.slots;
+    return slots[s] === fp || slots[s + 1] === fp || slots[s + 2] === fp || slots[s + 3] === fp;
+  }
+
+  private putIn(bucket: number, fp: number): boolean {
+    const s = bucket * SLOTS_PER_BUCKET;
+    for (let k = 0; k < SLOTS_PER_BUCKET; k++) {
+      if (this.slots[s + k] === 0) {
+        this.slots[s + k] = fp;
+        return true;
+      }
+    }
+    return false;
+  }
+
+  contains(h: number, fp: number): boolean {
+    const i1 = h & this.mask;
+    return this.hasIn(i1, fp) || this.hasIn(this.alt(i1, fp), fp);
+  }
+
+  /**
+   * Returns false when the table is too full to place the fingerprint; the
+   * table is then left exactly as it was, so no resident is lost
+   */
+  insert(h: number, fp: number): boolean {
+    const i1 = h & this.mask;
+    const i2 = this.alt(i1, fp);
+    if (this.putIn(i1, fp) || this.putIn(i2, fp)) {
+      this.count++;
+      return true;
+    }
+
+    // Evict a random resident and relocate it to its alternate bucket
+    let index = Math.random() < 0.5 ? i1 : i2;
+    let cur = fp;
+    for (let n = 0; n < MAX_KICKS; n++) {
+      const slot = index * SLOTS_PER_BUCKET + ((Math.random() * SLOTS_PER_BUCKET) | 0);
+      const evicted = this.slots[slot];
+      kickSlots[n] = slot;
+      kickPrev[n] = evicted;
+      this.slots[slot] = cur;
+      cur = evicted;
+      index = this.alt(index, cur);
+      if (this.putIn(index, cur)) {
+        this.count++;
+        return true;
+      }
+    }
+
+    // No home for the fingerprint still being carried (another key's): unwind the chain
+    for (let n = MAX_KICKS - 1; n >= 0; n--) this.slots[kickSlots[n]] = kickPrev[n];
+    return false;
+  }
+
+  clear() {
+    this.slots.fill(0);
+    this.count = 0;
+  }
+}
+
+export interface DedupStats {
+  inserts: number;
+  hits: number;
+  rotations: number;
+  saturations: number; // Overflow tables chained because a partition filled before its time slot ended
+}
+
+export class ReplayFilter {
+  // Per time slot: the partition's table, plus overflow tables chained when it fills up
+  private readonly partitions: CuckooTable[][];
+  private readonly buckets: number;
+  private readonly partitionMs: number;
+  private current = 0;
+  private currentStart: number;
+  readonly stats: DedupStats = { inserts: 0, hits: 0, rotations: 0, saturations: 0 };
+
+  constructor(opts: { windowMs: number; partitions: number; slotsPerPartition: number }, now = Date.now()) {
+    // Round buckets to a power of two for mask indexing
+    let buckets = 1;
+    while (buckets * SLOTS_PER_BUCKET < opts.slotsPerPartition) buckets <<= 1;
+    this.buckets = buckets;
+    this.partitions = Array.from({ length: opts.partitions }, () => [new CuckooTable(buckets)]);
+    this.partitionMs = Math.ceil(opts.windowMs / opts.partitions);
+    this.currentStart = now;
+  }
+
+  static key(deviceId: string, timestampMs: number, seq: number | null): string {
+    return `${deviceId}|${timestampMs}|${seq ?? ''}`;
+  }
+
+  /**
+   * Record a key; returns true if it may have been seen within the window
+   * (confirm with an exact check before treating it as a duplicate).
+   */
+  checkAndInsert(key: string, now = Date.now()): boolean {
+    this.maybeRotate(now);
+    const h = fnv1a(key, 0x811c9dc5);
+    const fp = (fnv1a(key, 0x050c5d1f) & 0xffff) || 1;
+
+    for (const partition of this.partitions) {
+      for (const t of partition) {
+        if (t.count > 0 && t.contains(h, fp)) {
+          this.stats.hits++;
+          return true;
+        }
+      }
+    }
+
+    const partition = this.partitions[this.current];
+    if (!partition[partition.length - 1].insert(h, fp)) {
+      // Full before its time slot ended: every key in it is still inside the window, so
+      // chain another table (released on rotation) instead of clearing one early
+      this.stats.saturations++;
+      console.warn('[DEDUP] Replay filter partition full before its time slot ended; raise DEDUP_PARTITION_SLOTS');
+      const overflow = new CuckooTable(this.buckets);
+      overflow.insert(h, fp);
+      partition.push(overflow);
+    }
+    this.stats.inserts++;
+    return false;
+  }
+
+  private maybeRotate(now: number) {
+    // Idle longer than the whole window: every partition is stale
+    if (now - this.currentStart >= this.partitionMs * this.partitions.length) {
+      this.partitions.forEach((_, i) => this.clearPartition(i));
+      this.currentStart = now;
+      this.stats.rotations++;
+      return;
+    }
+    while (now - this.currentStart >= this.partitionMs) {
+      this.rotate(this.currentStart + this.partitionMs);
+    }
+  }
+
+  private rotate(start: number) {
+    this.current = (this.current + 1) % this.partitions.length;
+    this.clearPartition(this.current);
+    this.currentStart = start;
+    this.stats.rotations++;
+  }
+
+  private clearPartition(i: number) {
+    const partition = this.partitions[i];
+    partition.length = 1;
+    partition[0].clear();
+  }
+
+  get memoryBytes(): number {
+    return this.partitions.reduce((n, p) => p.reduce((m, t) => m + t.slots.byteLength, n), 0);
+  }
+}
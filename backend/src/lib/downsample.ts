@@ -0,0 +1,98 @@
+/**
+ * Time Series Downsampling
+ * Reduce a time-ordered series to a fixed number of chart points.
+ * - LTTB (Largest-Triangle-Three-Buckets) keeps the visual shape of the line
+ * - min/max per time bucket keeps every spike, at two points per bucket
+ * Both return indices into the input so callers can pick any columns they need.
+ */
+
+export type DownsampleMethod = 'lttb' | 'minmax';
+
+function allIndices(n: number): number[] {
+  return Array.from({ length: n }, (_, i) => i);
+}
+
+/**
+ * LTTB over x (timestamps, ascending) and y. Always keeps the first and last point.
+ */
+export function lttb(xs: ArrayLike<number>, ys: ArrayLike<number>, threshold: number): number[] {
+  const n = xs.length;
+  if (threshold >= n || threshold < 3) return allIndices(n);
+
+  const out: number[] = [0];
+  const every = (n - 2) / (threshold - 2);
+  let a = 0;
+
+  for (let i = 0; i < threshold - 2; i++) {
+    // Average of the next bucket is the third triangle vertex
+    const avgStart = Math.floor((i + 1) * every) + 1;
+    const avgEnd = Math.min(Math.floor((i + 2) * every) + 1, n);
+    let avgX = 0;
+    let avgY = 0;
+    for (let j = avgStart; j < avgEnd; j++) {
+      avgX += xs[j];
+      avgY += ys[j];
+    }
+    const avgLen = avgEnd - avgStart;
+    avgX /= avgLen;
+    avgY /= avgLen;
+
+    // Pick the point in this bucket forming the largest triangle with `a` and the average
+    const rangeStart = Math.floor(i * every) + 1;
+    const rangeEnd = Math.floor((i + 1) * every) + 1;
+    const ax = xs[a];
+    const ay = ys[a];
+    let maxArea = -1;
+    let next = rangeStart;
+    for (let j = rangeStart; j < rangeEnd; j++) {
+      const area = Math.abs((ax - avgX) * (ys[j] - ay) - (ax - xs[j]) * (avgY - ay));
+      if (area > maxArea) {
+        maxArea = area;
+        next = j;
+      }
+    }
+    out.push(next);
+    a = next;
+  }
+
+  out.push(n - 1);
+  return out;
+}
+
+/**
+ * Min and max of y per equal-width time bucket (`threshold / 2` buckets), in time order
+ */
+export function minMaxBuckets(xs: ArrayLike<number>, ys: ArrayLike<number>, threshold: number): number[] {
+  const n = xs.length;
+  const buckets = Math.floor(threshold / 2);
+  if (threshold >= n || buckets < 1) return allIndices(n);
+
+  const x0 = xs[0];
+  const width = (xs[n - 1] - x0) / buckets || 1;
+  const out: number[] = [];
+
+  let i = 0;
+  for (let b = 0; b < buckets && i < n; b++) {
+    const bucketEnd = b === buckets - 1 ? Infinity : x0 + (b + 1) * width;
+    let minIdx = -1;
+    let maxIdx = -1;
+    for (; i < n && xs[i] < bucketEnd; i++) {
+      if (minIdx < 0 || ys[i] < ys[minIdx]) minIdx = i;
+      if (maxIdx < 0 || ys[i] > ys[maxIdx]) maxIdx = i;
+    }
+    if (minIdx < 0) continue; // Empty bucket (gap in the data)
+    if (minIdx === maxIdx) out.push(minIdx);
+    else if (minIdx < maxIdx) out.push(minIdx, maxIdx);
+    else out.push(maxIdx, minIdx);
+  }
+  return out;
+}
+
+export function downsample(
+  xs: ArrayLike<number>,
+  ys: ArrayLike<number>,
+  threshold: number,
+  method: DownsampleMethod = 'lttb'
+): number[] {
+  return method === 'minmax' ? minMaxBuckets(xs, ys, threshold) : lttb(xs, ys, threshold);
+}
@@ -1,9 +1,27 @@
+import cluster from 'node:cluster';
 import { EventEmitter } from 'node:events';
 
 export const events = new EventEmitter();
 // Allow many listeners (SSE clients)
 events.setMaxListeners(0);
 
+export const RELAY_MESSAGE = 'aeroguard:event';
+
+/**
+ * Emit locally and, in a multi-core deployment, on every other worker too
+ * (relayed by the primary), so listeners such as SSE streams see all events.
+ */
+export function publish(name: string, payload: unknown) {
+  events.emit(name, payload);
+  if (cluster.isWorker && process.send) process.send({ type: RELAY_MESSAGE, name, payload });
+}
+
+if (cluster.isWorker) {
+  process.on('message', (msg: any) => {
+    if (msg?.type === RELAY_MESSAGE) events.emit(msg.name, msg.payload);
+  });
+}
+
 export type MeasurementEvent = {
   deviceId: string;
   deviceName?: string | null;
@@ -13,4 +31,5 @@ export type MeasurementEvent = {
   temperature: number | null;
   humidity: number | null;
   pressureHpa: number | null;
+  alert?: string | null; // Priority uplink reason (category change or threshold breach)
 };
@@ -0,0 +1,80 @@
+/**
+ * Exposure Metrics
+ * Single-pass reductions over a device's AQI series held in typed arrays:
+ * time-weighted average, hours above thresholds and the worst rolling window.
+ * Computed once per device and shared by every user subscribed to it.
+ */
+
+// A reading stands for at most this long; longer gaps count as missing data
+const MAX_SAMPLE_MS = 15 * 60 * 1000;
+const PEAK_WINDOW_MS = 60 * 60 * 1000;
+
+export const EXPOSURE_THRESHOLDS = [100, 150, 200] as const;
+
+export interface ExposureMetrics {
+  samples: number;
+  avgAqi: number;
+  timeWeightedAqi: number;
+  peakAqi: number;
+  coveredHours: number;
+  // Hours above each EXPOSURE_THRESHOLDS entry
+  hoursAbove: Record<number, number>;
+  // Fraction of covered time above 100
+  unhealthyFraction: number;
+  peakWindow: { start: number; end: number; avgAqi: number };
+}
+
+/**
+ * `ts` must be ascending epoch ms; `aqi` is the matching value column
+ */
+export function computeExposure(ts: Float64Array, aqi: Float64Array): ExposureMetrics | null {
+  const n = ts.length;
+  if (n === 0) return null;
+
+  let sum = 0;
+  let weightedSum = 0;
+  let coveredMs = 0;
+  let peak = -Infinity;
+  const aboveMs = new Float64Array(EXPOSURE_THRESHOLDS.length);
+
+  for (let i = 0; i < n; i++) {
+    const v = aqi[i];
+    sum += v;
+    if (v > peak) peak = v;
+
+    // Each reading holds until the next one (capped); the last reuses the previous interval
+    const span = i + 1 < n ? ts[i + 1] - ts[i] : i > 0 ? ts[i] - ts[i - 1] : MAX_SAMPLE_MS;
+    const w = Math.min(Math.max(span, 0), MAX_SAMPLE_MS);
+    weightedSum += v * w;
+    coveredMs += w;
+    for (let k = 0; k < EXPOSURE_THRESHOLDS.length; k++) {
+      if (v > EXPOSURE_THRESHOLDS[k]) aboveMs[k] += w;
+    }
+  }
+
+  // Worst rolling one-hour mean (two pointers over the sorted timestamps)
+  let windowSum = 0;
+  let lo = 0;
+  let best = { start: ts[0], end: ts[0], avgAqi: aqi[0] };
+  for (let hi = 0; hi < n; hi++) {
+    windowSum += aqi[hi];
+    while (ts[hi] - ts[lo] > PEAK_WINDOW_MS) windowSum -= aqi[lo++];
+    const mean = windowSum / (hi - lo + 1);
+    if (mean > best.avgAqi) best = { start: ts[lo], end: ts[hi], avgAqi: mean };
+  }
+
+  const avgAqi = sum / n;
+  const hoursAbove: Record<number, number> = {};
+  EXPOSURE_THRESHOLDS.forEach((t, k) => (hoursAbove[t] = aboveMs[k] / 3_600_000));
+
+  return {
+    samples: n,
+    avgAqi,
+    timeWeightedAqi: coveredMs > 0 ? weightedSum / coveredMs : avgAqi,
+    peakAqi: peak,
+    coveredHours: coveredMs / 3_600_000,
+    hoursAbove,
+    unhealthyFraction: coveredMs > 0 ? aboveMs[0] / coveredMs : 0,
+    peakWindow: best,
+  };
+}
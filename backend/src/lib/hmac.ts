@@ -1,14 +1,20 @@
 import crypto from 'crypto';
 
+const SIGNATURE_HEX = /^[0-9a-f]{64}$/i;
+
 export function verifyHMAC(payload: string, signature: string, secret: string): boolean {
+  // timingSafeEqual throws when the buffers differ in length, which a string length check
+  // misses for multibyte input; anything but 64 hex chars is simply an invalid signature
+  if (typeof signature !== 'string' || !SIGNATURE_HEX.test(signature)) return false;
+
   const expectedSignature = crypto
     .createHmac('sha256', secret)
     .update(payload)
-    .digest('hex');
-  
+    .digest();
+
   return crypto.timingSafeEqual(
-    Buffer.from(signature),
-    Buffer.from(expectedSignature)
+    Buffer.from(signature, 'hex'),
+    expectedSignature
   );
 }
 
@@ -18,4 +24,17 @@ export function generateAPIKey(deviceId: string, salt: string): string {
     .update(deviceId + salt + Date.now().toString())
     .digest('hex')
     .substring(0, 32);
-}
\ No newline at end of file
+}
+
+/**
+ * Device key derived from the master secret: HMAC-SHA256(master, deviceId), as 32 hex
+ * chars like generateAPIKey(). Ingest can recompute it from the device_id in the payload,
+ * so signatures are checked without loading the device row.
+ */
+export function deriveDeviceKey(masterKey: string, deviceId: string): string {
+  return crypto
+    .createHmac('sha256', masterKey)
+    .update(deviceId)
+    .digest('hex')
+    .substring(0, 32);
+}
@@ -0,0 +1,143 @@
+/**
+ * Holt-Winters Forecasting
+ * Additive level + damped trend + daily season over hourly AQI buckets.
+ * State is small and updated one hour at a time, so a device's model is
+ * fitted once and then kept current from new readings only.
+ */
+
+export const HOURS_PER_DAY = 24;
+const DAMPING = 0.98;
+const ALPHAS = [0.1, 0.3, 0.5];
+const GAMMAS = [0.05, 0.2, 0.4];
+const BETA = 0.02;
+
+export interface HoltWintersState {
+  alpha: number;
+  beta: number;
+  gamma: number;
+  level: number;
+  trend: number;
+  // Indexed by epoch hour % 24 (UTC hour of day)
+  season: number[];
+  // Epoch hour (ms / 3600000) of the last applied bucket
+  lastHour: number;
+  // One-step-ahead squared error, for confidence
+  sse: number;
+  n: number;
+}
+
+export interface HourlySeries {
+  // Ascending epoch hours with at least one reading
+  hours: number[];
+  values: number[];
+}
+
+/**
+ * Average readings into hourly buckets
+ */
+export function toHourly(ts: ArrayLike<number>, values: ArrayLike<number>): HourlySeries {
+  const hours: number[] = [];
+  const out: number[] = [];
+  let sum = 0;
+  let count = 0;
+  let current = -1;
+  for (let i = 0; i < ts.length; i++) {
+    const h = Math.floor(ts[i] / 3_600_000);
+    if (h !== current && count > 0) {
+      hours.push(current);
+      out.push(sum / count);
+      sum = 0;
+      count = 0;
+    }
+    current = h;
+    sum += values[i];
+    count++;
+  }
+  if (count > 0) {
+    hours.push(current);
+    out.push(sum / count);
+  }
+  return { hours, values: out };
+}
+
+/**
+ * Apply one hourly observation. Hours skipped since the last update advance the
+ * level along the trend without touching the season.
+ */
+export function updateState(state: HoltWintersState, hour: number, value: number) {
+  if (hour <= state.lastHour) return;
+  for (let h = state.lastHour + 1; h < hour; h++) {
+    state.level += DAMPING * state.trend;
+    state.trend *= DAMPING;
+  }
+
+  const idx = hour % HOURS_PER_DAY;
+  const s = state.season[idx];
+  const predicted = state.level + DAMPING * state.trend + s;
+  const err = value - predicted;
+  state.sse += err * err;
+  state.n++;
+
+  const level = state.alpha * (value - s) + (1 - state.alpha) * (state.level + DAMPING * state.trend);
+  state.trend = state.beta * (level - state.level) + (1 - state.beta) * DAMPING * state.trend;
+  state.level = level;
+  state.season[idx] = state.gamma * (value - level) + (1 - state.gamma) * s;
+  state.lastHour = hour;
+}
+
+function initialState(series: HourlySeries, alpha: number, gamma: number): HoltWintersState {
+  const { hours, values } = series;
+  const season = new Array<number>(HOURS_PER_DAY).fill(0);
+  const first = hours[0];
+
+  // Level/trend from the first two days' means, season from day-one deviations
+  const day1 = values.filter((_, i) => hours[i] - first < HOURS_PER_DAY);
+  const day2 = values.filter((_, i) => hours[i] - first >= HOURS_PER_DAY && hours[i] - first < 2 * HOURS_PER_DAY);
+  const mean = (xs: number[]) => xs.reduce((a, b) => a + b, 0) / xs.length;
+  const level = mean(day1);
+  const trend = day2.length > 0 ? (mean(day2) - level) / HOURS_PER_DAY : 0;
+  if (day2.length > 0) {
+    hours.forEach((h, i) => {
+      if (h - first < HOURS_PER_DAY) season[h % HOURS_PER_DAY] = values[i] - level;
+    });
+  }
+
+  return { alpha, beta: BETA, gamma, level, trend, season, lastHour: first - 1, sse: 0, n: 0 };
+}
+
+/**
+ * Fit smoothing parameters by a small grid search on one-step error.
+ * Returns null with fewer than 6 hourly buckets.
+ */
+export function fitHoltWinters(series: HourlySeries): HoltWintersState | null {
+  if (series.values.length < 6) return null;
+
+  let best: HoltWintersState | null = null;
+  for (const alpha of ALPHAS) {
+    for (const gamma of GAMMAS) {
+      const state = initialState(series, alpha, gamma);
+      for (let i = 0; i < series.hours.length; i++) updateState(state, series.hours[i], series.values[i]);
+      if (!best || state.sse < best.sse) best = state;
+    }
+  }
+  return best;
+}
+
+/**
+ * Forecast `horizon` hours after state.lastHour
+ */
+export function forecastHoltWinters(state: HoltWintersState, horizon: number): number[] {
+  const out: number[] = [];
+  let damped = 0;
+  let phi = 1;
+  for (let h = 1; h <= horizon; h++) {
+    phi *= DAMPING;
+    damped += phi;
+    out.push(state.level + damped * state.trend + state.season[(state.lastHour + h) % HOURS_PER_DAY]);
+  }
+  return out;
+}
+
+export function rmse(state: HoltWintersState): number {
+  return state.n > 0 ? Math.sqrt(state.sse / state.n) : Infinity;
+}
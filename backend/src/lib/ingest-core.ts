@@ -0,0 +1,180 @@
+/**
+ * Ingest Core
+ * One call from raw request body to a normalized, storage-ready reading:
+ * payload decode, HMAC verification, timestamp resolution, AQI and quality flags.
+ * Kept free of database and config imports so it can be benchmarked in isolation.
+ */
+
+import crypto from 'crypto';
+import type { Device } from '@prisma/client';
+import { decodePayload, DecodedPayload } from './payload';
+import { verifyHMAC, deriveDeviceKey } from './hmac';
+import { calculateAQI, getAQICategoryKey } from './aqi';
+
+export interface NormalizedReading {
+  id: string;
+  deviceId: string;
+  measuredAt: Date;
+  mq135Raw?: number;
+  iaqScore?: number;
+  co2Equiv?: number;
+  temperature?: number;
+  humidity?: number;
+  pressureHpa?: number;
+  altitudeM?: number;
+  pm25Api?: number;
+  aqiCalculated?: number;
+  aqiCategory?: string;
+  externalData: Record<string, unknown>;
+  qualityFlags: Record<string, boolean>;
+  rssi?: number;
+  uptime: bigint | null;
+}
+
+/**
+ * Stateless device authentication. With a master key, signatures are checked against
+ * deriveDeviceKey(masterKey, device_id) before the device is resolved, so forged or
+ * unsigned traffic is rejected without a lookup. allowLegacyKeys lets devices still on
+ * a stored random key fall through to the per-row check while they are re-provisioned.
+ */
+export interface DeviceAuth {
+  masterKey: string;
+  allowLegacyKeys: boolean;
+}
+
+/**
+ * True when the payload carries a valid signature under its derived device key
+ */
+export function verifyDerivedKey(body: DecodedPayload, masterKey: string): boolean {
+  if (!body.deviceId || !body.signature) return false;
+  return verifyHMAC(body.signedPayload(), body.signature, deriveDeviceKey(masterKey, body.deviceId));
+}
+
+/**
+ * Alert readings are extra IAQ/CO2-only samples from the node's priority uplink. They are
+ * stored and reach the live feed, but stay out of rollups, exposure, the neighborhood
+ * consensus and the reading cache, which assume the regular reporting cadence.
+ */
+export function isPriorityAlert(qualityFlags: unknown): boolean {
+  return (qualityFlags as Record<string, unknown> | null)?.priority_alert === true;
+}
+
+export type NormalizeResult =
+  | { ok: true; reading: NormalizedReading; device: Device; payload: DecodedPayload }
+  | { ok: false; status: 400 | 401 | 404; error: string };
+
+/**
+ * Deterministic measurement id for a (device, boot, sequence) triple.
+ * Replays of the same reading map to the same primary key, so the batch
+ * INSERT ... ON CONFLICT DO NOTHING drops them.
+ */
+export function measurementIdFor(deviceId: string, bootId: string, seq: number): string {
+  const hex = crypto.createHash('sha1').update(`${deviceId}|${bootId}|${seq}`).digest('hex');
+  // Format as an RFC 4122 version-5 style UUID
+  const variant = ((parseInt(hex[16], 16) & 0x3) | 0x8).toString(16);
+  return `${hex.slice(0, 8)}-${hex.slice(8, 12)}-5${hex.slice(13, 16)}-${variant}${hex.slice(17, 20)}-${hex.slice(20, 32)}`;
+}
+
+// Resolve measuredAt (accept measuredAt ISO, numeric/string timestamp in seconds or ms)
+function resolveMeasuredAt(body: DecodedPayload): Date {
+  let measuredAt: Date;
+  if (body.measuredAt) {
+    measuredAt = new Date(body.measuredAt);
+  } else if (body.timestamp !== undefined) {
+    const tsRaw = typeof body.timestamp === 'string' && /^[0-9]+$/.test(body.timestamp)
+      ? Number(body.timestamp)
+      : body.timestamp;
+    if (typeof tsRaw === 'number') {
+      measuredAt = tsRaw > 1e12 ? new Date(tsRaw) : new Date(tsRaw * 1000);
+    } else {
+      measuredAt = new Date(String(body.timestamp));
+    }
+  } else {
+    measuredAt = new Date();
+  }
+  return Number.isNaN(measuredAt.getTime()) ? new Date() : measuredAt;
+}
+
+/**
+ * Calculate AQI - prefer API PM2.5, fallback to provided pm25, then estimate from IAQ
+ */
+export function applyAQI(reading: NormalizedReading, pm25Api: number | null, pm25: number | null, iaq: number | null) {
+  let aqi: number | null = null;
+  if (pm25Api !== null) {
+    aqi = calculateAQI(pm25Api, 'pm25');
+  } else if (pm25 !== null) {
+    aqi = calculateAQI(pm25, 'pm25');
+  } else if (iaq !== null) {
+    aqi = calculateAQI(Math.max(0, (iaq - 50) * 0.5), 'pm25');
+  }
+  reading.aqiCalculated = aqi ?? undefined;
+  reading.aqiCategory = aqi !== null ? getAQICategoryKey(aqi) : undefined;
+  reading.pm25Api = pm25Api ?? pm25 ?? undefined;
+}
+
+/**
+ * Decode, authenticate and normalize one ingest body
+ */
+export async function normalizeIngest(
+  raw: unknown,
+  resolveDevice: (id: string) => Promise<Device | null> | Device | null,
+  auth?: DeviceAuth
+): Promise<NormalizeResult> {
+  const body = decodePayload(raw);
+
+  if (!body.deviceId) return { ok: false, status: 400, error: 'device_id is required' };
+
+  // Derived-key check first: needs nothing but the payload
+  let verified = false;
+  if (auth?.masterKey) {
+    verified = verifyDerivedKey(body, auth.masterKey);
+    if (!verified && !auth.allowLegacyKeys) {
+      return { ok: false, status: 401, error: body.signature ? 'Invalid signature' : 'Signature required' };
+    }
+  }
+
+  const device = await resolveDevice(body.deviceId);
+  if (!device) return { ok: false, status: 404, error: 'Device not found' };
+
+  // Optional HMAC verification if signature is provided
+  if (!verified && body.signature && !verifyHMAC(body.signedPayload(), body.signature, device.deviceKey)) {
+    return { ok: false, status: 401, error: 'Invalid signature' };
+  }
+
+  const { iaq, temperature, humidity, pressure, uptimeMs } = body;
+  const altitude = body.altitude ?? (typeof device.altitude === 'number' ? device.altitude : null);
+
+  // Optional measurement id to avoid duplicates; nodes that report (boot_id, seq)
+  // get a deterministic id so replays of the same reading collapse on insert
+  const id =
+    body.measurementId ??
+    (body.bootId && body.seq !== null ? measurementIdFor(device.id, body.bootId, body.seq) : crypto.randomUUID());
+
+  const reading: NormalizedReading = {
+    id,
+    deviceId: device.id,
+    measuredAt: resolveMeasuredAt(body),
+    mq135Raw: body.mq135Raw ?? undefined,
+    iaqScore: iaq ?? undefined,
+    co2Equiv: body.co2 ?? undefined,
+    temperature: temperature ?? undefined,
+    humidity: humidity ?? undefined,
+    pressureHpa: pressure ?? undefined,
+    altitudeM: altitude ?? undefined,
+    externalData: {},
+    qualityFlags: {
+      sensor_warmed_up: true,
+      dht22_valid: temperature !== null && humidity !== null,
+      bmp180_valid: pressure !== null,
+      mq135_in_range: iaq !== null ? iaq >= 10 && iaq <= 500 : false,
+      overall_valid: true,
+    },
+    rssi: body.rssi ?? undefined,
+    // Uptime handling (accept ms)
+    uptime: uptimeMs !== null && !Number.isNaN(uptimeMs) ? BigInt(Math.floor(uptimeMs)) : null,
+  };
+  if (body.alert) reading.qualityFlags.priority_alert = true;
+  applyAQI(reading, null, body.pm25, iaq);
+
+  return { ok: true, reading, device, payload: body };
+}
@@ -0,0 +1,439 @@
+/**
+ * Durable Ingest Log
+ * Segmented, CRC-checked append-only log that sits between the ingest route
+ * and storage. Appends are acknowledged after a group-commit fsync; consumers
+ * (DB writer, rollups, alerts) track their own offsets and replay after a crash.
+ *
+ * On-disk layout (one directory):
+ *   <baseOffset>.log     segment files, named by the byte offset of their first record
+ *   <consumer>.offset    committed offset per consumer (written atomically via rename)
+ *   <consumer>.dead      records the consumer gave up on, one JSON line each
+ *
+ * Record frame: [u32 payload length][u32 crc32(payload)][payload bytes], little-endian.
+ *
+ * Free of config imports; the ingest instance lives in measurement-writer.ts and
+ * the edge broker reuses the class as its upstream queue.
+ */
+
+import fs from 'fs';
+import path from 'path';
+
+const HEADER_BYTES = 8;
+const SEGMENT_SUFFIX = '.log';
+// Consumer reads fetch this much of a segment per syscall (more for a larger record)
+const READ_CHUNK_BYTES = 256 * 1024;
+
+// ---------------------------------------------------------------------------
+// CRC-32 (IEEE 802.3), table driven
+// ---------------------------------------------------------------------------
+const CRC_TABLE = (() => {
+  const table = new Uint32Array(256);
+  for (let n = 0; n < 256; n++) {
+    let c = n;
+    for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+    table[n] = c >>> 0;
+  }
+  return table;
+})();
+
+export function crc32(buf: Uint8Array): number {
+  let crc = 0xffffffff;
+  for (let i = 0; i < buf.length; i++) crc = CRC_TABLE[(crc ^ buf[i]) & 0xff] ^ (crc >>> 8);
+  return (crc ^ 0xffffffff) >>> 0;
+}
+
+interface Segment {
+  base: number;
+  file: string;
+  size: number; // Durable (fsynced) bytes, visible to readers
+  written: number; // Bytes handed to the OS, may not be synced yet
+}
+
+interface PendingAppend {
+  frame: Buffer;
+  offset: number;
+  resolve: (offset: number) => void;
+  reject: (err: unknown) => void;
+}
+
+export interface LogRecord<T = unknown> {
+  offset: number;
+  next: number;
+  value: T;
+}
+
+export interface IngestLogOptions {
+  dir: string;
+  segmentBytes: number;
+  fsyncIntervalMs: number;
+}
+
+export class IngestLog {
+  private segments: Segment[] = [];
+  private handle: fs.promises.FileHandle | null = null;
+  private nextOffset = 0;
+  private pending: PendingAppend[] = [];
+  private timer: NodeJS.Timeout | null = null;
+  private committing: Promise<void> | null = null;
+  private waiters = new Set<() => void>();
+
+  readonly stats = { deadLettered: 0 };
+
+  constructor(private readonly opts: IngestLogOptions) {}
+
+  /**
+   * Open the log directory, dropping any torn record at the tail of the last segment
+   */
+  async open() {
+    fs.mkdirSync(this.opts.dir, { recursive: true });
+    this.segments = fs
+      .readdirSync(this.opts.dir)
+      .filter((f) => f.endsWith(SEGMENT_SUFFIX))
+      .map((f) => {
+        const file = path.join(this.opts.dir, f);
+        const size = fs.statSync(file).size;
+        return { base: parseInt(f, 10), file, size, written: size };
+      })
+      .sort((a, b) => a.base - b.base);
+
+    if (this.segments.length === 0) {
+      this.segments.push(this.createSegment(0));
+    }
+
+    const last = this.segments[this.segments.length - 1];
+    const validBytes = this.scanValidBytes(last);
+    if (validBytes < last.size) {
+      console.warn(`[LOG] Truncating torn tail of ${path.basename(last.file)}: ${last.size} -> ${validBytes} bytes`);
+      fs.truncateSync(last.file, validBytes);
+      last.size = last.written = validBytes;
+    }
+
+    this.handle = await fs.promises.open(last.file, 'a');
+    this.nextOffset = last.base + last.size;
+  }
+
+  async close() {
+    if (this.timer) clearTimeout(this.timer);
+    this.timer = null;
+    while (this.committing || this.pending.length > 0) {
+      await (this.committing ?? this.commit());
+    }
+    await this.handle?.close();
+    this.handle = null;
+  }
+
+  /**
+   * Offset one past the last durable record
+   */
+  get end(): number {
+    const last = this.segments[this.segments.length - 1];
+    return last ? last.base + last.size : 0;
+  }
+
+  /**
+   * Append a JSON record. Resolves with its offset once it is fsynced.
+   */
+  append(value: unknown): Promise<number> {
+    const payload = Buffer.from(JSON.stringify(value), 'utf8');
+    const frame = Buffer.allocUnsafe(HEADER_BYTES + payload.length);
+    frame.writeUInt32LE(payload.length, 0);
+    frame.writeUInt32LE(crc32(payload), 4);
+    payload.copy(frame, HEADER_BYTES);
+
+    return new Promise<number>((resolve, reject) => {
+      this.pending.push({ frame, offset: -1, resolve, reject });
+      this.scheduleCommit();
+    });
+  }
+
+  private scheduleCommit() {
+    if (this.timer || this.committing) return;
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      this.commit();
+    }, this.opts.fsyncIntervalMs);
+  }
+
+  /**
+   * Group commit: one writev + one fdatasync for every append since the last commit
+   */
+  private commit(): Promise<void> {
+    if (this.committing || this.pending.length === 0 || !this.handle) return this.committing ?? Promise.resolve();
+
+    const batch = this.pending.splice(0);
+    this.committing = (async () => {
+      try {
+        let i = 0;
+        while (i < batch.length) {
+          if (this.current.written >= this.opts.segmentBytes) await this.roll();
+          const seg = this.current;
+
+          // Fill the current segment up to its size limit (at least one record)
+          const frames: Buffer[] = [];
+          let bytes = 0;
+          while (i < batch.length && (frames.length === 0 || seg.written + bytes + batch[i].frame.length <= this.opts.segmentBytes)) {
+            batch[i].offset = seg.base + seg.written + bytes;
+            frames.push(batch[i].frame);
+            bytes += batch[i].frame.length;
+            i++;
+          }
+          await this.handle!.writev(frames);
+          seg.written += bytes;
+          this.nextOffset = seg.base + seg.written;
+        }
+        await this.handle!.datasync();
+        this.current.size = this.current.written;
+        batch.forEach((p) => p.resolve(p.offset));
+        this.notify();
+      } catch (err) {
+        console.error('[LOG] Commit failed:', err);
+        batch.forEach((p) => p.reject(err));
+      } finally {
+        this.committing = null;
+        if (this.pending.length > 0) this.scheduleCommit();
+      }
+    })();
+    return this.committing;
+  }
+
+  private get current(): Segment {
+    return this.segments[this.segments.length - 1];
+  }
+
+  private async roll() {
+    const old = this.current;
+    await this.handle!.datasync();
+    await this.handle!.close();
+    old.size = old.written;
+    const seg = this.createSegment(this.nextOffset);
+    this.segments.push(seg);
+    this.handle = await fs.promises.open(seg.file, 'a');
+  }
+
+  private createSegment(base: number): Segment {
+    const file = path.join(this.opts.dir, `${String(base).padStart(20, '0')}${SEGMENT_SUFFIX}`);
+    fs.closeSync(fs.openSync(file, 'a'));
+    const size = fs.statSync(file).size;
+    return { base, file, size, written: size };
+  }
+
+  private scanValidBytes(seg: Segment): number {
+    let pos = 0;
+    for (const rec of this.readSegment(seg, seg.base, Number.MAX_SAFE_INTEGER)) {
+      pos = rec.next - seg.base;
+    }
+    return pos;
+  }
+
+  // Synchronous, for the tail scan in open() only; consumers go through read()
+  private *readSegment(seg: Segment, from: number, max: number): Generator<LogRecord> {
+    const fd = fs.openSync(seg.file, 'r');
+    try {
+      const header = Buffer.allocUnsafe(HEADER_BYTES);
+      let pos = from - seg.base;
+      let count = 0;
+      while (count < max && pos + HEADER_BYTES <= seg.size) {
+        if (fs.readSync(fd, header, 0, HEADER_BYTES, pos) < HEADER_BYTES) return;
+        const len = header.readUInt32LE(0);
+        const crc = header.readUInt32LE(4);
+        if (pos + HEADER_BYTES + len > seg.size) return;
+        const payload = Buffer.allocUnsafe(len);
+        fs.readSync(fd, payload, 0, len, pos + HEADER_BYTES);
+        if (crc32(payload) !== crc) return; // Corrupt or torn record ends the readable range
+        const next = pos + HEADER_BYTES + len;
+        yield { offset: seg.base + pos, next: seg.base + next, value: JSON.parse(payload.toString('utf8')) };
+        pos = next;
+        count++;
+      }
+    } finally {
+      fs.closeSync(fd);
+    }
+  }
+
+  /**
+   * Read up to `max` committed records starting at `from`. Reads are async and chunked
+   * so a consumer catching up on a large backlog doesn't block the event loop.
+   */
+  async read<T = unknown>(from: number, max: number): Promise<LogRecord<T>[]> {
+    const out: LogRecord<T>[] = [];
+    // Snapshot: truncateBefore() may drop segments while a read is in flight
+    const segments = this.segments.slice();
+    for (let i = 0; i < segments.length && out.length < max; i++) {
+      const seg = segments[i];
+      const segEnd = seg.base + seg.size;
+      if (from >= segEnd) continue;
+      await this.readSegmentAsync(seg, Math.max(from, seg.base), segEnd, max, out as LogRecord[]);
+      from = segEnd;
+    }
+    return out;
+  }
+
+  private async readSegmentAsync(seg: Segment, from: number, end: number, max: number, out: LogRecord[]) {
+    const fh = await fs.promises.open(seg.file, 'r');
+    try {
+      const limit = end - seg.base;
+      let pos = from - seg.base;
+      let buf = Buffer.alloc(0);
+      let bufStart = pos;
+      // Make [pos, pos + bytes) available in buf; false if the file is shorter
+      const ensure = async (bytes: number): Promise<boolean> => {
+        if (pos + bytes <= bufStart + buf.length) return true;
+        const size = Math.min(Math.max(READ_CHUNK_BYTES, bytes), limit - pos);
+        buf = Buffer.allocUnsafe(size);
+        const { bytesRead } = await fh.read(buf, 0, size, pos);
+        buf = buf.subarray(0, bytesRead);
+        bufStart = pos;
+        return bytesRead >= bytes;
+      };
+
+      while (out.length < max && pos + HEADER_BYTES <= limit) {
+        if (!(await ensure(HEADER_BYTES))) return;
+        const len = buf.readUInt32LE(pos - bufStart);
+        const crc = buf.readUInt32LE(pos - bufStart + 4);
+        if (pos + HEADER_BYTES + len > limit) return;
+        if (!(await ensure(HEADER_BYTES + len))) return;
+        const at = pos - bufStart + HEADER_BYTES;
+        const payload = buf.subarray(at, at + len);
+        if (crc32(payload) !== crc) return; // Corrupt or torn record ends the readable range
+        const next = pos + HEADER_BYTES + len;
+        out.push({ offset: seg.base + pos, next: seg.base + next, value: JSON.parse(payload.toString('utf8')) });
+        pos = next;
+      }
+    } finally {
+      await fh.close();
+    }
+  }
+
+  /**
+   * Resolve once new records have been committed
+   */
+  waitForData(timeoutMs: number): Promise<void> {
+    return new Promise((resolve) => {
+      // Deregistered on either path, so an idle consumer doesn't pile up waiters
+      const done = () => {
+        clearTimeout(t);
+        this.waiters.delete(done);
+        resolve();
+      };
+      const t = setTimeout(done, timeoutMs);
+      this.waiters.add(done);
+    });
+  }
+
+  private notify() {
+    const waiters = Array.from(this.waiters);
+    this.waiters.clear();
+    waiters.forEach((w) => w());
+  }
+
+  // -------------------------------------------------------------------------
+  // Consumer offsets
+  // -------------------------------------------------------------------------
+  loadOffset(consumer: string): number {
+    try {
+      return parseInt(fs.readFileSync(path.join(this.opts.dir, `${consumer}.offset`), 'utf8'), 10) || 0;
+    } catch {
+      return this.segments[0]?.base ?? 0;
+    }
+  }
+
+  commitOffset(consumer: string, offset: number) {
+    const file = path.join(this.opts.dir, `${consumer}.offset`);
+    fs.writeFileSync(`${file}.tmp`, String(offset));
+    fs.renameSync(`${file}.tmp`, file);
+  }
+
+  /**
+   * Set aside a record a consumer keeps failing on, so the rest of the log can move.
+   * It is kept as a JSON line in <consumer>.dead for inspection or a manual replay.
+   */
+  deadLetter(consumer: string, record: LogRecord, err: unknown) {
+    const line = JSON.stringify({
+      offset: record.offset,
+      failedAt: new Date().toISOString(),
+      error: err instanceof Error ? err.message : String(err),
+      value: record.value,
+    });
+    fs.appendFileSync(path.join(this.opts.dir, `${consumer}.dead`), `${line}\n`);
+    this.stats.deadLettered++;
+  }
+
+  /**
+   * Delete whole segments that every listed consumer has moved past
+   */
+  truncateBefore(consumers: string[]) {
+    const min = Math.min(...consumers.map((c) => this.loadOffset(c)));
+    while (this.segments.length > 1 && this.segments[1].base <= min) {
+      const seg = this.segments.shift()!;
+      fs.unlinkSync(seg.file);
+    }
+  }
+}
+
+/**
+ * Run a consumer loop: read from the committed offset, hand batches to `handle`,
+ * and commit the offset only after the handler succeeds (at-least-once delivery).
+ *
+ * Errors `isTransient` accepts (an outage downstream) are retried indefinitely. A batch
+ * that fails otherwise `maxAttempts` times is retried one record at a time, and a record
+ * that still fails `maxAttempts` times is dead-lettered and skipped, so one bad record
+ * can't stall the log (and fill the disk) behind it.
+ */
+export function startLogConsumer<T>(
+  log: IngestLog,
+  name: string,
+  handle: (records: LogRecord<T>[]) => Promise<void>,
+  opts: {
+    batchSize?: number;
+    idleWaitMs?: number;
+    maxAttempts?: number;
+    isTransient?: (err: unknown) => boolean;
+  } = {}
+): () => void {
+  const batchSize = opts.batchSize ?? 1000;
+  const idleWaitMs = opts.idleWaitMs ?? 1000;
+  const maxAttempts = opts.maxAttempts ?? 5;
+  const isTransient = opts.isTransient ?? (() => false);
+  let stopped = false;
+  let offset = log.loadOffset(name);
+  let failures = 0;
+  // Up to here records go through one at a time, after their batch kept failing
+  let isolateUntil = -1;
+
+  (async () => {
+    while (!stopped) {
+      const isolating = offset < isolateUntil;
+      const records = await log.read<T>(offset, isolating ? 1 : batchSize);
+      if (records.length === 0) {
+        await log.waitForData(idleWaitMs);
+        continue;
+      }
+      try {
+        await handle(records);
+        failures = 0;
+        offset = records[records.length - 1].next;
+        log.commitOffset(name, offset);
+      } catch (err) {
+        if (isTransient(err) || ++failures < maxAttempts) {
+          console.error(`[LOG] Consumer ${name} failed at offset ${offset}, retrying:`, err);
+          await new Promise((r) => setTimeout(r, idleWaitMs));
+          continue;
+        }
+        failures = 0;
+        if (!isolating && records.length > 1) {
+          console.warn(`[LOG] Consumer ${name}: batch at offset ${offset} keeps failing, retrying its records one at a time`);
+          isolateUntil = records[records.length - 1].next;
+          continue;
+        }
+        console.error(`[LOG] Consumer ${name} dead-lettered the record at offset ${offset}:`, err);
+        log.deadLetter(name, records[0], err);
+        offset = records[0].next;
+        log.commitOffset(name, offset);
+      }
+    }
+  })();
+
+  return () => {
+    stopped = true;
+  };
+}
@@ -0,0 +1,222 @@
+/**
+ * Ingest Pipeline
+ * Everything after transport: decode and verify, replay check, external data,
+ * neighborhood outlier flags, durable write and the live event. Shared by the
+ * HTTP route and the MQTT bridge so both paths store identical rows.
+ */
+
+import { Device } from '@prisma/client';
+import fs from 'fs';
+import { db } from './db';
+import { decodePayload } from './payload';
+import { normalizeIngest, verifyDerivedKey, applyAQI, NormalizedReading, DeviceAuth } from './ingest-core';
+import { publish } from './events';
+import { fetchOpenWeatherAirQuality } from './external-api';
+import { measurementWriter, toLoggedMeasurement, ingestLog } from './measurement-writer';
+import { ReplayFilter } from './dedup-filter';
+import { NeighborhoodMonitor, neighborhoodKey } from './neighborhood-outliers';
+import { ClusterMembership, parseClusterNodes } from './cluster';
+import { config } from '../config';
+
+// pino-compatible subset (Fastify's logger satisfies it)
+export interface IngestLogger {
+  info(obj: object, msg?: string): void;
+  warn(obj: object, msg?: string): void;
+  error(obj: unknown, msg?: string): void;
+}
+
+export interface IngestOutcome {
+  status: number;
+  body: Record<string, unknown>;
+}
+
+// Device rows change rarely; cache lookups briefly so a DB stall doesn't block every POST
+const DEVICE_CACHE_TTL_MS = 60_000;
+const deviceCache = new Map<string, { device: Device; expires: number }>();
+
+export async function findDevice(id: string): Promise<Device | null> {
+  const hit = deviceCache.get(id);
+  if (hit && hit.expires > Date.now()) return hit.device;
+  const device = await db.device.findFirst({ where: { id } });
+  if (device) deviceCache.set(id, { device, expires: Date.now() + DEVICE_CACHE_TTL_MS });
+  else deviceCache.delete(id);
+  return device;
+}
+
+// Derived device keys: signatures are checked before the device row is loaded
+const deviceAuth: DeviceAuth | undefined = config.deviceKeyMaster
+  ? { masterKey: config.deviceKeyMaster, allowLegacyKeys: config.deviceKeyAllowLegacy }
+  : undefined;
+
+/**
+ * The body's device id when its signature verifies under the derived key, else null.
+ * Costs a decode and one HMAC, no lookup, so admission can run it on every request;
+ * without a master key nothing can be verified this early.
+ */
+export function authenticatedDeviceId(raw: unknown): string | null {
+  if (!deviceAuth) return null;
+  try {
+    const body = decodePayload(raw);
+    return verifyDerivedKey(body, deviceAuth.masterKey) ? body.deviceId! : null;
+  } catch {
+    return null; // Malformed body: charged as unverified, the handler reports the error
+  }
+}
+
+// Catches readings re-sent by flushBuffer() whose first POST landed before timing out
+const replayFilter = new ReplayFilter({
+  windowMs: config.dedupWindowHours * 60 * 60 * 1000,
+  partitions: config.dedupPartitions,
+  slotsPerPartition: config.dedupPartitionSlots,
+});
+
+// Robust consensus of nearby nodes; readings far from it are flagged, not trusted
+const neighborhoods = new NeighborhoodMonitor({
+  windowMs: config.outlierWindowMin * 60 * 1000,
+  minNeighbors: config.outlierMinNeighbors,
+  zThreshold: config.outlierZThreshold,
+  minDeviation: { aqi: 50, iaq: 75 },
+});
+setInterval(() => neighborhoods.sweep(), 5 * 60_000).unref();
+
+// Each device is owned by one instance; others redirect it there. Devices picked up in a
+// membership change have no replay-filter history here, so they get exact checks for one window.
+export const cluster =
+  config.clusterNodes && config.clusterSelf
+    ? new ClusterMembership(config.clusterSelf, parseClusterNodes(config.clusterNodes), config.dedupWindowHours * 60 * 60 * 1000)
+    : null;
+
+if (cluster && config.clusterNodesFile) {
+  process.on('SIGHUP', () => {
+    try {
+      const nodes = parseClusterNodes(fs.readFileSync(config.clusterNodesFile, 'utf8').replace(/\s+/g, ','));
+      if (nodes.length === 0) throw new Error('no nodes listed');
+      cluster.update(nodes);
+      console.log(`[CLUSTER] Membership reloaded: ${nodes.map((n) => n.id).join(', ')}`);
+    } catch (err) {
+      console.error('[CLUSTER] Membership reload failed:', err);
+    }
+  });
+}
+
+// Devices this instance does not own (MQTT is not redirected) or only just acquired have no
+// replay-filter history here
+function needsExactCheck(membership: ClusterMembership, deviceId: string): boolean {
+  return !membership.owns(deviceId) || membership.recentlyAcquired(deviceId);
+}
+
+// Exact check, only reached on a filter hit
+async function findStored(m: NormalizedReading, deterministicId: boolean) {
+  const select = { id: true, measuredAt: true, aqiCalculated: true, aqiCategory: true };
+  if (deterministicId) return db.measurement.findUnique({ where: { id: m.id }, select });
+  return db.measurement.findFirst({ where: { deviceId: m.deviceId, measuredAt: m.measuredAt }, select });
+}
+
+/**
+ * Run one raw ingest body through the pipeline; the outcome maps directly onto an HTTP reply
+ */
+export async function ingestReading(raw: unknown, log: IngestLogger): Promise<IngestOutcome> {
+  try {
+    // Decode, verify HMAC, compute AQI and quality flags in one pass
+    // (device lookup goes through a short-lived cache to keep the hot path off the database;
+    // with a master key, bad signatures are rejected before the lookup)
+    const result = await normalizeIngest(raw, findDevice, deviceAuth);
+    if (!result.ok) {
+      return { status: result.status, body: { error: result.error } };
+    }
+    const { reading: measurement, device, payload: body } = result;
+
+    // Drop replays before any external call or write
+    const replayKey = ReplayFilter.key(device.id, measurement.measuredAt.getTime(), body.seq);
+    if (replayFilter.checkAndInsert(replayKey) || (cluster && needsExactCheck(cluster, device.id))) {
+      const stored = await findStored(measurement, Boolean(body.measurementId || (body.bootId && body.seq !== null)));
+      if (stored) {
+        return {
+          status: 200,
+          body: {
+            success: true,
+            duplicate: true,
+            measurement_id: stored.id,
+            measuredAt: stored.measuredAt.toISOString(),
+            aqi: stored.aqiCalculated,
+            category: stored.aqiCategory,
+          },
+        };
+      }
+    }
+
+    // External data (optional); API PM2.5 takes precedence for AQI. Alerts skip the
+    // round trip: the next regular reading from the node picks it up.
+    if (device.latitude && device.longitude && !body.alert) {
+      const owData = await fetchOpenWeatherAirQuality(device.latitude, device.longitude);
+      if (owData) {
+        measurement.externalData.openweather = owData;
+        if (owData.pm2_5) applyAQI(measurement, owData.pm2_5, body.pm25, body.iaq);
+      }
+    }
+
+    // Alerts are extra samples off the regular cadence: they are judged by the consensus
+    // like any reading, but don't join it, so a faulty node's spike can't skew its neighbors
+    const area = neighborhoodKey(device);
+    if (area) {
+      const verdict = neighborhoods.check(
+        area,
+        device.id,
+        measurement.measuredAt.getTime(),
+        { aqi: measurement.aqiCalculated ?? null, iaq: measurement.iaqScore ?? null },
+        !body.alert
+      );
+      measurement.qualityFlags.neighborhood_outlier = verdict.outlier;
+      if (verdict.outlier) {
+        measurement.qualityFlags.overall_valid = false;
+        log.info(
+          { deviceId: device.id, area, metric: verdict.metric, median: verdict.median, z: verdict.z },
+          'Reading deviates from neighborhood consensus'
+        );
+      }
+    }
+
+    // With the durable log enabled the reading is acknowledged once it is fsynced there;
+    // otherwise it goes straight to the batched writer. Device lastSeen is coalesced per batch.
+    const firmwareVersion = body.firmwareVersion ?? device.firmwareVersion ?? undefined;
+    if (ingestLog) {
+      await ingestLog.append(toLoggedMeasurement(measurement as any, firmwareVersion, Boolean(body.alert)));
+    } else {
+      await measurementWriter.enqueue(measurement as any, { firmwareVersion }, Boolean(body.alert));
+    }
+
+    const responsePayload = {
+      success: true,
+      measurement_id: measurement.id,
+      measuredAt: measurement.measuredAt.toISOString(),
+      aqi: measurement.aqiCalculated ?? null,
+      category: measurement.aqiCategory ?? null,
+    };
+
+    // Emit live update event (non-blocking)
+    try {
+      publish('measurement:new', {
+        deviceId: device.id,
+        deviceName: device.name,
+        measuredAt: measurement.measuredAt.toISOString(),
+        aqiCalculated: measurement.aqiCalculated ?? null,
+        iaqScore: measurement.iaqScore ?? null,
+        temperature: measurement.temperature ?? null,
+        humidity: measurement.humidity ?? null,
+        pressureHpa: measurement.pressureHpa ?? null,
+        alert: body.alert ?? null,
+      });
+    } catch (e) {
+      log.warn({ err: e }, 'Failed to emit live measurement event');
+    }
+
+    return { status: 201, body: responsePayload };
+
+  } catch (error) {
+    log.error(error);
+    if ((error as any).name === 'ZodError') {
+      return { status: 400, body: { error: 'Invalid payload', details: (error as any).errors } };
+    }
+    return { status: 500, body: { error: 'Internal server error' } };
+  }
+}
@@ -0,0 +1,238 @@
+/**
+ * Batched Measurement Writer
+ * Accumulates normalized readings and loads them with one multi-row INSERT
+ * per batch instead of one statement per reading.
+ */
+
+import { Prisma } from '@prisma/client';
+import { db } from './db';
+import { config } from '../config';
+import { IngestLog, startLogConsumer } from './ingest-log';
+
+interface PendingRow {
+  data: Prisma.MeasurementCreateManyInput;
+  resolve: () => void;
+  reject: (err: unknown) => void;
+}
+
+interface DeviceTouch {
+  lastSeen: Date;
+  firmwareVersion?: string;
+}
+
+export interface WriterStats {
+  batches: number;
+  rows: number;
+  skipped: number;
+  lastBatchMs: number;
+}
+
+/**
+ * Shape of a measurement row in the durable ingest log (JSON-safe: no Date/BigInt)
+ */
+export interface LoggedMeasurement {
+  measurement: Omit<Prisma.MeasurementCreateManyInput, 'measuredAt' | 'uptime'> & {
+    measuredAt: string;
+    uptime: string | null;
+  };
+  firmwareVersion?: string;
+  // Node alert: the consumer flushes it without waiting for a full batch
+  priority?: boolean;
+}
+
+export function toLoggedMeasurement(
+  row: Prisma.MeasurementCreateManyInput,
+  firmwareVersion?: string,
+  priority = false
+): LoggedMeasurement {
+  return {
+    measurement: {
+      ...row,
+      measuredAt: new Date(row.measuredAt).toISOString(),
+      uptime: row.uptime != null ? String(row.uptime) : null,
+    },
+    firmwareVersion,
+    ...(priority ? { priority } : {}),
+  };
+}
+
+export class MeasurementWriter {
+  private pending: PendingRow[] = [];
+  private touches = new Map<string, DeviceTouch>();
+  private timer: NodeJS.Timeout | null = null;
+  private flushing: Promise<void> = Promise.resolve();
+
+  readonly stats: WriterStats = { batches: 0, rows: 0, skipped: 0, lastBatchMs: 0 };
+
+  constructor(private readonly maxBatch: number, private readonly maxDelayMs: number) {}
+
+  /**
+   * Queue a measurement row. Resolves once the batch containing it is committed.
+   * Priority rows (node alerts) flush the batch now instead of waiting out the delay.
+   */
+  enqueue(data: Prisma.MeasurementCreateManyInput, device?: { firmwareVersion?: string }, priority = false): Promise<void> {
+    const measuredAt = new Date(data.measuredAt);
+    const touch = this.touches.get(data.deviceId);
+    if (!touch || touch.lastSeen < measuredAt) {
+      this.touches.set(data.deviceId, {
+        lastSeen: measuredAt,
+        firmwareVersion: device?.firmwareVersion ?? touch?.firmwareVersion,
+      });
+    }
+
+    return new Promise<void>((resolve, reject) => {
+      this.pending.push({ data, resolve, reject });
+      if (priority || this.pending.length >= this.maxBatch) {
+        this.scheduleFlush(0);
+      } else if (!this.timer) {
+        this.scheduleFlush(this.maxDelayMs);
+      }
+    });
+  }
+
+  /**
+   * Flush everything queued so far (used on shutdown and by benchmarks)
+   */
+  async drain(): Promise<void> {
+    if (this.timer) {
+      clearTimeout(this.timer);
+      this.timer = null;
+    }
+    await this.runFlush();
+  }
+
+  private scheduleFlush(delayMs: number) {
+    if (this.timer) clearTimeout(this.timer);
+    this.timer = setTimeout(() => {
+      this.timer = null;
+      this.runFlush().catch(() => {});
+    }, delayMs);
+  }
+
+  // Batches are serialized so device lastSeen updates apply in order
+  private runFlush(): Promise<void> {
+    this.flushing = this.flushing.then(() => this.flushOnce());
+    return this.flushing;
+  }
+
+  private async flushOnce() {
+    if (this.pending.length === 0) return;
+
+    const batch = this.pending.splice(0, this.maxBatch);
+    const touches = this.touches;
+    this.touches = new Map();
+    if (this.pending.length > 0) this.scheduleFlush(0);
+
+    const started = Date.now();
+    try {
+      const result = await this.insertBatch(batch);
+
+      // One lastSeen update per device per batch rather than per reading
+      await Promise.all(
+        Array.from(touches.entries()).map(([id, t]) =>
+          db.device
+            .update({
+              where: { id },
+              data: {
+                lastSeen: t.lastSeen,
+                active: true,
+                ...(t.firmwareVersion ? { firmwareVersion: t.firmwareVersion } : {}),
+              },
+            })
+            .catch((err) => console.warn(`[WRITER] Failed to update device ${id}:`, err?.message || err))
+        )
+      );
+
+      this.stats.batches++;
+      this.stats.rows += result.count;
+      this.stats.skipped += result.attempted - result.count;
+      this.stats.lastBatchMs = Date.now() - started;
+    } catch (err) {
+      console.error('[WRITER] Batch insert failed:', err);
+      batch.forEach((b) => b.reject(err));
+    }
+  }
+
+  /**
+   * One INSERT for the whole batch. If Postgres rejects it for a reason tied to the
+   * data (not the connection), fall back to one INSERT per row so only the bad row
+   * fails and the rest of the batch is still stored. Settles each row's promise.
+   */
+  private async insertBatch(batch: PendingRow[]): Promise<{ count: number; attempted: number }> {
+    try {
+      const result = await db.measurement.createMany({
+        data: batch.map((b) => b.data),
+        skipDuplicates: true,
+      });
+      batch.forEach((b) => b.resolve());
+      return { count: result.count, attempted: batch.length };
+    } catch (err) {
+      if (batch.length === 1 || isTransientDbError(err)) throw err;
+      console.warn(`[WRITER] Batch of ${batch.length} rejected, retrying row by row:`, (err as Error)?.message || err);
+    }
+
+    let count = 0;
+    let attempted = 0;
+    for (const b of batch) {
+      try {
+        count += (await db.measurement.createMany({ data: [b.data], skipDuplicates: true })).count;
+        attempted++;
+        b.resolve();
+      } catch (err) {
+        console.error(`[WRITER] Row for device ${b.data.deviceId} rejected:`, err);
+        b.reject(err);
+      }
+    }
+    return { count, attempted };
+  }
+}
+
+export const measurementWriter = new MeasurementWriter(config.ingestBatchSize, config.ingestBatchDelayMs);
+
+// Durable ingest log (null = write straight to Postgres)
+export const ingestLog = config.ingestLogDir
+  ? new IngestLog({
+      dir: config.ingestLogDir,
+      segmentBytes: config.ingestLogSegmentMb * 1024 * 1024,
+      fsyncIntervalMs: config.ingestLogFsyncMs,
+    })
+  : null;
+
+/**
+ * Database errors that clear up on their own (connection loss, timeouts, pool
+ * exhaustion). Anything else, e.g. a constraint violation, fails the same way on retry.
+ */
+export function isTransientDbError(err: unknown): boolean {
+  if (err instanceof Prisma.PrismaClientInitializationError || err instanceof Prisma.PrismaClientRustPanicError) return true;
+  const code = (err as { code?: unknown })?.code;
+  return typeof code === 'string' && (code.startsWith('P1') || code === 'P2024' || code === 'P2034');
+}
+
+/**
+ * Drain the durable ingest log into Postgres. Offsets are committed only after
+ * the batch is stored, so a crash replays at most one batch (ids make it idempotent).
+ * A row Postgres keeps rejecting is dead-lettered rather than retried forever.
+ */
+export function startWriterConsumer(log: IngestLog): () => void {
+  return startLogConsumer<LoggedMeasurement>(
+    log,
+    'db-writer',
+    async (records) => {
+      await Promise.all(
+        records.map(({ value }) =>
+          measurementWriter.enqueue(
+            {
+              ...value.measurement,
+              measuredAt: new Date(value.measurement.measuredAt),
+              uptime: value.measurement.uptime != null ? BigInt(value.measurement.uptime) : null,
+            },
+            { firmwareVersion: value.firmwareVersion },
+            Boolean(value.priority)
+          )
+        )
+      );
+      log.truncateBefore(['db-writer']);
+    },
+    { batchSize: config.ingestBatchSize, isTransient: isTransientDbError }
+  );
+}
@@ -0,0 +1,369 @@
+/**
+ * Edge MQTT Broker
+ * Small MQTT 3.1.1 broker for a site's node fleet: QoS 0/1, clean sessions,
+ * retained messages, wills, keepalive, and `$share/<group>/<filter>` shared
+ * subscriptions routed by topic hash (so with per-device topics a device always
+ * lands on the same group member and keeps its order). Subscriptions live in a
+ * topic trie, and a published payload is written to every subscriber as the
+ * same buffer behind a per-subscriber header (no payload copies on fan-out).
+ *
+ * An optional `persist` hook sees every inbound PUBLISH; QoS 1 publishers get
+ * their PUBACK only after it resolves (e.g. once queued to disk for upstream).
+ */
+
+import { EventEmitter } from 'events';
+import net from 'net';
+import crypto from 'crypto';
+import {
+  encodePacket,
+  encodePublishHeader,
+  Packet,
+  PacketParser,
+  QoS,
+  CONNACK_ACCEPTED,
+  CONNACK_BAD_CREDENTIALS,
+  SUBACK_FAILURE,
+} from './mqtt-codec';
+import { TopicTrie, filterMatches, validFilter, validTopic } from './topic-trie';
+
+export interface BrokerOptions {
+  authenticate?: (clientId: string, username?: string, password?: Buffer) => boolean;
+  // Returns a promise for messages it persisted, or undefined to skip
+  persist?: (topic: string, payload: Buffer, qos: QoS) => Promise<unknown> | undefined;
+  maxPacketBytes?: number;
+  // QoS 0 deliveries are dropped for a subscriber with more than this buffered
+  maxBufferedBytes?: number;
+}
+
+interface Session {
+  clientId: string;
+  socket: net.Socket;
+  keepaliveMs: number;
+  lastSeen: number;
+  will?: { topic: string; payload: Buffer; qos: QoS; retain: boolean };
+  subs: Map<string, Subscription>;
+  nextId: number;
+  // PUBACKs to this client go out in the order its PUBLISHes arrived
+  ackChain: Promise<void>;
+}
+
+interface Subscription {
+  session: Session;
+  filter: string;
+  qos: QoS;
+  group?: string;
+}
+
+export interface BrokerStats {
+  connections: number;
+  subscriptions: number;
+  messagesIn: number;
+  messagesOut: number;
+  dropped: number;
+  retained: number;
+}
+
+const CONNECT_TIMEOUT_MS = 10_000;
+
+function topicHash(topic: string): number {
+  let h = 0x811c9dc5;
+  for (let i = 0; i < topic.length; i++) {
+    h ^= topic.charCodeAt(i);
+    h = Math.imul(h, 0x01000193);
+  }
+  return h >>> 0;
+}
+
+function parseShare(filter: string): { group?: string; filter: string } {
+  if (!filter.startsWith('$share/')) return { filter };
+  const slash = filter.indexOf('/', 7);
+  if (slash < 0) return { filter: '' };
+  return { group: filter.slice(7, slash), filter: filter.slice(slash + 1) };
+}
+
+export class MqttBroker extends EventEmitter {
+  private sessions = new Map<string, Session>();
+  private trie = new TopicTrie<Subscription>();
+  private retained = new Map<string, { payload: Buffer; qos: QoS }>();
+  private server: net.Server | null = null;
+  private keepaliveTimer: NodeJS.Timeout | null = null;
+  private readonly counters = { messagesIn: 0, messagesOut: 0, dropped: 0 };
+
+  constructor(private readonly opts: BrokerOptions = {}) {
+    super();
+  }
+
+  get stats(): BrokerStats {
+    return {
+      connections: this.sessions.size,
+      subscriptions: this.trie.size,
+      ...this.counters,
+      retained: this.retained.size,
+    };
+  }
+
+  listen(port: number, host = '0.0.0.0'): Promise<void> {
+    this.server = net.createServer((socket) => this.accept(socket));
+    this.keepaliveTimer = setInterval(() => this.expireIdle(), 1000);
+    this.keepaliveTimer.unref();
+    return new Promise((resolve) => this.server!.listen(port, host, resolve));
+  }
+
+  get port(): number {
+    return (this.server?.address() as net.AddressInfo | null)?.port ?? 0;
+  }
+
+  async close() {
+    if (this.keepaliveTimer) clearInterval(this.keepaliveTimer);
+    for (const session of this.sessions.values()) session.socket.destroy();
+    await new Promise<void>((resolve) => (this.server ? this.server.close(() => resolve()) : resolve()));
+  }
+
+  // -------------------------------------------------------------------------
+  // Connection lifecycle
+  // -------------------------------------------------------------------------
+
+  private accept(socket: net.Socket) {
+    socket.setNoDelay(true);
+    const parser = new PacketParser(this.opts.maxPacketBytes ?? 256 * 1024);
+    let session: Session | null = null;
+    let graceful = false;
+    const connectTimer = setTimeout(() => socket.destroy(), CONNECT_TIMEOUT_MS);
+
+    socket.on('data', (chunk) => {
+      let packets: Packet[];
+      try {
+        packets = parser.push(chunk);
+      } catch {
+        socket.destroy();
+        return;
+      }
+      for (const packet of packets) {
+        if (!session) {
+          if (packet.type !== 'connect') {
+            socket.destroy();
+            return;
+          }
+          clearTimeout(connectTimer);
+          session = this.onConnect(socket, packet);
+          if (!session) return;
+          continue;
+        }
+        session.lastSeen = Date.now();
+        if (packet.type === 'disconnect') {
+          graceful = true;
+          socket.end();
+          return;
+        }
+        this.onPacket(session, packet);
+      }
+    });
+
+    socket.on('error', () => {});
+    socket.on('close', () => {
+      clearTimeout(connectTimer);
+      if (!session) return;
+      this.dropSession(session);
+      // Wills fire on anything but a clean DISCONNECT
+      if (!graceful && session.will) {
+        const { topic, payload, qos, retain } = session.will;
+        this.route(topic, payload, qos, retain);
+      }
+    });
+  }
+
+  private onConnect(socket: net.Socket, packet: Extract<Packet, { type: 'connect' }>): Session | null {
+    if (this.opts.authenticate && !this.opts.authenticate(packet.clientId, packet.username, packet.password)) {
+      socket.end(encodePacket({ type: 'connack', sessionPresent: false, returnCode: CONNACK_BAD_CREDENTIALS }));
+      return null;
+    }
+    const clientId = packet.clientId || `edge-${crypto.randomBytes(6).toString('hex')}`;
+
+    // A reconnect under the same id takes over; the stale connection is closed
+    const previous = this.sessions.get(clientId);
+    if (previous) {
+      this.dropSession(previous);
+      previous.socket.destroy();
+    }
+
+    const session: Session = {
+      clientId,
+      socket,
+      keepaliveMs: packet.keepalive * 1000,
+      lastSeen: Date.now(),
+      // Copied: the parsed payload is a view into the socket chunk
+      will: packet.will ? { ...packet.will, payload: Buffer.from(packet.will.payload) } : undefined,
+      subs: new Map(),
+      nextId: 0,
+      ackChain: Promise.resolve(),
+    };
+    this.sessions.set(clientId, session);
+    socket.write(encodePacket({ type: 'connack', sessionPresent: false, returnCode: CONNACK_ACCEPTED }));
+    this.emit('client', clientId);
+    return session;
+  }
+
+  private dropSession(session: Session) {
+    if (this.sessions.get(session.clientId) !== session) return;
+    this.sessions.delete(session.clientId);
+    for (const sub of session.subs.values()) this.trie.remove(sub.filter, sub);
+    session.subs.clear();
+  }
+
+  // Clients silent for 1.5x their keepalive are disconnected (and their will published)
+  private expireIdle() {
+    const now = Date.now();
+    for (const session of this.sessions.values()) {
+      if (session.keepaliveMs > 0 && now - session.lastSeen > session.keepaliveMs * 1.5) session.socket.destroy();
+    }
+  }
+
+  // -------------------------------------------------------------------------
+  // Packets
+  // -------------------------------------------------------------------------
+
+  private onPacket(session: Session, packet: Packet) {
+    switch (packet.type) {
+      case 'publish': {
+        if (!validTopic(packet.topic)) {
+          session.socket.destroy();
+          return;
+        }
+        this.counters.messagesIn++;
+        const persisted = this.opts.persist?.(packet.topic, packet.payload, packet.qos);
+        this.route(packet.topic, packet.payload, packet.qos, packet.retain);
+        if (packet.qos === 1) {
+          const ack = encodePacket({ type: 'puback', messageId: packet.messageId! });
+          session.ackChain = session.ackChain
+            .then(() => persisted)
+            .then(
+              () => void session.socket.write(ack),
+              (err) => {
+                // Not durably queued: drop the connection so the client resends
+                this.emit('persist-error', err);
+                session.socket.destroy();
+              }
+            );
+        }
+        return;
+      }
+      case 'subscribe': {
+        const granted = packet.subscriptions.map(({ topic, qos }) => {
+          const { group, filter } = parseShare(topic);
+          if (!validFilter(filter)) return SUBACK_FAILURE;
+          const existing = session.subs.get(topic);
+          if (existing) this.trie.remove(existing.filter, existing);
+          const sub: Subscription = { session, filter, qos, group };
+          session.subs.set(topic, sub);
+          this.trie.add(filter, sub);
+          return qos;
+        });
+        session.socket.write(encodePacket({ type: 'suback', messageId: packet.messageId, granted }));
+        // Retained messages go to plain (not shared) subscriptions
+        for (const { topic, qos } of packet.subscriptions) {
+          const { group, filter } = parseShare(topic);
+          if (group || !validFilter(filter)) continue;
+          for (const [retainedTopic, msg] of this.retained) {
+            if (filterMatches(filter, retainedTopic)) this.deliver(session, retainedTopic, msg.payload, Math.min(qos, msg.qos) as QoS, true);
+          }
+        }
+        return;
+      }
+      case 'unsubscribe':
+        for (const topic of packet.topics) {
+          const sub = session.subs.get(topic);
+          if (!sub) continue;
+          this.trie.remove(sub.filter, sub);
+          session.subs.delete(topic);
+        }
+        session.socket.write(encodePacket({ type: 'unsuback', messageId: packet.messageId }));
+        return;
+      case 'pingreq':
+        session.socket.write(encodePacket({ type: 'pingresp' }));
+        return;
+      default:
+        // PUBACKs for our QoS 1 deliveries: clean sessions keep no redelivery state
+        return;
+    }
+  }
+
+  // -------------------------------------------------------------------------
+  // Routing
+  // -------------------------------------------------------------------------
+
+  /**
+   * Publish from inside the process (e.g. commands bridged down from upstream)
+   */
+  publish(topic: string, payload: Buffer, qos: QoS = 0, retain = false) {
+    this.route(topic, payload, qos, retain);
+  }
+
+  private route(topic: string, payload: Buffer, qos: QoS, retain: boolean) {
+    if (retain) {
+      if (payload.length === 0) this.retained.delete(topic);
+      else this.retained.set(topic, { payload: Buffer.from(payload), qos });
+    }
+
+    const matches = this.trie.match(topic);
+    if (matches.length === 0) return;
+
+    // One copy per session at its highest matching QoS; one member per shared group
+    const direct = new Map<Session, QoS>();
+    let groups: Map<string, Subscription[]> | null = null;
+    for (const sub of matches) {
+      if (sub.group) {
+        groups ??= new Map();
+        const key = `${sub.group}\0${sub.filter}`;
+        const members = groups.get(key);
+        if (members) members.push(sub);
+        else groups.set(key, [sub]);
+        continue;
+      }
+      const q = Math.min(sub.qos, qos) as QoS;
+      if ((direct.get(sub.session) ?? -1) < q) direct.set(sub.session, q);
+    }
+    if (groups) {
+      const h = topicHash(topic);
+      for (const members of groups.values()) {
+        // Stable member order so a topic keeps hashing to the same member
+        members.sort((a, b) => (a.session.clientId < b.session.clientId ? -1 : 1));
+        const pick = members[h % members.length];
+        const q = Math.min(pick.qos, qos) as QoS;
+        if ((direct.get(pick.session) ?? -1) < q) direct.set(pick.session, q);
+      }
+    }
+
+    // QoS 0 header is identical for every subscriber: encode it once
+    let qos0Header: Buffer | null = null;
+    for (const [session, q] of direct) {
+      if (q === 0) {
+        qos0Header ??= encodePublishHeader(topic, 0, false, payload.length);
+        this.write(session, qos0Header, payload, 0);
+      } else {
+        this.deliver(session, topic, payload, 1, false);
+      }
+    }
+  }
+
+  private deliver(session: Session, topic: string, payload: Buffer, qos: QoS, retain: boolean) {
+    let messageId: number | undefined;
+    if (qos === 1) {
+      session.nextId = session.nextId >= 0xffff ? 1 : session.nextId + 1;
+      messageId = session.nextId;
+    }
+    this.write(session, encodePublishHeader(topic, qos, retain, payload.length, messageId), payload, qos);
+  }
+
+  private write(session: Session, header: Buffer, payload: Buffer, qos: QoS) {
+    const socket = session.socket;
+    if (qos === 0 && socket.writableLength > (this.opts.maxBufferedBytes ?? 1024 * 1024)) {
+      this.counters.dropped++;
+      return;
+    }
+    socket.cork();
+    socket.write(header);
+    socket.write(payload);
+    process.nextTick(() => socket.uncork());
+    this.counters.messagesOut++;
+  }
+}
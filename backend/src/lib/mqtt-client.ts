@@ -0,0 +1,255 @@
+/**
+ * Minimal MQTT 3.1.1 Client
+ * Just enough for the backend's needs: subscribe (including `$share/...`
+ * shared subscriptions), QoS 0/1 publish and receive, keepalive and
+ * reconnect with resubscribe. Received QoS 1 messages are acknowledged only
+ * when the caller calls ack(), and PUBACKs go out in arrival order as the
+ * spec requires, so anything not yet processed is redelivered after a drop.
+ */
+
+import { EventEmitter } from 'events';
+import net from 'net';
+import tls from 'tls';
+import { encodePacket, Packet, PacketParser, QoS, CONNACK_ACCEPTED } from './mqtt-codec';
+
+export interface MqttClientOptions {
+  url: string;
+  clientId: string;
+  username?: string;
+  password?: string;
+  keepaliveSec?: number;
+  clean?: boolean;
+  reconnectMs?: number;
+}
+
+export interface MqttMessage {
+  topic: string;
+  payload: Buffer;
+  qos: QoS;
+  ack(): void;
+}
+
+interface PendingPublish {
+  packet: Extract<Packet, { type: 'publish' }>;
+  resolve: () => void;
+}
+
+export class MqttClient extends EventEmitter {
+  private socket: net.Socket | null = null;
+  private parser = new PacketParser();
+  private connected = false;
+  private closing = false;
+  private nextId = 1;
+  private pingTimer: NodeJS.Timeout | null = null;
+  private subscriptions = new Map<string, QoS>();
+  private subAcks = new Map<number, (granted: number[]) => void>();
+  private outbound = new Map<number, PendingPublish>();
+  // Received QoS 1 messages in arrival order; acked from the head once processed
+  private inbound: Array<{ messageId: number; done: boolean }> = [];
+
+  constructor(private readonly opts: MqttClientOptions) {
+    super();
+  }
+
+  get isConnected(): boolean {
+    return this.connected;
+  }
+
+  connect() {
+    const url = new URL(this.opts.url);
+    const secure = url.protocol === 'mqtts:';
+    const port = parseInt(url.port || (secure ? '8883' : '1883'));
+    const socket = secure
+      ? tls.connect({ host: url.hostname, port, servername: url.hostname })
+      : net.connect({ host: url.hostname, port });
+    socket.setNoDelay(true);
+    this.socket = socket;
+    this.parser = new PacketParser();
+    this.inbound = [];
+
+    socket.once(secure ? 'secureConnect' : 'connect', () => {
+      socket.write(
+        encodePacket({
+          type: 'connect',
+          clientId: this.opts.clientId,
+          keepalive: this.opts.keepaliveSec ?? 30,
+          clean: this.opts.clean ?? true,
+          username: this.opts.username || undefined,
+          password: this.opts.password ? Buffer.from(this.opts.password) : undefined,
+        })
+      );
+    });
+    socket.on('data', (chunk) => {
+      try {
+        for (const packet of this.parser.push(chunk)) this.handle(packet);
+      } catch (err) {
+        this.emit('error', err);
+        socket.destroy();
+      }
+    });
+    socket.on('error', (err) => this.emit('error', err));
+    socket.on('close', () => this.onClose(socket));
+  }
+
+  private onClose(socket: net.Socket) {
+    if (socket !== this.socket) return;
+    const wasConnected = this.connected;
+    this.connected = false;
+    this.socket = null;
+    if (this.pingTimer) clearInterval(this.pingTimer);
+    if (wasConnected) this.emit('offline');
+    if (this.closing) {
+      this.emit('close');
+      return;
+    }
+    setTimeout(() => {
+      if (!this.closing) this.connect();
+    }, this.opts.reconnectMs ?? 2000);
+  }
+
+  private handle(packet: Packet) {
+    switch (packet.type) {
+      case 'connack':
+        if (packet.returnCode !== CONNACK_ACCEPTED) {
+          this.emit('error', new Error(`MQTT connection refused (code ${packet.returnCode})`));
+          this.socket?.destroy();
+          return;
+        }
+        this.connected = true;
+        this.startPing();
+        if (this.subscriptions.size > 0) {
+          this.send({
+            type: 'subscribe',
+            messageId: this.allocId(),
+            subscriptions: [...this.subscriptions].map(([topic, qos]) => ({ topic, qos })),
+          });
+        }
+        // Unacknowledged publishes are resent after a reconnect
+        for (const pending of this.outbound.values()) this.send({ ...pending.packet, dup: true });
+        this.emit('connect');
+        return;
+      case 'publish': {
+        if (packet.qos === 0) {
+          this.emit('message', { topic: packet.topic, payload: packet.payload, qos: 0, ack: () => {} } as MqttMessage);
+          return;
+        }
+        const slot = { messageId: packet.messageId!, done: false };
+        const socket = this.socket;
+        this.inbound.push(slot);
+        this.emit('message', {
+          topic: packet.topic,
+          payload: packet.payload,
+          qos: 1,
+          ack: () => {
+            if (slot.done || socket !== this.socket) return;
+            slot.done = true;
+            this.flushAcks();
+          },
+        } as MqttMessage);
+        return;
+      }
+      case 'puback': {
+        const pending = this.outbound.get(packet.messageId);
+        if (pending) {
+          this.outbound.delete(packet.messageId);
+          pending.resolve();
+        }
+        return;
+      }
+      case 'suback':
+        this.subAcks.get(packet.messageId)?.(packet.granted);
+        this.subAcks.delete(packet.messageId);
+        return;
+      default:
+        return;
+    }
+  }
+
+  private flushAcks() {
+    while (this.inbound.length > 0 && this.inbound[0].done) {
+      this.send({ type: 'puback', messageId: this.inbound.shift()!.messageId });
+    }
+  }
+
+  private startPing() {
+    const keepalive = this.opts.keepaliveSec ?? 30;
+    if (this.pingTimer) clearInterval(this.pingTimer);
+    if (keepalive > 0) {
+      this.pingTimer = setInterval(() => this.send({ type: 'pingreq' }), (keepalive * 1000) / 2);
+      this.pingTimer.unref();
+    }
+  }
+
+  private allocId(): number {
+    do {
+      this.nextId = this.nextId >= 0xffff ? 1 : this.nextId + 1;
+    } while (this.outbound.has(this.nextId) || this.subAcks.has(this.nextId));
+    return this.nextId;
+  }
+
+  private send(packet: Packet): boolean {
+    if (!this.socket || this.socket.destroyed) return false;
+    return this.socket.write(encodePacket(packet));
+  }
+
+  /**
+   * Subscribe now (if connected) and again after every reconnect
+   */
+  subscribe(topic: string, qos: QoS = 1): Promise<number[]> {
+    this.subscriptions.set(topic, qos);
+    if (!this.connected) return Promise.resolve([]);
+    const messageId = this.allocId();
+    return new Promise((resolve) => {
+      this.subAcks.set(messageId, resolve);
+      this.send({ type: 'subscribe', messageId, subscriptions: [{ topic, qos }] });
+    });
+  }
+
+  /**
+   * QoS 0 resolves once written; QoS 1 resolves on PUBACK (resent on reconnect until then).
+   * With `timeoutMs`, a QoS 1 publish not acknowledged in time rejects and is no longer resent.
+   */
+  publish(topic: string, payload: Buffer | string, qos: QoS = 0, retain = false, timeoutMs?: number): Promise<void> {
+    const body = typeof payload === 'string' ? Buffer.from(payload) : payload;
+    if (qos === 0) {
+      this.send({ type: 'publish', topic, payload: body, qos, retain, dup: false });
+      return Promise.resolve();
+    }
+    const packet = { type: 'publish' as const, topic, payload: body, qos, retain, dup: false, messageId: this.allocId() };
+    return new Promise((resolve, reject) => {
+      const timer = timeoutMs
+        ? setTimeout(() => {
+            this.outbound.delete(packet.messageId);
+            reject(new Error(`No PUBACK for ${topic} within ${timeoutMs} ms`));
+          }, timeoutMs)
+        : undefined;
+      this.outbound.set(packet.messageId, {
+        packet,
+        resolve: () => {
+          clearTimeout(timer);
+          resolve();
+        },
+      });
+      if (this.connected) this.send(packet);
+    });
+  }
+
+  // Socket-level flow control: stop reading while the consumer catches up
+  pause() {
+    this.socket?.pause();
+  }
+
+  resume() {
+    this.socket?.resume();
+  }
+
+  end(): Promise<void> {
+    this.closing = true;
+    if (!this.socket) return Promise.resolve();
+    return new Promise((resolve) => {
+      this.once('close', resolve);
+      this.send({ type: 'disconnect' });
+      this.socket!.end();
+    });
+  }
+}
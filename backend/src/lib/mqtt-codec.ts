@@ -0,0 +1,352 @@
+/**
+ * MQTT 3.1.1 Packet Codec
+ * Encoder and streaming parser for the packet types the fleet uses (QoS 0/1,
+ * no QoS 2). Parsed PUBLISH payloads are views into the received socket
+ * chunk, not copies; anything that keeps a payload beyond the current tick
+ * should copy it.
+ */
+
+export type QoS = 0 | 1;
+
+export type Packet =
+  | {
+      type: 'connect';
+      clientId: string;
+      keepalive: number;
+      clean: boolean;
+      username?: string;
+      password?: Buffer;
+      will?: { topic: string; payload: Buffer; qos: QoS; retain: boolean };
+    }
+  | { type: 'connack'; sessionPresent: boolean; returnCode: number }
+  | { type: 'publish'; topic: string; payload: Buffer; qos: QoS; retain: boolean; dup: boolean; messageId?: number }
+  | { type: 'puback'; messageId: number }
+  | { type: 'subscribe'; messageId: number; subscriptions: Array<{ topic: string; qos: QoS }> }
+  | { type: 'suback'; messageId: number; granted: number[] }
+  | { type: 'unsubscribe'; messageId: number; topics: string[] }
+  | { type: 'unsuback'; messageId: number }
+  | { type: 'pingreq' }
+  | { type: 'pingresp' }
+  | { type: 'disconnect' };
+
+const TYPE_CODES = {
+  connect: 1,
+  connack: 2,
+  publish: 3,
+  puback: 4,
+  subscribe: 8,
+  suback: 9,
+  unsubscribe: 10,
+  unsuback: 11,
+  pingreq: 12,
+  pingresp: 13,
+  disconnect: 14,
+} as const;
+
+export const CONNACK_ACCEPTED = 0;
+export const CONNACK_BAD_CREDENTIALS = 4;
+export const SUBACK_FAILURE = 0x80;
+
+// Largest remaining length a 4-byte varint can express
+const MAX_REMAINING = 268_435_455;
+
+// ---------------------------------------------------------------------------
+// Encoding
+// ---------------------------------------------------------------------------
+
+function strLen(s: string): number {
+  return 2 + Buffer.byteLength(s);
+}
+
+function lengthBytes(n: number): number {
+  return n < 128 ? 1 : n < 16_384 ? 2 : n < 2_097_152 ? 3 : 4;
+}
+
+class Out {
+  readonly buf: Buffer;
+  private pos = 0;
+
+  constructor(first: number, remaining: number) {
+    if (remaining > MAX_REMAINING) throw new Error('MQTT packet too large');
+    this.buf = Buffer.allocUnsafe(1 + lengthBytes(remaining) + remaining);
+    this.u8(first);
+    do {
+      let b = remaining % 128;
+      remaining = Math.floor(remaining / 128);
+      if (remaining > 0) b |= 0x80;
+      this.u8(b);
+    } while (remaining > 0);
+  }
+
+  u8(v: number) {
+    this.buf[this.pos++] = v;
+  }
+
+  u16(v: number) {
+    this.buf.writeUInt16BE(v, this.pos);
+    this.pos += 2;
+  }
+
+  str(s: string) {
+    const n = this.buf.write(s, this.pos + 2, 'utf8');
+    this.u16(n);
+    this.pos += n;
+  }
+
+  bytes(b: Buffer, withLength = false) {
+    if (withLength) this.u16(b.length);
+    b.copy(this.buf, this.pos);
+    this.pos += b.length;
+  }
+}
+
+export function encodePacket(p: Packet): Buffer {
+  switch (p.type) {
+    case 'connect': {
+      let len = strLen('MQTT') + 1 + 1 + 2 + strLen(p.clientId);
+      if (p.will) len += strLen(p.will.topic) + 2 + p.will.payload.length;
+      if (p.username !== undefined) len += strLen(p.username);
+      if (p.password !== undefined) len += 2 + p.password.length;
+      const o = new Out(TYPE_CODES.connect << 4, len);
+      o.str('MQTT');
+      o.u8(4);
+      let flags = p.clean ? 0x02 : 0;
+      if (p.will) flags |= 0x04 | (p.will.qos << 3) | (p.will.retain ? 0x20 : 0);
+      if (p.password !== undefined) flags |= 0x40;
+      if (p.username !== undefined) flags |= 0x80;
+      o.u8(flags);
+      o.u16(p.keepalive);
+      o.str(p.clientId);
+      if (p.will) {
+        o.str(p.will.topic);
+        o.bytes(p.will.payload, true);
+      }
+      if (p.username !== undefined) o.str(p.username);
+      if (p.password !== undefined) o.bytes(p.password, true);
+      return o.buf;
+    }
+    case 'connack': {
+      const o = new Out(TYPE_CODES.connack << 4, 2);
+      o.u8(p.sessionPresent ? 1 : 0);
+      o.u8(p.returnCode);
+      return o.buf;
+    }
+    case 'publish': {
+      const len = strLen(p.topic) + (p.qos > 0 ? 2 : 0) + p.payload.length;
+      const o = new Out((TYPE_CODES.publish << 4) | (p.dup ? 0x08 : 0) | (p.qos << 1) | (p.retain ? 1 : 0), len);
+      o.str(p.topic);
+      if (p.qos > 0) o.u16(p.messageId!);
+      o.bytes(p.payload);
+      return o.buf;
+    }
+    case 'puback':
+    case 'unsuback': {
+      const o = new Out(TYPE_CODES[p.type] << 4, 2);
+      o.u16(p.messageId);
+      return o.buf;
+    }
+    case 'subscribe': {
+      const len = 2 + p.subscriptions.reduce((n, s) => n + strLen(s.topic) + 1, 0);
+      const o = new Out((TYPE_CODES.subscribe << 4) | 0x02, len);
+      o.u16(p.messageId);
+      for (const s of p.subscriptions) {
+        o.str(s.topic);
+        o.u8(s.qos);
+      }
+      return o.buf;
+    }
+    case 'suback': {
+      const o = new Out(TYPE_CODES.suback << 4, 2 + p.granted.length);
+      o.u16(p.messageId);
+      for (const g of p.granted) o.u8(g);
+      return o.buf;
+    }
+    case 'unsubscribe': {
+      const o = new Out((TYPE_CODES.unsubscribe << 4) | 0x02, 2 + p.topics.reduce((n, t) => n + strLen(t), 0));
+      o.u16(p.messageId);
+      for (const t of p.topics) o.str(t);
+      return o.buf;
+    }
+    case 'pingreq':
+    case 'pingresp':
+    case 'disconnect':
+      return Buffer.from([TYPE_CODES[p.type] << 4, 0]);
+  }
+}
+
+/**
+ * PUBLISH fixed + variable header only. Written ahead of a shared payload buffer
+ * so fan-out sends the same payload bytes to every subscriber without copying.
+ */
+export function encodePublishHeader(topic: string, qos: QoS, retain: boolean, payloadBytes: number, messageId?: number): Buffer {
+  const variable = strLen(topic) + (qos > 0 ? 2 : 0);
+  const remaining = variable + payloadBytes;
+  if (remaining > MAX_REMAINING) throw new Error('MQTT packet too large');
+  const out = Buffer.allocUnsafe(1 + lengthBytes(remaining) + variable);
+  let pos = 0;
+  out[pos++] = (TYPE_CODES.publish << 4) | (qos << 1) | (retain ? 1 : 0);
+  let n = remaining;
+  do {
+    let b = n % 128;
+    n = Math.floor(n / 128);
+    if (n > 0) b |= 0x80;
+    out[pos++] = b;
+  } while (n > 0);
+  const len = out.write(topic, pos + 2, 'utf8');
+  out.writeUInt16BE(len, pos);
+  pos += 2 + len;
+  if (qos > 0) out.writeUInt16BE(messageId!, pos);
+  return out;
+}
+
+// ---------------------------------------------------------------------------
+// Parsing
+// ---------------------------------------------------------------------------
+
+class In {
+  pos: number;
+
+  constructor(
+    private readonly buf: Buffer,
+    start: number,
+    readonly end: number
+  ) {
+    this.pos = start;
+  }
+
+  u8(): number {
+    if (this.pos >= this.end) throw new Error('Malformed MQTT packet');
+    return this.buf[this.pos++];
+  }
+
+  u16(): number {
+    if (this.pos + 2 > this.end) throw new Error('Malformed MQTT packet');
+    const v = this.buf.readUInt16BE(this.pos);
+    this.pos += 2;
+    return v;
+  }
+
+  bytes(): Buffer {
+    const n = this.u16();
+    if (this.pos + n > this.end) throw new Error('Malformed MQTT packet');
+    const b = this.buf.subarray(this.pos, this.pos + n);
+    this.pos += n;
+    return b;
+  }
+
+  str(): string {
+    return this.bytes().toString('utf8');
+  }
+
+  rest(): Buffer {
+    const b = this.buf.subarray(this.pos, this.end);
+    this.pos = this.end;
+    return b;
+  }
+}
+
+function decodeBody(first: number, r: In): Packet {
+  const code = first >> 4;
+  switch (code) {
+    case TYPE_CODES.connect: {
+      const protocol = r.str();
+      const level = r.u8();
+      if (protocol !== 'MQTT' || level !== 4) throw new Error(`Unsupported MQTT protocol ${protocol}/${level}`);
+      const flags = r.u8();
+      const keepalive = r.u16();
+      const clientId = r.str();
+      const will =
+        flags & 0x04
+          ? { topic: r.str(), payload: r.bytes(), qos: Math.min(1, (flags >> 3) & 3) as QoS, retain: (flags & 0x20) !== 0 }
+          : undefined;
+      const username = flags & 0x80 ? r.str() : undefined;
+      const password = flags & 0x40 ? r.bytes() : undefined;
+      return { type: 'connect', clientId, keepalive, clean: (flags & 0x02) !== 0, username, password, will };
+    }
+    case TYPE_CODES.connack:
+      return { type: 'connack', sessionPresent: (r.u8() & 1) === 1, returnCode: r.u8() };
+    case TYPE_CODES.publish: {
+      const qos = (first >> 1) & 3;
+      if (qos > 1) throw new Error('QoS 2 is not supported');
+      const topic = r.str();
+      const messageId = qos > 0 ? r.u16() : undefined;
+      return { type: 'publish', topic, payload: r.rest(), qos: qos as QoS, retain: (first & 1) === 1, dup: (first & 8) !== 0, messageId };
+    }
+    case TYPE_CODES.puback:
+      return { type: 'puback', messageId: r.u16() };
+    case TYPE_CODES.subscribe: {
+      const messageId = r.u16();
+      const subscriptions: Array<{ topic: string; qos: QoS }> = [];
+      while (r.pos < r.end) subscriptions.push({ topic: r.str(), qos: Math.min(1, r.u8() & 3) as QoS });
+      return { type: 'subscribe', messageId, subscriptions };
+    }
+    case TYPE_CODES.suback: {
+      const messageId = r.u16();
+      const granted: number[] = [];
+      while (r.pos < r.end) granted.push(r.u8());
+      return { type: 'suback', messageId, granted };
+    }
+    case TYPE_CODES.unsubscribe: {
+      const messageId = r.u16();
+      const topics: string[] = [];
+      while (r.pos < r.end) topics.push(r.str());
+      return { type: 'unsubscribe', messageId, topics };
+    }
+    case TYPE_CODES.unsuback:
+      return { type: 'unsuback', messageId: r.u16() };
+    case TYPE_CODES.pingreq:
+      return { type: 'pingreq' };
+    case TYPE_CODES.pingresp:
+      return { type: 'pingresp' };
+    case TYPE_CODES.disconnect:
+      return { type: 'disconnect' };
+    default:
+      throw new Error(`Unsupported MQTT packet type ${code}`);
+  }
+}
+
+/**
+ * Incremental parser: feed socket chunks, get whole packets back.
+ * Throws on malformed input (callers drop the connection).
+ */
+export class PacketParser {
+  private pending: Buffer | null = null;
+
+  constructor(private readonly maxPacketBytes = 1024 * 1024) {}
+
+  push(chunk: Buffer): Packet[] {
+    const buf = this.pending ? Buffer.concat([this.pending, chunk]) : chunk;
+    this.pending = null;
+    const out: Packet[] = [];
+    let pos = 0;
+
+    while (pos < buf.length) {
+      // Fixed header: type/flags byte + 1-4 byte remaining length
+      let remaining = 0;
+      let mult = 1;
+      let i = pos + 1;
+      let complete = false;
+      for (; i < buf.length && i < pos + 5; i++) {
+        remaining += (buf[i] & 0x7f) * mult;
+        mult *= 128;
+        if ((buf[i] & 0x80) === 0) {
+          complete = true;
+          break;
+        }
+      }
+      if (!complete) {
+        if (i >= pos + 5) throw new Error('Malformed MQTT remaining length');
+        break;
+      }
+      if (remaining > this.maxPacketBytes) throw new Error('MQTT packet too large');
+      const start = i + 1;
+      const end = start + remaining;
+      if (end > buf.length) break;
+      out.push(decodeBody(buf[pos], new In(buf, start, end)));
+      pos = end;
+    }
+
+    if (pos < buf.length) this.pending = buf.subarray(pos);
+    return out;
+  }
+}
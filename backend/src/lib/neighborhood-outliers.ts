@@ -0,0 +1,132 @@
+/**
+ * Neighborhood Outlier Detection
+ * Compares each reading with the latest readings of other nodes in the same
+ * area over a sliding window. A value far from the neighborhood median (in
+ * robust z-score, using the MAD) is more likely a sensor fault than a
+ * pollution event, so it is flagged instead of trusted.
+ */
+
+export type OutlierMetric = 'aqi' | 'iaq';
+
+export interface OutlierOptions {
+  windowMs: number;
+  // Other nodes with a recent reading needed before anything is judged
+  minNeighbors: number;
+  // Robust z-score above which a reading is an outlier
+  zThreshold: number;
+  // Minimum absolute deviation, so tight neighborhoods don't flag small differences
+  minDeviation: Record<OutlierMetric, number>;
+}
+
+export interface OutlierVerdict {
+  outlier: boolean;
+  neighbors: number;
+  metric?: OutlierMetric;
+  median?: number;
+  z?: number;
+}
+
+interface NodeReading {
+  ts: number;
+  aqi: number | null;
+  iaq: number | null;
+}
+
+// MAD → standard deviation for normally distributed data
+const MAD_SCALE = 1.4826;
+
+function median(sorted: number[]): number {
+  const mid = sorted.length >> 1;
+  return sorted.length % 2 ? sorted[mid] : (sorted[mid - 1] + sorted[mid]) / 2;
+}
+
+/**
+ * Area key shared with the aggregator: areaName, else a ~1 km lat/lon grid cell
+ */
+export function neighborhoodKey(device: { areaName?: string | null; latitude?: number | null; longitude?: number | null }): string | null {
+  if (device.areaName) return device.areaName;
+  if (device.latitude == null || device.longitude == null) return null;
+  return `${device.latitude.toFixed(2)},${device.longitude.toFixed(2)}`;
+}
+
+export class NeighborhoodMonitor {
+  private areas = new Map<string, Map<string, NodeReading>>();
+  readonly stats = { checked: 0, flagged: 0 };
+
+  constructor(private readonly opts: OutlierOptions) {}
+
+  /**
+   * Judge a reading against its neighbors, then record it as this node's latest.
+   * With record false the reading is only judged and leaves the consensus untouched.
+   */
+  check(
+    area: string,
+    deviceId: string,
+    ts: number,
+    values: { aqi: number | null; iaq: number | null },
+    record = true
+  ): OutlierVerdict {
+    let nodes = this.areas.get(area);
+    if (!nodes) {
+      nodes = new Map();
+      this.areas.set(area, nodes);
+    }
+
+    const cutoff = ts - this.opts.windowMs;
+    const aqis: number[] = [];
+    const iaqs: number[] = [];
+    for (const [id, r] of nodes) {
+      if (r.ts < cutoff) {
+        nodes.delete(id);
+        continue;
+      }
+      // Buffered (older) uploads are judged against neighbors from around the same time
+      if (id === deviceId || r.ts > ts + this.opts.windowMs) continue;
+      if (r.aqi !== null) aqis.push(r.aqi);
+      if (r.iaq !== null) iaqs.push(r.iaq);
+    }
+
+    const prev = nodes.get(deviceId);
+    if (record && (!prev || prev.ts <= ts)) nodes.set(deviceId, { ts, ...values });
+
+    this.stats.checked++;
+    const neighbors = Math.max(aqis.length, iaqs.length);
+    for (const [metric, value, others] of [
+      ['iaq', values.iaq, iaqs],
+      ['aqi', values.aqi, aqis],
+    ] as const) {
+      if (value === null || others.length < this.opts.minNeighbors) continue;
+      const verdict = this.judge(metric, value, others);
+      if (verdict) {
+        this.stats.flagged++;
+        return { ...verdict, neighbors };
+      }
+    }
+    return { outlier: false, neighbors };
+  }
+
+  private judge(metric: OutlierMetric, value: number, others: number[]): OutlierVerdict | null {
+    others.sort((a, b) => a - b);
+    const med = median(others);
+    const deviations = others.map((v) => Math.abs(v - med)).sort((a, b) => a - b);
+    const mad = median(deviations);
+    const deviation = Math.abs(value - med);
+    if (deviation < this.opts.minDeviation[metric]) return null;
+
+    // Identical neighbors (MAD 0): any deviation past the floor counts
+    const z = mad > 0 ? deviation / (MAD_SCALE * mad) : Infinity;
+    if (z <= this.opts.zThreshold) return null;
+    return { outlier: true, neighbors: others.length, metric, median: med, z: Number.isFinite(z) ? z : undefined };
+  }
+
+  /**
+   * Forget nodes with no reading in the window and empty areas
+   */
+  sweep(now = Date.now()) {
+    const cutoff = now - this.opts.windowMs;
+    for (const [area, nodes] of this.areas) {
+      for (const [id, r] of nodes) if (r.ts < cutoff) nodes.delete(id);
+      if (nodes.size === 0) this.areas.delete(area);
+    }
+  }
+}
@@ -0,0 +1,255 @@
+/**
+ * Node Payload Decoder
+ * Fast path specialized to the firmware `transmitData()` shape, with the
+ * flexible zod + unit-stripping path as fallback for legacy/flat payloads.
+ */
+
+import { z } from 'zod';
+
+export interface DecodedPayload {
+  deviceId?: string;
+  firmwareVersion?: string;
+  timestamp?: number | string;
+  measuredAt?: string;
+  measurementId?: string;
+  iaq: number | null;
+  co2: number | null;
+  temperature: number | null;
+  humidity: number | null;
+  pressure: number | null;
+  altitude: number | null;
+  mq135Raw: number | null;
+  pm25: number | null;
+  rssi: number | null;
+  uptimeMs: number | null;
+  bootId?: string;
+  seq: number | null;
+  // Set on the node's priority uplink: what made the reading alert-grade
+  alert?: string;
+  signature?: string;
+  // The exact string the node signed (payload without `signature`)
+  signedPayload: () => string;
+  fastPath: boolean;
+}
+
+// Coerce a possibly unit-suffixed string into a number, otherwise return null
+export function num(value: unknown): number | null {
+  if (value === null || value === undefined) return null;
+  if (typeof value === 'number') return Number.isFinite(value) ? value : null;
+  if (typeof value === 'string') {
+    // Extract first number incl. sign and decimal
+    const match = value.replace(/,/g, '').match(/-?\d+(?:\.\d+)?/);
+    if (!match) return null;
+    const n = Number(match[0]);
+    return Number.isFinite(n) ? n : null;
+  }
+  return null;
+}
+
+// Flexible ingest schema: many fields optional because devices may send slightly different shapes
+export const ingestSchema = z.object({
+  device_id: z.string().optional(),
+  deviceId: z.string().optional(),
+  firmware_version: z.string().optional(),
+  timestamp: z.union([z.number(), z.string()]).optional(),
+  measuredAt: z.string().optional(),
+  // Client-chosen row id (idempotent retries); must be a UUID like server-assigned ones
+  measurement_id: z.string().uuid().optional(),
+  id: z.string().uuid().optional(),
+  sensors: z.record(z.any()).optional(),
+  // also allow top-level metrics if device sends flat payload
+  iaq_score: z.union([z.number(), z.string()]).optional(),
+  iaq: z.union([z.number(), z.string()]).optional(),
+  co2_equiv: z.union([z.number(), z.string()]).optional(),
+  co2: z.union([z.number(), z.string()]).optional(),
+  temperature: z.union([z.number(), z.string()]).optional(),
+  humidity: z.union([z.number(), z.string()]).optional(),
+  pressure_hpa: z.union([z.number(), z.string()]).optional(),
+  pressure: z.union([z.number(), z.string()]).optional(),
+  altitude_m: z.union([z.number(), z.string()]).optional(),
+  pm25_api: z.union([z.number(), z.string()]).optional(),
+  pm25: z.union([z.number(), z.string()]).optional(),
+  meta: z.record(z.any()).optional(),
+  signature: z.string().optional(),
+});
+
+// ---------------------------------------------------------------------------
+// Fast path
+// ---------------------------------------------------------------------------
+
+// Top-level keys in the order the firmware (and the zod schema) emits them.
+// The signed string is order-sensitive, so out-of-order payloads use the generic path.
+const enum TopKey {
+  DeviceId = 0,
+  FirmwareVersion,
+  Timestamp,
+  Sensors,
+  Meta,
+  Signature,
+}
+
+function topKeyIndex(key: string): number {
+  switch (key) {
+    case 'device_id': return TopKey.DeviceId;
+    case 'firmware_version': return TopKey.FirmwareVersion;
+    case 'timestamp': return TopKey.Timestamp;
+    case 'sensors': return TopKey.Sensors;
+    case 'meta': return TopKey.Meta;
+    case 'signature': return TopKey.Signature;
+    default: return -1;
+  }
+}
+
+function finiteOrNull(v: unknown): number | null | undefined {
+  if (v === null) return null;
+  if (typeof v === 'number') return Number.isFinite(v) ? v : null;
+  return undefined; // Not a plain number: needs the unit-stripping path
+}
+
+function isPlainObject(v: unknown): v is Record<string, unknown> {
+  return typeof v === 'object' && v !== null && !Array.isArray(v);
+}
+
+function decodeFast(body: Record<string, unknown>): DecodedPayload | null {
+  const out: DecodedPayload = {
+    iaq: null,
+    co2: null,
+    temperature: null,
+    humidity: null,
+    pressure: null,
+    altitude: null,
+    mq135Raw: null,
+    pm25: null,
+    rssi: null,
+    uptimeMs: null,
+    seq: null,
+    signedPayload: () => '',
+    fastPath: true,
+  };
+
+  let lastIdx = -1;
+  for (const key in body) {
+    const idx = topKeyIndex(key);
+    if (idx <= lastIdx) return null;
+    lastIdx = idx;
+    const value = body[key];
+
+    switch (idx) {
+      case TopKey.DeviceId:
+        if (typeof value !== 'string') return null;
+        out.deviceId = value;
+        break;
+      case TopKey.FirmwareVersion:
+        if (typeof value !== 'string') return null;
+        out.firmwareVersion = value;
+        break;
+      case TopKey.Timestamp:
+        if (typeof value !== 'number') return null;
+        out.timestamp = value;
+        break;
+      case TopKey.Signature:
+        if (typeof value !== 'string') return null;
+        out.signature = value;
+        break;
+      case TopKey.Sensors: {
+        if (!isPlainObject(value)) return null;
+        for (const sk in value) {
+          const n = finiteOrNull(value[sk]);
+          if (n === undefined) return null;
+          switch (sk) {
+            case 'mq135_raw': out.mq135Raw = n; break;
+            case 'iaq_score': out.iaq = n; break;
+            case 'co2_equiv': out.co2 = n; break;
+            case 'temperature': out.temperature = n; break;
+            case 'humidity': out.humidity = n; break;
+            case 'pressure_hpa': out.pressure = n; break;
+            case 'altitude_m': out.altitude = n; break;
+            default: return null; // Aliases (iaq, pm25, ...) have precedence rules: generic path
+          }
+        }
+        break;
+      }
+      case TopKey.Meta: {
+        if (!isPlainObject(value)) return null;
+        for (const mk in value) {
+          const v = value[mk];
+          if (mk === 'boot_id' || mk === 'alert') {
+            if (typeof v !== 'string') return null;
+            if (mk === 'boot_id') out.bootId = v;
+            else out.alert = v;
+            continue;
+          }
+          const n = finiteOrNull(v);
+          if (n === undefined) return null;
+          switch (mk) {
+            case 'uptime_ms': out.uptimeMs = n; break;
+            case 'rssi': out.rssi = n; break;
+            case 'seq': out.seq = n; break;
+            case 'free_heap': break;
+            case 'heap_max_block': break;
+            default: return null;
+          }
+        }
+        break;
+      }
+      default:
+        return null;
+    }
+  }
+
+  out.signedPayload = () => {
+    if (out.signature === undefined) return JSON.stringify(body);
+    const { signature, ...rest } = body;
+    return JSON.stringify(rest);
+  };
+  return out;
+}
+
+// ---------------------------------------------------------------------------
+// Generic path
+// ---------------------------------------------------------------------------
+
+export function decodeGeneric(raw: unknown): DecodedPayload {
+  const body = ingestSchema.parse(raw || {}) as any;
+  const sensors = body.sensors || {};
+  const meta = body.meta || {};
+  const bootId = meta.boot_id;
+
+  return {
+    deviceId: body.device_id || body.deviceId,
+    firmwareVersion: body.firmware_version,
+    timestamp: body.timestamp,
+    measuredAt: body.measuredAt,
+    measurementId: body.measurement_id ?? body.id ?? undefined,
+    iaq: num(sensors.iaq_score ?? sensors.iaq ?? body.iaq_score ?? body.iaq),
+    co2: num(sensors.co2_equiv ?? sensors.co2 ?? body.co2_equiv ?? body.co2),
+    temperature: num(sensors.temperature ?? body.temperature),
+    humidity: num(sensors.humidity ?? body.humidity),
+    pressure: num(sensors.pressure_hpa ?? sensors.pressure ?? body.pressure_hpa ?? body.pressure),
+    altitude: num(sensors.altitude_m ?? body.altitude_m),
+    mq135Raw: num(sensors.mq135_raw ?? sensors.mq135Raw),
+    pm25: num(sensors.pm25_api ?? sensors.pm25Api ?? sensors.pm25 ?? body.pm25_api ?? body.pm25),
+    rssi: num(sensors.rssi ?? meta.rssi),
+    uptimeMs: num(sensors.uptime_ms ?? meta.uptime_ms ?? meta.uptime),
+    bootId: typeof bootId === 'string' && bootId ? bootId : undefined,
+    seq: num(meta.seq),
+    alert: typeof meta.alert === 'string' && meta.alert ? meta.alert : undefined,
+    signature: body.signature,
+    signedPayload: () => {
+      const { signature, ...rest } = body;
+      return JSON.stringify(rest);
+    },
+    fastPath: false,
+  };
+}
+
+/**
+ * Decode an ingest body. Throws a ZodError for payloads neither path accepts.
+ */
+export function decodePayload(raw: unknown): DecodedPayload {
+  if (isPlainObject(raw)) {
+    const fast = decodeFast(raw);
+    if (fast) return fast;
+  }
+  return decodeGeneric(raw);
+}
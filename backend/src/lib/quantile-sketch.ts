@@ -0,0 +1,286 @@
+/**
+ * Quantile Sketch (DDSketch)
+ * Mergeable percentile summary with relative-error guarantees: every quantile
+ * is within `relativeAccuracy` of a true value. Rollup buckets keep one sketch
+ * per device, and area-level percentiles come from merging them rather than
+ * re-reading raw measurements.
+ *
+ * Serialized form is a small varint-packed buffer (base64 in JSON columns).
+ */
+
+const DEFAULT_RELATIVE_ACCURACY = 0.01;
+const DEFAULT_MAX_BINS = 2048;
+const MIN_INDEXABLE = 1e-9;
+const FORMAT_VERSION = 1;
+
+/**
+ * Contiguous bin counts; key = offset + index
+ */
+class DenseStore {
+  counts: number[] = [];
+  offset = 0;
+  total = 0;
+
+  constructor(private readonly maxBins: number) {}
+
+  add(key: number, weight = 1) {
+    if (this.counts.length === 0) {
+      this.offset = key;
+      this.counts.push(0);
+    } else if (key < this.offset) {
+      const grow = this.offset - key;
+      this.counts = new Array<number>(grow).fill(0).concat(this.counts);
+      this.offset = key;
+    } else if (key >= this.offset + this.counts.length) {
+      for (let k = this.offset + this.counts.length; k <= key; k++) this.counts.push(0);
+    }
+    this.counts[key - this.offset] += weight;
+    this.total += weight;
+    if (this.counts.length > this.maxBins) this.collapseLowest();
+  }
+
+  // Fold the lowest bins into one so memory stays bounded (only lower quantiles lose accuracy)
+  private collapseLowest() {
+    const excess = this.counts.length - this.maxBins;
+    let folded = 0;
+    for (let i = 0; i <= excess; i++) folded += this.counts[i];
+    this.counts = this.counts.slice(excess);
+    this.counts[0] = folded;
+    this.offset += excess;
+  }
+
+  merge(other: DenseStore) {
+    for (let i = 0; i < other.counts.length; i++) {
+      if (other.counts[i] > 0) this.add(other.offset + i, other.counts[i]);
+    }
+  }
+}
+
+export class QuantileSketch {
+  private readonly gamma: number;
+  private readonly logGamma: number;
+  private readonly positive: DenseStore;
+  private readonly negative: DenseStore;
+  private zeroCount = 0;
+
+  count = 0;
+  sum = 0;
+  min = Infinity;
+  max = -Infinity;
+
+  constructor(readonly relativeAccuracy = DEFAULT_RELATIVE_ACCURACY, private readonly maxBins = DEFAULT_MAX_BINS) {
+    this.gamma = (1 + relativeAccuracy) / (1 - relativeAccuracy);
+    this.logGamma = Math.log(this.gamma);
+    this.positive = new DenseStore(maxBins);
+    this.negative = new DenseStore(maxBins);
+  }
+
+  private key(v: number): number {
+    return Math.ceil(Math.log(v) / this.logGamma);
+  }
+
+  private value(key: number): number {
+    return (2 * Math.pow(this.gamma, key)) / (this.gamma + 1);
+  }
+
+  add(v: number, weight = 1) {
+    if (!Number.isFinite(v)) return;
+    if (v > MIN_INDEXABLE) this.positive.add(this.key(v), weight);
+    else if (v < -MIN_INDEXABLE) this.negative.add(this.key(-v), weight);
+    else this.zeroCount += weight;
+
+    this.count += weight;
+    this.sum += v * weight;
+    if (v < this.min) this.min = v;
+    if (v > this.max) this.max = v;
+  }
+
+  merge(other: QuantileSketch) {
+    if (other.gamma !== this.gamma) throw new Error('Cannot merge sketches with different accuracy');
+    if (other.count === 0) return;
+    this.positive.merge(other.positive);
+    this.negative.merge(other.negative);
+    this.zeroCount += other.zeroCount;
+    this.count += other.count;
+    this.sum += other.sum;
+    if (other.min < this.min) this.min = other.min;
+    if (other.max > this.max) this.max = other.max;
+  }
+
+  /**
+   * Value at quantile q in [0, 1]; null for an empty sketch
+   */
+  quantile(q: number): number | null {
+    if (this.count === 0) return null;
+    if (q <= 0) return this.min;
+    if (q >= 1) return this.max;
+
+    const rank = q * (this.count - 1);
+    let seen = 0;
+    let result: number | undefined;
+
+    // Most negative first: negative keys in descending order
+    const neg = this.negative.counts;
+    for (let i = neg.length - 1; i >= 0 && result === undefined; i--) {
+      seen += neg[i];
+      if (seen > rank) result = -this.value(this.negative.offset + i);
+    }
+    if (result === undefined) {
+      seen += this.zeroCount;
+      if (seen > rank) result = 0;
+    }
+    const pos = this.positive.counts;
+    for (let i = 0; i < pos.length && result === undefined; i++) {
+      seen += pos[i];
+      if (seen > rank) result = this.value(this.positive.offset + i);
+    }
+    return Math.min(this.max, Math.max(this.min, result ?? this.max));
+  }
+
+  get mean(): number | null {
+    return this.count > 0 ? this.sum / this.count : null;
+  }
+
+  // -------------------------------------------------------------------------
+  // Serialization
+  // -------------------------------------------------------------------------
+
+  toBuffer(): Buffer {
+    const w = new ByteWriter();
+    w.byte(FORMAT_VERSION);
+    w.f64(this.relativeAccuracy);
+    w.f64(this.sum);
+    w.f64(this.count ? this.min : 0);
+    w.f64(this.count ? this.max : 0);
+    w.varint(this.zeroCount);
+    for (const store of [this.positive, this.negative]) {
+      w.zigzag(store.offset);
+      w.varint(store.counts.length);
+      for (const c of store.counts) w.varint(c);
+    }
+    return w.finish();
+  }
+
+  toBase64(): string {
+    return this.toBuffer().toString('base64');
+  }
+
+  static fromBuffer(buf: Buffer, maxBins = DEFAULT_MAX_BINS): QuantileSketch {
+    const r = new ByteReader(buf);
+    const version = r.byte();
+    if (version !== FORMAT_VERSION) throw new Error(`Unsupported sketch version ${version}`);
+
+    const sketch = new QuantileSketch(r.f64(), maxBins);
+    sketch.sum = r.f64();
+    const min = r.f64();
+    const max = r.f64();
+    sketch.zeroCount = r.varint();
+    for (const store of [sketch.positive, sketch.negative]) {
+      store.offset = r.zigzag();
+      const n = r.varint();
+      for (let i = 0; i < n; i++) {
+        const c = r.varint();
+        store.counts.push(c);
+        store.total += c;
+      }
+    }
+    sketch.count = sketch.zeroCount + sketch.positive.total + sketch.negative.total;
+    if (sketch.count > 0) {
+      sketch.min = min;
+      sketch.max = max;
+    }
+    return sketch;
+  }
+
+  static fromBase64(s: string): QuantileSketch {
+    return QuantileSketch.fromBuffer(Buffer.from(s, 'base64'));
+  }
+}
+
+/**
+ * Merge serialized sketches (skipping missing ones) into a single sketch
+ */
+export function mergeSketches(encoded: Array<string | null | undefined>): QuantileSketch {
+  let merged: QuantileSketch | null = null;
+  for (const s of encoded) {
+    if (!s) continue;
+    const sketch = QuantileSketch.fromBase64(s);
+    if (!merged) merged = sketch;
+    else merged.merge(sketch);
+  }
+  return merged ?? new QuantileSketch();
+}
+
+class ByteWriter {
+  private buf = Buffer.alloc(256);
+  private pos = 0;
+
+  private ensure(n: number) {
+    if (this.pos + n <= this.buf.length) return;
+    const next = Buffer.alloc(Math.max(this.buf.length * 2, this.pos + n));
+    this.buf.copy(next, 0, 0, this.pos);
+    this.buf = next;
+  }
+
+  byte(v: number) {
+    this.ensure(1);
+    this.buf[this.pos++] = v;
+  }
+
+  f64(v: number) {
+    this.ensure(8);
+    this.buf.writeDoubleLE(v, this.pos);
+    this.pos += 8;
+  }
+
+  // Unsigned LEB128 (counts may exceed 2^32 after many merges, so no bitwise ops)
+  varint(v: number) {
+    this.ensure(10);
+    while (v >= 0x80) {
+      this.buf[this.pos++] = (v % 0x80) | 0x80;
+      v = Math.floor(v / 0x80);
+    }
+    this.buf[this.pos++] = v;
+  }
+
+  zigzag(v: number) {
+    this.varint(v >= 0 ? v * 2 : -v * 2 - 1);
+  }
+
+  finish(): Buffer {
+    return this.buf.subarray(0, this.pos);
+  }
+}
+
+class ByteReader {
+  private pos = 0;
+
+  constructor(private readonly buf: Buffer) {}
+
+  byte(): number {
+    return this.buf[this.pos++];
+  }
+
+  f64(): number {
+    const v = this.buf.readDoubleLE(this.pos);
+    this.pos += 8;
+    return v;
+  }
+
+  varint(): number {
+    let result = 0;
+    let scale = 1;
+    for (;;) {
+      const b = this.buf[this.pos++];
+      if (b === undefined) throw new Error('Truncated sketch');
+      result += (b & 0x7f) * scale;
+      if (b < 0x80) return result;
+      scale *= 0x80;
+    }
+  }
+
+  zigzag(): number {
+    const v = this.varint();
+    return v % 2 === 0 ? v / 2 : -(v + 1) / 2;
+  }
+}
@@ -0,0 +1,192 @@
+/**
+ * Dashboard Reading Cache
+ * Keeps a ReadingRingCache current from the live measurement stream (relayed to
+ * every worker), so "latest for these devices" and "last N hours for a device"
+ * are answered from memory. A device is loaded from the database once, the first
+ * time it is asked for after a restart; from then on ingest keeps it up to date.
+ */
+
+import { db } from './db';
+import { events, MeasurementEvent } from './events';
+import { ReadingRingCache, LatestReading, RingBucket } from './reading-ring';
+import { isPriorityAlert } from './ingest-core';
+import { config } from '../config';
+
+const WINDOW_MS = 24 * 60 * 60 * 1000;
+
+// Cluster instances only see events for the devices they own, so there the cache
+// would serve stale readings for the rest; fall back to queries instead
+export const readingCache =
+  config.readingCacheBucketMin > 0 && !config.clusterNodes
+    ? new ReadingRingCache({ bucketMs: config.readingCacheBucketMin * 60_000, windowMs: WINDOW_MS })
+    : null;
+
+// Devices loaded (or being loaded) from the database since boot
+const loaded = new Map<string, Promise<void>>();
+
+if (readingCache) {
+  events.on('measurement:new', (e: MeasurementEvent) => {
+    // Priority alerts carry IAQ/CO2 only and would drag the bucket means; the live feed has them
+    if (e.alert) return;
+    const at = Date.parse(e.measuredAt);
+    // A node with a wrong clock must not push its ring past the present
+    if (!Number.isFinite(at) || at > Date.now() + readingCache.bucketMs) return;
+    readingCache.record(e.deviceId, at, {
+      aqi: e.aqiCalculated,
+      iaq: e.iaqScore,
+      temperature: e.temperature,
+      humidity: e.humidity,
+      pressureHpa: e.pressureHpa,
+    });
+  });
+}
+
+type Row = {
+  deviceId: string;
+  measuredAt: Date;
+  aqiCalculated: number | null;
+  iaqScore: number | null;
+  temperature: number | null;
+  humidity: number | null;
+  pressureHpa: number | null;
+};
+
+const ROW_SELECT = {
+  deviceId: true,
+  measuredAt: true,
+  aqiCalculated: true,
+  iaqScore: true,
+  temperature: true,
+  humidity: true,
+  pressureHpa: true,
+} as const;
+
+function recordRow(cache: ReadingRingCache, r: Row) {
+  cache.record(r.deviceId, r.measuredAt.getTime(), {
+    aqi: r.aqiCalculated,
+    iaq: r.iaqScore,
+    temperature: r.temperature,
+    humidity: r.humidity,
+    pressureHpa: r.pressureHpa,
+  });
+}
+
+const LATEST_PAGE = 8;
+
+/**
+ * A device's newest reading that is not a priority alert. Alerts are rare, so this is
+ * almost always the first short page; they are skipped in JS because a JSON-path NOT
+ * would also drop rows whose flags lack the key.
+ */
+async function latestRegularRow(deviceId: string): Promise<Row | null> {
+  for (let skip = 0; ; skip += LATEST_PAGE) {
+    const rows = await db.measurement.findMany({
+      where: { deviceId },
+      orderBy: { measuredAt: 'desc' },
+      skip,
+      take: LATEST_PAGE,
+      select: { ...ROW_SELECT, qualityFlags: true },
+    });
+    const hit = rows.find((r) => !isPriorityAlert(r.qualityFlags));
+    if (hit) {
+      const { qualityFlags, ...row } = hit;
+      return row;
+    }
+    if (rows.length < LATEST_PAGE) return null;
+  }
+}
+
+// Rows inserted after this point arrive through the event stream as well
+const startedAt = new Date();
+
+// One window query for every device not seen yet; devices quiet for the whole window
+// still get their last reading so the dashboard shows a value for them
+async function loadDevices(cache: ReadingRingCache, ids: string[]) {
+  const rows = await db.measurement.findMany({
+    where: {
+      deviceId: { in: ids },
+      measuredAt: { gte: new Date(Date.now() - WINDOW_MS) },
+      createdAt: { lt: startedAt },
+    },
+    orderBy: { measuredAt: 'asc' },
+    select: { ...ROW_SELECT, qualityFlags: true },
+  });
+  for (const r of rows) if (!isPriorityAlert(r.qualityFlags)) recordRow(cache, r);
+
+  const quiet = ids.filter((id) => !cache.has(id));
+  const last = await Promise.all(quiet.map(latestRegularRow));
+  for (const r of last) if (r) recordRow(cache, r);
+}
+
+async function ensureLoaded(cache: ReadingRingCache, ids: string[]) {
+  const missing = ids.filter((id) => !loaded.has(id));
+  if (missing.length > 0) {
+    const loading = loadDevices(cache, missing);
+    for (const id of missing) loaded.set(id, loading);
+    loading.catch(() => {
+      for (const id of missing) if (loaded.get(id) === loading) loaded.delete(id);
+    });
+  }
+  await Promise.all(ids.map((id) => loaded.get(id)));
+}
+
+export interface LatestMeasurement {
+  measuredAt: Date;
+  aqiCalculated: number | null;
+  iaqScore: number | null;
+  temperature: number | null;
+  humidity: number | null;
+  pressureHpa: number | null;
+}
+
+function fromCache(r: LatestReading | RingBucket, measuredAt: Date): LatestMeasurement {
+  return {
+    measuredAt,
+    aqiCalculated: r.aqi,
+    iaqScore: r.iaq,
+    temperature: r.temperature,
+    humidity: r.humidity,
+    pressureHpa: r.pressureHpa,
+  };
+}
+
+/**
+ * Latest reading for each device, in the order given (null where a device has none)
+ */
+export async function latestMeasurements(deviceIds: string[]): Promise<(LatestMeasurement | null)[]> {
+  if (!readingCache) {
+    return Promise.all(deviceIds.map(latestRegularRow));
+  }
+  await ensureLoaded(readingCache, deviceIds);
+  return deviceIds.map((id) => {
+    const r = readingCache.latestFor(id);
+    return r ? fromCache(r, r.measuredAt) : null;
+  });
+}
+
+export interface RecentMeasurement extends LatestMeasurement {
+  count: number; // Readings averaged into the bucket
+  aqiMin: number | null; // AQI range of those readings
+  aqiMax: number | null;
+}
+
+/**
+ * The device's readings over the last `hours` (at most 24), averaged per cache bucket, oldest first
+ */
+export async function recentMeasurements(deviceId: string, hours: number): Promise<RecentMeasurement[]> {
+  const since = Date.now() - Math.min(hours, 24) * 60 * 60 * 1000;
+  if (!readingCache) {
+    const rows = await db.measurement.findMany({
+      where: { deviceId, measuredAt: { gte: new Date(since) } },
+      orderBy: { measuredAt: 'asc' },
+      select: { ...ROW_SELECT, qualityFlags: true },
+    });
+    return rows
+      .filter((r) => !isPriorityAlert(r.qualityFlags))
+      .map(({ deviceId: _, qualityFlags: __, ...r }) => ({ ...r, count: 1, aqiMin: r.aqiCalculated, aqiMax: r.aqiCalculated }));
+  }
+  await ensureLoaded(readingCache, [deviceId]);
+  return readingCache
+    .recent(deviceId, since)
+    .map((b) => ({ ...fromCache(b, b.start), count: b.count, aqiMin: b.aqiMin, aqiMax: b.aqiMax }));
+}
@@ -0,0 +1,223 @@
+/**
+ * Reading Ring Cache
+ * Latest reading plus a fixed window of time buckets per device, held as
+ * structure-of-arrays typed arrays indexed by a dense device slot. Each bucket
+ * keeps the mean of the readings that fell into it, quantized to 16 bits per
+ * metric, plus the AQI minimum and maximum so peaks survive the averaging; a
+ * device costs a fixed few KB however often it reports.
+ *
+ * A bucket slot is reused when its time comes round again; a stamp with the
+ * absolute bucket number tells a live slot from a stale one, so nothing has to
+ * be cleared as time moves on. Readings older than the window are ignored.
+ */
+
+export const RING_METRICS = ['aqi', 'iaq', 'temperature', 'humidity', 'pressureHpa'] as const;
+export type RingMetric = (typeof RING_METRICS)[number];
+export type RingValues = Record<RingMetric, number | null>;
+
+// Fixed-point scale per metric; the ranges fit 16 bits with room to spare
+const SCALE: Record<RingMetric, number> = { aqi: 10, iaq: 10, temperature: 100, humidity: 100, pressureHpa: 10 };
+const SIGNED: Record<RingMetric, boolean> = { aqi: false, iaq: false, temperature: true, humidity: false, pressureHpa: false };
+const MISSING_U16 = 0xffff;
+const MISSING_I16 = -0x8000;
+
+// Per-metric constants by position, for the record() loop
+const SCALES = RING_METRICS.map((m) => SCALE[m]);
+const MISSING = RING_METRICS.map((m) => (SIGNED[m] ? MISSING_I16 : MISSING_U16));
+const MIN_Q = RING_METRICS.map((m) => (SIGNED[m] ? -0x7fff : 0));
+const MAX_Q = RING_METRICS.map((m) => (SIGNED[m] ? 0x7fff : 0xfffe));
+const AQI = RING_METRICS.indexOf('aqi');
+
+// Fixed-point value clamped to the metric's range, clear of the missing-value sentinel
+function clampQ(k: number, x: number): number {
+  return x < MIN_Q[k] ? MIN_Q[k] : x > MAX_Q[k] ? MAX_Q[k] : x;
+}
+
+export interface LatestReading extends RingValues {
+  measuredAt: Date;
+}
+
+export interface RingBucket extends RingValues {
+  start: Date;
+  count: number;
+  // Extremes of the individual AQI readings averaged into `aqi`
+  aqiMin: number | null;
+  aqiMax: number | null;
+}
+
+export interface ReadingRingOptions {
+  bucketMs: number;
+  windowMs: number;
+  initialDevices?: number;
+}
+
+type Quantized = Uint16Array | Int16Array;
+
+export class ReadingRingCache {
+  readonly bucketMs: number;
+  readonly slots: number;
+  private readonly index = new Map<string, number>();
+  private capacity: number;
+
+  // Latest reading per device
+  private latestAt: Float64Array;
+  private latest: Float32Array[];
+  // Ring per device: slots consecutive entries starting at device * slots
+  private stamp: Uint32Array;
+  private count: Uint16Array;
+  private ring: Quantized[];
+  private aqiMin: Uint16Array;
+  private aqiMax: Uint16Array;
+
+  constructor(opts: ReadingRingOptions) {
+    this.bucketMs = opts.bucketMs;
+    this.slots = Math.max(1, Math.ceil(opts.windowMs / opts.bucketMs));
+    this.capacity = Math.max(1, opts.initialDevices ?? 1024);
+    this.latestAt = new Float64Array(this.capacity);
+    this.latest = RING_METRICS.map(() => new Float32Array(this.capacity).fill(NaN));
+    this.stamp = new Uint32Array(this.capacity * this.slots);
+    this.count = new Uint16Array(this.capacity * this.slots);
+    this.ring = RING_METRICS.map((m) => this.newRing(m, this.capacity * this.slots));
+    this.aqiMin = new Uint16Array(this.capacity * this.slots);
+    this.aqiMax = new Uint16Array(this.capacity * this.slots);
+  }
+
+  get size(): number {
+    return this.index.size;
+  }
+
+  has(deviceId: string): boolean {
+    return this.index.has(deviceId);
+  }
+
+  /**
+   * Typed-array bytes per device (excludes the id -> slot map)
+   */
+  get bytesPerDevice(): number {
+    return 8 + 4 * RING_METRICS.length + this.slots * (4 + 2 + 2 * RING_METRICS.length + 4);
+  }
+
+  record(deviceId: string, measuredAtMs: number, values: RingValues): void {
+    const d = this.slotFor(deviceId);
+
+    if (measuredAtMs >= this.latestAt[d]) {
+      this.latestAt[d] = measuredAtMs;
+      for (let k = 0; k < RING_METRICS.length; k++) {
+        const v = values[RING_METRICS[k]];
+        this.latest[k][d] = v ?? NaN;
+      }
+    }
+
+    const bucket = Math.floor(measuredAtMs / this.bucketMs);
+    const newest = Math.floor(this.latestAt[d] / this.bucketMs);
+    if (bucket <= newest - this.slots) return;
+
+    const i = d * this.slots + (bucket % this.slots);
+    if (this.stamp[i] !== bucket) {
+      // A newer bucket already owns the slot: this reading is late and out of the window
+      if (this.stamp[i] > bucket) return;
+      this.stamp[i] = bucket;
+      this.count[i] = 0;
+      for (let k = 0; k < RING_METRICS.length; k++) this.ring[k][i] = MISSING[k];
+      this.aqiMin[i] = MISSING_U16;
+      this.aqiMax[i] = MISSING_U16;
+    }
+
+    const n = this.count[i] < 0xffff ? ++this.count[i] : this.count[i];
+    for (let k = 0; k < RING_METRICS.length; k++) {
+      const v = values[RING_METRICS[k]];
+      if (v === null || !Number.isFinite(v)) continue;
+      const q = this.ring[k];
+      const x = v * SCALES[k];
+      // Running mean; a metric missing from some readings averages over one count for all
+      q[i] = clampQ(k, Math.round(q[i] === MISSING[k] ? x : q[i] + (x - q[i]) / n));
+    }
+
+    const aqi = values.aqi;
+    if (aqi !== null && Number.isFinite(aqi)) {
+      const x = clampQ(AQI, Math.round(aqi * SCALES[AQI]));
+      if (this.aqiMin[i] === MISSING_U16 || x < this.aqiMin[i]) this.aqiMin[i] = x;
+      if (this.aqiMax[i] === MISSING_U16 || x > this.aqiMax[i]) this.aqiMax[i] = x;
+    }
+  }
+
+  latestFor(deviceId: string): LatestReading | null {
+    const d = this.index.get(deviceId);
+    if (d === undefined || this.latestAt[d] === 0) return null;
+    const out = { measuredAt: new Date(this.latestAt[d]) } as LatestReading;
+    for (let k = 0; k < RING_METRICS.length; k++) {
+      const v = this.latest[k][d];
+      out[RING_METRICS[k]] = Number.isNaN(v) ? null : v;
+    }
+    return out;
+  }
+
+  /**
+   * Buckets from sinceMs up to nowMs, oldest first; empty buckets are skipped
+   */
+  recent(deviceId: string, sinceMs: number, nowMs = Date.now()): RingBucket[] {
+    const d = this.index.get(deviceId);
+    if (d === undefined) return [];
+    const last = Math.floor(nowMs / this.bucketMs);
+    const first = Math.max(Math.floor(sinceMs / this.bucketMs), last - this.slots + 1);
+    const base = d * this.slots;
+
+    const out: RingBucket[] = [];
+    for (let b = first; b <= last; b++) {
+      const i = base + (b % this.slots);
+      if (this.stamp[i] !== b || this.count[i] === 0) continue;
+      const bucket = { start: new Date(b * this.bucketMs), count: this.count[i] } as RingBucket;
+      for (let k = 0; k < RING_METRICS.length; k++) {
+        const q = this.ring[k][i];
+        bucket[RING_METRICS[k]] = q === MISSING[k] ? null : q / SCALES[k];
+      }
+      bucket.aqiMin = this.aqiMin[i] === MISSING_U16 ? null : this.aqiMin[i] / SCALES[AQI];
+      bucket.aqiMax = this.aqiMax[i] === MISSING_U16 ? null : this.aqiMax[i] / SCALES[AQI];
+      out.push(bucket);
+    }
+    return out;
+  }
+
+  private slotFor(deviceId: string): number {
+    let d = this.index.get(deviceId);
+    if (d !== undefined) return d;
+    d = this.index.size;
+    if (d >= this.capacity) this.grow(this.capacity * 2);
+    this.index.set(deviceId, d);
+    return d;
+  }
+
+  private grow(capacity: number) {
+    const slots = this.slots;
+    const latestAt = new Float64Array(capacity);
+    latestAt.set(this.latestAt);
+    this.latestAt = latestAt;
+    this.latest = this.latest.map((old) => {
+      const next = new Float32Array(capacity).fill(NaN);
+      next.set(old);
+      return next;
+    });
+    const stamp = new Uint32Array(capacity * slots);
+    stamp.set(this.stamp);
+    this.stamp = stamp;
+    const count = new Uint16Array(capacity * slots);
+    count.set(this.count);
+    this.count = count;
+    this.ring = this.ring.map((old, k) => {
+      const next = this.newRing(RING_METRICS[k], capacity * slots);
+      next.set(old);
+      return next;
+    });
+    const aqiMin = new Uint16Array(capacity * slots);
+    aqiMin.set(this.aqiMin);
+    this.aqiMin = aqiMin;
+    const aqiMax = new Uint16Array(capacity * slots);
+    aqiMax.set(this.aqiMax);
+    this.aqiMax = aqiMax;
+    this.capacity = capacity;
+  }
+
+  private newRing(metric: RingMetric, length: number): Quantized {
+    return SIGNED[metric] ? new Int16Array(length) : new Uint16Array(length);
+  }
+}
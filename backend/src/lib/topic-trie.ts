@@ -0,0 +1,116 @@
+/**
+ * MQTT Topic Trie
+ * Subscription filters stored level by level, so matching a topic costs one
+ * walk down its levels (plus `+`/`#` branches) instead of testing every
+ * filter. Follows MQTT 3.1.1 matching: `#` also matches the parent level,
+ * and wildcards at the first level never match `$`-prefixed topics.
+ */
+
+interface TrieNode<T> {
+  children: Map<string, TrieNode<T>>;
+  values: Set<T>;
+}
+
+function node<T>(): TrieNode<T> {
+  return { children: new Map(), values: new Set() };
+}
+
+export function validFilter(filter: string): boolean {
+  if (filter.length === 0) return false;
+  const levels = filter.split('/');
+  return levels.every((level, i) => {
+    if (level === '#') return i === levels.length - 1;
+    if (level === '+') return true;
+    return !level.includes('#') && !level.includes('+');
+  });
+}
+
+export function validTopic(topic: string): boolean {
+  return topic.length > 0 && !topic.includes('+') && !topic.includes('#');
+}
+
+/**
+ * Single filter/topic test (retained-message delivery on subscribe)
+ */
+export function filterMatches(filter: string, topic: string): boolean {
+  if (topic.startsWith('$') && (filter.startsWith('+') || filter.startsWith('#'))) return false;
+  const f = filter.split('/');
+  const t = topic.split('/');
+  for (let i = 0; i < f.length; i++) {
+    if (f[i] === '#') return true;
+    if (i >= t.length || (f[i] !== '+' && f[i] !== t[i])) return false;
+  }
+  return f.length === t.length;
+}
+
+export class TopicTrie<T> {
+  private root = node<T>();
+  private count = 0;
+
+  get size(): number {
+    return this.count;
+  }
+
+  add(filter: string, value: T) {
+    let cur = this.root;
+    for (const level of filter.split('/')) {
+      let next = cur.children.get(level);
+      if (!next) {
+        next = node<T>();
+        cur.children.set(level, next);
+      }
+      cur = next;
+    }
+    if (!cur.values.has(value)) {
+      cur.values.add(value);
+      this.count++;
+    }
+  }
+
+  remove(filter: string, value: T) {
+    const path: Array<[TrieNode<T>, string]> = [];
+    let cur: TrieNode<T> | undefined = this.root;
+    for (const level of filter.split('/')) {
+      path.push([cur, level]);
+      cur = cur.children.get(level);
+      if (!cur) return;
+    }
+    if (cur.values.delete(value)) this.count--;
+    // Prune empty branches so long-gone device topics don't accumulate
+    for (let i = path.length - 1; i >= 0; i--) {
+      const [parent, level] = path[i];
+      const child = parent.children.get(level)!;
+      if (child.values.size > 0 || child.children.size > 0) break;
+      parent.children.delete(level);
+    }
+  }
+
+  /**
+   * Every value whose filter matches the topic (a value may appear once per matching filter)
+   */
+  match(topic: string): T[] {
+    const levels = topic.split('/');
+    const out: T[] = [];
+    const system = topic.startsWith('$');
+
+    const walk = (n: TrieNode<T>, depth: number) => {
+      const wildcardsAllowed = !(system && depth === 0);
+      if (wildcardsAllowed) {
+        const hash = n.children.get('#');
+        if (hash) for (const v of hash.values) out.push(v);
+      }
+      if (depth === levels.length) {
+        for (const v of n.values) out.push(v);
+        return;
+      }
+      const exact = n.children.get(levels[depth]);
+      if (exact) walk(exact, depth + 1);
+      if (wildcardsAllowed) {
+        const plus = n.children.get('+');
+        if (plus) walk(plus, depth + 1);
+      }
+    };
+    walk(this.root, 0);
+    return out;
+  }
+}
@@ -1,6 +1,8 @@
 /**
  * AQI Forecast Model - TensorFlow.js Inference
- * Loads trained LSTM model and generates 24-hour predictions
+ * Loads trained LSTM model and generates 24-hour predictions.
+ * Falls back to per-device Holt-Winters (daily seasonality) when TensorFlow or
+ * the trained model is unavailable.
  */
 
 // Remove static import of tfjs-node to avoid install/build failures on unsupported Node versions
@@ -8,6 +10,18 @@
 import { db } from '../lib/db';
 import path from 'path';
 import fs from 'fs';
+import {
+  HoltWintersState,
+  fitHoltWinters,
+  forecastHoltWinters,
+  updateState,
+  toHourly,
+  rmse,
+} from '../lib/holt-winters';
+import { isPriorityAlert } from '../lib/ingest-core';
+
+const HW_HISTORY_HOURS = 7 * 24;
+const HOUR_MS = 60 * 60 * 1000;
 
 interface ForecastInput {
   deviceId: string;
@@ -24,6 +38,7 @@ interface ForecastOutput {
   }[];
   confidence: number;
   modelVersion: string;
+  timing?: { fitMs: number; predictMs: number; incremental: boolean };
 }
 
 class AQIForecaster {
@@ -31,9 +46,13 @@ class AQIForecaster {
   private scalerParams: any = null;
   private modelVersion = '1.0.0';
   private tf: any | null = null;
+  private tfUnavailable = false;
+  // Holt-Winters state per device, advanced incrementally between runs
+  private hwStates = new Map<string, HoltWintersState>();
 
   private async loadTF(): Promise<any | null> {
     if (this.tf) return this.tf;
+    if (this.tfUnavailable) return null;
     try {
       // Try to load native Node backend if available using computed specifier to avoid TS module resolution
       const pkgName = '@tensorflow/tfjs-node';
@@ -41,8 +60,9 @@ class AQIForecaster {
       this.tf = mod;
       return this.tf;
     } catch (err: any) {
-      console.warn('[ML] TensorFlow backend not available. Forecasts are disabled.', err?.message || err);
+      console.warn('[ML] TensorFlow backend not available. Using Holt-Winters forecasts.', err?.message || err);
       this.tf = null;
+      this.tfUnavailable = true;
       return null;
     }
   }
@@ -91,8 +111,80 @@ class AQIForecaster {
 
   async forecast(input: ForecastInput): Promise<ForecastOutput | null> {
     await this.loadModel();
-    if (!this.model || !this.tf) return null;
+    if (this.model && this.tf) {
+      const lstm = await this.forecastLSTM(input);
+      if (lstm) return lstm;
+    }
+    return this.forecastHoltWinters(input.deviceId);
+  }
+
+  /**
+   * Statistical fallback. The first call per device fits on the last week of hourly
+   * buckets; later calls only fold in the hours completed since the previous run.
+   */
+  private async forecastHoltWinters(deviceId: string): Promise<ForecastOutput | null> {
+    const fitStarted = process.hrtime.bigint();
+    const nowHour = Math.floor(Date.now() / HOUR_MS);
+
+    let state = this.hwStates.get(deviceId);
+    if (state && nowHour - state.lastHour > HW_HISTORY_HOURS) state = undefined;
+    const incremental = state !== undefined;
+
+    // Only complete hours; the current one is still filling. Node alerts cluster at peaks
+    // and would pull the hourly means up, so only the regular cadence is fitted.
+    const rows = (await db.measurement.findMany({
+      where: {
+        deviceId,
+        measuredAt: {
+          gte: new Date(state ? (state.lastHour + 1) * HOUR_MS : (nowHour - HW_HISTORY_HOURS) * HOUR_MS),
+          lt: new Date(nowHour * HOUR_MS),
+        },
+        aqiCalculated: { not: null },
+      },
+      orderBy: { measuredAt: 'asc' },
+      select: { measuredAt: true, aqiCalculated: true, qualityFlags: true },
+    })).filter((r) => !isPriorityAlert(r.qualityFlags));
+    const series = toHourly(
+      rows.map((r) => r.measuredAt.getTime()),
+      rows.map((r) => r.aqiCalculated!)
+    );
+
+    if (state) {
+      for (let i = 0; i < series.hours.length; i++) updateState(state, series.hours[i], series.values[i]);
+    } else {
+      state = fitHoltWinters(series) ?? undefined;
+      if (!state) return null;
+    }
+    this.hwStates.set(deviceId, state);
+    const fitMs = Number(process.hrtime.bigint() - fitStarted) / 1e6;
+
+    const predictStarted = process.hrtime.bigint();
+    const skip = nowHour - state.lastHour;
+    const values = forecastHoltWinters(state, skip + 24).slice(skip);
+    const predictions = values.map((v, i) => {
+      const aqi = Math.max(0, Math.round(v));
+      return {
+        hour: i + 1,
+        aqi,
+        category: this.getAQICategory(aqi),
+        timestamp: new Date((nowHour + i + 1) * HOUR_MS),
+      };
+    });
+    const predictMs = Number(process.hrtime.bigint() - predictStarted) / 1e6;
+
+    // Confidence from one-step-ahead error
+    const confidence = Math.max(0.3, Math.min(0.95, 1 / (1 + rmse(state) / 50)));
+
+    return {
+      deviceId,
+      predictions,
+      confidence: Math.round(confidence * 100) / 100,
+      modelVersion: 'holt-winters-1',
+      timing: { fitMs, predictMs, incremental },
+    };
+  }
 
+  private async forecastLSTM(input: ForecastInput): Promise<ForecastOutput | null> {
     const tf = this.tf;
     const lookback = input.lookbackHours || 24;
 
@@ -4,9 +4,11 @@
  */
 
 import { db } from '../lib/db';
+import { computeExposure, ExposureMetrics } from '../lib/exposure';
+import { isPriorityAlert } from '../lib/ingest-core';
 
 interface HealthRiskInput {
-  deviceId?: string;
+  deviceId: string;
   userId?: string;
   periodDays?: number;
 }
@@ -18,7 +20,7 @@ interface DiseaseRisk {
   allergy_risk: number;
 }
 
-interface HealthRiskOutput {
+export interface HealthRiskOutput {
   exposureScore: number;
   diseaseRisks: DiseaseRisk;
   recommendations: string[];
@@ -27,33 +29,50 @@ interface HealthRiskOutput {
     peakAqi: number;
     hoursUnhealthy: number;
     periodDays: number;
+    timeWeightedAqi: number;
+    hoursAbove: Record<number, number>;
+    peakHour: { start: string; end: string; avgAqi: number };
   };
 }
 
-export async function analyzeHealthRisk(input: HealthRiskInput): Promise<HealthRiskOutput | null> {
-  const periodDays = input.periodDays || 7;
-  const startDate = new Date(Date.now() - periodDays * 24 * 60 * 60 * 1000);
-
-  // Fetch measurements
-  const measurements = await db.measurement.findMany({
-    where: {
-      deviceId: input.deviceId,
-      measuredAt: { gte: startDate },
-      aqiCalculated: { not: null },
-    },
-    orderBy: { measuredAt: 'asc' },
-  });
-
-  if (measurements.length === 0) return null;
+/**
+ * Load a device's AQI series since `since` as columns (only the two fields needed).
+ * One device only: exposure is time-weighted, so several devices' readings interleaved
+ * into one series would be weighted by each other's sampling gaps.
+ */
+export async function loadAqiSeries(deviceId: string, since: Date): Promise<{ ts: Float64Array; aqi: Float64Array }> {
+  const rows = (
+    await db.measurement.findMany({
+      where: {
+        deviceId,
+        measuredAt: { gte: since },
+        aqiCalculated: { not: null },
+      },
+      orderBy: { measuredAt: 'asc' },
+      select: { measuredAt: true, aqiCalculated: true, qualityFlags: true },
+    })
+  ).filter((r) => !isPriorityAlert(r.qualityFlags));
+
+  const ts = new Float64Array(rows.length);
+  const aqi = new Float64Array(rows.length);
+  for (let i = 0; i < rows.length; i++) {
+    ts[i] = rows[i].measuredAt.getTime();
+    aqi[i] = rows[i].aqiCalculated!;
+  }
+  return { ts, aqi };
+}
 
-  // Calculate exposure metrics
-  const aqiValues = measurements.map((m) => m.aqiCalculated!);
-  const avgAqi = aqiValues.reduce((a, b) => a + b, 0) / aqiValues.length;
-  const peakAqi = Math.max(...aqiValues);
-  const hoursUnhealthy = measurements.filter((m) => m.aqiCalculated! > 100).length;
+/**
+ * Turn device exposure metrics into a risk report. Pure, so one device's
+ * metrics can be reused for every subscriber.
+ */
+export function assessExposure(exposure: ExposureMetrics, periodDays: number): HealthRiskOutput {
+  const avgAqi = exposure.timeWeightedAqi;
+  const peakAqi = exposure.peakAqi;
+  const hoursUnhealthy = exposure.hoursAbove[100];
 
   // Exposure score (0-100)
-  const exposureScore = Math.min(100, avgAqi * 0.5 + (hoursUnhealthy / measurements.length) * 100);
+  const exposureScore = Math.min(100, avgAqi * 0.5 + exposure.unhealthyFraction * 100);
 
   // Calculate disease risks (WHO-based correlations)
   const diseaseRisks = calculateDiseaseRisks({
@@ -73,12 +92,30 @@ export async function analyzeHealthRisk(input: HealthRiskInput): Promise<HealthR
     stats: {
       avgAqi: Math.round(avgAqi),
       peakAqi,
-      hoursUnhealthy,
+      hoursUnhealthy: Math.round(hoursUnhealthy),
       periodDays,
+      timeWeightedAqi: Math.round(avgAqi * 10) / 10,
+      hoursAbove: exposure.hoursAbove,
+      peakHour: {
+        start: new Date(exposure.peakWindow.start).toISOString(),
+        end: new Date(exposure.peakWindow.end).toISOString(),
+        avgAqi: Math.round(exposure.peakWindow.avgAqi),
+      },
     },
   };
 }
 
+export async function analyzeHealthRisk(input: HealthRiskInput): Promise<HealthRiskOutput | null> {
+  const periodDays = input.periodDays || 7;
+  const startDate = new Date(Date.now() - periodDays * 24 * 60 * 60 * 1000);
+
+  const { ts, aqi } = await loadAqiSeries(input.deviceId, startDate);
+  const exposure = computeExposure(ts, aqi);
+  if (!exposure) return null;
+
+  return assessExposure(exposure, periodDays);
+}
+
 function calculateDiseaseRisks(exposure: {
   avgPm25: number;
   peakPm25: number;
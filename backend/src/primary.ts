@@ -0,0 +1,71 @@
+/**
+ * Multi-core Primary
+ * Forks one server worker per core (node:cluster shares the listening socket).
+ * Worker 0 is the only one that runs background jobs and the Telegram bot;
+ * every worker gets its own durable-log directory and a share of the global
+ * in-flight cap. Live measurement events are relayed between workers so SSE
+ * clients see readings whichever worker ingested them.
+ */
+
+import cluster, { Worker } from 'node:cluster';
+import path from 'path';
+import { config } from './config';
+import { RELAY_MESSAGE } from './lib/events';
+
+function workerEnv(index: number, count: number): NodeJS.ProcessEnv {
+  const env: NodeJS.ProcessEnv = {
+    SERVER_WORKER_INDEX: String(index),
+    INGEST_MAX_INFLIGHT: String(Math.ceil(config.ingestMaxInFlight / count)),
+  };
+  if (config.ingestLogDir) env.INGEST_LOG_DIR = path.join(config.ingestLogDir, `worker-${index}`);
+  if (index > 0) {
+    env.ENABLE_JOBS = 'false';
+    env.ENABLE_TELEGRAM = 'false';
+  }
+  return env;
+}
+
+export function startPrimary(count: number) {
+  const workers = new Map<number, Worker>();
+  let stopping = false;
+
+  const fork = (index: number) => {
+    const worker = cluster.fork(workerEnv(index, count));
+    workers.set(index, worker);
+
+    worker.on('message', (msg: any) => {
+      if (msg?.type !== RELAY_MESSAGE) return;
+      for (const other of workers.values()) {
+        if (other !== worker && other.isConnected()) other.send(msg);
+      }
+    });
+
+    // Same index on restart, so the replacement reopens (and recovers) the same log directory
+    worker.on('exit', (code, signal) => {
+      if (workers.get(index) === worker) workers.delete(index);
+      if (stopping) {
+        if (workers.size === 0) process.exit(0);
+        return;
+      }
+      console.error(`❌ Worker ${index} exited (${signal || code}), restarting`);
+      setTimeout(() => fork(index), 1000);
+    });
+  };
+
+  for (let i = 0; i < count; i++) fork(i);
+  console.log(`🧵 Primary ${process.pid} started ${count} workers (jobs on worker 0)`);
+
+  const stop = (signal: NodeJS.Signals) => {
+    stopping = true;
+    for (const worker of workers.values()) worker.process.kill(signal);
+    if (workers.size === 0) process.exit(0);
+  };
+  process.on('SIGTERM', () => stop('SIGTERM'));
+  process.on('SIGINT', () => stop('SIGINT'));
+  // Cluster membership reloads happen in the workers
+  if (config.clusterNodesFile) {
+    process.on('SIGHUP', () => {
+      for (const worker of workers.values()) worker.process.kill('SIGHUP');
+    });
+  }
+}
@@ -1,7 +1,10 @@
+import crypto from 'crypto';
 import { FastifyPluginAsync } from 'fastify';
 import { z } from 'zod';
 import { db } from '../lib/db';
-import { generateAPIKey } from '../lib/hmac';
+import { generateAPIKey, deriveDeviceKey } from '../lib/hmac';
+import { findDevice } from '../lib/ingest-pipeline';
+import { recentMeasurements, readingCache } from '../lib/reading-cache';
 import { config } from '../config';
 
 // Convert BigInt fields in nested measurements for JSON safety
@@ -90,6 +93,25 @@ const deviceRoutes: FastifyPluginAsync = async (server) => {
     return reply.send(serialized);
   });
 
+  // Last N hours (max 24) averaged per cache bucket, with each bucket's reading count and
+  // AQI range; chart-ready, oldest first. bucket_minutes is null when rows are returned as stored.
+  server.get('/:id/recent', async (request, reply) => {
+    const { id } = request.params as { id: string };
+    const hours = Number((request.query as { hours?: string }).hours ?? 24);
+    if (!Number.isFinite(hours) || hours <= 0 || hours > 24) {
+      return reply.code(400).send({ error: 'hours must be between 0 and 24' });
+    }
+
+    // Cached device lookup keeps an unknown id from loading anything
+    if (!(await findDevice(id))) {
+      return reply.code(404).send({ error: 'Device not found' });
+    }
+
+    const data = await recentMeasurements(id, hours);
+    const bucketMinutes = readingCache ? readingCache.bucketMs / 60_000 : null;
+    return reply.send({ count: data.length, hours, bucket_minutes: bucketMinutes, data });
+  });
+
   // Register new device (admin-lite; add auth in production)
   server.post('/register', async (request, reply) => {
     try {
@@ -109,10 +131,15 @@ const deviceRoutes: FastifyPluginAsync = async (server) => {
         areaName: raw?.areaName,
       });
 
-      const deviceKey = generateAPIKey(parsed.name, config.apiKeySalt);
+      // With a master key the id is chosen here so the key can be derived from it
+      const id = crypto.randomUUID();
+      const deviceKey = config.deviceKeyMaster
+        ? deriveDeviceKey(config.deviceKeyMaster, id)
+        : generateAPIKey(parsed.name, config.apiKeySalt);
 
       const device = await db.device.create({
         data: {
+          id,
           name: parsed.name,
           deviceKey,
           latitude: parsed.latitude,
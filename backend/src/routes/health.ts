@@ -19,6 +19,9 @@ const healthRoutes: FastifyPluginAsync = async (server) => {
   // Generate health risk analysis
   server.post('/analyze', async (request, reply) => {
     const { deviceId, userId, periodDays } = request.body as any;
+    if (typeof deviceId !== 'string' || deviceId.length === 0) {
+      return reply.code(400).send({ error: 'deviceId is required' });
+    }
 
     const analysis = await analyzeHealthRisk({ deviceId, userId, periodDays });
 
@@ -1,6 +1,12 @@
 import { FastifyPluginAsync } from 'fastify';
 import { z } from 'zod';
+import { Readable } from 'stream';
 import { db } from '../lib/db';
+import { streamMeasurementsCsv } from '../lib/csv-export';
+import { downsample } from '../lib/downsample';
+import { reachesCold, readColdMeasurements, iterateColdSegments, findColdMeasurement } from '../lib/cold-store';
+import { isPriorityAlert } from '../lib/ingest-core';
+import type { ColdRow } from '../lib/columnar-segment';
 
 // Helper to convert BigInt fields to numbers for JSON safety
 function serializeMeasurement(m: any) {
@@ -31,12 +37,107 @@ const querySchema = z.object({
   limit: z.string().transform(Number).optional(),
 });
 
+// One device per series: readings from several devices interleaved into one line
+// would downsample into nothing meaningful
+const seriesQuerySchema = querySchema.extend({
+  device_id: z.string().min(1),
+  points: z.string().transform(Number).pipe(z.number().int().min(3).max(5000)).optional(),
+  method: z.enum(['lttb', 'minmax']).optional(),
+});
+
+// Raw rows a chart series downsamples directly; longer ranges are pre-reduced first
+const MAX_SERIES_ROWS = 200_000;
+
+type SeriesRow = { measuredAt: Date; aqiCalculated: number | null; iaqScore: number | null; temperature: number | null };
+
+const bySeriesTime = (a: SeriesRow, b: SeriesRow) => a.measuredAt.getTime() - b.measuredAt.getTime();
+
+function seriesPoint({ measuredAt, aqiCalculated, iaqScore, temperature }: SeriesRow): SeriesRow {
+  return { measuredAt, aqiCalculated, iaqScore, temperature };
+}
+
+// Node alerts are off-cadence samples at peaks; the chart follows the regular readings
+function isSeriesReading(r: { aqiCalculated: number | null; qualityFlags: unknown }): boolean {
+  return r.aqiCalculated !== null && !isPriorityAlert(r.qualityFlags);
+}
+
+/**
+ * Every reading in range, oldest first
+ */
+async function loadSeries(deviceId: string, start: Date | undefined, end: Date | undefined, cold: boolean): Promise<SeriesRow[]> {
+  const hot = await db.measurement.findMany({
+    where: { deviceId, aqiCalculated: { not: null }, measuredAt: { gte: start, lte: end } },
+    orderBy: { measuredAt: 'asc' },
+    select: { measuredAt: true, aqiCalculated: true, iaqScore: true, temperature: true, qualityFlags: true },
+  });
+  const rows = hot.filter(isSeriesReading).map(seriesPoint);
+  if (!cold) return rows;
+  const coldRows = (await readColdMeasurements({ deviceId, start, end }, 'asc')).filter(isSeriesReading).map(seriesPoint);
+  return [...coldRows, ...rows].sort(bySeriesTime);
+}
+
+/**
+ * The lowest- and highest-AQI reading of each `bucketMs` bucket in range, oldest first.
+ * Hot rows are reduced in Postgres, cold segments as they are decoded.
+ */
+async function loadSeriesExtremes(deviceId: string, start: Date, end: Date, bucketMs: number, cold: boolean): Promise<SeriesRow[]> {
+  const startMs = start.getTime();
+  const hot = await db.$queryRaw<SeriesRow[]>`
+    SELECT measured_at AS "measuredAt", aqi_calculated AS "aqiCalculated", iaq_score AS "iaqScore", temperature
+    FROM (
+      SELECT measured_at, aqi_calculated, iaq_score, temperature,
+        row_number() OVER (PARTITION BY bucket ORDER BY aqi_calculated, measured_at) AS low,
+        row_number() OVER (PARTITION BY bucket ORDER BY aqi_calculated DESC, measured_at) AS high
+      FROM (
+        SELECT measured_at, aqi_calculated, iaq_score, temperature,
+          floor((extract(epoch FROM measured_at) * 1000 - ${startMs}) / ${bucketMs}) AS bucket
+        FROM measurements
+        WHERE device_id = ${deviceId} AND aqi_calculated IS NOT NULL
+          AND measured_at >= ${start} AND measured_at <= ${end}
+          AND (quality_flags -> 'priority_alert') IS DISTINCT FROM 'true'::jsonb
+      ) bucketed
+    ) ranked
+    WHERE low = 1 OR high = 1
+    ORDER BY measured_at`;
+  if (!cold) return hot;
+
+  const low = new Map<number, ColdRow>();
+  const high = new Map<number, ColdRow>();
+  for await (const seg of iterateColdSegments({ deviceId, start, end })) {
+    for (const r of seg.rows) {
+      if (!isSeriesReading(r)) continue;
+      const b = Math.floor((r.measuredAt.getTime() - startMs) / bucketMs);
+      const lo = low.get(b);
+      const hi = high.get(b);
+      if (!lo || r.aqiCalculated! < lo.aqiCalculated!) low.set(b, r);
+      if (!hi || r.aqiCalculated! > hi.aqiCalculated!) high.set(b, r);
+    }
+  }
+  const coldRows = [...new Set([...low.values(), ...high.values()])].map(seriesPoint);
+  return [...coldRows, ...hot].sort(bySeriesTime);
+}
+
+/**
+ * Time of the device's first reading, cold tier included (now if it has none)
+ */
+async function earliestReading(deviceId: string): Promise<Date> {
+  const [segment, hot] = await Promise.all([
+    db.measurementSegment.findFirst({ where: { deviceId }, orderBy: { periodStart: 'asc' }, select: { periodStart: true } }),
+    db.measurement.aggregate({ where: { deviceId }, _min: { measuredAt: true } }),
+  ]);
+  const times = [segment?.periodStart, hot._min.measuredAt].filter((d): d is Date => d instanceof Date);
+  return times.length ? new Date(Math.min(...times.map((d) => d.getTime()))) : new Date();
+}
+
 const measurementRoutes: FastifyPluginAsync = async (server) => {
   server.get('/', async (request, reply) => {
     try {
       const query = querySchema.parse(request.query);
+      const take = query.limit || 100;
+      const start = query.start ? new Date(query.start) : undefined;
+      const end = query.end ? new Date(query.end) : undefined;
 
-      const measurements = await db.measurement.findMany({
+      let measurements: any[] = await db.measurement.findMany({
         where: {
           deviceId: query.device_id,
           measuredAt: {
@@ -45,7 +146,7 @@ const measurementRoutes: FastifyPluginAsync = async (server) => {
           },
         },
         orderBy: { measuredAt: 'desc' },
-        take: query.limit || 100,
+        take,
         include: {
           device: {
             select: {
@@ -58,6 +159,19 @@ const measurementRoutes: FastifyPluginAsync = async (server) => {
         },
       });
 
+      // Older readings live in the cold tier; fill the page from there when the hot table runs out
+      if (measurements.length < take && reachesCold(start)) {
+        const cold = await readColdMeasurements({ deviceId: query.device_id, start, end }, 'desc', take);
+        const devices = await db.device.findMany({
+          where: { id: { in: Array.from(new Set(cold.map((m) => m.deviceId))) } },
+          select: { id: true, name: true, latitude: true, longitude: true },
+        });
+        const byId = new Map(devices.map((d) => [d.id, d]));
+        measurements = [...measurements, ...cold.map((m) => ({ ...m, device: byId.get(m.deviceId) ?? null }))]
+          .sort((a, b) => b.measuredAt.getTime() - a.measuredAt.getTime())
+          .slice(0, take);
+      }
+
       const data = measurements.map(serializeMeasurement);
       const payload = { count: data.length, data };
       return reply.send(sanitizeBigInt(payload));
@@ -67,6 +181,63 @@ const measurementRoutes: FastifyPluginAsync = async (server) => {
     }
   });
 
+  // Chart series: one device's readings in range, reduced server-side to a fixed number of points.
+  // Ranges over MAX_SERIES_ROWS readings are first cut to each time bucket's extremes
+  // (bucket_ms in the response), so any range covers start to end.
+  server.get('/series', async (request, reply) => {
+    try {
+      const query = seriesQuerySchema.parse(request.query);
+      const deviceId = query.device_id;
+
+      const start = query.start ? new Date(query.start) : undefined;
+      const end = query.end ? new Date(query.end) : undefined;
+      const cold = reachesCold(start);
+
+      const [hotCount, coldCount] = await Promise.all([
+        db.measurement.count({ where: { deviceId, aqiCalculated: { not: null }, measuredAt: { gte: start, lte: end } } }),
+        cold
+          ? db.measurementSegment
+              .aggregate({
+                where: { deviceId, periodEnd: start ? { gt: start } : undefined, periodStart: end ? { lte: end } : undefined },
+                _sum: { rowCount: true },
+              })
+              .then((r) => r._sum.rowCount ?? 0)
+          : 0,
+      ]);
+
+      let rows: SeriesRow[];
+      let bucketMs: number | undefined;
+      if (hotCount + coldCount <= MAX_SERIES_ROWS) {
+        rows = await loadSeries(deviceId, start, end, cold);
+      } else {
+        const from = start ?? (await earliestReading(deviceId));
+        const to = end ?? new Date();
+        bucketMs = Math.max(1, Math.ceil((to.getTime() - from.getTime()) / (MAX_SERIES_ROWS / 2)));
+        rows = await loadSeriesExtremes(deviceId, from, to, bucketMs, cold);
+      }
+
+      const xs = new Float64Array(rows.length);
+      const ys = new Float64Array(rows.length);
+      rows.forEach((r, i) => {
+        xs[i] = r.measuredAt.getTime();
+        ys[i] = r.aqiCalculated as number;
+      });
+      const picked = downsample(xs, ys, query.points ?? 500, query.method);
+      const data = picked.map((i) => rows[i]);
+
+      return reply.send({
+        count: data.length,
+        total: hotCount + coldCount,
+        method: query.method ?? 'lttb',
+        ...(bucketMs ? { bucket_ms: bucketMs } : {}),
+        data,
+      });
+    } catch (error: any) {
+      server.log.error(error);
+      return reply.code(400).send({ error: error.message });
+    }
+  });
+
   server.get('/:id', async (request, reply) => {
     const { id } = request.params as { id: string };
 
@@ -76,60 +247,36 @@ const measurementRoutes: FastifyPluginAsync = async (server) => {
     });
 
     if (!measurement) {
+      // Compacted readings carry `<segment id>:<time>:<index>` ids
+      const cold = await findColdMeasurement(id);
+      if (cold) {
+        const device = await db.device.findUnique({ where: { id: cold.deviceId } });
+        return reply.send(sanitizeBigInt(serializeMeasurement({ ...cold, device })));
+      }
       return reply.code(404).send({ error: 'Measurement not found' });
     }
 
     return reply.send(sanitizeBigInt(serializeMeasurement(measurement)));
   });
 
-  // CSV Export
+  // CSV Export (streamed page by page; `limit` is optional and uncapped by default)
   server.get('/export/csv', async (request, reply) => {
     const query = querySchema.parse(request.query);
 
-    const measurements = await db.measurement.findMany({
-      where: {
-        deviceId: query.device_id,
-        measuredAt: {
-          gte: query.start ? new Date(query.start) : undefined,
-          lte: query.end ? new Date(query.end) : undefined,
-        },
+    const where = {
+      deviceId: query.device_id,
+      measuredAt: {
+        gte: query.start ? new Date(query.start) : undefined,
+        lte: query.end ? new Date(query.end) : undefined,
       },
-      orderBy: { measuredAt: 'asc' },
-      take: query.limit || 10000,
-    });
-
-    // Build CSV
-    const headers = [
-      'timestamp',
-      'device_id',
-      'iaq_score',
-      'co2_equiv',
-      'temperature',
-      'humidity',
-      'pressure_hpa',
-      'pm25_api',
-      'aqi_calculated',
-      'aqi_category',
-    ];
-
-    const rows = measurements.map((m) => [
-      m.measuredAt.toISOString(),
-      m.deviceId,
-      m.iaqScore ?? '',
-      m.co2Equiv ?? '',
-      m.temperature ?? '',
-      m.humidity ?? '',
-      m.pressureHpa ?? '',
-      m.pm25Api ?? '',
-      m.aqiCalculated ?? '',
-      m.aqiCategory ?? '',
-    ]);
-
-    const csv = [headers, ...rows].map((row) => row.join(',')).join('\n');
+    };
 
     reply.header('Content-Type', 'text/csv');
     reply.header('Content-Disposition', 'attachment; filename="aeroguard-export.csv"');
-    return reply.send(csv);
+    const cold = reachesCold(where.measuredAt.gte)
+      ? { deviceId: query.device_id, start: where.measuredAt.gte, end: where.measuredAt.lte }
+      : undefined;
+    return reply.send(Readable.from(streamMeasurementsCsv(where, query.limit || undefined, cold)));
   });
 };
 
@@ -1,6 +1,8 @@
 import { FastifyPluginAsync } from 'fastify';
 import { db } from '../lib/db';
 import { events } from '../lib/events';
+import { latestMeasurements } from '../lib/reading-cache';
+import { areaQuantiles } from '../jobs/aggregator';
 
 const publicRoutes: FastifyPluginAsync = async (server) => {
   // Server-Sent Events for live measurements
@@ -55,33 +57,31 @@ const publicRoutes: FastifyPluginAsync = async (server) => {
 
     const deviceIds = devices.map((d) => d.id);
 
-    const latestMeasurements = await Promise.all(
-      deviceIds.map((id) =>
-        db.measurement.findFirst({
-          where: { deviceId: id },
-          orderBy: { measuredAt: 'desc' },
-        })
-      )
-    );
+    // Served from the in-memory reading cache (one DB load per device after a restart)
+    const latest = await latestMeasurements(deviceIds);
 
-    const aqiValues = latestMeasurements
+    const aqiValues = latest
       .filter((m) => m?.aqiCalculated)
       .map((m) => m!.aqiCalculated!);
 
     const avgAqi = aqiValues.reduce((a, b) => a + b, 0) / aqiValues.length || 0;
 
+    // Distribution over the last 24h from merged hourly rollup sketches
+    const last24h = await areaQuantiles(cityName, '1hour', new Date(Date.now() - 24 * 60 * 60 * 1000));
+
     return reply.send({
       city: cityName,
       deviceCount: devices.length,
       avgAqi: Math.round(avgAqi),
       maxAqi: Math.max(...aqiValues, 0),
       minAqi: Math.min(...aqiValues, 0),
+      percentiles24h: last24h.count > 0 ? last24h.values : null,
       devices: devices.map((d, i) => ({
         id: d.id,
         name: d.name,
         latitude: d.latitude,
         longitude: d.longitude,
-        currentAqi: latestMeasurements[i]?.aqiCalculated,
+        currentAqi: latest[i]?.aqiCalculated,
       })),
     });
   });
@@ -0,0 +1,106 @@
+/**
+ * Edge Uplink (store and forward)
+ * Readings published to the edge broker on forwarded topics are appended to a
+ * disk-backed log (the same segmented, CRC-checked log as durable ingest) and
+ * drained to the upstream broker in order at QoS 1. The consumer offset only
+ * advances once upstream has acknowledged a batch, so a backhaul outage or a
+ * restart just leaves readings queued on disk. Commands published upstream
+ * are relayed down to local nodes.
+ */
+
+import os from 'os';
+import { IngestLog, startLogConsumer } from '../lib/ingest-log';
+import { MqttBroker } from '../lib/mqtt-broker';
+import { MqttClient } from '../lib/mqtt-client';
+import { filterMatches } from '../lib/topic-trie';
+import type { QoS } from '../lib/mqtt-codec';
+
+export interface UplinkOptions {
+  url: string;
+  username?: string;
+  password?: string;
+  queueDir: string;
+  forwardFilters: string[];
+  commandFilters: string[];
+  batchSize: number;
+}
+
+interface QueuedMessage {
+  t: string;
+  p: string;
+}
+
+const CONSUMER = 'upstream';
+// A publish upstream never acknowledges (e.g. the broker drops the connection over it)
+// fails the batch after this long instead of holding the queue forever
+const ACK_TIMEOUT_MS = 30_000;
+
+export class EdgeUplink {
+  readonly queue: IngestLog;
+  readonly client: MqttClient;
+  private stopConsumer: (() => void) | null = null;
+  private truncateTimer: NodeJS.Timeout | null = null;
+  forwarded = 0;
+
+  constructor(
+    private readonly broker: MqttBroker,
+    private readonly opts: UplinkOptions
+  ) {
+    this.queue = new IngestLog({ dir: opts.queueDir, segmentBytes: 16 * 1024 * 1024, fsyncIntervalMs: 5 });
+    this.client = new MqttClient({
+      url: opts.url,
+      clientId: `aeroguard-edge-${os.hostname()}`,
+      username: opts.username,
+      password: opts.password,
+    });
+  }
+
+  /**
+   * Persist hook for the broker: queue forwarded topics, skip everything else
+   */
+  persist = (topic: string, payload: Buffer, _qos: QoS): Promise<number> | undefined => {
+    if (!this.opts.forwardFilters.some((f) => filterMatches(f, topic))) return undefined;
+    return this.queue.append({ t: topic, p: payload.toString('utf8') } satisfies QueuedMessage);
+  };
+
+  async start() {
+    await this.queue.open();
+
+    this.client.on('connect', () => console.log(`[UPLINK] Connected to ${this.opts.url}, ${this.backlogBytes()} bytes queued`));
+    this.client.on('offline', () => console.warn('[UPLINK] Upstream offline, queueing to disk'));
+    this.client.on('error', (err) => console.warn(`[UPLINK] ${err.message}`));
+    this.client.on('message', (msg) => {
+      this.broker.publish(msg.topic, Buffer.from(msg.payload), msg.qos);
+      msg.ack();
+    });
+    for (const filter of this.opts.commandFilters) this.client.subscribe(filter, 1);
+    this.client.connect();
+
+    // Publishes wait for the upstream PUBACK (and are resent after reconnects),
+    // so the offset commit below only happens once the whole batch is upstream.
+    // Timeouts while upstream is unreachable are an outage and retried indefinitely;
+    // a message that keeps timing out on a live connection is dead-lettered.
+    this.stopConsumer = startLogConsumer<QueuedMessage>(
+      this.queue,
+      CONSUMER,
+      async (records) => {
+        await Promise.all(records.map(({ value }) => this.client.publish(value.t, value.p, 1, false, ACK_TIMEOUT_MS)));
+        this.forwarded += records.length;
+      },
+      { batchSize: this.opts.batchSize, idleWaitMs: 200, isTransient: () => !this.client.isConnected }
+    );
+    this.truncateTimer = setInterval(() => this.queue.truncateBefore([CONSUMER]), 30_000);
+    this.truncateTimer.unref();
+  }
+
+  backlogBytes(): number {
+    return this.queue.end - this.queue.loadOffset(CONSUMER);
+  }
+
+  async stop() {
+    this.stopConsumer?.();
+    if (this.truncateTimer) clearInterval(this.truncateTimer);
+    await this.client.end();
+    await this.queue.close();
+  }
+}
@@ -0,0 +1,92 @@
+/**
+ * MQTT Ingest Bridge
+ * Consumes node readings published to MQTT_TOPIC/<device id> (firmware built
+ * with USE_MQTT; the bare topic is accepted too) and runs them through the
+ * same pipeline as HTTP ingest. Every server worker joins one shared
+ * subscription, so the broker spreads devices across them; brokers that
+ * route shared subscriptions by topic hash keep each device on one worker.
+ * Within a worker, a device's messages are processed strictly in arrival
+ * order while different devices run concurrently. Messages are
+ * acknowledged (QoS 1) only once stored or rejected, so a crash means
+ * redelivery, not loss; the replay filter absorbs the repeats.
+ */
+
+import os from 'os';
+import { MqttClient, MqttMessage } from '../lib/mqtt-client';
+import { ingestReading, IngestLogger } from '../lib/ingest-pipeline';
+import { config } from '../config';
+
+// Back-off between attempts when the pipeline fails internally (DB down, log full)
+const RETRY_DELAYS_MS = [500, 2000, 5000, 15000];
+
+export function startMqttBridge(log: IngestLogger): MqttClient | null {
+  if (!config.mqttUrl) return null;
+
+  const share = (filter: string) => (config.mqttShareGroup ? `$share/${config.mqttShareGroup}/${filter}` : filter);
+  const topics = [share(config.mqttTopic), share(`${config.mqttTopic}/+`)];
+  const client = new MqttClient({
+    url: config.mqttUrl,
+    clientId: `aeroguard-ingest-${os.hostname()}-${process.pid}`,
+    username: config.mqttUsername,
+    password: config.mqttPassword,
+  });
+
+  // Tail of each device's processing chain; removed once the device goes idle
+  const chains = new Map<string, Promise<void>>();
+  let inFlight = 0;
+  let paused = false;
+
+  async function processMessage(deviceId: string, body: unknown, msg: MqttMessage) {
+    for (let attempt = 0; ; attempt++) {
+      const outcome = await ingestReading(body, log);
+      if (outcome.status < 500 || attempt >= RETRY_DELAYS_MS.length) {
+        if (outcome.status >= 400) {
+          log.warn({ deviceId, status: outcome.status, error: outcome.body.error }, 'MQTT reading rejected');
+        }
+        msg.ack();
+        return;
+      }
+      await new Promise((resolve) => setTimeout(resolve, RETRY_DELAYS_MS[attempt]));
+    }
+  }
+
+  client.on('message', (msg: MqttMessage) => {
+    let body: any;
+    try {
+      body = JSON.parse(msg.payload.toString('utf8'));
+    } catch {
+      log.warn({ topic: msg.topic, bytes: msg.payload.length }, 'Dropping non-JSON MQTT message');
+      msg.ack();
+      return;
+    }
+    const deviceId = String(body?.device_id ?? body?.deviceId ?? '');
+
+    // Stop reading from the broker while too many readings are in the pipeline
+    inFlight++;
+    if (!paused && inFlight >= config.mqttMaxInFlight) {
+      paused = true;
+      client.pause();
+    }
+
+    const next = (chains.get(deviceId) ?? Promise.resolve())
+      .then(() => processMessage(deviceId, body, msg))
+      .catch((err) => log.error(err, 'MQTT bridge processing failed'))
+      .finally(() => {
+        if (chains.get(deviceId) === next) chains.delete(deviceId);
+        inFlight--;
+        if (paused && inFlight <= config.mqttMaxInFlight / 2) {
+          paused = false;
+          client.resume();
+        }
+      });
+    chains.set(deviceId, next);
+  });
+
+  client.on('connect', () => log.info({ url: config.mqttUrl, topics }, '📡 MQTT bridge subscribed'));
+  client.on('offline', () => log.warn({ url: config.mqttUrl }, 'MQTT bridge disconnected, reconnecting'));
+  client.on('error', (err) => log.warn({ err: err.message }, 'MQTT bridge error'));
+
+  for (const topic of topics) client.subscribe(topic, 1);
+  client.connect();
+  return client;
+}
@@ -0,0 +1,98 @@
+import { describe, it, expect } from '@jest/globals';
+import { TokenBuckets, AdmissionController } from '../src/lib/admission';
+
+const T0 = 1_760_000_000_000;
+
+describe('TokenBuckets', () => {
+  it('admits a full burst, then reports the wait for the next token', () => {
+    const buckets = new TokenBuckets(3, 6); // one token every 10 s
+    expect([0, 1, 2].map(() => buckets.take('a', T0))).toEqual([0, 0, 0]);
+    expect(buckets.take('a', T0)).toBe(10_000);
+    expect(buckets.take('a', T0 + 4_000)).toBe(6_000);
+    expect(buckets.take('a', T0 + 10_000)).toBe(0);
+  });
+
+  it('keeps one bucket per key', () => {
+    const buckets = new TokenBuckets(1, 1);
+    expect(buckets.take('a', T0)).toBe(0);
+    expect(buckets.take('a', T0)).toBeGreaterThan(0);
+    expect(buckets.take('b', T0)).toBe(0);
+    expect(buckets.size).toBe(2);
+  });
+
+  it('refills no further than the capacity', () => {
+    const buckets = new TokenBuckets(2, 60);
+    buckets.take('a', T0);
+    const later = T0 + 60 * 60_000;
+    expect(buckets.take('a', later)).toBe(0);
+    expect(buckets.take('a', later)).toBe(0);
+    expect(buckets.take('a', later)).toBeGreaterThan(0);
+  });
+
+  it('sweeps only buckets that have refilled completely', () => {
+    const buckets = new TokenBuckets(2, 60); // full again 2 s after the last take
+    buckets.take('old', T0);
+    buckets.take('new', T0 + 1_500);
+    buckets.sweep(T0 + 2_000);
+    expect(buckets.size).toBe(1);
+    buckets.sweep(T0 + 3_500);
+    expect(buckets.size).toBe(0);
+  });
+});
+
+describe('AdmissionController', () => {
+  it('rejects a device over its rate with a retry hint', () => {
+    const controller = new AdmissionController(1, 12, 100, 2000);
+    expect(controller.admit('dev', T0)).toEqual({ admitted: true });
+    expect(controller.admit('dev', T0)).toEqual({ admitted: false, reason: 'device_rate', retryAfterMs: 5_000 });
+  });
+
+  it('caps requests in flight until they are released', () => {
+    const controller = new AdmissionController(10, 60, 2, 2000);
+    expect(controller.admit('a', T0).admitted).toBe(true);
+    expect(controller.admit('b', T0).admitted).toBe(true);
+    expect(controller.admit('c', T0)).toEqual({ admitted: false, reason: 'overloaded', retryAfterMs: 2000 });
+    controller.release();
+    expect(controller.active).toBe(1);
+    expect(controller.admit('c', T0).admitted).toBe(true);
+  });
+
+  it('does not charge the device bucket when overloaded', () => {
+    const controller = new AdmissionController(1, 1, 1, 2000);
+    expect(controller.admit('a', T0).admitted).toBe(true);
+    expect(controller.admit('b', T0).admitted).toBe(false);
+    controller.release();
+    expect(controller.admit('b', T0).admitted).toBe(true);
+  });
+
+  it('charges unverified requests to their source, apart from device buckets', () => {
+    const controller = new AdmissionController(1, 1, 100, 2000, 2, 1);
+    expect(controller.admitUnverified('10.0.0.7', T0).admitted).toBe(true);
+    expect(controller.admitUnverified('10.0.0.7', T0).admitted).toBe(true);
+    expect(controller.admitUnverified('10.0.0.7', T0)).toMatchObject({ admitted: false, reason: 'source_rate' });
+    // A forged flood from that address leaves the real device's budget alone
+    expect(controller.admit('dev', T0).admitted).toBe(true);
+    expect(controller.buckets.size).toBe(1);
+    expect(controller.sourceBuckets.size).toBe(1);
+  });
+
+  it('charges a claimed id to both its device bucket and its source ceiling', () => {
+    const controller = new AdmissionController(2, 1, 100, 2000, 3, 1);
+    // Two nodes behind one address each get their own device budget...
+    expect(controller.admitClaimed('a', '10.0.0.7', T0).admitted).toBe(true);
+    expect(controller.admitClaimed('a', '10.0.0.7', T0).admitted).toBe(true);
+    expect(controller.admitClaimed('a', '10.0.0.7', T0)).toMatchObject({ admitted: false, reason: 'device_rate' });
+    // ...and a node over its own rate did not spend the shared ceiling
+    expect(controller.admitClaimed('b', '10.0.0.7', T0).admitted).toBe(true);
+    expect(controller.admitClaimed('b', '10.0.0.7', T0)).toMatchObject({ admitted: false, reason: 'source_rate' });
+    expect(controller.active).toBe(3);
+  });
+
+  it('sweeps both bucket maps', () => {
+    const controller = new AdmissionController(1, 60, 100, 2000, 1, 60);
+    controller.admit('dev', T0);
+    controller.admitUnverified('10.0.0.7', T0);
+    controller.sweep(T0 + 1_000);
+    expect(controller.buckets.size + controller.sourceBuckets.size).toBe(0);
+  });
+});
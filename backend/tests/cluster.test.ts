@@ -0,0 +1,91 @@
+import { describe, it, expect } from '@jest/globals';
+import { RendezvousRing, ClusterMembership, parseClusterNodes, ClusterNode } from '../src/lib/cluster';
+
+const node = (i: number): ClusterNode => ({ id: `ingest-${i}`, url: `http://10.0.0.${i}:3000` });
+const nodes = (n: number) => Array.from({ length: n }, (_, i) => node(i + 1));
+const ids = Array.from({ length: 20_000 }, (_, i) => `AERO-${i.toString(36).toUpperCase()}-${(i * 7919) % 1000}`);
+
+function owners(ring: RendezvousRing) {
+  return ids.map((id) => ring.owner(id)!.id);
+}
+
+describe('parseClusterNodes', () => {
+  it('parses id=url pairs and bare urls', () => {
+    expect(parseClusterNodes(' a=http://a:3000/ , http://b:3000,, c=https://c.example//')).toEqual([
+      { id: 'a', url: 'http://a:3000' },
+      { id: 'http://b:3000', url: 'http://b:3000' },
+      { id: 'c', url: 'https://c.example' },
+    ]);
+    expect(parseClusterNodes('')).toEqual([]);
+  });
+});
+
+describe('RendezvousRing', () => {
+  it('gives every device one owner regardless of node list order', () => {
+    const a = owners(new RendezvousRing(nodes(4)));
+    const b = owners(new RendezvousRing([...nodes(4)].reverse()));
+    expect(a).toEqual(b);
+  });
+
+  it('spreads devices roughly evenly', () => {
+    const counts = new Map<string, number>();
+    for (const o of owners(new RendezvousRing(nodes(5)))) counts.set(o, (counts.get(o) ?? 0) + 1);
+    expect(counts.size).toBe(5);
+    for (const c of counts.values()) expect(Math.abs(c - ids.length / 5)).toBeLessThan(ids.length / 5 * 0.1);
+  });
+
+  it('moves only the new node\'s share when a node joins', () => {
+    const before = owners(new RendezvousRing(nodes(4)));
+    const after = owners(new RendezvousRing(nodes(5)));
+    let moved = 0;
+    after.forEach((o, i) => {
+      if (o !== before[i]) {
+        moved++;
+        expect(o).toBe('ingest-5');
+      }
+    });
+    expect(Math.abs(moved - ids.length / 5)).toBeLessThan(ids.length / 5 * 0.1);
+  });
+
+  it('moves only the leaving node\'s devices when a node leaves', () => {
+    const before = owners(new RendezvousRing(nodes(5)));
+    const after = owners(new RendezvousRing(nodes(5).filter((n) => n.id !== 'ingest-3')));
+    after.forEach((o, i) => {
+      if (before[i] !== 'ingest-3') expect(o).toBe(before[i]);
+    });
+  });
+
+  it('has no owner in an empty cluster', () => {
+    expect(new RendezvousRing([]).owner('dev')).toBeNull();
+  });
+});
+
+describe('ClusterMembership', () => {
+  it('redirects devices owned elsewhere and keeps its own', () => {
+    const membership = new ClusterMembership('ingest-1', nodes(3), 60_000);
+    const ring = new RendezvousRing(nodes(3));
+    for (const id of ids.slice(0, 500)) {
+      const owner = ring.owner(id)!;
+      expect(membership.owns(id)).toBe(owner.id === 'ingest-1');
+      expect(membership.redirectFor(id)).toEqual(owner.id === 'ingest-1' ? null : owner);
+    }
+  });
+
+  it('treats devices picked up in a membership change as recently acquired for the handoff window', () => {
+    const T0 = 1_760_000_000_000;
+    const membership = new ClusterMembership('ingest-1', nodes(3), 60_000);
+    const before = new Set(ids.filter((id) => membership.owns(id)));
+    membership.update(nodes(3).filter((n) => n.id !== 'ingest-2'), T0);
+
+    const acquired = ids.filter((id) => membership.owns(id) && !before.has(id));
+    expect(acquired.length).toBeGreaterThan(0);
+    expect(acquired.every((id) => membership.recentlyAcquired(id, T0 + 1_000))).toBe(true);
+    expect([...before].some((id) => membership.recentlyAcquired(id, T0 + 1_000))).toBe(false);
+    expect(acquired.some((id) => membership.recentlyAcquired(id, T0 + 60_000))).toBe(false);
+  });
+
+  it('has no recent acquisitions before any change', () => {
+    const membership = new ClusterMembership('ingest-1', nodes(3), 60_000);
+    expect(ids.slice(0, 100).some((id) => membership.recentlyAcquired(id))).toBe(false);
+  });
+});
@@ -0,0 +1,66 @@
+import zlib from 'zlib';
+import { describe, it, expect } from '@jest/globals';
+import { encodeSegment, decodeSegment, ColdRow, FLOAT_COLUMNS } from '../src/lib/columnar-segment';
+
+const T0 = Date.UTC(2025, 9, 1);
+
+function row(i: number, overrides: Partial<ColdRow> = {}): ColdRow {
+  const r = {
+    measuredAt: new Date(T0 + i * 60_000 + (i % 7) * 13),
+    rssi: -60 - (i % 5),
+    uptime: BigInt(3_600_000 + i * 60_000),
+    aqiCategory: i % 50 < 40 ? 'moderate' : 'unhealthy_sensitive',
+    qualityFlags: { sensor_warmed_up: true, dht22_valid: true, bmp180_valid: i % 11 !== 0, overall_valid: true },
+    externalData: {},
+  } as ColdRow;
+  FLOAT_COLUMNS.forEach((col, k) => (r[col] = Math.round((50 + k * 10 + Math.sin(i / 30 + k) * 20) * 100) / 100));
+  r.pm10Api = null;
+  r.uvIndex = null;
+  return { ...r, ...overrides };
+}
+
+const day = Array.from({ length: 1440 }, (_, i) => row(i));
+
+describe('columnar segments', () => {
+  it('round-trips a day of readings exactly', () => {
+    expect(decodeSegment(encodeSegment(day))).toEqual(day);
+  });
+
+  it('stores rows sorted by measuredAt whatever the input order', () => {
+    const shuffled = [...day].reverse();
+    const decoded = decodeSegment(encodeSegment(shuffled));
+    expect(decoded.map((r) => r.measuredAt.getTime())).toEqual(day.map((r) => r.measuredAt.getTime()));
+  });
+
+  it('keeps values that do not fit the scaled encoding exact', () => {
+    const rows = [row(0, { temperature: 1 / 3, pressureHpa: 1008.123456 }), row(1, { temperature: -40.25 }), row(2)];
+    const decoded = decodeSegment(encodeSegment(rows));
+    expect(decoded[0].temperature).toBe(1 / 3);
+    expect(decoded[0].pressureHpa).toBe(1008.123456);
+    expect(decoded[1].temperature).toBe(-40.25);
+  });
+
+  it('keeps nulls, JSON columns and bigint uptime apart from present values', () => {
+    const rows = [
+      row(0, { aqiCalculated: null, aqiCategory: null, qualityFlags: null, uptime: null, rssi: null }),
+      row(1, { externalData: { openweather: { pm2_5: 35.2, aqi: 3 } }, qualityFlags: { priority_alert: true } }),
+      row(2, { aqiCalculated: 0, temperature: -0.01 }),
+    ];
+    expect(decodeSegment(encodeSegment(rows))).toEqual(rows);
+  });
+
+  it('round-trips an empty segment', () => {
+    expect(decodeSegment(encodeSegment([]))).toEqual([]);
+  });
+
+  it('compresses well below the JSON size of the rows', () => {
+    const json = JSON.stringify(day, (_k, v) => (typeof v === 'bigint' ? v.toString() : v));
+    expect(encodeSegment(day).length * 10).toBeLessThan(json.length);
+  });
+
+  it('rejects data that is not a segment', () => {
+    expect(() => decodeSegment(zlib.deflateSync(Buffer.from('definitely not a segment')))).toThrow('Not a measurement segment');
+    const raw = zlib.inflateSync(encodeSegment(day.slice(0, 10)));
+    expect(() => decodeSegment(zlib.deflateSync(raw.subarray(0, 6)))).toThrow();
+  });
+});
@@ -0,0 +1,89 @@
+import { describe, it, expect } from '@jest/globals';
+import { ReplayFilter } from '../src/lib/dedup-filter';
+
+const HOUR = 60 * 60 * 1000;
+
+function filter(slotsPerPartition = 4096, partitions = 4, windowMs = 4 * HOUR) {
+  return new ReplayFilter({ windowMs, partitions, slotsPerPartition }, 0);
+}
+
+describe('ReplayFilter', () => {
+  it('reports a key as new the first time and as seen on replay', () => {
+    const f = filter();
+    const key = ReplayFilter.key('device-1', 1760000000000, 7);
+    expect(f.checkAndInsert(key, 1000)).toBe(false);
+    expect(f.checkAndInsert(key, 2000)).toBe(true);
+    expect(f.stats.inserts).toBe(1);
+    expect(f.stats.hits).toBe(1);
+  });
+
+  it('keeps sequence numbers apart in the key', () => {
+    expect(ReplayFilter.key('d', 5, 1)).not.toBe(ReplayFilter.key('d', 5, 2));
+    expect(ReplayFilter.key('d', 5, null)).toBe('d|5|');
+  });
+
+  it('has no false negatives within the window', () => {
+    const f = filter(8192);
+    const keys = Array.from({ length: 6000 }, (_, i) => ReplayFilter.key(`device-${i % 50}`, i * 60_000, i));
+    keys.forEach((k, i) => f.checkAndInsert(k, i));
+    expect(keys.every((k) => f.checkAndInsert(k, 10_000))).toBe(true);
+  });
+
+  it('keeps the false-positive rate low for never-seen keys', () => {
+    const f = filter(65536);
+    for (let i = 0; i < 10000; i++) f.checkAndInsert(ReplayFilter.key('a', i, i), 0);
+    let hits = 0;
+    for (let i = 0; i < 10000; i++) if (f.checkAndInsert(ReplayFilter.key('b', i, i), 1)) hits++;
+    expect(hits / 10000).toBeLessThan(0.01);
+  });
+
+  it('forgets keys once the window has passed', () => {
+    const f = filter();
+    const key = ReplayFilter.key('device-1', 0, 1);
+    f.checkAndInsert(key, 0);
+    expect(f.checkAndInsert(ReplayFilter.key('device-1', 0, 2), 3 * HOUR)).toBe(false);
+    expect(f.checkAndInsert(key, 5 * HOUR)).toBe(false);
+  });
+
+  it('loses no earlier key when a partition saturates', () => {
+    // Tiny partitions saturate quickly; every key inserted so far must still be reported
+    const f = filter(64, 64, 64 * HOUR);
+    const warn = console.warn;
+    console.warn = () => {};
+    try {
+      const keys: string[] = [];
+      for (let i = 0; i < 2000; i++) {
+        const k = ReplayFilter.key('device', i, i);
+        keys.push(k);
+        f.checkAndInsert(k, 0);
+        if (f.stats.saturations > 0) break;
+      }
+      expect(f.stats.saturations).toBeGreaterThan(0);
+      expect(keys.every((k) => f.checkAndInsert(k, 1))).toBe(true);
+    } finally {
+      console.warn = warn;
+    }
+  });
+
+  it('keeps every key in the window however often partitions fill up', () => {
+    // Far more keys than the four partitions hold: early rotation would have wrapped
+    // around and cleared keys that are still inside the window
+    const f = filter(64, 4, 4 * HOUR);
+    const warn = console.warn;
+    console.warn = () => {};
+    try {
+      const keys = Array.from({ length: 2000 }, (_, i) => ReplayFilter.key(`device-${i % 20}`, i * 60_000, i));
+      keys.forEach((k) => f.checkAndInsert(k, 0));
+      expect(f.stats.saturations).toBeGreaterThan(4);
+      expect(keys.every((k) => f.checkAndInsert(k, HOUR))).toBe(true);
+
+      // Overflow tables go once their slot rotates out
+      const grown = f.memoryBytes;
+      f.checkAndInsert(ReplayFilter.key('device-0', 0, null), 5 * HOUR);
+      expect(f.memoryBytes).toBeLessThan(grown);
+      expect(f.checkAndInsert(keys[0], 5 * HOUR)).toBe(false);
+    } finally {
+      console.warn = warn;
+    }
+  });
+});
@@ -0,0 +1,58 @@
+import { describe, it, expect } from '@jest/globals';
+import { lttb, minMaxBuckets, downsample } from '../src/lib/downsample';
+
+function series(n: number, f: (i: number) => number) {
+  const xs = Float64Array.from({ length: n }, (_, i) => i * 60_000);
+  const ys = Float64Array.from({ length: n }, (_, i) => f(i));
+  return { xs, ys };
+}
+
+const increasing = (idx: number[]) => idx.every((v, i) => i === 0 || v > idx[i - 1]);
+
+describe('lttb', () => {
+  it('returns every index when the series is already small enough', () => {
+    const { xs, ys } = series(10, (i) => i);
+    expect(lttb(xs, ys, 20)).toEqual([0, 1, 2, 3, 4, 5, 6, 7, 8, 9]);
+    expect(lttb(xs, ys, 2)).toHaveLength(10);
+  });
+
+  it('picks exactly threshold points in time order, keeping both ends', () => {
+    const { xs, ys } = series(10_000, (i) => Math.sin(i / 50) * 100);
+    const idx = lttb(xs, ys, 500);
+    expect(idx).toHaveLength(500);
+    expect(idx[0]).toBe(0);
+    expect(idx[499]).toBe(9_999);
+    expect(increasing(idx)).toBe(true);
+  });
+
+  it('keeps an isolated spike', () => {
+    const { xs, ys } = series(5_000, (i) => (i === 2_345 ? 400 : 50));
+    expect(lttb(xs, ys, 100)).toContain(2_345);
+  });
+});
+
+describe('minMaxBuckets', () => {
+  it('keeps the min and max of every bucket, in time order', () => {
+    const { xs, ys } = series(1_000, (i) => (i === 10 ? -5 : i === 20 ? 999 : i % 7));
+    const idx = minMaxBuckets(xs, ys, 20);
+    expect(idx).toContain(10);
+    expect(idx).toContain(20);
+    expect(idx.length).toBeLessThanOrEqual(20);
+    expect(increasing(idx)).toBe(true);
+  });
+
+  it('skips empty buckets across a gap', () => {
+    const xs = Float64Array.from([0, 1, 2, 3, 1000, 1001, 1002, 1003]);
+    const ys = Float64Array.from([1, 5, 2, 4, 3, 9, 1, 2]);
+    const idx = minMaxBuckets(xs, ys, 6);
+    expect(idx).toEqual([0, 1, 5, 6]);
+  });
+});
+
+describe('downsample', () => {
+  it('dispatches on method', () => {
+    const { xs, ys } = series(2_000, (i) => i % 13);
+    expect(downsample(xs, ys, 100)).toEqual(lttb(xs, ys, 100));
+    expect(downsample(xs, ys, 100, 'minmax')).toEqual(minMaxBuckets(xs, ys, 100));
+  });
+});
@@ -0,0 +1,46 @@
+import crypto from 'crypto';
+import { describe, it, expect } from '@jest/globals';
+import { verifyHMAC, deriveDeviceKey } from '../src/lib/hmac';
+
+const SECRET = 'kGj3@z7P!qT9$L8rVb2mXyW4sN6fC1eH';
+const PAYLOAD = JSON.stringify({ device_id: 'AERO-ROURKELA-01', sensors: { iaq_score: 88.5 } });
+const sign = (payload: string, key = SECRET) => crypto.createHmac('sha256', key).update(payload).digest('hex');
+
+describe('verifyHMAC', () => {
+  it('accepts the signature of the exact payload', () => {
+    expect(verifyHMAC(PAYLOAD, sign(PAYLOAD), SECRET)).toBe(true);
+    expect(verifyHMAC(PAYLOAD, sign(PAYLOAD).toUpperCase(), SECRET)).toBe(true);
+  });
+
+  it('rejects a changed payload or the wrong key', () => {
+    expect(verifyHMAC(PAYLOAD + ' ', sign(PAYLOAD), SECRET)).toBe(false);
+    expect(verifyHMAC(PAYLOAD, sign(PAYLOAD, 'other-key'), SECRET)).toBe(false);
+  });
+
+  it('returns false instead of throwing on malformed signatures', () => {
+    const good = sign(PAYLOAD);
+    expect(verifyHMAC(PAYLOAD, '', SECRET)).toBe(false);
+    expect(verifyHMAC(PAYLOAD, good.slice(0, 63), SECRET)).toBe(false);
+    expect(verifyHMAC(PAYLOAD, good + '0', SECRET)).toBe(false);
+    expect(verifyHMAC(PAYLOAD, 'z' + good.slice(1), SECRET)).toBe(false);
+    // 64 UTF-16 units but more than 64 bytes: a plain length check lets this reach timingSafeEqual
+    expect(verifyHMAC(PAYLOAD, 'é'.repeat(64), SECRET)).toBe(false);
+    expect(verifyHMAC(PAYLOAD, '€' + good.slice(1), SECRET)).toBe(false);
+    expect(verifyHMAC(PAYLOAD, undefined as unknown as string, SECRET)).toBe(false);
+  });
+});
+
+describe('deriveDeviceKey', () => {
+  it('is HMAC-SHA256(master, id) as 32 hex chars', () => {
+    const master = 'a'.repeat(64);
+    const key = deriveDeviceKey(master, 'AERO-ROURKELA-01');
+    expect(key).toBe(crypto.createHmac('sha256', master).update('AERO-ROURKELA-01').digest('hex').substring(0, 32));
+    expect(key).toHaveLength(32);
+  });
+
+  it('differs per device and per master', () => {
+    const master = 'a'.repeat(64);
+    expect(deriveDeviceKey(master, 'dev-1')).not.toBe(deriveDeviceKey(master, 'dev-2'));
+    expect(deriveDeviceKey(master, 'dev-1')).not.toBe(deriveDeviceKey('b'.repeat(64), 'dev-1'));
+  });
+});
@@ -0,0 +1,74 @@
+import { describe, it, expect } from '@jest/globals';
+import { toHourly, fitHoltWinters, updateState, forecastHoltWinters, rmse, HOURS_PER_DAY } from '../src/lib/holt-winters';
+
+const HOUR = 3_600_000;
+const H0 = 488_000; // Epoch hour, a UTC midnight
+
+// Daily AQI cycle: traffic peaks in the morning and evening
+const daily = (hour: number) => 90 + 30 * Math.sin((2 * Math.PI * (hour % HOURS_PER_DAY)) / HOURS_PER_DAY);
+
+function series(days: number, f = daily) {
+  const hours = Array.from({ length: days * HOURS_PER_DAY }, (_, i) => H0 + i);
+  return { hours, values: hours.map(f) };
+}
+
+describe('toHourly', () => {
+  it('averages readings per epoch hour and skips empty hours', () => {
+    const ts = [H0 * HOUR, H0 * HOUR + 60_000, (H0 + 1) * HOUR + 5, (H0 + 3) * HOUR];
+    expect(toHourly(ts, [10, 20, 40, 7])).toEqual({ hours: [H0, H0 + 1, H0 + 3], values: [15, 40, 7] });
+    expect(toHourly([], [])).toEqual({ hours: [], values: [] });
+  });
+});
+
+describe('fitHoltWinters', () => {
+  it('needs at least six hourly buckets', () => {
+    expect(fitHoltWinters({ hours: [1, 2, 3, 4, 5], values: [1, 2, 3, 4, 5] })).toBeNull();
+    expect(fitHoltWinters({ hours: [1, 2, 3, 4, 5, 6], values: [1, 2, 3, 4, 5, 6] })).not.toBeNull();
+  });
+
+  it('learns the daily season and forecasts the next day', () => {
+    const state = fitHoltWinters(series(5))!;
+    const next = forecastHoltWinters(state, HOURS_PER_DAY);
+    expect(next).toHaveLength(HOURS_PER_DAY);
+    next.forEach((v, i) => expect(Math.abs(v - daily(state.lastHour + 1 + i))).toBeLessThan(8));
+    expect(rmse(state)).toBeLessThan(10);
+  });
+
+  it('forecasts a flat series as flat', () => {
+    const state = fitHoltWinters(series(3, () => 55))!;
+    forecastHoltWinters(state, 12).forEach((v) => expect(v).toBeCloseTo(55, 6));
+    expect(rmse(state)).toBeCloseTo(0, 6);
+  });
+});
+
+describe('updateState', () => {
+  it('keeps a fitted model current from new hours only', () => {
+    const full = series(6);
+    const cut = 5 * HOURS_PER_DAY;
+    const state = fitHoltWinters({ hours: full.hours.slice(0, cut), values: full.values.slice(0, cut) })!;
+    const n = state.n;
+    for (let i = cut; i < full.hours.length; i++) updateState(state, full.hours[i], full.values[i]);
+    expect(state.lastHour).toBe(full.hours[full.hours.length - 1]);
+    expect(state.n).toBe(n + HOURS_PER_DAY);
+    forecastHoltWinters(state, 6).forEach((v, i) => expect(Math.abs(v - daily(state.lastHour + 1 + i))).toBeLessThan(8));
+  });
+
+  it('ignores hours at or before the last applied one', () => {
+    const state = fitHoltWinters(series(2))!;
+    const before = JSON.stringify(state);
+    updateState(state, state.lastHour, 500);
+    updateState(state, state.lastHour - 3, 500);
+    expect(JSON.stringify(state)).toBe(before);
+  });
+
+  it('carries the damped trend across a gap without touching the season', () => {
+    const state = fitHoltWinters(series(2, (h) => 50 + (h - H0)))!; // Rising 1/hour
+    const season = [...state.season];
+    const gapHour = state.lastHour + 5;
+    updateState(state, gapHour, 50 + (gapHour - H0));
+    const touched = season.map((s, i) => s !== state.season[i]);
+    expect(touched.filter(Boolean)).toHaveLength(1);
+    expect(touched[gapHour % HOURS_PER_DAY]).toBe(true);
+    expect(state.lastHour).toBe(gapHour);
+  });
+});
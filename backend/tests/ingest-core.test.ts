@@ -0,0 +1,129 @@
+import crypto from 'crypto';
+import { describe, it, expect } from '@jest/globals';
+import type { Device } from '@prisma/client';
+import { normalizeIngest, verifyDerivedKey, isPriorityAlert, measurementIdFor, DeviceAuth } from '../src/lib/ingest-core';
+import { decodePayload } from '../src/lib/payload';
+import { deriveDeviceKey } from '../src/lib/hmac';
+
+const MASTER = 'f'.repeat(64);
+const DEVICE_ID = '3b1f6f4e-5c1a-4d8e-9a57-0d2c6b7e1a90';
+
+function payload(deviceId = DEVICE_ID, extra: Record<string, unknown> = {}) {
+  return {
+    device_id: deviceId,
+    firmware_version: '1.2.0',
+    timestamp: 1760000000,
+    sensors: { mq135_raw: 71.4, iaq_score: 88.5, co2_equiv: 612.3, temperature: 27.4, humidity: 54.2 },
+    meta: { uptime_ms: 3600000, rssi: -61, boot_id: '9f2c01ab', seq: 42 },
+    ...extra,
+  };
+}
+
+function signed(body: Record<string, unknown>, key: string) {
+  return { ...body, signature: crypto.createHmac('sha256', key).update(JSON.stringify(body)).digest('hex') };
+}
+
+function lookup(devices: Device[]) {
+  const rows = new Map(devices.map((d) => [d.id, d]));
+  const calls: string[] = [];
+  return {
+    resolve: (id: string) => {
+      calls.push(id);
+      return rows.get(id) ?? null;
+    },
+    calls,
+  };
+}
+
+const derivedDevice = { id: DEVICE_ID, deviceKey: deriveDeviceKey(MASTER, DEVICE_ID), altitude: null } as unknown as Device;
+const legacyDevice = { id: DEVICE_ID, deviceKey: 'legacy-random-key-0123456789abcd', altitude: null } as unknown as Device;
+const strict: DeviceAuth = { masterKey: MASTER, allowLegacyKeys: false };
+const lenient: DeviceAuth = { masterKey: MASTER, allowLegacyKeys: true };
+
+describe('verifyDerivedKey', () => {
+  it('accepts a payload signed with the derived key only', () => {
+    expect(verifyDerivedKey(decodePayload(signed(payload(), derivedDevice.deviceKey)), MASTER)).toBe(true);
+    expect(verifyDerivedKey(decodePayload(signed(payload(), legacyDevice.deviceKey)), MASTER)).toBe(false);
+    expect(verifyDerivedKey(decodePayload(payload()), MASTER)).toBe(false);
+  });
+
+  it('binds the signature to the device id', () => {
+    const other = crypto.randomUUID();
+    const forged = signed(payload(other), derivedDevice.deviceKey);
+    expect(verifyDerivedKey(decodePayload(forged), MASTER)).toBe(false);
+  });
+});
+
+describe('normalizeIngest', () => {
+  it('normalizes a signed reading under a derived key', async () => {
+    const db = lookup([derivedDevice]);
+    const r = await normalizeIngest(signed(payload(), derivedDevice.deviceKey), db.resolve, strict);
+    expect(r.ok).toBe(true);
+    if (!r.ok) return;
+    expect(r.reading.deviceId).toBe(DEVICE_ID);
+    expect(r.reading.id).toBe(measurementIdFor(DEVICE_ID, '9f2c01ab', 42));
+    expect(r.reading.measuredAt.getTime()).toBe(1760000000 * 1000);
+    expect(r.reading.iaqScore).toBe(88.5);
+    expect(r.reading.qualityFlags.priority_alert).toBe(undefined);
+  });
+
+  it('rejects forged and unsigned traffic before the device lookup', async () => {
+    const db = lookup([derivedDevice]);
+    const forged = await normalizeIngest(signed(payload(), 'b'.repeat(32)), db.resolve, strict);
+    const unsigned = await normalizeIngest(payload(), db.resolve, strict);
+    expect(forged).toEqual({ ok: false, status: 401, error: 'Invalid signature' });
+    expect(unsigned).toEqual({ ok: false, status: 401, error: 'Signature required' });
+    expect(db.calls).toHaveLength(0);
+  });
+
+  it('falls back to the stored key when legacy keys are allowed', async () => {
+    const db = lookup([legacyDevice]);
+    const ok = await normalizeIngest(signed(payload(), legacyDevice.deviceKey), db.resolve, lenient);
+    const bad = await normalizeIngest(signed(payload(), 'b'.repeat(32)), db.resolve, lenient);
+    expect(ok.ok).toBe(true);
+    expect(bad).toEqual({ ok: false, status: 401, error: 'Invalid signature' });
+    expect(db.calls).toHaveLength(2);
+  });
+
+  it('checks the stored key without a master key', async () => {
+    const db = lookup([legacyDevice]);
+    expect((await normalizeIngest(signed(payload(), legacyDevice.deviceKey), db.resolve)).ok).toBe(true);
+    expect(await normalizeIngest(signed(payload(), 'b'.repeat(32)), db.resolve)).toEqual({
+      ok: false,
+      status: 401,
+      error: 'Invalid signature',
+    });
+    expect(await normalizeIngest(signed(payload(crypto.randomUUID()), 'b'.repeat(32)), db.resolve)).toEqual({
+      ok: false,
+      status: 404,
+      error: 'Device not found',
+    });
+  });
+
+  it('requires a device id', async () => {
+    expect(await normalizeIngest({ sensors: {} }, () => null)).toEqual({ ok: false, status: 400, error: 'device_id is required' });
+  });
+});
+
+describe('priority alerts', () => {
+  it('flags readings from the priority uplink so aggregate consumers can skip them', async () => {
+    const db = lookup([derivedDevice]);
+    const alert = {
+      device_id: DEVICE_ID,
+      timestamp: 1760000030,
+      sensors: { iaq_score: 212.4, co2_equiv: 1480 },
+      meta: { boot_id: '9f2c01ab', seq: 43, alert: 'category' },
+    };
+    const r = await normalizeIngest(signed(alert, derivedDevice.deviceKey), db.resolve, strict);
+    const regular = await normalizeIngest(signed(payload(), derivedDevice.deviceKey), db.resolve, strict);
+    expect(r.ok && isPriorityAlert(r.reading.qualityFlags)).toBe(true);
+    expect(regular.ok && isPriorityAlert(regular.reading.qualityFlags)).toBe(false);
+  });
+
+  it('treats missing or legacy flags as regular readings', () => {
+    expect(isPriorityAlert(null)).toBe(false);
+    expect(isPriorityAlert({})).toBe(false);
+    expect(isPriorityAlert({ overall_valid: true })).toBe(false);
+    expect(isPriorityAlert({ priority_alert: true })).toBe(true);
+  });
+});
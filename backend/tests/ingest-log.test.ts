@@ -0,0 +1,167 @@
+import fs from 'fs';
+import os from 'os';
+import path from 'path';
+import { describe, it, expect, beforeEach, afterEach } from '@jest/globals';
+import { IngestLog, crc32, startLogConsumer, LogRecord } from '../src/lib/ingest-log';
+
+describe('IngestLog', () => {
+  let dir: string;
+  const open = async (segmentBytes = 1 << 20) => {
+    const log = new IngestLog({ dir, segmentBytes, fsyncIntervalMs: 1 });
+    await log.open();
+    return log;
+  };
+
+  beforeEach(() => {
+    dir = fs.mkdtempSync(path.join(os.tmpdir(), 'ingest-log-'));
+  });
+
+  afterEach(() => {
+    fs.rmSync(dir, { recursive: true, force: true });
+  });
+
+  it('computes the IEEE CRC-32', () => {
+    expect(crc32(Buffer.from('123456789'))).toBe(0xcbf43926);
+  });
+
+  it('reads back appended records in order with chained offsets', async () => {
+    const log = await open();
+    const offsets = await Promise.all([1, 2, 3].map((n) => log.append({ n })));
+    const records = await log.read<{ n: number }>(0, 10);
+    expect(records.map((r) => r.value.n)).toEqual([1, 2, 3]);
+    expect(records.map((r) => r.offset)).toEqual(offsets);
+    expect(records[1].offset).toBe(records[0].next);
+    expect(log.end).toBe(records[2].next);
+    await log.close();
+  });
+
+  it('rolls segments and reads across them', async () => {
+    const log = await open(64);
+    for (let n = 0; n < 10; n++) await log.append({ n, pad: 'x'.repeat(20) });
+    expect(fs.readdirSync(dir).filter((f) => f.endsWith('.log')).length).toBeGreaterThan(1);
+    expect((await log.read<{ n: number }>(0, 100)).map((r) => r.value.n)).toEqual([0, 1, 2, 3, 4, 5, 6, 7, 8, 9]);
+    await log.close();
+  });
+
+  it('truncates a torn tail on open and keeps the complete records', async () => {
+    const log = await open();
+    await log.append({ n: 1 });
+    const end = await log.append({ n: 2 }).then(() => log.end);
+    await log.close();
+
+    // Half-written third record: header promises more bytes than were written
+    const file = path.join(dir, fs.readdirSync(dir).find((f) => f.endsWith('.log'))!);
+    const header = Buffer.alloc(8);
+    header.writeUInt32LE(100, 0);
+    fs.appendFileSync(file, Buffer.concat([header, Buffer.from('{"n":')]));
+
+    const reopened = await open();
+    expect(fs.statSync(file).size).toBe(end);
+    expect((await reopened.read<{ n: number }>(0, 10)).map((r) => r.value.n)).toEqual([1, 2]);
+    await reopened.append({ n: 3 });
+    expect((await reopened.read<{ n: number }>(0, 10)).map((r) => r.value.n)).toEqual([1, 2, 3]);
+    await reopened.close();
+  });
+
+  it('stops at a record whose CRC does not match', async () => {
+    const log = await open();
+    await log.append({ n: 1 });
+    const second = await log.append({ n: 2 });
+    await log.close();
+
+    const file = path.join(dir, fs.readdirSync(dir).find((f) => f.endsWith('.log'))!);
+    const bytes = fs.readFileSync(file);
+    bytes[second + 8] ^= 0xff;
+    fs.writeFileSync(file, bytes);
+
+    const reopened = await open();
+    expect(await reopened.read(0, 10)).toHaveLength(1);
+    expect(reopened.end).toBe(second);
+    await reopened.close();
+  });
+
+  it('persists consumer offsets', async () => {
+    const log = await open();
+    const offset = await log.append({ n: 1 });
+    log.commitOffset('writer', offset + 1);
+    expect(log.loadOffset('writer')).toBe(offset + 1);
+    expect(log.loadOffset('unknown')).toBe(0);
+    await log.close();
+  });
+
+  it('drops waiters that time out instead of keeping them until the next commit', async () => {
+    const log = await open();
+    await log.waitForData(5);
+    await log.waitForData(5);
+    expect((log as any).waiters.size).toBe(0);
+
+    const woken = log.waitForData(60_000);
+    await log.append({ n: 1 });
+    await woken;
+    expect((log as any).waiters.size).toBe(0);
+    await log.close();
+  });
+
+  it('reads records larger than one read chunk', async () => {
+    const log = await open(4 << 20);
+    await log.append({ n: 1 });
+    await log.append({ n: 2, pad: 'x'.repeat(600 * 1024) });
+    await log.append({ n: 3 });
+    expect((await log.read<{ n: number }>(0, 10)).map((r) => r.value.n)).toEqual([1, 2, 3]);
+    await log.close();
+  });
+
+  it('dead-letters a record that keeps failing and moves past it', async () => {
+    const log = await open();
+    for (let n = 1; n <= 5; n++) await log.append({ n });
+    const handled: number[] = [];
+    let done!: () => void;
+    const finished = new Promise<void>((r) => (done = r));
+
+    const stop = startLogConsumer<{ n: number }>(
+      log,
+      'writer',
+      async (records: LogRecord<{ n: number }>[]) => {
+        if (records.some((r) => r.value.n === 3)) throw new Error('constraint violation');
+        handled.push(...records.map((r) => r.value.n));
+        if (handled.includes(5)) done();
+      },
+      { batchSize: 10, idleWaitMs: 1, maxAttempts: 2 }
+    );
+    await finished;
+    await new Promise((r) => setTimeout(r, 10)); // Let the consumer commit the last batch
+    stop();
+
+    expect(handled).toEqual([1, 2, 4, 5]);
+    expect(log.stats.deadLettered).toBe(1);
+    const dead = fs.readFileSync(path.join(dir, 'writer.dead'), 'utf8').trim().split('\n').map((l) => JSON.parse(l));
+    expect(dead).toHaveLength(1);
+    expect(dead[0]).toMatchObject({ error: 'constraint violation', value: { n: 3 } });
+    expect(log.loadOffset('writer')).toBe(log.end);
+    await log.close();
+  });
+
+  it('retries transient failures without dead-lettering', async () => {
+    const log = await open();
+    await log.append({ n: 1 });
+    let calls = 0;
+    let done!: () => void;
+    const finished = new Promise<void>((r) => (done = r));
+
+    const stop = startLogConsumer<{ n: number }>(
+      log,
+      'writer',
+      async () => {
+        if (++calls < 6) throw new Error('connection refused');
+        done();
+      },
+      { idleWaitMs: 1, maxAttempts: 2, isTransient: () => true }
+    );
+    await finished;
+    stop();
+
+    expect(log.stats.deadLettered).toBe(0);
+    expect(fs.existsSync(path.join(dir, 'writer.dead'))).toBe(false);
+    await log.close();
+  });
+});
@@ -0,0 +1,74 @@
+import { describe, it, expect } from '@jest/globals';
+import { encodePacket, encodePublishHeader, PacketParser, Packet, CONNACK_ACCEPTED, SUBACK_FAILURE } from '../src/lib/mqtt-codec';
+
+const reading = Buffer.from(JSON.stringify({ device_id: 'AERO-ROURKELA-01', sensors: { iaq_score: 88.5 } }));
+
+const packets: Packet[] = [
+  {
+    type: 'connect',
+    clientId: 'AERO-ROURKELA-01',
+    keepalive: 60,
+    clean: true,
+    username: 'aeroguard',
+    password: Buffer.from('s3cret'),
+    will: { topic: 'aeroguard/status/AERO-ROURKELA-01', payload: Buffer.from('offline'), qos: 1, retain: true },
+  },
+  { type: 'connect', clientId: 'bare', keepalive: 0, clean: false },
+  { type: 'connack', sessionPresent: false, returnCode: CONNACK_ACCEPTED },
+  { type: 'publish', topic: 'aeroguard/measurements/AERO-ROURKELA-01', payload: reading, qos: 1, retain: false, dup: true, messageId: 7 },
+  { type: 'publish', topic: 'aeroguard/commands', payload: Buffer.alloc(0), qos: 0, retain: true, dup: false },
+  { type: 'puback', messageId: 65535 },
+  { type: 'subscribe', messageId: 2, subscriptions: [{ topic: 'aeroguard/measurements/+', qos: 1 }, { topic: '#', qos: 0 }] },
+  { type: 'suback', messageId: 2, granted: [1, SUBACK_FAILURE] },
+  { type: 'unsubscribe', messageId: 3, topics: ['aeroguard/measurements/+', 'ünïcode/topic'] },
+  { type: 'unsuback', messageId: 3 },
+  { type: 'pingreq' },
+  { type: 'pingresp' },
+  { type: 'disconnect' },
+];
+
+describe('MQTT codec', () => {
+  it('round-trips every supported packet type', () => {
+    for (const p of packets) expect(new PacketParser().push(encodePacket(p))).toEqual([p]);
+  });
+
+  it('reassembles packets split at any byte and splits packets sharing a chunk', () => {
+    const stream = Buffer.concat(packets.map(encodePacket));
+    const parser = new PacketParser();
+    const out: Packet[] = [];
+    for (let i = 0; i < stream.length; i++) out.push(...parser.push(stream.subarray(i, i + 1)));
+    expect(out).toEqual(packets);
+    expect(new PacketParser().push(stream)).toEqual(packets);
+  });
+
+  it('encodes multi-byte remaining lengths', () => {
+    for (const size of [127, 128, 16_383, 16_384, 200_000]) {
+      const p: Packet = { type: 'publish', topic: 't', payload: Buffer.alloc(size, 7), qos: 0, retain: false, dup: false };
+      const [back] = new PacketParser(1 << 20).push(encodePacket(p)) as Array<Extract<Packet, { type: 'publish' }>>;
+      expect(back.payload.length).toBe(size);
+    }
+  });
+
+  it('writes a publish header that matches a full encode when followed by the payload', () => {
+    const header = encodePublishHeader('aeroguard/measurements/AERO-ROURKELA-01', 1, false, reading.length, 7);
+    const full = encodePacket({ ...(packets[3] as Extract<Packet, { type: 'publish' }>), dup: false });
+    expect(Buffer.concat([header, reading]).equals(full)).toBe(true);
+    expect(encodePublishHeader('t', 0, true, 10).equals(encodePacket({ type: 'publish', topic: 't', payload: Buffer.alloc(10), qos: 0, retain: true, dup: false }).subarray(0, 5))).toBe(true);
+  });
+
+  it('rejects packets over the size limit before buffering them', () => {
+    const big = encodePacket({ type: 'publish', topic: 't', payload: Buffer.alloc(2048), qos: 0, retain: false, dup: false });
+    expect(() => new PacketParser(1024).push(big.subarray(0, 4))).toThrow('MQTT packet too large');
+  });
+
+  it('rejects malformed input', () => {
+    expect(() => new PacketParser().push(Buffer.from([0x30, 0xff, 0xff, 0xff, 0xff, 0x01]))).toThrow('Malformed MQTT remaining length');
+    expect(() => new PacketParser().push(Buffer.from([0x34, 0x03, 0x00, 0x01, 0x74]))).toThrow('QoS 2 is not supported');
+    expect(() => new PacketParser().push(Buffer.from([0xf0, 0x00]))).toThrow('Unsupported MQTT packet type 15');
+    // Topic length runs past the end of the packet
+    expect(() => new PacketParser().push(Buffer.from([0x30, 0x03, 0x00, 0x09, 0x74]))).toThrow('Malformed MQTT packet');
+    const v5 = encodePacket(packets[1]);
+    v5[8] = 5; // Protocol level byte
+    expect(() => new PacketParser().push(v5)).toThrow('Unsupported MQTT protocol MQTT/5');
+  });
+});
@@ -0,0 +1,94 @@
+import { describe, it, expect } from '@jest/globals';
+import { NeighborhoodMonitor, neighborhoodKey } from '../src/lib/neighborhood-outliers';
+
+const MIN = 60_000;
+const T0 = 1_760_000_000_000;
+
+const monitor = () =>
+  new NeighborhoodMonitor({ windowMs: 15 * MIN, minNeighbors: 3, zThreshold: 3.5, minDeviation: { aqi: 50, iaq: 75 } });
+
+// Neighbors with a realistic spread around AQI 80 / IAQ 100
+function seed(m: NeighborhoodMonitor, area = 'Civil Township', ts = T0) {
+  [72, 78, 80, 84, 90].forEach((aqi, i) => m.check(area, `n${i}`, ts, { aqi, iaq: aqi + 20 }));
+}
+
+describe('NeighborhoodMonitor', () => {
+  it('does not judge until enough neighbors have reported', () => {
+    const m = monitor();
+    m.check('A', 'n0', T0, { aqi: 80, iaq: 100 });
+    m.check('A', 'n1', T0, { aqi: 82, iaq: 100 });
+    expect(m.check('A', 'bad', T0, { aqi: 400, iaq: 450 })).toEqual({ outlier: false, neighbors: 2 });
+  });
+
+  it('accepts readings near the consensus', () => {
+    const m = monitor();
+    seed(m);
+    expect(m.check('Civil Township', 'dev', T0 + MIN, { aqi: 95, iaq: 118 })).toEqual({ outlier: false, neighbors: 5 });
+  });
+
+  it('flags a reading far from the neighborhood median', () => {
+    const m = monitor();
+    seed(m);
+    const verdict = m.check('Civil Township', 'dev', T0 + MIN, { aqi: 60, iaq: 420 });
+    expect(verdict).toMatchObject({ outlier: true, neighbors: 5, metric: 'iaq', median: 100 });
+    expect(verdict.z!).toBeGreaterThan(3.5);
+    expect(m.stats).toEqual({ checked: 6, flagged: 1 });
+  });
+
+  it('needs the minimum absolute deviation even when neighbors agree exactly', () => {
+    const m = monitor();
+    [80, 80, 80].forEach((aqi, i) => m.check('A', `n${i}`, T0, { aqi, iaq: null }));
+    expect(m.check('A', 'dev', T0, { aqi: 120, iaq: null }).outlier).toBe(false);
+    const verdict = m.check('A', 'dev2', T0, { aqi: 140, iaq: null });
+    expect(verdict).toMatchObject({ outlier: true, metric: 'aqi', median: 80 });
+    expect(verdict.z).toBeUndefined(); // MAD 0: infinite z is not reported
+  });
+
+  it('judges an unrecorded reading without adding it to the consensus', () => {
+    const m = monitor();
+    seed(m);
+    expect(m.check('Civil Township', 'dev', T0 + MIN, { aqi: 60, iaq: 420 }, false).outlier).toBe(true);
+    // dev was never recorded, so it is still not a neighbor of anyone
+    expect(m.check('Civil Township', 'other', T0 + MIN, { aqi: 80, iaq: 100 }).neighbors).toBe(5);
+  });
+
+  it('does not count the device itself or other areas', () => {
+    const m = monitor();
+    seed(m, 'A');
+    seed(m, 'B');
+    // dev's own earlier reading is not a neighbor; only area A's five are
+    m.check('A', 'dev', T0, { aqi: 80, iaq: 100 });
+    expect(m.check('A', 'dev', T0 + MIN, { aqi: 81, iaq: 101 }).neighbors).toBe(5);
+  });
+
+  it('forgets neighbors that fell out of the window', () => {
+    const m = monitor();
+    seed(m);
+    expect(m.check('Civil Township', 'dev', T0 + 20 * MIN, { aqi: 400, iaq: 450 })).toEqual({ outlier: false, neighbors: 0 });
+  });
+
+  it('judges a buffered upload against neighbors from around its own time', () => {
+    const m = monitor();
+    seed(m, 'A', T0 + 30 * MIN);
+    // Neighbors are more than a window newer than the buffered reading
+    expect(m.check('A', 'dev', T0, { aqi: 400, iaq: 450 }).neighbors).toBe(0);
+  });
+
+  it('sweeps stale nodes and empty areas', () => {
+    const m = monitor();
+    seed(m, 'A', T0);
+    seed(m, 'B', T0 + 10 * MIN);
+    m.sweep(T0 + 20 * MIN);
+    expect(m.check('A', 'dev', T0 + 20 * MIN, { aqi: 80, iaq: 100 }).neighbors).toBe(0);
+    expect(m.check('B', 'dev', T0 + 20 * MIN, { aqi: 80, iaq: 100 }).neighbors).toBe(5);
+  });
+});
+
+describe('neighborhoodKey', () => {
+  it('prefers the area name, else a ~1 km grid cell', () => {
+    expect(neighborhoodKey({ areaName: 'Civil Township', latitude: 22.25, longitude: 84.88 })).toBe('Civil Township');
+    expect(neighborhoodKey({ latitude: 22.2512, longitude: 84.8849 })).toBe('22.25,84.88');
+    expect(neighborhoodKey({ latitude: 22.25 })).toBeNull();
+    expect(neighborhoodKey({})).toBeNull();
+  });
+});
@@ -0,0 +1,108 @@
+import { describe, it, expect } from '@jest/globals';
+import { decodePayload, decodeGeneric, num } from '../src/lib/payload';
+
+// What transmitData() sends, keys in firmware order
+const firmware = () => ({
+  device_id: 'AERO-ROURKELA-01',
+  firmware_version: '1.2.0',
+  timestamp: 1760000000,
+  sensors: {
+    mq135_raw: 71.4,
+    iaq_score: 88.5,
+    co2_equiv: 612.3,
+    temperature: 27.4,
+    humidity: 54.2,
+    pressure_hpa: 1008.6,
+    altitude_m: 219.5,
+  },
+  meta: { uptime_ms: 3600000, rssi: -61, free_heap: 181240, heap_max_block: 110580, boot_id: '9f2c01ab', seq: 42 },
+  signature: 'ab'.repeat(32),
+});
+
+const { signedPayload: _a, fastPath: _b, ...fields } = decodeGeneric(firmware());
+
+describe('decodePayload', () => {
+  it('takes the fast path for the firmware shape and agrees with the generic decoder', () => {
+    const fast = decodePayload(firmware());
+    expect(fast.fastPath).toBe(true);
+    const { signedPayload, fastPath, ...rest } = fast;
+    expect(rest).toEqual({ ...fields, measuredAt: undefined, measurementId: undefined });
+    expect(rest.deviceId).toBe('AERO-ROURKELA-01');
+    expect(rest.seq).toBe(42);
+    expect(rest.bootId).toBe('9f2c01ab');
+  });
+
+  it('signs the body without the signature, byte for byte as sent', () => {
+    const { signature, ...unsigned } = firmware();
+    expect(decodePayload(firmware()).signedPayload()).toBe(JSON.stringify(unsigned));
+    expect(decodeGeneric(firmware()).signedPayload()).toBe(JSON.stringify(unsigned));
+    expect(decodePayload(unsigned).signedPayload()).toBe(JSON.stringify(unsigned));
+  });
+
+  it('decodes the priority alert shape on the fast path', () => {
+    const alert = decodePayload({
+      device_id: 'AERO-ROURKELA-01',
+      timestamp: 1760000030,
+      sensors: { iaq_score: 212.4, co2_equiv: 1480 },
+      meta: { boot_id: '9f2c01ab', seq: 43, alert: 'co2' },
+    });
+    expect(alert.fastPath).toBe(true);
+    expect(alert.alert).toBe('co2');
+    expect(alert.temperature).toBeNull();
+  });
+
+  it('maps non-finite sensor values to null on the fast path', () => {
+    const body = firmware();
+    body.sensors.temperature = NaN;
+    const out = decodePayload(body);
+    expect(out.fastPath).toBe(true);
+    expect(out.temperature).toBeNull();
+  });
+
+  it('falls back to the generic path for shapes it does not specialize', () => {
+    const { device_id, firmware_version, ...rest } = firmware();
+    const cases: Record<string, unknown>[] = [
+      { firmware_version, device_id, ...rest },                               // Keys out of order
+      { ...firmware(), sensors: { ...firmware().sensors, temperature: '27.4 C' } }, // Unit string
+      { ...firmware(), sensors: { iaq: 90 } },                                // Alias
+      { ...firmware(), meta: { ...firmware().meta, extra: 1 } },              // Unknown meta key
+      { ...firmware(), timestamp: '1760000000' },                             // String timestamp
+      { deviceId: 'AERO-ROURKELA-01', iaq_score: 90 },                        // Flat legacy payload
+    ];
+    for (const body of cases) expect(decodePayload(body).fastPath).toBe(false);
+  });
+
+  it('strips units and resolves aliases on the generic path', () => {
+    const out = decodePayload({
+      deviceId: 'AERO-ROURKELA-01',
+      sensors: { iaq: '95 IAQ', temperature: '27.4 C', pressure: '1,008.6 hPa', pm25: 35 },
+      meta: { uptime: 5000, seq: '7' },
+    });
+    expect(out.deviceId).toBe('AERO-ROURKELA-01');
+    expect(out.iaq).toBe(95);
+    expect(out.temperature).toBe(27.4);
+    expect(out.pressure).toBe(1008.6);
+    expect(out.pm25).toBe(35);
+    expect(out.uptimeMs).toBe(5000);
+    expect(out.seq).toBe(7);
+  });
+
+  it('accepts only UUIDs as client-supplied measurement ids', () => {
+    const id = '3b241101-e2bb-4255-8caf-4136c566a962';
+    expect(decodePayload({ ...firmware(), measurement_id: id }).measurementId).toBe(id);
+    expect(() => decodePayload({ ...firmware(), measurement_id: 'reading-1' })).toThrow();
+    expect(() => decodePayload({ ...firmware(), id: '' })).toThrow();
+  });
+});
+
+describe('num', () => {
+  it('coerces numbers and unit-suffixed strings', () => {
+    expect(num(12.5)).toBe(12.5);
+    expect(num('-3.5 C')).toBe(-3.5);
+    expect(num('1,013 hPa')).toBe(1013);
+    expect(num(Infinity)).toBeNull();
+    expect(num('n/a')).toBeNull();
+    expect(num(undefined)).toBeNull();
+    expect(num({})).toBeNull();
+  });
+});
@@ -0,0 +1,141 @@
+import { describe, it, expect } from '@jest/globals';
+import { QuantileSketch, mergeSketches } from '../src/lib/quantile-sketch';
+
+// Deterministic PRNG so failures reproduce
+function rng(seed: number) {
+  return () => {
+    seed = (seed * 1664525 + 1013904223) >>> 0;
+    return seed / 2 ** 32;
+  };
+}
+
+// AQI-like skewed values
+function values(n: number, seed: number): number[] {
+  const rand = rng(seed);
+  return Array.from({ length: n }, () => 20 + 300 * rand() ** 3);
+}
+
+// Same rank convention as QuantileSketch.quantile()
+function exact(sorted: number[], q: number): number {
+  return sorted[Math.floor(q * (sorted.length - 1))];
+}
+
+const QS = [0.01, 0.1, 0.25, 0.5, 0.75, 0.9, 0.99];
+
+function expectWithinAccuracy(sketch: QuantileSketch, data: number[]) {
+  const sorted = [...data].sort((a, b) => a - b);
+  for (const q of QS) {
+    const truth = exact(sorted, q);
+    expect(Math.abs(sketch.quantile(q)! - truth)).toBeLessThanOrEqual(Math.abs(truth) * sketch.relativeAccuracy + 1e-9);
+  }
+}
+
+describe('QuantileSketch', () => {
+  it('answers every quantile within the relative accuracy', () => {
+    const data = values(20_000, 1);
+    const sketch = new QuantileSketch();
+    data.forEach((v) => sketch.add(v));
+    expectWithinAccuracy(sketch, data);
+    expect(sketch.count).toBe(20_000);
+    expect(sketch.min).toBe(Math.min(...data));
+    expect(sketch.max).toBe(Math.max(...data));
+    expect(sketch.quantile(0)).toBe(sketch.min);
+    expect(sketch.quantile(1)).toBe(sketch.max);
+  });
+
+  it('handles zeros and negative values', () => {
+    const data = [-40, -12.5, -0.5, 0, 0, 3, 18, 25.5, 31, 44];
+    const sketch = new QuantileSketch();
+    data.forEach((v) => sketch.add(v));
+    expectWithinAccuracy(sketch, data);
+    expect(sketch.quantile(0.45)).toBe(0);
+    expect(sketch.mean).toBeCloseTo(data.reduce((a, b) => a + b, 0) / data.length, 9);
+  });
+
+  it('ignores non-finite values and reports null when empty', () => {
+    const sketch = new QuantileSketch();
+    sketch.add(NaN);
+    sketch.add(Infinity);
+    expect(sketch.count).toBe(0);
+    expect(sketch.quantile(0.5)).toBeNull();
+    expect(sketch.mean).toBeNull();
+  });
+
+  it('merges per-device sketches into the same answers as one sketch over everything', () => {
+    const parts = [values(3_000, 2), values(500, 3), values(8_000, 4)];
+    const whole = new QuantileSketch();
+    const merged = new QuantileSketch();
+    for (const part of parts) {
+      const device = new QuantileSketch();
+      part.forEach((v) => {
+        device.add(v);
+        whole.add(v);
+      });
+      merged.merge(device);
+    }
+    for (const q of QS) expect(merged.quantile(q)).toBe(whole.quantile(q));
+    expect(merged.count).toBe(whole.count);
+    expect(merged.min).toBe(whole.min);
+    expect(merged.max).toBe(whole.max);
+    expectWithinAccuracy(merged, parts.flat());
+  });
+
+  it('refuses to merge sketches of different accuracy', () => {
+    expect(() => new QuantileSketch(0.01).merge(new QuantileSketch(0.02))).toThrow();
+  });
+
+  it('round-trips through the serialized form', () => {
+    const sketch = new QuantileSketch();
+    [...values(5_000, 5), -3, 0].forEach((v) => sketch.add(v));
+    const copy = QuantileSketch.fromBase64(sketch.toBase64());
+    for (const q of QS) expect(copy.quantile(q)).toBe(sketch.quantile(q));
+    expect(copy.count).toBe(sketch.count);
+    expect(copy.sum).toBe(sketch.sum);
+    expect(copy.min).toBe(sketch.min);
+    expect(copy.max).toBe(sketch.max);
+    expect(copy.relativeAccuracy).toBe(sketch.relativeAccuracy);
+    // A day of readings fits a small JSON column
+    expect(sketch.toBuffer().length).toBeLessThan(1_024);
+  });
+
+  it('round-trips an empty sketch', () => {
+    const copy = QuantileSketch.fromBuffer(new QuantileSketch().toBuffer());
+    expect(copy.count).toBe(0);
+    expect(copy.quantile(0.5)).toBeNull();
+  });
+
+  it('rejects an unknown format version', () => {
+    const buf = new QuantileSketch().toBuffer();
+    buf[0] = 99;
+    expect(() => QuantileSketch.fromBuffer(buf)).toThrow('Unsupported sketch version 99');
+  });
+
+  it('bounds its bins, losing accuracy only at the low end', () => {
+    const data = Array.from({ length: 10_000 }, (_, i) => 1.001 ** i);
+    const sketch = new QuantileSketch(0.01, 64);
+    data.forEach((v) => sketch.add(v));
+    const sorted = [...data].sort((a, b) => a - b);
+    for (const q of [0.9, 0.99]) {
+      const truth = exact(sorted, q);
+      expect(Math.abs(sketch.quantile(q)! - truth)).toBeLessThanOrEqual(truth * 0.01);
+    }
+    expect(sketch.toBuffer().length).toBeLessThan(64 * 3 + 64);
+  });
+});
+
+describe('mergeSketches', () => {
+  it('merges encoded sketches and skips missing ones', () => {
+    const a = new QuantileSketch();
+    const b = new QuantileSketch();
+    values(1_000, 6).forEach((v) => a.add(v));
+    values(1_000, 7).forEach((v) => b.add(v));
+    const merged = mergeSketches([a.toBase64(), null, undefined, b.toBase64()]);
+    expect(merged.count).toBe(2_000);
+    a.merge(b);
+    expect(merged.quantile(0.5)).toBe(a.quantile(0.5));
+  });
+
+  it('returns an empty sketch for no input', () => {
+    expect(mergeSketches([null]).count).toBe(0);
+  });
+});
@@ -0,0 +1,83 @@
+import { describe, it, expect } from '@jest/globals';
+import { ReadingRingCache, RingValues } from '../src/lib/reading-ring';
+
+const MIN = 60_000;
+const T0 = Math.floor(1_760_000_000_000 / (5 * MIN)) * 5 * MIN; // Bucket-aligned
+
+const values = (aqi: number | null, extra: Partial<RingValues> = {}): RingValues => ({
+  aqi,
+  iaq: null,
+  temperature: null,
+  humidity: null,
+  pressureHpa: null,
+  ...extra,
+});
+
+describe('ReadingRingCache', () => {
+  it('keeps the newest reading as latest, even when older ones arrive after it', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 60 * MIN });
+    cache.record('dev', T0 + 2 * MIN, values(80, { temperature: -3.25 }));
+    cache.record('dev', T0 + MIN, values(40));
+    const latest = cache.latestFor('dev')!;
+    expect(latest.measuredAt.getTime()).toBe(T0 + 2 * MIN);
+    expect(latest.aqi).toBe(80);
+    expect(latest.temperature).toBeCloseTo(-3.25, 5);
+    expect(latest.iaq).toBeNull();
+    expect(cache.latestFor('other')).toBeNull();
+  });
+
+  it('averages readings per bucket and reports count and AQI range', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 60 * MIN });
+    [60, 180, 90].forEach((aqi, i) => cache.record('dev', T0 + i * MIN, values(aqi, { humidity: 50 + i })));
+    cache.record('dev', T0 + 5 * MIN, values(70));
+
+    const buckets = cache.recent('dev', T0, T0 + 6 * MIN);
+    expect(buckets).toHaveLength(2);
+    expect(buckets[0]).toMatchObject({ count: 3, aqi: 110, aqiMin: 60, aqiMax: 180, humidity: 51 });
+    expect(buckets[0].start.getTime()).toBe(T0);
+    expect(buckets[1]).toMatchObject({ count: 1, aqi: 70, aqiMin: 70, aqiMax: 70, humidity: null });
+  });
+
+  it('leaves the AQI range empty for buckets without AQI', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 60 * MIN });
+    cache.record('dev', T0, values(null, { iaq: 120 }));
+    expect(cache.recent('dev', T0, T0)[0]).toMatchObject({ count: 1, aqi: null, aqiMin: null, aqiMax: null, iaq: 120 });
+  });
+
+  it('reuses slots as time moves on and drops readings older than the window', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 15 * MIN });
+    expect(cache.slots).toBe(3);
+    for (let b = 0; b < 5; b++) cache.record('dev', T0 + b * 5 * MIN, values(100 + b));
+    const now = T0 + 4 * 5 * MIN;
+    expect(cache.recent('dev', T0, now).map((b) => b.aqi)).toEqual([102, 103, 104]);
+
+    // Late reading for a bucket that has left the window
+    cache.record('dev', T0 + MIN, values(500));
+    expect(cache.recent('dev', T0, now).map((b) => b.aqiMax)).toEqual([102, 103, 104]);
+  });
+
+  it('skips stale slots instead of reporting an old day', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 15 * MIN });
+    cache.record('dev', T0, values(100));
+    expect(cache.recent('dev', T0, T0 + 60 * MIN)).toHaveLength(0);
+  });
+
+  it('clamps to the fixed-point range', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 15 * MIN });
+    cache.record('dev', T0, values(1e6, { temperature: -1e6 }));
+    const [b] = cache.recent('dev', T0, T0);
+    expect(b.aqi).toBe(0xfffe / 10);
+    expect(b.aqiMax).toBe(0xfffe / 10);
+    expect(b.temperature).toBe(-0x7fff / 100);
+  });
+
+  it('grows past its initial capacity without losing data', () => {
+    const cache = new ReadingRingCache({ bucketMs: 5 * MIN, windowMs: 15 * MIN, initialDevices: 2 });
+    for (let d = 0; d < 9; d++) cache.record(`dev-${d}`, T0, values(10 + d));
+    expect(cache.size).toBe(9);
+    for (let d = 0; d < 9; d++) {
+      expect(cache.latestFor(`dev-${d}`)!.aqi).toBe(10 + d);
+      expect(cache.recent(`dev-${d}`, T0, T0)[0]).toMatchObject({ aqi: 10 + d, aqiMin: 10 + d, aqiMax: 10 + d });
+    }
+  });
+});
@@ -0,0 +1,110 @@
+import { describe, it, expect } from '@jest/globals';
+import { TopicTrie, filterMatches, validFilter, validTopic } from '../src/lib/topic-trie';
+
+const filters = [
+  '#',
+  '+',
+  'aeroguard/#',
+  'aeroguard/measurements/+',
+  'aeroguard/measurements/AERO-ROURKELA-01',
+  'aeroguard/+/AERO-ROURKELA-01',
+  '+/+/+',
+  'aeroguard/commands',
+  'aeroguard/measurements/+/#',
+  '$SYS/#',
+  '$SYS/broker/+',
+  '/leading',
+  '+/leading',
+];
+
+const topics = [
+  'aeroguard',
+  'aeroguard/commands',
+  'aeroguard/measurements/AERO-ROURKELA-01',
+  'aeroguard/measurements/AERO-ROURKELA-02',
+  'aeroguard/status/AERO-ROURKELA-01',
+  'aeroguard/measurements/AERO-ROURKELA-01/raw',
+  '$SYS/broker/clients',
+  '$SYS',
+  '/leading',
+  'other',
+  'a/b/c',
+];
+
+function trie() {
+  const t = new TopicTrie<string>();
+  for (const f of filters) t.add(f, f);
+  return t;
+}
+
+describe('filterMatches', () => {
+  it('follows MQTT 3.1.1 wildcard rules', () => {
+    expect(filterMatches('aeroguard/#', 'aeroguard')).toBe(true); // # includes the parent level
+    expect(filterMatches('aeroguard/+', 'aeroguard')).toBe(false);
+    expect(filterMatches('aeroguard/+', 'aeroguard/')).toBe(true); // Empty level
+    expect(filterMatches('+/+', '/leading')).toBe(true);
+    expect(filterMatches('#', '$SYS/broker/clients')).toBe(false);
+    expect(filterMatches('+/broker/clients', '$SYS/broker/clients')).toBe(false);
+    expect(filterMatches('$SYS/#', '$SYS/broker/clients')).toBe(true);
+    expect(filterMatches('aeroguard/commands', 'aeroguard/commands/extra')).toBe(false);
+  });
+});
+
+describe('TopicTrie', () => {
+  it('matches exactly the filters filterMatches accepts', () => {
+    const t = trie();
+    for (const topic of topics) {
+      const expected = filters.filter((f) => filterMatches(f, topic)).sort();
+      expect(t.match(topic).sort()).toEqual(expected);
+    }
+  });
+
+  it('returns a value once per matching filter', () => {
+    const t = new TopicTrie<number>();
+    t.add('aeroguard/#', 1);
+    t.add('aeroguard/measurements/+', 1);
+    t.add('aeroguard/measurements/+', 2);
+    t.add('aeroguard/measurements/+', 2); // Duplicate add is a no-op
+    expect(t.size).toBe(3);
+    expect(t.match('aeroguard/measurements/AERO-ROURKELA-01').sort()).toEqual([1, 1, 2]);
+  });
+
+  it('removes subscriptions and prunes empty branches', () => {
+    const t = trie();
+    t.remove('aeroguard/measurements/AERO-ROURKELA-01', 'aeroguard/measurements/AERO-ROURKELA-01');
+    t.remove('aeroguard/measurements/+', 'not-subscribed');
+    t.remove('no/such/filter', 'x');
+    expect(t.size).toBe(filters.length - 1);
+    expect(t.match('aeroguard/measurements/AERO-ROURKELA-01')).not.toContain('aeroguard/measurements/AERO-ROURKELA-01');
+
+    for (const f of filters) t.remove(f, f);
+    expect(t.size).toBe(0);
+    expect(t.match('aeroguard/measurements/AERO-ROURKELA-01')).toEqual([]);
+    // Every branch was pruned, so the root is as empty as a fresh trie's
+    expect(JSON.stringify((t as any).root, (_k, v) => (v instanceof Map ? [...v] : v instanceof Set ? [...v] : v))).toBe(
+      JSON.stringify({ children: [], values: [] })
+    );
+  });
+
+  it('keeps a branch that still has subscribers below it', () => {
+    const t = new TopicTrie<string>();
+    t.add('a/b', 'x');
+    t.add('a/b/c', 'y');
+    t.remove('a/b', 'x');
+    expect(t.match('a/b/c')).toEqual(['y']);
+  });
+});
+
+describe('validFilter / validTopic', () => {
+  it('accepts well-formed filters only', () => {
+    for (const f of filters) expect(validFilter(f)).toBe(true);
+    for (const f of ['', 'a/#/b', 'a#', 'a/b+', 'sport+']) expect(validFilter(f)).toBe(false);
+  });
+
+  it('rejects wildcards in publish topics', () => {
+    expect(validTopic('aeroguard/measurements/AERO-ROURKELA-01')).toBe(true);
+    expect(validTopic('')).toBe(false);
+    expect(validTopic('aeroguard/+')).toBe(false);
+    expect(validTopic('aeroguard/#')).toBe(false);
+  });
+});
@@ -39,32 +39,34 @@ export default function DeviceDetailPage() {
       else if (timeRange === '7d') start.setDate(start.getDate() - 7);
       else if (timeRange === '30d') start.setDate(start.getDate() - 30);
 
-      // Fetch device info and measurements
+      // Fetch device info and measurements (the last 24h comes from the server's cache)
       const [deviceRes, measurementsRes] = await Promise.all([
         apiClient.getDevice(deviceId),
-        apiClient.getMeasurements({
-          device_id: deviceId,
-          start: start.toISOString(),
-          end: end.toISOString(),
-          limit: 1000
-        })
+        timeRange === '24h'
+          ? apiClient.getRecent(deviceId, 24)
+          : apiClient.getMeasurements({
+              device_id: deviceId,
+              start: start.toISOString(),
+              end: end.toISOString(),
+              limit: 1000
+            })
       ]);
 
       setDevice(deviceRes.data);
       setMeasurements(measurementsRes.data.data || []);
 
-      // Calculate statistics
+      // Calculate statistics. The 24h rows are bucket means: weight them by their reading
+      // count and take the extremes from each bucket's AQI range (raw rows count once).
       if (measurementsRes.data.data && measurementsRes.data.data.length > 0) {
-        const aqiValues = measurementsRes.data.data
-          .map((m: any) => m.aqiCalculated)
-          .filter((v: any) => v !== null);
+        const withAqi = measurementsRes.data.data.filter((m: any) => m.aqiCalculated !== null);
+        const readings = withAqi.reduce((n: number, m: any) => n + (m.count ?? 1), 0);
 
         setStats({
-          avgAqi: Math.round(aqiValues.reduce((a: number, b: number) => a + b, 0) / aqiValues.length),
-          maxAqi: Math.max(...aqiValues),
-          minAqi: Math.min(...aqiValues),
-          dataPoints: aqiValues.length,
-          uptime: calculateUptime(measurementsRes.data.data)
+          avgAqi: Math.round(withAqi.reduce((s: number, m: any) => s + m.aqiCalculated * (m.count ?? 1), 0) / readings),
+          maxAqi: Math.max(...withAqi.map((m: any) => m.aqiMax ?? m.aqiCalculated)),
+          minAqi: Math.min(...withAqi.map((m: any) => m.aqiMin ?? m.aqiCalculated)),
+          dataPoints: readings,
+          uptime: calculateUptime(measurementsRes.data.data, measurementsRes.data.bucket_minutes)
         });
       }
 
@@ -85,10 +87,12 @@ export default function DeviceDetailPage() {
     }
   };
 
-  const calculateUptime = (measurements: any[]) => {
+  // Share of the day's slots holding data: cache buckets when the server averaged them,
+  // otherwise 5-min intervals
+  const calculateUptime = (measurements: any[], bucketMinutes?: number | null) => {
     if (measurements.length === 0) return 0;
-    const expectedPoints = 288; // 5-min intervals in 24h
-    return (measurements.length / expectedPoints) * 100;
+    const expectedPoints = bucketMinutes ? (24 * 60) / bucketMinutes : 288;
+    return Math.min(100, (measurements.length / expectedPoints) * 100);
   };
 
   const generateMockDevice = () => ({
@@ -172,11 +172,11 @@ export default function HomePage() {
       const start = new Date();
       if (r === '24h') start.setHours(start.getHours() - 24);
       else start.setDate(start.getDate() - 7);
-      const res = await apiClient.getMeasurements({
+      const res = await apiClient.getSeries({
         device_id: deviceId,
         start: start.toISOString(),
         end: end.toISOString(),
-        limit: 500,
+        points: 500,
       });
       setSeries(res.data.data || []);
     } catch (e) {
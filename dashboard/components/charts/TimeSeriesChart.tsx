@@ -3,6 +3,7 @@
 import { Line, XAxis, YAxis, CartesianGrid, Tooltip, Legend, ResponsiveContainer, Area, AreaChart } from 'recharts';
 import { format } from 'date-fns';
 import { getAQICategory } from '@/lib/aqi-utils';
+import { lttb } from '@/lib/downsample';
 
 interface TimeSeriesChartProps {
   data: Array<{
@@ -17,6 +18,8 @@ interface TimeSeriesChartProps {
     aqi: number;
     confidence?: number;
   }>;
+  // Longer series are reduced client-side (LTTB) so large or live-appended arrays stay cheap to render
+  maxPoints?: number;
 }
 
 interface ParsedPoint {
@@ -32,7 +35,7 @@ interface ForecastPoint {
   confidence?: number;
 }
 
-export function TimeSeriesChart({ data, showForecast, forecastData }: TimeSeriesChartProps) {
+export function TimeSeriesChart({ data, showForecast, forecastData, maxPoints = 400 }: TimeSeriesChartProps) {
   // Parse, sanitize, and sort input data by time ascending
   const parsed: ParsedPoint[] = (data || [])
     .map((d: any): ParsedPoint | null => {
@@ -58,7 +61,15 @@ export function TimeSeriesChart({ data, showForecast, forecastData }: TimeSeries
   const spanDays = spanMs / (1000 * 60 * 60 * 24);
   const timeFmt = spanDays >= 2 ? 'MMM d' : 'HH:mm';
 
-  const chartData = parsed.map((p) => ({
+  // Downsample on AQI; points without AQI would only render as gaps
+  let visible = parsed;
+  if (parsed.length > maxPoints) {
+    const withAqi = parsed.filter((p) => p.aqi !== undefined);
+    const picked = lttb(withAqi.map((p) => p.ts), withAqi.map((p) => p.aqi as number), maxPoints);
+    visible = picked.map((i) => withAqi[i]);
+  }
+
+  const chartData = visible.map((p) => ({
     time: format(new Date(p.ts), timeFmt),
     ts: p.ts,
     aqi: p.aqi,
@@ -28,6 +28,10 @@ export const apiClient = {
   getMeasurements: (params?: { device_id?: string; start?: string; end?: string; limit?: number }) =>
     api.get('/measurements', { params }),
 
+  // Chart-ready series reduced server-side to `points` (LTTB by default, or min/max per bucket)
+  getSeries: (params: { device_id: string; start?: string; end?: string; points?: number; method?: 'lttb' | 'minmax' }) =>
+    api.get('/measurements/series', { params }),
+
   getMeasurement: (id: string) =>
     api.get(`/measurements/${id}`),
 
@@ -41,6 +45,11 @@ export const apiClient = {
   getDevice: (id: string) =>
     api.get(`/devices/${id}`),
 
+  // Last `hours` (max 24) averaged per server cache bucket, from memory; each row carries
+  // its reading count and AQI range (aqiMin/aqiMax)
+  getRecent: (id: string, hours = 24) =>
+    api.get(`/devices/${id}/recent`, { params: { hours } }),
+
   registerDevice: (data: { name: string; latitude?: number; longitude?: number; areaName?: string }) =>
     api.post('/devices/register', data),
 
@@ -0,0 +1,56 @@
+/**
+ * Client-side LTTB (Largest-Triangle-Three-Buckets) for live-appended series.
+ * The server reduces the initial series (backend/src/lib/downsample.ts); this
+ * only keeps the chart bounded as SSE points arrive. Returns input indices.
+ */
+
+function allIndices(n: number): number[] {
+  return Array.from({ length: n }, (_, i) => i);
+}
+
+/**
+ * LTTB over x (timestamps, ascending) and y. Always keeps the first and last point.
+ */
+export function lttb(xs: ArrayLike<number>, ys: ArrayLike<number>, threshold: number): number[] {
+  const n = xs.length;
+  if (threshold >= n || threshold < 3) return allIndices(n);
+
+  const out: number[] = [0];
+  const every = (n - 2) / (threshold - 2);
+  let a = 0;
+
+  for (let i = 0; i < threshold - 2; i++) {
+    // Average of the next bucket is the third triangle vertex
+    const avgStart = Math.floor((i + 1) * every) + 1;
+    const avgEnd = Math.min(Math.floor((i + 2) * every) + 1, n);
+    let avgX = 0;
+    let avgY = 0;
+    for (let j = avgStart; j < avgEnd; j++) {
+      avgX += xs[j];
+      avgY += ys[j];
+    }
+    const avgLen = avgEnd - avgStart;
+    avgX /= avgLen;
+    avgY /= avgLen;
+
+    // Pick the point in this bucket forming the largest triangle with `a` and the average
+    const rangeStart = Math.floor(i * every) + 1;
+    const rangeEnd = Math.floor((i + 1) * every) + 1;
+    const ax = xs[a];
+    const ay = ys[a];
+    let maxArea = -1;
+    let next = rangeStart;
+    for (let j = rangeStart; j < rangeEnd; j++) {
+      const area = Math.abs((ax - avgX) * (ys[j] - ay) - (ax - xs[j]) * (avgY - ay));
+      if (area > maxArea) {
+        maxArea = area;
+        next = j;
+      }
+    }
+    out.push(next);
+    a = next;
+  }
+
+  out.push(n - 1);
+  return out;
+}
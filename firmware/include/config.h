@@ -7,7 +7,8 @@
 
 // Device Identity
 #define DEVICE_ID "AERO-ROURKELA-01"  // Unique per device
-#define DEVICE_KEY "kGj3@z7P!qT9$L8rVb2mXyW4sN6fC1eH"  // Provision from backend
+#define DEVICE_KEY "kGj3@z7P!qT9$L8rVb2mXyW4sN6fC1eH"  // Fallback when no key is provisioned in NVS
+#define DEVICE_KEY_NVS_NAMESPACE "aeroguard"  // Preferences namespace holding the provisioned key
 #define FIRMWARE_VERSION "1.2.0"
 
 // WiFi Provisioning (WiFiManager will override if not configured)
@@ -22,11 +23,13 @@
   #define MQTT_PORT 8883  // TLS
   #define MQTT_USER "aeroguard"
   #define MQTT_PASS "your-mqtt-password"
-  #define MQTT_TOPIC_PUB "aeroguard/measurements"
+  #define MQTT_TOPIC_PUB "aeroguard/measurements/" DEVICE_ID  // Per-device topic keeps a device on one consumer
   #define MQTT_TOPIC_SUB "aeroguard/commands"
+  #define MQTT_BUFFER_SIZE 1024  // Packet buffer; must hold a signed reading
 #else
   #define API_ENDPOINT "http://192.168.1.50:3000/api/v1/ingest"
   #define API_TIMEOUT 10000  // ms
+  #define MAX_REDIRECTS 2    // Cluster owner redirects followed per POST
 #endif
 
 // Pin Definitions
@@ -65,6 +68,58 @@
 
 // Security
 #define ENABLE_HMAC true  // Sign payloads with HMAC-SHA256
+#define CRYPTO_BENCH false  // Print software vs hardware HMAC/AES timings (300 B - 32 KB) at boot
+
+// TLS Memory: serve mbedTLS allocations from fixed-size pools reserved at boot (~92 KB).
+// Installed only when the board has PSRAM; without it mbedTLS keeps using the heap.
+#define TLS_POOL_ENABLE true
+#define TLS_POOL_INTERNAL false   // Also reserve them in internal RAM on boards without PSRAM
+
+// TLS Verification for the HTTPS uplink: TLS_VERIFY_INSECURE (no checks, demo only),
+// TLS_VERIFY_CHAIN (full chain against TLS_CA_CERT) or TLS_VERIFY_PINNED (server public key).
+// The default checks the chain against ISRG Root X1 (Let's Encrypt); pin the server key for
+// the fastest handshakes. Not used by USE_MQTT builds.
+#define TLS_VERIFY_MODE TLS_VERIFY_CHAIN
+// SHA-256 of the server's SubjectPublicKeyInfo as hex:
+//   openssl s_client -connect HOST:443 </dev/null | openssl x509 -pubkey -noout |
+//   openssl pkey -pubin -outform der | openssl dgst -sha256
+#define TLS_PIN_SHA256 ""              // Required in pinned mode: the build fails until it is set
+#define TLS_PIN_SHA256_BACKUP ""       // Next server key, so a key rotation doesn't strand nodes
+// PEM root CA for TLS_VERIFY_CHAIN (required in that mode): ISRG Root X1, valid until 2035
+#define TLS_CA_CERT \
+  "-----BEGIN CERTIFICATE-----\n" \
+  "MIIFazCCA1OgAwIBAgIRAIIQz7DSQONZRGPgu2OCiwAwDQYJKoZIhvcNAQELBQAw\n" \
+  "TzELMAkGA1UEBhMCVVMxKTAnBgNVBAoTIEludGVybmV0IFNlY3VyaXR5IFJlc2Vh\n" \
+  "cmNoIEdyb3VwMRUwEwYDVQQDEwxJU1JHIFJvb3QgWDEwHhcNMTUwNjA0MTEwNDM4\n" \
+  "WhcNMzUwNjA0MTEwNDM4WjBPMQswCQYDVQQGEwJVUzEpMCcGA1UEChMgSW50ZXJu\n" \
+  "ZXQgU2VjdXJpdHkgUmVzZWFyY2ggR3JvdXAxFTATBgNVBAMTDElTUkcgUm9vdCBY\n" \
+  "MTCCAiIwDQYJKoZIhvcNAQEBBQADggIPADCCAgoCggIBAK3oJHP0FDfzm54rVygc\n" \
+  "h77ct984kIxuPOZXoHj3dcKi/vVqbvYATyjb3miGbESTtrFj/RQSa78f0uoxmyF+\n" \
+  "0TM8ukj13Xnfs7j/EvEhmkvBioZxaUpmZmyPfjxwv60pIgbz5MDmgK7iS4+3mX6U\n" \
+  "A5/TR5d8mUgjU+g4rk8Kb4Mu0UlXjIB0ttov0DiNewNwIRt18jA8+o+u3dpjq+sW\n" \
+  "T8KOEUt+zwvo/7V3LvSye0rgTBIlDHCNAymg4VMk7BPZ7hm/ELNKjD+Jo2FR3qyH\n" \
+  "B5T0Y3HsLuJvW5iB4YlcNHlsdu87kGJ55tukmi8mxdAQ4Q7e2RCOFvu396j3x+UC\n" \
+  "B5iPNgiV5+I3lg02dZ77DnKxHZu8A/lJBdiB3QW0KtZB6awBdpUKD9jf1b0SHzUv\n" \
+  "KBds0pjBqAlkd25HN7rOrFleaJ1/ctaJxQZBKT5ZPt0m9STJEadao0xAH0ahmbWn\n" \
+  "OlFuhjuefXKnEgV4We0+UXgVCwOPjdAvBbI+e0ocS3MFEvzG6uBQE3xDk3SzynTn\n" \
+  "jh8BCNAw1FtxNrQHusEwMFxIt4I7mKZ9YIqioymCzLq9gwQbooMDQaHWBfEbwrbw\n" \
+  "qHyGO0aoSCqI3Haadr8faqU9GY/rOPNk3sgrDQoo//fb4hVC1CLQJ13hef4Y53CI\n" \
+  "rU7m2Ys6xt0nUW7/vGT1M0NPAgMBAAGjQjBAMA4GA1UdDwEB/wQEAwIBBjAPBgNV\n" \
+  "HRMBAf8EBTADAQH/MB0GA1UdDgQWBBR5tFnme7bl5AFzgAiIyBpY9umbbjANBgkq\n" \
+  "hkiG9w0BAQsFAAOCAgEAVR9YqbyyqFDQDLHYGmkgJykIrGF1XIpu+ILlaS/V9lZL\n" \
+  "ubhzEFnTIZd+50xx+7LSYK05qAvqFyFWhfFQDlnrzuBZ6brJFe+GnY+EgPbk6ZGQ\n" \
+  "3BebYhtF8GaV0nxvwuo77x/Py9auJ/GpsMiu/X1+mvoiBOv/2X/qkSsisRcOj/KK\n" \
+  "NFtY2PwByVS5uCbMiogziUwthDyC3+6WVwW6LLv3xLfHTjuCvjHIInNzktHCgKQ5\n" \
+  "ORAzI4JMPJ+GslWYHb4phowim57iaztXOoJwTdwJx4nLCgdNbOhdjsnvzqvHu7Ur\n" \
+  "TkXWStAmzOVyyghqpZXjFaH3pO3JLF+l+/+sKAIuvtd7u+Nxe5AW0wdeRlN8NwdC\n" \
+  "jNPElpzVmbUq4JUagEiuTDkHzsxHpFKVK7q4+63SM1N95R1NbdWhscdCb+ZAJzVc\n" \
+  "oyi3B43njTOQ5yOf+1CceWxG1bQVs5ZufpsMljq4Ui0/1lvh+wjChP4kqKOJ2qxq\n" \
+  "4RgqsahDYVvTH9w7jXbyLeiNdd8XM2w9U/t7y0Ff/9yi0GE44Za4rF2LN9d11TPA\n" \
+  "mRGunUHBcnWEvgJBQl9nJEiU0Zsnvgc/ubhPgXRR4Xq37Z0j4r7g1SgEEzwxA57d\n" \
+  "emyPxgcYxn/eR44/KJ4EBs+lVDR3veyJm+kXQ99b21/+jh5Xos1AnX5iItreGCc=\n" \
+  "-----END CERTIFICATE-----\n"
+#define TLS_HANDSHAKE_BENCH false      // Time full/resumed handshakes in every mode at boot
+#define TLS_HANDSHAKE_BENCH_ROUNDS 6
 
 // NTP
 #define NTP_SERVER "pool.ntp.org"
@@ -74,6 +129,26 @@
 // Retry Logic
 #define MAX_RETRIES 3
 #define RETRY_DELAY_MS 5000
+#define BACKOFF_DEFAULT_SEC 30   // When a 429/503 carries no Retry-After
+#define BACKOFF_MAX_SEC 600      // Cap on server-requested backoff
+
+// Sensor Trace Recorder: stream raw samples as binary frames over Serial
+// instead of sampling/transmitting (replay with scripts/trace-replay.js)
+#define TRACE_RECORDER false
+#define TRACE_MQ135_INTERVAL_MS 100
+#define TRACE_DHT_INTERVAL_MS 2000   // DHT22 minimum read interval
+#define TRACE_BMP_INTERVAL_MS 1000
+#define TRACE_FLUSH_MS 5000          // Partial frames go out at least this often
+
+// Priority Alerts: IAQ is re-checked between samples; band changes (GOOD/FAIR/POOR)
+// and threshold breaches are sent at once, ahead of buffered records
+#define ALERT_CHECK_INTERVAL_MS 5000
+#define ALERT_CHECK_SAMPLES 3        // ADC reads per quick check (median)
+#define ALERT_IAQ_THRESHOLD 250      // Alerts even without a band change
+#define ALERT_CO2_THRESHOLD 2000     // ppm (CO2 equivalent)
+#define ALERT_MIN_INTERVAL_MS 30000  // Band-change debounce at a band edge
+#define ALERT_RETRY_MS 5000          // Retry spacing while the link is down
+#define ALERT_QUEUE_SIZE 4
 
 // Local Storage (ring buffer for offline)
 #define OFFLINE_BUFFER_SIZE 50
@@ -0,0 +1,373 @@
+#include "CryptoBackend.h"
+
+#if defined(ESP_PLATFORM)
+  #include <esp_heap_caps.h>
+  #include <aes/esp_aes.h>
+  #if CONFIG_IDF_TARGET_ESP32
+    #include <sha/sha_parallel_engine.h>
+  #else
+    #include <sha/sha_dma.h>
+  #endif
+  #define CRYPTO_HAS_HARDWARE 1
+#else
+  #define CRYPTO_HAS_HARDWARE 0
+#endif
+
+// Hardware HMAC hashes (key ^ pad || message) in one engine call; messages up to
+// this size are staged on the stack, larger batches on the heap
+#define CRYPTO_STACK_MSG_BYTES 1024
+
+static CryptoEngine selected = CRYPTO_SOFTWARE;
+static bool hardwareVerified = false;
+
+// ============================================================================
+// SOFTWARE SHA-256 (FIPS 180-4)
+// ============================================================================
+static const uint32_t K256[64] = {
+  0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+  0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+  0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+  0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+  0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+  0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+  0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+  0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+static inline uint32_t ror(uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+static void sha256Block(uint32_t *state, const uint8_t *p) {
+  uint32_t w[64];
+  for (int i = 0; i < 16; i++) {
+    w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+  }
+  for (int i = 16; i < 64; i++) {
+    uint32_t s0 = ror(w[i - 15], 7) ^ ror(w[i - 15], 18) ^ (w[i - 15] >> 3);
+    uint32_t s1 = ror(w[i - 2], 17) ^ ror(w[i - 2], 19) ^ (w[i - 2] >> 10);
+    w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+  }
+  uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+  uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+  for (int i = 0; i < 64; i++) {
+    uint32_t t1 = h + (ror(e, 6) ^ ror(e, 11) ^ ror(e, 25)) + ((e & f) ^ (~e & g)) + K256[i] + w[i];
+    uint32_t t2 = (ror(a, 2) ^ ror(a, 13) ^ ror(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+    h = g; g = f; f = e; e = d + t1;
+    d = c; c = b; b = a; a = t1 + t2;
+  }
+  state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+  state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void cryptoSha256Start(CryptoSha256 &ctx) {
+  static const uint32_t iv[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+  memcpy(ctx.state, iv, sizeof(iv));
+  ctx.bytes = 0;
+  ctx.used = 0;
+}
+
+void cryptoSha256Update(CryptoSha256 &ctx, const uint8_t *data, size_t len) {
+  ctx.bytes += len;
+  if (ctx.used) {
+    size_t take = min(len, (size_t)(64 - ctx.used));
+    memcpy(ctx.block + ctx.used, data, take);
+    ctx.used += take;
+    data += take;
+    len -= take;
+    if (ctx.used < 64) return;
+    sha256Block(ctx.state, ctx.block);
+    ctx.used = 0;
+  }
+  for (; len >= 64; data += 64, len -= 64) sha256Block(ctx.state, data);
+  memcpy(ctx.block, data, len);
+  ctx.used = len;
+}
+
+void cryptoSha256Finish(CryptoSha256 &ctx, uint8_t out[CRYPTO_SHA256_BYTES]) {
+  uint64_t bits = ctx.bytes * 8;
+  ctx.block[ctx.used++] = 0x80;
+  if (ctx.used > 56) {
+    memset(ctx.block + ctx.used, 0, 64 - ctx.used);
+    sha256Block(ctx.state, ctx.block);
+    ctx.used = 0;
+  }
+  memset(ctx.block + ctx.used, 0, 56 - ctx.used);
+  for (int i = 0; i < 8; i++) ctx.block[56 + i] = (uint8_t)(bits >> (56 - 8 * i));
+  sha256Block(ctx.state, ctx.block);
+  for (int i = 0; i < 8; i++) {
+    out[i * 4] = ctx.state[i] >> 24;
+    out[i * 4 + 1] = ctx.state[i] >> 16;
+    out[i * 4 + 2] = ctx.state[i] >> 8;
+    out[i * 4 + 3] = ctx.state[i];
+  }
+}
+
+// ============================================================================
+// SOFTWARE AES-128 (FIPS 197, encryption only; CTR needs nothing else)
+// ============================================================================
+static const uint8_t SBOX[256] = {
+  0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+  0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+  0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+  0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+  0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+  0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+  0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+  0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+  0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+  0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+  0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+  0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+  0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+  0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+  0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+  0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+static inline uint8_t xtime(uint8_t x) { return (x << 1) ^ ((x & 0x80) ? 0x1b : 0); }
+
+static void aesExpandKey(const uint8_t *key, uint8_t *rk) {
+  memcpy(rk, key, 16);
+  uint8_t rcon = 1;
+  for (int i = 16; i < 176; i += 4) {
+    uint8_t t[4] = {rk[i - 4], rk[i - 3], rk[i - 2], rk[i - 1]};
+    if (i % 16 == 0) {
+      uint8_t first = t[0];
+      t[0] = SBOX[t[1]] ^ rcon;
+      t[1] = SBOX[t[2]];
+      t[2] = SBOX[t[3]];
+      t[3] = SBOX[first];
+      rcon = xtime(rcon);
+    }
+    for (int j = 0; j < 4; j++) rk[i + j] = rk[i - 16 + j] ^ t[j];
+  }
+}
+
+static void aesEncryptBlock(const uint8_t *rk, const uint8_t *in, uint8_t *out) {
+  uint8_t s[16];
+  for (int i = 0; i < 16; i++) s[i] = in[i] ^ rk[i];
+  for (int round = 1; round <= 10; round++) {
+    uint8_t t[16];
+    // SubBytes + ShiftRows (state is column-major)
+    for (int c = 0; c < 4; c++) {
+      for (int r = 0; r < 4; r++) t[c * 4 + r] = SBOX[s[((c + r) % 4) * 4 + r]];
+    }
+    if (round < 10) {
+      for (int c = 0; c < 4; c++) {
+        uint8_t *col = t + c * 4;
+        uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+        uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+        col[0] ^= all ^ xtime(a0 ^ a1);
+        col[1] ^= all ^ xtime(a1 ^ a2);
+        col[2] ^= all ^ xtime(a2 ^ a3);
+        col[3] ^= all ^ xtime(a3 ^ a0);
+      }
+    }
+    for (int i = 0; i < 16; i++) s[i] = t[i] ^ rk[round * 16 + i];
+  }
+  memcpy(out, s, 16);
+}
+
+static void counterIncrement(uint8_t *counter) {
+  for (int i = CRYPTO_AES_BLOCK_BYTES - 1; i >= 0 && ++counter[i] == 0; i--) {}
+}
+
+// ============================================================================
+// ENGINE DISPATCH
+// ============================================================================
+static void hardwareSha256(const uint8_t *data, size_t len, uint8_t *out) {
+#if CRYPTO_HAS_HARDWARE
+  esp_sha(SHA2_256, data, len, out);  // Blocks until the engine lock is free
+#else
+  CryptoSha256 ctx;
+  cryptoSha256Start(ctx);
+  cryptoSha256Update(ctx, data, len);
+  cryptoSha256Finish(ctx, out);
+#endif
+}
+
+void cryptoSha256(const uint8_t *data, size_t len, uint8_t out[CRYPTO_SHA256_BYTES], CryptoEngine engine) {
+  if (engine == CRYPTO_HARDWARE && CRYPTO_HAS_HARDWARE) {
+    hardwareSha256(data, len, out);
+    return;
+  }
+  CryptoSha256 ctx;
+  cryptoSha256Start(ctx);
+  cryptoSha256Update(ctx, data, len);
+  cryptoSha256Finish(ctx, out);
+}
+
+// Inner HMAC hash on the engine: (key ^ ipad || message) staged contiguously
+static bool hardwareHmacInner(const uint8_t *ipad, const uint8_t *msg, size_t len, uint8_t *inner) {
+  uint8_t stackBuf[64 + CRYPTO_STACK_MSG_BYTES];
+  uint8_t *staged = len <= CRYPTO_STACK_MSG_BYTES ? stackBuf : (uint8_t *)malloc(64 + len);
+  if (!staged) return false;
+  memcpy(staged, ipad, 64);
+  memcpy(staged + 64, msg, len);
+  hardwareSha256(staged, 64 + len, inner);
+  if (staged != stackBuf) free(staged);
+  return true;
+}
+
+void cryptoHmacSha256(const uint8_t *key, size_t keyLen, const uint8_t *msg, size_t len,
+                      uint8_t out[CRYPTO_SHA256_BYTES], CryptoEngine engine) {
+  uint8_t k[64] = {0};
+  if (keyLen > 64) cryptoSha256(key, keyLen, k, engine);
+  else memcpy(k, key, keyLen);
+
+  uint8_t pad[64 + CRYPTO_SHA256_BYTES];
+  for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x36;
+
+  uint8_t inner[CRYPTO_SHA256_BYTES];
+  bool hardware = engine == CRYPTO_HARDWARE && CRYPTO_HAS_HARDWARE;
+  // No room to stage a large batch: hash it in software rather than fail
+  if (hardware) hardware = hardwareHmacInner(pad, msg, len, inner);
+  if (!hardware) {
+    CryptoSha256 ctx;
+    cryptoSha256Start(ctx);
+    cryptoSha256Update(ctx, pad, 64);
+    cryptoSha256Update(ctx, msg, len);
+    cryptoSha256Finish(ctx, inner);
+  }
+
+  for (int i = 0; i < 64; i++) pad[i] = k[i] ^ 0x5c;
+  memcpy(pad + 64, inner, CRYPTO_SHA256_BYTES);
+  cryptoSha256(pad, sizeof(pad), out, hardware ? CRYPTO_HARDWARE : CRYPTO_SOFTWARE);
+}
+
+void cryptoAesCtr(const uint8_t key[CRYPTO_AES_KEY_BYTES], uint8_t counter[CRYPTO_AES_BLOCK_BYTES],
+                  const uint8_t *in, uint8_t *out, size_t len, CryptoEngine engine) {
+#if CRYPTO_HAS_HARDWARE
+  if (engine == CRYPTO_HARDWARE) {
+    esp_aes_context ctx;
+    esp_aes_init(&ctx);
+    esp_aes_setkey(&ctx, key, CRYPTO_AES_KEY_BYTES * 8);
+    size_t offset = 0;
+    uint8_t stream[CRYPTO_AES_BLOCK_BYTES];
+    esp_aes_crypt_ctr(&ctx, len, &offset, counter, stream, in, out);
+    esp_aes_free(&ctx);
+    return;
+  }
+#endif
+  (void)engine;
+  uint8_t rk[176], stream[CRYPTO_AES_BLOCK_BYTES];
+  aesExpandKey(key, rk);
+  for (size_t done = 0; done < len; done += CRYPTO_AES_BLOCK_BYTES) {
+    aesEncryptBlock(rk, counter, stream);
+    counterIncrement(counter);
+    size_t n = min(len - done, (size_t)CRYPTO_AES_BLOCK_BYTES);
+    for (size_t i = 0; i < n; i++) out[done + i] = in[done + i] ^ stream[i];
+  }
+}
+
+// ============================================================================
+// SELF-TEST & SELECTION
+// ============================================================================
+// RFC 4231 test case 2 and the FIPS 197 / SP 800-38A F.5.1 AES-128-CTR vector
+static bool knownAnswers(CryptoEngine engine) {
+  static const uint8_t hmacExpected[CRYPTO_SHA256_BYTES] = {
+    0x5b, 0xdc, 0xc1, 0x46, 0xbf, 0x60, 0x75, 0x4e, 0x6a, 0x04, 0x24, 0x26, 0x08, 0x95, 0x75, 0xc7,
+    0x5a, 0x00, 0x3f, 0x08, 0x9d, 0x27, 0x39, 0x83, 0x9d, 0xec, 0x58, 0xb9, 0x64, 0xec, 0x38, 0x43
+  };
+  uint8_t mac[CRYPTO_SHA256_BYTES];
+  const char *msg = "what do ya want for nothing?";
+  cryptoHmacSha256((const uint8_t *)"Jefe", 4, (const uint8_t *)msg, strlen(msg), mac, engine);
+  if (memcmp(mac, hmacExpected, sizeof(mac)) != 0) return false;
+
+  static const uint8_t key[16] = {0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                  0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c};
+  static const uint8_t plain[16] = {0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96,
+                                    0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a};
+  static const uint8_t cipherExpected[16] = {0x87, 0x4d, 0x61, 0x91, 0xb6, 0x20, 0xe3, 0x26,
+                                             0x1b, 0xef, 0x68, 0x64, 0x99, 0x0d, 0xb6, 0xce};
+  uint8_t counter[16] = {0xf0, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7,
+                         0xf8, 0xf9, 0xfa, 0xfb, 0xfc, 0xfd, 0xfe, 0xff};
+  uint8_t cipher[16];
+  cryptoAesCtr(key, counter, plain, cipher, sizeof(plain), engine);
+  return memcmp(cipher, cipherExpected, sizeof(cipher)) == 0;
+}
+
+bool cryptoBegin() {
+  if (!knownAnswers(CRYPTO_SOFTWARE)) {
+    Serial.println("[CRYPTO] Software self-test FAILED");
+    return false;
+  }
+#if CRYPTO_HAS_HARDWARE
+  hardwareVerified = knownAnswers(CRYPTO_HARDWARE);
+  if (!hardwareVerified) Serial.println("[CRYPTO] Hardware self-test failed, signing in software");
+#endif
+  selected = hardwareVerified ? CRYPTO_HARDWARE : CRYPTO_SOFTWARE;
+
+#if defined(CONFIG_MBEDTLS_HARDWARE_SHA) && defined(CONFIG_MBEDTLS_HARDWARE_AES)
+  const char *tls = "hardware SHA/AES";
+#elif defined(CONFIG_MBEDTLS_HARDWARE_SHA) || defined(CONFIG_MBEDTLS_HARDWARE_AES)
+  const char *tls = "partly hardware";
+#else
+  const char *tls = "software";
+#endif
+  Serial.printf("[CRYPTO] Signing: %s (self-test passed), TLS: %s\n", cryptoEngineName(selected), tls);
+  return true;
+}
+
+CryptoEngine cryptoEngine() {
+  return selected;
+}
+
+bool cryptoHardwareAvailable() {
+  return hardwareVerified;
+}
+
+const char *cryptoEngineName(CryptoEngine engine) {
+  return engine == CRYPTO_HARDWARE ? "hardware" : "software";
+}
+
+// ============================================================================
+// BENCHMARK
+// ============================================================================
+static uint32_t timeHmac(const uint8_t *buf, size_t len, uint16_t iterations, CryptoEngine engine) {
+  uint8_t mac[CRYPTO_SHA256_BYTES];
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < iterations; i++) cryptoHmacSha256(buf, 32, buf, len, mac, engine);
+  return (micros() - start) / iterations;
+}
+
+static uint32_t timeAes(uint8_t *buf, size_t len, uint16_t iterations, CryptoEngine engine) {
+  uint8_t counter[CRYPTO_AES_BLOCK_BYTES] = {0};
+  uint32_t start = micros();
+  for (uint16_t i = 0; i < iterations; i++) cryptoAesCtr(buf, counter, buf, buf, len, engine);
+  return (micros() - start) / iterations;
+}
+
+void cryptoBench(Print &out) {
+  static const size_t sizes[] = {300, 1024, 4096, 16384, 32768};
+  const size_t maxLen = 32768;
+#if CRYPTO_HAS_HARDWARE
+  uint8_t *buf = (uint8_t *)heap_caps_malloc(maxLen, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#else
+  uint8_t *buf = (uint8_t *)malloc(maxLen);
+#endif
+  if (!buf) {
+    out.println("[CRYPTO] Bench skipped, no 32 KB buffer");
+    return;
+  }
+  for (size_t i = 0; i < maxLen; i++) buf[i] = (uint8_t)(i * 31 + 7);
+
+  out.println("[CRYPTO] Bench, us per op (speedup):");
+  out.println("[CRYPTO]    bytes   hmac-sw   hmac-hw            aes-sw    aes-hw");
+  for (size_t len : sizes) {
+    uint16_t iterations = max((size_t)4, (size_t)65536 / len);
+    uint32_t hmacSw = timeHmac(buf, len, iterations, CRYPTO_SOFTWARE);
+    uint32_t aesSw = timeAes(buf, len, iterations, CRYPTO_SOFTWARE);
+    if (hardwareVerified) {
+      uint32_t hmacHw = timeHmac(buf, len, iterations, CRYPTO_HARDWARE);
+      uint32_t aesHw = timeAes(buf, len, iterations, CRYPTO_HARDWARE);
+      out.printf("[CRYPTO] %8u %9u %9u (%4.1fx) %9u %9u (%4.1fx)\n", (unsigned)len, (unsigned)hmacSw,
+                 (unsigned)hmacHw, hmacHw ? (float)hmacSw / hmacHw : 0.0f, (unsigned)aesSw, (unsigned)aesHw,
+                 aesHw ? (float)aesSw / aesHw : 0.0f);
+    } else {
+      out.printf("[CRYPTO] %8u %9u %9s          %9u %9s\n", (unsigned)len, (unsigned)hmacSw, "-",
+                 (unsigned)aesSw, "-");
+    }
+  }
+  free(buf);
+}
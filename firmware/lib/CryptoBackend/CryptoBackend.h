@@ -0,0 +1,54 @@
+#ifndef CRYPTOBACKEND_H
+#define CRYPTOBACKEND_H
+
+#include <Arduino.h>
+
+// SHA-256 / HMAC-SHA256 / AES-128-CTR with an explicit engine choice: the ESP32
+// SHA and AES peripherals, or portable software (the only engine off-target).
+// cryptoBegin() runs known-answer tests on both engines and selects hardware
+// only if it is compiled in and produces the right digests, so the signer never
+// silently ends up on a path nobody checked. mbedTLS (and with it TLS) uses the
+// same peripherals when built with CONFIG_MBEDTLS_HARDWARE_SHA/AES; the hardware
+// calls here block on the same engine locks, so never use CRYPTO_HARDWARE from code
+// that runs inside an mbedTLS operation (e.g. a verify callback): the handshake may
+// already hold the engine and the call would never return.
+
+#define CRYPTO_SHA256_BYTES 32
+#define CRYPTO_AES_KEY_BYTES 16
+#define CRYPTO_AES_BLOCK_BYTES 16
+
+enum CryptoEngine : uint8_t {
+  CRYPTO_SOFTWARE = 0,
+  CRYPTO_HARDWARE = 1
+};
+
+// Incremental software SHA-256 (HMAC streams through this without copying the message)
+struct CryptoSha256 {
+  uint32_t state[8];
+  uint64_t bytes;
+  uint8_t block[64];
+  uint8_t used;
+};
+
+void cryptoSha256Start(CryptoSha256 &ctx);
+void cryptoSha256Update(CryptoSha256 &ctx, const uint8_t *data, size_t len);
+void cryptoSha256Finish(CryptoSha256 &ctx, uint8_t out[CRYPTO_SHA256_BYTES]);
+
+// Verify the engines and pick the default; call once at boot
+bool cryptoBegin();
+CryptoEngine cryptoEngine();
+bool cryptoHardwareAvailable();
+const char *cryptoEngineName(CryptoEngine engine);
+
+void cryptoSha256(const uint8_t *data, size_t len, uint8_t out[CRYPTO_SHA256_BYTES],
+                  CryptoEngine engine = cryptoEngine());
+void cryptoHmacSha256(const uint8_t *key, size_t keyLen, const uint8_t *msg, size_t len,
+                      uint8_t out[CRYPTO_SHA256_BYTES], CryptoEngine engine = cryptoEngine());
+// Encrypts/decrypts in place or out of place; counter is big-endian and advanced
+void cryptoAesCtr(const uint8_t key[CRYPTO_AES_KEY_BYTES], uint8_t counter[CRYPTO_AES_BLOCK_BYTES],
+                  const uint8_t *in, uint8_t *out, size_t len, CryptoEngine engine = cryptoEngine());
+
+// Software vs hardware HMAC-SHA256 and AES-128-CTR from 300 B to 32 KB
+void cryptoBench(Print &out);
+
+#endif
@@ -0,0 +1,365 @@
+#include "PinnedTls.h"
+#include <CryptoBackend.h>
+#include <mbedtls/ctr_drbg.h>
+#include <mbedtls/entropy.h>
+#include <mbedtls/error.h>
+#include <mbedtls/net_sockets.h>
+#include <mbedtls/x509_crt.h>
+
+#define TLS_PIN_BYTES 32
+
+static mbedtls_entropy_context entropy;
+static mbedtls_ctr_drbg_context ctrDrbg;
+static mbedtls_x509_crt caChain;
+static mbedtls_ssl_config configs[3];
+static bool configReady[3] = {false, false, false};
+static uint8_t pins[2][TLS_PIN_BYTES];
+static uint8_t pinCount = 0;
+static bool trustReady = false;
+
+static const char *modeName(TlsVerifyMode mode) {
+  switch (mode) {
+    case TLS_VERIFY_INSECURE: return "insecure";
+    case TLS_VERIFY_CHAIN: return "chain";
+    default: return "pinned";
+  }
+}
+
+static bool parsePin(const char *hex, uint8_t *out) {
+  if (!hex || strlen(hex) != TLS_PIN_BYTES * 2) return false;
+  for (int i = 0; i < TLS_PIN_BYTES; i++) {
+    char byteHex[3] = {hex[i * 2], hex[i * 2 + 1], 0};
+    char *end;
+    out[i] = (uint8_t)strtoul(byteHex, &end, 16);
+    if (*end) return false;
+  }
+  return true;
+}
+
+// Pinned mode: only the leaf's public key matters, so intermediates, expiry and
+// hostname flags are cleared and the leaf is trusted iff its SPKI hash is pinned
+static int verifyPin(void *, mbedtls_x509_crt *crt, int depth, uint32_t *flags) {
+  if (depth > 0) {
+    *flags = 0;
+    return 0;
+  }
+  uint8_t hash[TLS_PIN_BYTES];
+  // Software only: this runs inside the handshake, whose transcript hash may hold
+  // the SHA engine, and esp_sha() would wait on that lock forever
+  cryptoSha256(crt->pk_raw.p, crt->pk_raw.len, hash, CRYPTO_SOFTWARE);
+  *flags = MBEDTLS_X509_BADCERT_NOT_TRUSTED;
+  for (int i = 0; i < pinCount; i++) {
+    if (memcmp(hash, pins[i], TLS_PIN_BYTES) == 0) *flags = 0;
+  }
+  return 0;
+}
+
+static bool buildConfig(TlsVerifyMode mode) {
+  mbedtls_ssl_config &conf = configs[mode];
+  mbedtls_ssl_config_init(&conf);
+  if (mbedtls_ssl_config_defaults(&conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT) != 0) {
+    return false;
+  }
+  mbedtls_ssl_conf_rng(&conf, mbedtls_ctr_drbg_random, &ctrDrbg);
+  switch (mode) {
+    case TLS_VERIFY_INSECURE:
+      mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_NONE);
+      break;
+    case TLS_VERIFY_CHAIN:
+      mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+      mbedtls_ssl_conf_ca_chain(&conf, &caChain, NULL);
+      break;
+    case TLS_VERIFY_PINNED:
+      // REQUIRED refuses to run without a CA chain; the result is checked after the handshake
+      mbedtls_ssl_conf_authmode(&conf, MBEDTLS_SSL_VERIFY_OPTIONAL);
+      mbedtls_ssl_conf_verify(&conf, verifyPin, NULL);
+      break;
+  }
+  return true;
+}
+
+bool tlsTrustBegin(const char *caPem, const char *pinHex, const char *backupPinHex) {
+  if (trustReady) return true;
+
+  mbedtls_entropy_init(&entropy);
+  mbedtls_ctr_drbg_init(&ctrDrbg);
+  static const char pers[] = "aeroguard-tls";
+  if (mbedtls_ctr_drbg_seed(&ctrDrbg, mbedtls_entropy_func, &entropy,
+                            (const unsigned char *)pers, sizeof(pers) - 1) != 0) {
+    Serial.println("[TLS] RNG seed failed");
+    return false;
+  }
+
+  configReady[TLS_VERIFY_INSECURE] = buildConfig(TLS_VERIFY_INSECURE);
+
+  mbedtls_x509_crt_init(&caChain);
+  if (caPem && *caPem) {
+    int ret = mbedtls_x509_crt_parse(&caChain, (const unsigned char *)caPem, strlen(caPem) + 1);
+    if (ret == 0) {
+      configReady[TLS_VERIFY_CHAIN] = buildConfig(TLS_VERIFY_CHAIN);
+    } else {
+      Serial.printf("[TLS] CA certificate parse failed: -0x%04x\n", (unsigned)-ret);
+    }
+  }
+
+  if (parsePin(pinHex, pins[pinCount])) pinCount++;
+  else if (pinHex && *pinHex) Serial.println("[TLS] TLS_PIN_SHA256 is not 64 hex chars, ignored");
+  if (parsePin(backupPinHex, pins[pinCount])) pinCount++;
+  else if (backupPinHex && *backupPinHex) Serial.println("[TLS] Backup pin is not 64 hex chars, ignored");
+  if (pinCount > 0) configReady[TLS_VERIFY_PINNED] = buildConfig(TLS_VERIFY_PINNED);
+
+  trustReady = true;
+  Serial.printf("[TLS] Trust anchors ready: chain %s, %u pin(s)\n",
+                configReady[TLS_VERIFY_CHAIN] ? "yes" : "no", pinCount);
+  return true;
+}
+
+bool tlsModeAvailable(TlsVerifyMode mode) {
+  return trustReady && mode <= TLS_VERIFY_PINNED && configReady[mode];
+}
+
+// ============================================================================
+// CLIENT
+// ============================================================================
+PinnedTlsClient::PinnedTlsClient(TlsVerifyMode mode)
+    : _sessionPort(0), _mode(mode), _stats(), _peeked(-1), _sslInit(false), _ready(false),
+      _hasSession(false), _resumed(false) {
+  mbedtls_ssl_session_init(&_session);
+}
+
+PinnedTlsClient::~PinnedTlsClient() {
+  stop();
+  mbedtls_ssl_session_free(&_session);
+}
+
+void PinnedTlsClient::setMode(TlsVerifyMode mode) {
+  if (mode == _mode) return;
+  stop();
+  forgetSession();
+  _mode = mode;
+}
+
+void PinnedTlsClient::forgetSession() {
+  mbedtls_ssl_session_free(&_session);
+  mbedtls_ssl_session_init(&_session);
+  _hasSession = false;
+}
+
+int PinnedTlsClient::bioSend(void *ctx, const unsigned char *buf, size_t len) {
+  WiFiClient *tcp = (WiFiClient *)ctx;
+  size_t n = tcp->write(buf, len);
+  return n > 0 ? (int)n : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+int PinnedTlsClient::bioRecv(void *ctx, unsigned char *buf, size_t len) {
+  WiFiClient *tcp = (WiFiClient *)ctx;
+  if (!tcp->available()) return tcp->connected() ? MBEDTLS_ERR_SSL_WANT_READ : MBEDTLS_ERR_NET_CONN_RESET;
+  int n = tcp->read(buf, len);
+  return n > 0 ? n : MBEDTLS_ERR_SSL_WANT_READ;
+}
+
+void PinnedTlsClient::fail(int ret) {
+  char err[64];
+  mbedtls_strerror(ret, err, sizeof(err));
+  Serial.printf("[TLS] Handshake failed (%s): -0x%04x %s\n", modeName(_mode), (unsigned)-ret, err);
+  _stats.failed++;
+  stop();
+}
+
+bool PinnedTlsClient::handshake(const char *host, uint16_t port, int32_t timeout) {
+  mbedtls_ssl_init(&_ssl);
+  _sslInit = true;
+  int ret = mbedtls_ssl_setup(&_ssl, &configs[_mode]);
+  if (ret == 0) ret = mbedtls_ssl_set_hostname(&_ssl, host);
+  if (ret != 0) {
+    fail(ret);
+    return false;
+  }
+  mbedtls_ssl_set_bio(&_ssl, &_tcp, bioSend, bioRecv, NULL);
+
+  bool offered = _hasSession && _sessionPort == port && _sessionHost == host;
+  if (offered) mbedtls_ssl_set_session(&_ssl, &_session);
+
+  // Stepped by hand so we can tell whether the server sent its certificate,
+  // i.e. whether this was a full handshake or a resumed session
+  bool sawCertificate = false;
+  uint32_t start = millis();
+  while (_ssl.state != MBEDTLS_SSL_HANDSHAKE_OVER) {
+    if (_ssl.state == MBEDTLS_SSL_SERVER_CERTIFICATE) sawCertificate = true;
+    ret = mbedtls_ssl_handshake_step(&_ssl);
+    if (ret == 0) continue;
+    if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) break;
+    if (millis() - start > (uint32_t)timeout) {
+      ret = MBEDTLS_ERR_SSL_TIMEOUT;
+      break;
+    }
+    ret = 0;
+    delay(1);
+  }
+  uint32_t ms = millis() - start;
+
+  if (ret == 0 && _mode != TLS_VERIFY_INSECURE && mbedtls_ssl_get_verify_result(&_ssl) != 0) {
+    ret = MBEDTLS_ERR_X509_CERT_VERIFY_FAILED;  // Pin mismatch; nothing has been sent yet
+  }
+  if (ret != 0) {
+    if (offered) forgetSession();
+    fail(ret);
+    return false;
+  }
+
+  _resumed = !sawCertificate;
+  _stats.lastMs = ms;
+  if (_resumed) {
+    _stats.resumed++;
+    _stats.resumedMsTotal += ms;
+  } else {
+    _stats.full++;
+    _stats.fullMsTotal += ms;
+  }
+
+  // Keep the (possibly re-ticketed) session for the next connection
+  forgetSession();
+  if (mbedtls_ssl_get_session(&_ssl, &_session) == 0) {
+    _hasSession = true;
+    _sessionHost = host;
+    _sessionPort = port;
+  }
+  return true;
+}
+
+int PinnedTlsClient::connect(const char *host, uint16_t port, int32_t timeout) {
+  stop();
+  if (!tlsModeAvailable(_mode)) {
+    Serial.printf("[TLS] Mode %s not configured, check TLS settings in config.h\n", modeName(_mode));
+    return 0;
+  }
+  if (!_tcp.connect(host, port, timeout)) return 0;
+  if (!handshake(host, port, timeout)) return 0;
+  _ready = true;
+  Serial.printf("[TLS] Handshake %u ms (%s, %s)\n", (unsigned)_stats.lastMs, modeName(_mode),
+                _resumed ? "resumed" : "full");
+  return 1;
+}
+
+int PinnedTlsClient::connect(const char *host, uint16_t port) {
+  return connect(host, port, TLS_HANDSHAKE_TIMEOUT_MS);
+}
+
+int PinnedTlsClient::connect(IPAddress ip, uint16_t port, int32_t timeout) {
+  return connect(ip.toString().c_str(), port, timeout);
+}
+
+int PinnedTlsClient::connect(IPAddress ip, uint16_t port) {
+  return connect(ip, port, TLS_HANDSHAKE_TIMEOUT_MS);
+}
+
+size_t PinnedTlsClient::write(const uint8_t *buf, size_t size) {
+  if (!_ready) return 0;
+  size_t sent = 0;
+  uint32_t start = millis();
+  while (sent < size) {
+    int ret = mbedtls_ssl_write(&_ssl, buf + sent, size - sent);
+    if (ret > 0) {
+      sent += ret;
+      continue;
+    }
+    if ((ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) ||
+        millis() - start > getTimeout()) {
+      stop();
+      break;
+    }
+    delay(1);
+  }
+  return sent;
+}
+
+size_t PinnedTlsClient::write(uint8_t b) {
+  return write(&b, 1);
+}
+
+int PinnedTlsClient::available() {
+  if (!_ready) return 0;
+  int pending = _peeked >= 0 ? 1 : 0;
+  if (mbedtls_ssl_get_bytes_avail(&_ssl) == 0) {
+    // Pull the next record through mbedTLS so its plaintext becomes countable
+    int ret = mbedtls_ssl_read(&_ssl, NULL, 0);
+    if (ret < 0 && ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
+      stop();
+      return pending;
+    }
+  }
+  return pending + (int)mbedtls_ssl_get_bytes_avail(&_ssl);
+}
+
+int PinnedTlsClient::read(uint8_t *buf, size_t size) {
+  if (size == 0 || !available()) return -1;
+  size_t n = 0;
+  if (_peeked >= 0) {
+    buf[n++] = (uint8_t)_peeked;
+    _peeked = -1;
+  }
+  if (n < size && _ready && mbedtls_ssl_get_bytes_avail(&_ssl) > 0) {
+    int ret = mbedtls_ssl_read(&_ssl, buf + n, size - n);
+    if (ret > 0) n += ret;
+  }
+  return n > 0 ? (int)n : -1;
+}
+
+int PinnedTlsClient::read() {
+  uint8_t c;
+  return read(&c, 1) > 0 ? c : -1;
+}
+
+int PinnedTlsClient::peek() {
+  if (_peeked < 0) {
+    uint8_t c;
+    if (read(&c, 1) > 0) _peeked = c;
+  }
+  return _peeked;
+}
+
+void PinnedTlsClient::flush() {
+  // Records are written out synchronously; WiFiClient::flush() would discard unread ciphertext
+}
+
+void PinnedTlsClient::stop() {
+  if (_ready) mbedtls_ssl_close_notify(&_ssl);
+  if (_sslInit) mbedtls_ssl_free(&_ssl);
+  _sslInit = false;
+  _ready = false;
+  _peeked = -1;
+  _tcp.stop();
+}
+
+uint8_t PinnedTlsClient::connected() {
+  if (!_ready) return 0;
+  if (available() > 0) return 1;
+  return _ready && _tcp.connected();
+}
+
+// ============================================================================
+// HANDSHAKE BENCHMARK
+// ============================================================================
+void tlsHandshakeBench(const char *host, uint16_t port, uint8_t rounds, Print &out) {
+  out.printf("[TLS] Handshake bench: %s:%u, %u rounds per mode (even rounds full, odd resumed)\n",
+             host, port, rounds);
+  const TlsVerifyMode modes[] = {TLS_VERIFY_INSECURE, TLS_VERIFY_CHAIN, TLS_VERIFY_PINNED};
+  for (TlsVerifyMode mode : modes) {
+    if (!tlsModeAvailable(mode)) {
+      out.printf("[TLS]   %-8s not configured\n", modeName(mode));
+      continue;
+    }
+    PinnedTlsClient client(mode);
+    for (uint8_t r = 0; r < rounds; r++) {
+      if (r % 2 == 0) client.forgetSession();
+      client.connect(host, port);
+      client.stop();
+    }
+    const TlsHandshakeStats &s = client.stats();
+    out.printf("[TLS]   %-8s full %u ms avg (n=%u), resumed %u ms avg (n=%u), failed %u\n", modeName(mode),
+               s.full ? (unsigned)(s.fullMsTotal / s.full) : 0, (unsigned)s.full,
+               s.resumed ? (unsigned)(s.resumedMsTotal / s.resumed) : 0, (unsigned)s.resumed,
+               (unsigned)s.failed);
+  }
+}
@@ -0,0 +1,92 @@
+#ifndef PINNEDTLS_H
+#define PINNEDTLS_H
+
+#include <Arduino.h>
+#include <WiFiClient.h>
+#include <mbedtls/ssl.h>
+
+// TLS client over a WiFiClient socket with three verification modes. Trust
+// anchors (CA chain, public-key pins) are parsed once by tlsTrustBegin() and
+// shared by every connection through per-mode mbedTLS configs, and each client
+// keeps its last session so reconnects resume without re-verifying the server.
+// Written against mbedTLS 2.x as shipped with arduino-esp32 2.x.
+
+enum TlsVerifyMode : uint8_t {
+  TLS_VERIFY_INSECURE = 0,  // No verification (what setInsecure() did)
+  TLS_VERIFY_CHAIN = 1,     // Full chain against the CA and hostname check
+  TLS_VERIFY_PINNED = 2     // SHA-256 of the server's SubjectPublicKeyInfo must match a pin
+};
+
+#ifndef TLS_HANDSHAKE_TIMEOUT_MS
+  #define TLS_HANDSHAKE_TIMEOUT_MS 10000
+#endif
+
+struct TlsHandshakeStats {
+  uint32_t full;            // New sessions, server verified
+  uint32_t resumed;         // Abbreviated handshakes from the cached session
+  uint32_t failed;
+  uint32_t lastMs;
+  uint32_t fullMsTotal;
+  uint32_t resumedMsTotal;
+};
+
+// Parse the CA (PEM, may be empty) and pins (64 hex chars, backup may be empty)
+// and build the per-mode configs; call once at boot before the first connection
+bool tlsTrustBegin(const char *caPem, const char *pinHex, const char *backupPinHex);
+
+// Compile-time check for a pin literal: exactly 64 hex chars, for static_assert
+constexpr bool tlsPinIsHex(const char *hex, int i = 0) {
+  return i == 64 ? hex[i] == '\0'
+       : ((hex[i] >= '0' && hex[i] <= '9') || (hex[i] >= 'a' && hex[i] <= 'f') || (hex[i] >= 'A' && hex[i] <= 'F'))
+           && tlsPinIsHex(hex, i + 1);
+}
+bool tlsModeAvailable(TlsVerifyMode mode);
+
+class PinnedTlsClient : public WiFiClient {
+public:
+  PinnedTlsClient(TlsVerifyMode mode = TLS_VERIFY_PINNED);
+  ~PinnedTlsClient();
+
+  void setMode(TlsVerifyMode mode);  // Also forgets the cached session
+  void forgetSession();
+  bool lastResumed() const { return _resumed; }
+  const TlsHandshakeStats &stats() const { return _stats; }
+
+  int connect(IPAddress ip, uint16_t port);
+  int connect(IPAddress ip, uint16_t port, int32_t timeout);
+  int connect(const char *host, uint16_t port);
+  int connect(const char *host, uint16_t port, int32_t timeout);
+  size_t write(uint8_t b);
+  size_t write(const uint8_t *buf, size_t size);
+  int available();
+  int read();
+  int read(uint8_t *buf, size_t size);
+  int peek();
+  void flush();
+  void stop();
+  uint8_t connected();
+
+private:
+  bool handshake(const char *host, uint16_t port, int32_t timeout);
+  void fail(int ret);
+  static int bioSend(void *ctx, const unsigned char *buf, size_t len);
+  static int bioRecv(void *ctx, unsigned char *buf, size_t len);
+
+  WiFiClient _tcp;
+  mbedtls_ssl_context _ssl;
+  mbedtls_ssl_session _session;
+  String _sessionHost;
+  uint16_t _sessionPort;
+  TlsVerifyMode _mode;
+  TlsHandshakeStats _stats;
+  int _peeked;              // Byte returned by peek(), -1 if none
+  bool _sslInit;
+  bool _ready;
+  bool _hasSession;
+  bool _resumed;
+};
+
+// Time full and resumed handshakes against host:port in every configured mode
+void tlsHandshakeBench(const char *host, uint16_t port, uint8_t rounds, Print &out);
+
+#endif
@@ -0,0 +1,94 @@
+#include "SensorTrace.h"
+
+// Largest encoded sample: tag + two 5-byte varints
+#define TRACE_SAMPLE_MAX 11
+
+static uint32_t crc32(const uint8_t *data, size_t len) {
+  uint32_t crc = 0xFFFFFFFF;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int k = 0; k < 8; k++) crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+static void putU16(uint8_t *p, uint16_t v) {
+  p[0] = v & 0xFF;
+  p[1] = v >> 8;
+}
+
+static void putU32(uint8_t *p, uint32_t v) {
+  for (int i = 0; i < 4; i++) p[i] = (v >> (8 * i)) & 0xFF;
+}
+
+SensorTrace::SensorTrace(Print &out) : _out(out) {
+  _len = 0;
+  _count = 0;
+  _baseMs = 0;
+  _lastMs = 0;
+  _samples = 0;
+  _frames = 0;
+}
+
+void SensorTrace::begin(uint32_t ms) {
+  _len = 0;
+  _count = 0;
+  _baseMs = ms;
+  _lastMs = ms;
+  memset(_prev, 0, sizeof(_prev));
+}
+
+void SensorTrace::putVarint(uint32_t v) {
+  uint8_t *p = _frame + TRACE_HEADER_BYTES;
+  while (v >= 0x80) {
+    p[_len++] = (v & 0x7F) | 0x80;
+    v >>= 7;
+  }
+  p[_len++] = v;
+}
+
+void SensorTrace::record(uint8_t channel, int32_t value, uint32_t ms) {
+  if (channel >= TRACE_CHANNELS) return;
+  if (_count > 0 && _len + TRACE_SAMPLE_MAX > TRACE_PAYLOAD_MAX) flush();
+  if (_count == 0) begin(ms);
+
+  int32_t delta = value - _prev[channel];
+  _frame[TRACE_HEADER_BYTES + _len++] = channel;
+  putVarint(ms - _lastMs);
+  putVarint(((uint32_t)delta << 1) ^ (uint32_t)(delta >> 31));  // Zigzag: small +/- deltas stay 1 byte
+  _prev[channel] = value;
+  _lastMs = ms;
+  _count++;
+  _samples++;
+}
+
+void SensorTrace::recordMissing(uint8_t channel, uint32_t ms) {
+  if (channel >= TRACE_CHANNELS) return;
+  if (_count > 0 && _len + TRACE_SAMPLE_MAX > TRACE_PAYLOAD_MAX) flush();
+  if (_count == 0) begin(ms);
+
+  _frame[TRACE_HEADER_BYTES + _len++] = channel | TRACE_MISSING;
+  putVarint(ms - _lastMs);
+  _lastMs = ms;
+  _count++;
+  _samples++;
+}
+
+void SensorTrace::flush() {
+  if (_count == 0) return;
+
+  uint8_t *h = _frame;
+  memcpy(h, "AGTR", 4);
+  h[4] = TRACE_VERSION;
+  putU16(h + 5, _count);
+  putU32(h + 7, _baseMs);
+  putU16(h + 11, _len);
+  size_t body = TRACE_HEADER_BYTES + _len;
+  putU32(_frame + body, crc32(_frame, body));
+
+  // One write per frame keeps log lines from landing inside it
+  _out.write(_frame, body + 4);
+  _frames++;
+  _count = 0;
+  _len = 0;
+}
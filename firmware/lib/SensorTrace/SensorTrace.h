@@ -0,0 +1,55 @@
+#ifndef SENSORTRACE_H
+#define SENSORTRACE_H
+
+#include <Arduino.h>
+
+// Compact binary trace of raw sensor samples, written as self-contained frames
+// so a reader can resync after log text or a dropped byte on the serial line.
+//
+// Frame (little-endian):
+//   "AGTR" | version u8 | sample count u16 | base millis u32 | payload length u16
+//   | payload | crc32 u32 (over everything before it)
+// Sample:
+//   tag u8 (channel, | TRACE_MISSING for a failed read)
+//   | varint ms since the previous sample (the first sample is at base)
+//   | zigzag varint delta from the channel's previous value (absent if missing)
+// Channel deltas restart from zero in every frame.
+
+#define TRACE_VERSION 1
+#define TRACE_MISSING 0x80
+#define TRACE_PAYLOAD_MAX 480
+#define TRACE_HEADER_BYTES 13
+
+enum TraceChannel : uint8_t {
+  TRACE_MQ135_ADC = 0,      // Raw 12-bit ADC count
+  TRACE_DHT_TEMP = 1,       // 0.01 degC
+  TRACE_DHT_HUM = 2,        // 0.01 %RH
+  TRACE_BMP_PRESSURE = 3,   // Pa
+  TRACE_CHANNELS = 4
+};
+
+class SensorTrace {
+public:
+  SensorTrace(Print &out);
+  void record(uint8_t channel, int32_t value, uint32_t ms);
+  void recordMissing(uint8_t channel, uint32_t ms);
+  void flush();
+  uint32_t samples() const { return _samples; }
+  uint32_t frames() const { return _frames; }
+
+private:
+  void begin(uint32_t ms);
+  void putVarint(uint32_t v);
+
+  Print &_out;
+  uint8_t _frame[TRACE_HEADER_BYTES + TRACE_PAYLOAD_MAX + 4];
+  uint16_t _len;
+  uint16_t _count;
+  uint32_t _baseMs;
+  uint32_t _lastMs;
+  int32_t _prev[TRACE_CHANNELS];
+  uint32_t _samples;
+  uint32_t _frames;
+};
+
+#endif
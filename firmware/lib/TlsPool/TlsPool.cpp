@@ -0,0 +1,158 @@
+#include "TlsPool.h"
+#include <esp_heap_caps.h>
+#include <freertos/FreeRTOS.h>
+#include <mbedtls/platform.h>
+
+struct Pool {
+  uint8_t *base;
+  uint8_t *end;
+  void *freeList;     // Free blocks are chained through their first word
+  uint16_t size;
+  uint16_t blocks;
+  uint16_t inUse;
+  uint16_t peak;
+};
+
+static Pool pools[TLS_POOL_CLASSES];
+static const uint16_t blockSizes[TLS_POOL_CLASSES] = TLS_POOL_BLOCK_SIZES;
+static const uint16_t blockCounts[TLS_POOL_CLASSES] = TLS_POOL_BLOCK_COUNTS;
+static portMUX_TYPE poolLock = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t bytesInUse = 0, peakBytes = 0, fallbacks = 0;
+static uint16_t fallbackLive = 0, fallbackPeak = 0;
+static bool inPsram = false, installed = false;
+
+static void *poolCalloc(size_t n, size_t size) {
+  if (n == 0 || size == 0 || n > SIZE_MAX / size) return NULL;
+  size_t total = n * size;
+
+  void *block = NULL;
+  portENTER_CRITICAL(&poolLock);
+  // Smallest class that fits, else at most one class up before the heap. The top class
+  // (TLS record buffers) only serves requests too big for the class below it, so small
+  // allocations can't leave the record buffers to fragment the heap.
+  int fit = 0;
+  while (fit < TLS_POOL_CLASSES && pools[fit].size < total) fit++;
+  int last = fit + 1 < TLS_POOL_CLASSES - 1 ? fit + 1 : fit;
+  for (int i = fit; i <= last && i < TLS_POOL_CLASSES && !block; i++) {
+    Pool &p = pools[i];
+    if (!p.freeList) continue;
+    block = p.freeList;
+    p.freeList = *(void **)block;
+    if (++p.inUse > p.peak) p.peak = p.inUse;
+    bytesInUse += p.size;
+    if (bytesInUse > peakBytes) peakBytes = bytesInUse;
+  }
+  if (!block) {
+    fallbacks++;
+    if (++fallbackLive > fallbackPeak) fallbackPeak = fallbackLive;
+  }
+  portEXIT_CRITICAL(&poolLock);
+
+  if (!block) {
+    block = calloc(n, size);
+    if (!block) {
+      portENTER_CRITICAL(&poolLock);
+      fallbackLive--;
+      portEXIT_CRITICAL(&poolLock);
+    }
+    return block;
+  }
+  memset(block, 0, total);
+  return block;
+}
+
+static void poolFree(void *ptr) {
+  if (!ptr) return;
+  uint8_t *p8 = (uint8_t *)ptr;
+  portENTER_CRITICAL(&poolLock);
+  for (int i = 0; i < TLS_POOL_CLASSES; i++) {
+    Pool &p = pools[i];
+    if (p8 < p.base || p8 >= p.end) continue;
+    *(void **)ptr = p.freeList;
+    p.freeList = ptr;
+    p.inUse--;
+    bytesInUse -= p.size;
+    portEXIT_CRITICAL(&poolLock);
+    return;
+  }
+  // Heap fallback, or allocated by the default allocator before we were installed
+  if (fallbackLive > 0) fallbackLive--;
+  portEXIT_CRITICAL(&poolLock);
+  free(ptr);
+}
+
+bool tlsPoolBegin(bool allowInternal) {
+  if (installed) return true;
+
+#if defined(MBEDTLS_PLATFORM_MEMORY) && !defined(MBEDTLS_PLATFORM_CALLOC_MACRO)
+  inPsram = psramFound();
+  if (!inPsram && !allowInternal) {
+    Serial.println("[TLS] No PSRAM, pool not installed (mbedTLS allocates from the heap)");
+    return false;
+  }
+  uint32_t caps = inPsram ? MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT : MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
+
+  for (int i = 0; i < TLS_POOL_CLASSES; i++) {
+    Pool &p = pools[i];
+    p.size = blockSizes[i];
+    p.blocks = blockCounts[i];
+    p.inUse = 0;
+    p.peak = 0;
+    p.freeList = NULL;
+    p.base = (uint8_t *)heap_caps_malloc((size_t)p.size * p.blocks, caps);
+    if (!p.base) {
+      Serial.println("[TLS] Pool reservation failed for " + String(p.size) + " B blocks");
+      for (int j = 0; j < i; j++) heap_caps_free(pools[j].base);
+      memset(pools, 0, sizeof(pools));
+      return false;
+    }
+    p.end = p.base + (size_t)p.size * p.blocks;
+    for (int b = p.blocks - 1; b >= 0; b--) {
+      void *block = p.base + (size_t)b * p.size;
+      *(void **)block = p.freeList;
+      p.freeList = block;
+    }
+  }
+
+  mbedtls_platform_set_calloc_free(poolCalloc, poolFree);
+  installed = true;
+  return true;
+#else
+  (void)allowInternal;
+  Serial.println("[TLS] mbedTLS built without MBEDTLS_PLATFORM_MEMORY, pool not installed");
+  return false;
+#endif
+}
+
+void tlsPoolGetStats(TlsPoolStats &stats) {
+  portENTER_CRITICAL(&poolLock);
+  for (int i = 0; i < TLS_POOL_CLASSES; i++) {
+    stats.classes[i].blockSize = pools[i].size;
+    stats.classes[i].blocks = pools[i].blocks;
+    stats.classes[i].inUse = pools[i].inUse;
+    stats.classes[i].peak = pools[i].peak;
+  }
+  stats.bytesInUse = bytesInUse;
+  stats.peakBytes = peakBytes;
+  stats.fallbacks = fallbacks;
+  stats.fallbackLive = fallbackLive;
+  stats.fallbackPeak = fallbackPeak;
+  portEXIT_CRITICAL(&poolLock);
+  stats.inPsram = inPsram;
+  stats.installed = installed;
+}
+
+void tlsPoolPrintStats(Print &out) {
+  TlsPoolStats s;
+  tlsPoolGetStats(s);
+  if (!s.installed) return;
+  out.print("[TLS] Pool (");
+  out.print(s.inPsram ? "PSRAM" : "internal");
+  out.print(") peak ");
+  out.print(s.peakBytes);
+  out.print(" B:");
+  for (int i = 0; i < TLS_POOL_CLASSES; i++) {
+    out.printf(" %uB %u/%u", s.classes[i].blockSize, s.classes[i].peak, s.classes[i].blocks);
+  }
+  out.printf(", heap fallbacks %u (peak live %u)\n", (unsigned)s.fallbacks, (unsigned)s.fallbackPeak);
+}
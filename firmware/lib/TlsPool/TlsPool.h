@@ -0,0 +1,45 @@
+#ifndef TLSPOOL_H
+#define TLSPOOL_H
+
+#include <Arduino.h>
+
+// Fixed-size block pools for mbedTLS allocations. Reserved once at boot in
+// PSRAM and installed with mbedtls_platform_set_calloc_free, so the ~40 KB a
+// TLS handshake allocates and frees again never fragments the main heap.
+// Requests a pool cannot serve fall back to the heap and are counted. The
+// default counts reserve ~92 KB, which only PSRAM can spare; size them from
+// the high-water marks tlsPoolPrintStats() reports before allowing internal RAM.
+
+#define TLS_POOL_CLASSES 5
+#define TLS_POOL_BLOCK_SIZES {64, 256, 1024, 4096, 17408}  // Last class: one ~16.7 KB TLS record buffer
+
+// Blocks per class (override with -DTLS_POOL_BLOCK_COUNTS=... after reading the high-water marks)
+#ifndef TLS_POOL_BLOCK_COUNTS
+  #define TLS_POOL_BLOCK_COUNTS {96, 48, 16, 6, 2}
+#endif
+
+struct TlsPoolClassStats {
+  uint16_t blockSize;
+  uint16_t blocks;
+  uint16_t inUse;
+  uint16_t peak;      // High-water mark of blocks in use
+};
+
+struct TlsPoolStats {
+  TlsPoolClassStats classes[TLS_POOL_CLASSES];
+  uint32_t bytesInUse;      // Pool block bytes held by mbedTLS
+  uint32_t peakBytes;
+  uint32_t fallbacks;       // Requests served from the heap (pool full or too large)
+  uint16_t fallbackLive;
+  uint16_t fallbackPeak;
+  bool inPsram;
+  bool installed;
+};
+
+// Reserve the pools and install the allocator; call before the first TLS connection.
+// Without PSRAM nothing is reserved unless allowInternal is set.
+bool tlsPoolBegin(bool allowInternal);
+void tlsPoolGetStats(TlsPoolStats &stats);
+void tlsPoolPrintStats(Print &out);
+
+#endif
@@ -8,6 +8,7 @@
 #include <WiFiClientSecure.h>
 #include <WiFiManager.h>
 #include <HTTPClient.h>
+#include <Preferences.h>
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include <NTPClient.h>
@@ -15,8 +16,17 @@
 #include <DHT.h>
 #include <Adafruit_BMP085.h>
 #include <LiquidCrystal_I2C.h>
-#include <mbedtls/md.h>
+#include <esp_heap_caps.h>
+#include <sys/time.h>
 #include "config.h"
+#if TRACE_RECORDER
+  #include <SensorTrace.h>
+#endif
+#if TLS_POOL_ENABLE
+  #include <TlsPool.h>
+#endif
+#include <CryptoBackend.h>
+#include <PinnedTls.h>
 
 // ============================================================================
 // SENSOR INSTANCES
@@ -29,6 +39,15 @@ LiquidCrystal_I2C lcd(LCD_I2C_ADDR, LCD_COLS, LCD_ROWS);
 // NETWORKING
 // ============================================================================
 WiFiClientSecure wifiClient;
+PinnedTlsClient httpsClient(TLS_VERIFY_MODE);  // Kept open across posts; reconnects resume the TLS session
+#if !USE_MQTT
+static_assert(TLS_VERIFY_MODE != TLS_VERIFY_PINNED || tlsPinIsHex(TLS_PIN_SHA256),
+              "TLS_VERIFY_PINNED needs the server's SPKI SHA-256 (64 hex chars) in TLS_PIN_SHA256; see config.h");
+static_assert(TLS_PIN_SHA256_BACKUP[0] == '\0' || tlsPinIsHex(TLS_PIN_SHA256_BACKUP),
+              "TLS_PIN_SHA256_BACKUP must be empty or 64 hex chars");
+static_assert(TLS_VERIFY_MODE != TLS_VERIFY_CHAIN || TLS_CA_CERT[0] != '\0',
+              "TLS_VERIFY_CHAIN needs a PEM root CA in TLS_CA_CERT; see config.h");
+#endif
 #if USE_MQTT
   PubSubClient mqttClient(wifiClient);
 #endif
@@ -47,6 +66,7 @@ struct SensorData {
   float pressure_hpa;
   float altitude_m;
   unsigned long timestamp;
+  uint32_t seq;        // Per-boot sequence number (idempotency key with bootId)
   bool valid;
 };
 
@@ -56,6 +76,18 @@ unsigned long lastSampleTime = 0;
 unsigned long bootTime = 0;
 bool isWarmedUp = false;
 int failedTransmissions = 0;
+char bootId[9] = "";        // Random per boot, lets the backend drop replayed records
+uint32_t nextSeq = 0;
+String deviceKey = DEVICE_KEY;  // Replaced by the NVS-provisioned key at boot
+unsigned long backoffUntil = 0;  // millis() before which the server asked us not to send
+#if !USE_MQTT
+String ingestUrl = API_ENDPOINT;  // Owning cluster node, learned from 307/308 redirects
+int ownerFailures = 0;
+#endif
+
+bool backoffActive() {
+  return backoffUntil != 0 && (long)(millis() - backoffUntil) < 0;
+}
 
 // Offline buffer (simple ring buffer)
 SensorData offlineBuffer[OFFLINE_BUFFER_SIZE];
@@ -129,15 +161,9 @@ float emaFilter(float newValue, float oldValue, float alpha) {
 // ============================================================================
 String hmacSHA256(String message, String key) {
   byte hmacResult[32];
-  mbedtls_md_context_t ctx;
-  mbedtls_md_type_t md_type = MBEDTLS_MD_SHA256;
-
-  mbedtls_md_init(&ctx);
-  mbedtls_md_setup(&ctx, mbedtls_md_info_from_type(md_type), 1);
-  mbedtls_md_hmac_starts(&ctx, (const unsigned char*)key.c_str(), key.length());
-  mbedtls_md_hmac_update(&ctx, (const unsigned char*)message.c_str(), message.length());
-  mbedtls_md_hmac_finish(&ctx, hmacResult);
-  mbedtls_md_free(&ctx);
+  // Engine picked and self-tested by cryptoBegin() (hardware SHA when it passes)
+  cryptoHmacSha256((const uint8_t*)key.c_str(), key.length(),
+                   (const uint8_t*)message.c_str(), message.length(), hmacResult);
 
   String signature = "";
   for (int i = 0; i < 32; i++) {
@@ -148,6 +174,50 @@ String hmacSHA256(String message, String key) {
   return signature;
 }
 
+// ============================================================================
+// DEVICE KEY (NVS)
+// ============================================================================
+// The backend derives each node's key from its device id under a master secret
+// (register-device prints it); provisioning stores it in NVS so one image serves
+// every node. DEVICE_KEY from config.h is only used until a key is stored.
+Preferences keyStore;
+
+void loadDeviceKey() {
+  keyStore.begin(DEVICE_KEY_NVS_NAMESPACE, true);
+  String stored = keyStore.getString("device_key", "");
+  keyStore.end();
+  if (stored.length() > 0) {
+    deviceKey = stored;
+    Serial.println("[KEY] Using provisioned device key from NVS");
+  } else {
+    Serial.println("[KEY] No provisioned key, using DEVICE_KEY from config.h");
+  }
+}
+
+// Serial provisioning: "KEY <device_key>" stores a key, "KEY CLEAR" reverts to DEVICE_KEY
+void checkKeyProvisioning() {
+  if (!Serial.available()) return;
+  String line = Serial.readStringUntil('\n');
+  line.trim();
+  if (!line.startsWith("KEY ")) return;
+  String value = line.substring(4);
+  value.trim();
+
+  keyStore.begin(DEVICE_KEY_NVS_NAMESPACE, false);
+  if (value == "CLEAR") {
+    keyStore.remove("device_key");
+    deviceKey = DEVICE_KEY;
+    Serial.println("[KEY] Provisioned key cleared");
+  } else if (value.length() >= 16) {
+    keyStore.putString("device_key", value);
+    deviceKey = value;
+    Serial.println("[KEY] Device key stored in NVS");
+  } else {
+    Serial.println("[KEY] Rejected, key too short");
+  }
+  keyStore.end();
+}
+
 // ============================================================================
 // SENSOR READING
 // ============================================================================
@@ -195,9 +265,49 @@ SensorData readSensors() {
   return data;
 }
 
+// ============================================================================
+// TRACE RECORDER
+// ============================================================================
+#if TRACE_RECORDER
+SensorTrace trace(Serial);
+
+// Raw values only (ADC counts, DHT/BMP readings), each channel at its own rate
+void recordTrace(unsigned long now) {
+  static unsigned long lastMQ = 0, lastDHT = 0, lastBMP = 0, lastFlush = 0;
+
+  if (now - lastMQ >= TRACE_MQ135_INTERVAL_MS) {
+    lastMQ = now;
+    trace.record(TRACE_MQ135_ADC, analogRead(PIN_MQ135), now);
+  }
+  if (now - lastDHT >= TRACE_DHT_INTERVAL_MS) {
+    lastDHT = now;
+    float t = dht.readTemperature();
+    float h = dht.readHumidity();
+    if (isnan(t)) trace.recordMissing(TRACE_DHT_TEMP, now);
+    else trace.record(TRACE_DHT_TEMP, lroundf(t * 100), now);
+    if (isnan(h)) trace.recordMissing(TRACE_DHT_HUM, now);
+    else trace.record(TRACE_DHT_HUM, lroundf(h * 100), now);
+  }
+  if (now - lastBMP >= TRACE_BMP_INTERVAL_MS) {
+    lastBMP = now;
+    trace.record(TRACE_BMP_PRESSURE, bmp.readPressure(), now);
+  }
+  if (now - lastFlush >= TRACE_FLUSH_MS) {
+    lastFlush = now;
+    trace.flush();
+  }
+}
+#endif
+
 // ============================================================================
 // LCD DISPLAY UPDATE
 // ============================================================================
+const char *iaqCategory(float iaq) {
+  if (iaq > 150) return "POOR";
+  if (iaq > 100) return "FAIR";
+  return "GOOD";
+}
+
 void updateLCD(SensorData &data) {
   lcd.clear();
   
@@ -209,10 +319,7 @@ void updateLCD(SensorData &data) {
 
   // Line 1: AQI category + IAQ score
   lcd.setCursor(0, 0);
-  String category = "GOOD";
-  if (data.iaq_score > 150) category = "POOR";
-  else if (data.iaq_score > 100) category = "FAIR";
-  lcd.print(category + " IAQ:" + String((int)data.iaq_score));
+  lcd.print(String(iaqCategory(data.iaq_score)) + " IAQ:" + String((int)data.iaq_score));
 
   // Line 2: Temp + Humidity
   lcd.setCursor(0, 1);
@@ -224,6 +331,8 @@ void updateLCD(SensorData &data) {
 // ============================================================================
 // DATA TRANSMISSION
 // ============================================================================
+bool sendPayload(const String &payload);
+
 bool transmitData(SensorData &data) {
   if (!data.valid) {
     Serial.println("[WARN] Skipping transmission of invalid data");
@@ -249,19 +358,26 @@ bool transmitData(SensorData &data) {
   meta["uptime_ms"] = millis();
   meta["rssi"] = WiFi.RSSI();
   meta["free_heap"] = ESP.getFreeHeap();
+  meta["heap_max_block"] = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);  // Fragmentation trend
+  meta["boot_id"] = bootId;
+  meta["seq"] = data.seq;
 
   String payload;
   serializeJson(doc, payload);
 
 #if ENABLE_HMAC
-  String signature = hmacSHA256(payload, DEVICE_KEY);
+  String signature = hmacSHA256(payload, deviceKey);
   doc["signature"] = signature;
   payload = "";
   serializeJson(doc, payload);
 #endif
 
   Serial.println("[DATA] " + payload);
+  return sendPayload(payload);
+}
 
+// MQTT publish or HTTPS POST of a signed payload; shared by readings and alerts
+bool sendPayload(const String &payload) {
 #if USE_MQTT
   // MQTT Publish
   if (!mqttClient.connected()) {
@@ -279,21 +395,54 @@ bool transmitData(SensorData &data) {
   }
   return success;
 #else
-  // HTTPS POST
-  WiFiClientSecure client;
-  client.setInsecure();  // For demo; use cert pinning in production
-  HTTPClient http;
-  http.begin(client, API_ENDPOINT);
-  http.addHeader("Content-Type", "application/json");
-  http.addHeader("X-API-Key", DEVICE_KEY);
-  http.setTimeout(API_TIMEOUT);
-
-  int httpCode = http.POST(payload);
-  http.end();
+  // HTTPS POST (to the owning cluster node once a redirect has named it)
+  int httpCode = 0;
+  String retryAfter;
+  for (int hop = 0; hop <= MAX_REDIRECTS; hop++) {
+    HTTPClient http;
+    http.setReuse(true);
+    http.begin(httpsClient, ingestUrl);
+    http.addHeader("Content-Type", "application/json");
+    http.addHeader("X-API-Key", deviceKey);
+    http.setTimeout(API_TIMEOUT);
+    const char *collect[] = {"Retry-After", "Location"};
+    http.collectHeaders(collect, 2);
+
+    httpCode = http.POST(payload);
+    retryAfter = http.header("Retry-After");
+    String location = http.header("Location");
+    http.end();
+
+    if ((httpCode == 307 || httpCode == 308) && location.length()) {
+      // Remember the owner so later posts skip the extra round trip
+      Serial.println("[HTTPS] Redirected to owner " + location);
+      httpsClient.stop();  // A reused connection would still point at the old host
+      ingestUrl = location;
+      ownerFailures = 0;
+      continue;
+    }
+    break;
+  }
+  if (httpCode < 0) httpsClient.stop();  // Drop a half-dead connection; next post reconnects
+
+  // Owner unreachable: fall back to the configured endpoint, which redirects again if needed
+  if (httpCode < 0 && ingestUrl != API_ENDPOINT && ++ownerFailures >= MAX_RETRIES) {
+    Serial.println("[HTTPS] Owner unreachable, reverting to " + String(API_ENDPOINT));
+    ingestUrl = API_ENDPOINT;
+    ownerFailures = 0;
+  }
 
   if (httpCode == 200 || httpCode == 201) {
     Serial.println("[HTTPS] POST success: " + String(httpCode));
+    ownerFailures = 0;
     return true;
+  } else if (httpCode == 429 || httpCode == 503) {
+    // Server-side admission control: honor Retry-After (seconds), bounded
+    unsigned long waitSec = retryAfter.length() ? retryAfter.toInt() : BACKOFF_DEFAULT_SEC;
+    waitSec = constrain(waitSec, 1UL, (unsigned long)BACKOFF_MAX_SEC);
+    backoffUntil = millis() + waitSec * 1000UL;
+    Serial.println("[HTTPS] Throttled (" + String(httpCode) + "), backing off " + String(waitSec) + "s");
+    return false;
   } else {
     Serial.println("[ERROR] HTTPS POST failed: " + String(httpCode));
     return false;
@@ -301,6 +450,154 @@ bool transmitData(SensorData &data) {
 #endif
 }
 
+// ============================================================================
+// HEAP HEALTH
+// ============================================================================
+void logHeap() {
+  // A shrinking largest block with steady free heap means the heap is fragmenting
+  Serial.println("[HEAP] Free " + String(ESP.getFreeHeap()) + " B, largest block " +
+                 String(heap_caps_get_largest_free_block(MALLOC_CAP_8BIT)) + " B, min free " +
+                 String(ESP.getMinFreeHeap()) + " B");
+#if TLS_POOL_ENABLE
+  tlsPoolPrintStats(Serial);
+#endif
+}
+
+// ============================================================================
+// TLS HANDSHAKE BENCHMARK
+// ============================================================================
+#if TLS_HANDSHAKE_BENCH && !USE_MQTT
+void benchTlsHandshakes() {
+  // Split API_ENDPOINT into host and port
+  String url = API_ENDPOINT;
+  int hostStart = url.indexOf("://") + 3;
+  int pathStart = url.indexOf('/', hostStart);
+  String hostPort = url.substring(hostStart, pathStart < 0 ? url.length() : pathStart);
+  int colon = hostPort.indexOf(':');
+  uint16_t port = colon >= 0 ? hostPort.substring(colon + 1).toInt() : 443;
+  String host = colon >= 0 ? hostPort.substring(0, colon) : hostPort;
+  tlsHandshakeBench(host.c_str(), port, TLS_HANDSHAKE_BENCH_ROUNDS, Serial);
+}
+#endif
+
+// ============================================================================
+// PRIORITY ALERTS
+// ============================================================================
+// Category changes and threshold breaches are queued here and sent ahead of the
+// offline buffer as a compact payload, instead of waiting for the next sample
+// or behind a flush of up to OFFLINE_BUFFER_SIZE records.
+struct AlertReading {
+  float iaq_score;
+  float co2_equiv;
+  unsigned long timestamp;
+  uint32_t seq;
+  char reason[16];     // "category:POOR", "iaq>250", "co2>2000"
+};
+
+AlertReading alertQueue[ALERT_QUEUE_SIZE];
+int alertCount = 0;
+unsigned long alertRetryAt = 0;
+const char *alertCategory = NULL;   // Band last reported (or seen at boot)
+bool iaqBreached = false, co2Breached = false;
+unsigned long lastCategoryAlert = 0;
+
+void queueAlert(float iaq, float co2, const char *reason) {
+  if (alertCount == ALERT_QUEUE_SIZE) {
+    // Keep the latest state: drop the oldest alert
+    memmove(alertQueue, alertQueue + 1, (ALERT_QUEUE_SIZE - 1) * sizeof(AlertReading));
+    alertCount--;
+  }
+  AlertReading &a = alertQueue[alertCount++];
+  a.iaq_score = iaq;
+  a.co2_equiv = co2;
+  a.timestamp = timeClient.getEpochTime();
+  a.seq = nextSeq++;
+  strlcpy(a.reason, reason, sizeof(a.reason));
+  alertRetryAt = 0;  // Send now, even if an earlier alert is waiting out a retry
+  Serial.println("[ALERT] " + String(reason) + " (IAQ " + String(iaq, 0) + ", CO2eq " + String(co2, 0) + ")");
+}
+
+// Edge-triggered: one alert per band change or upward threshold crossing
+void evaluateAlert(float iaq, float co2, unsigned long now) {
+  const char *category = iaqCategory(iaq);
+  if (!alertCategory) {
+    alertCategory = category;
+  } else if (category != alertCategory && now - lastCategoryAlert >= ALERT_MIN_INTERVAL_MS) {
+    // Within the debounce the old band is kept, so a change that persists still alerts
+    char reason[16];
+    snprintf(reason, sizeof(reason), "category:%s", category);
+    queueAlert(iaq, co2, reason);
+    alertCategory = category;
+    lastCategoryAlert = now;
+  }
+
+  char reason[16];
+  if (!iaqBreached && iaq >= ALERT_IAQ_THRESHOLD) {
+    snprintf(reason, sizeof(reason), "iaq>%d", ALERT_IAQ_THRESHOLD);
+    queueAlert(iaq, co2, reason);
+  }
+  if (!co2Breached && co2 >= ALERT_CO2_THRESHOLD) {
+    snprintf(reason, sizeof(reason), "co2>%d", ALERT_CO2_THRESHOLD);
+    queueAlert(iaq, co2, reason);
+  }
+  // 10% hysteresis before a breach can fire again
+  if (iaq >= ALERT_IAQ_THRESHOLD) iaqBreached = true;
+  else if (iaq < ALERT_IAQ_THRESHOLD * 0.9) iaqBreached = false;
+  if (co2 >= ALERT_CO2_THRESHOLD) co2Breached = true;
+  else if (co2 < ALERT_CO2_THRESHOLD * 0.9) co2Breached = false;
+}
+
+// Quick IAQ between samples: a few ADC reads, compensated with the last DHT22 values
+void checkAlerts(unsigned long now) {
+  static unsigned long lastCheck = 0;
+  if (!isWarmedUp || !currentReading.valid || now - lastCheck < ALERT_CHECK_INTERVAL_MS) return;
+  lastCheck = now;
+
+  float samples[ALERT_CHECK_SAMPLES];
+  for (int i = 0; i < ALERT_CHECK_SAMPLES; i++) samples[i] = readMQ135Resistance();
+  float ratio = medianFilter(samples, ALERT_CHECK_SAMPLES) / mq135_baseline;
+  evaluateAlert(calculateIAQ(ratio, currentReading.temperature, currentReading.humidity),
+                estimateCO2(ratio), now);
+}
+
+bool transmitAlert(AlertReading &a) {
+  StaticJsonDocument<256> doc;
+  doc["device_id"] = DEVICE_ID;
+  doc["timestamp"] = a.timestamp;
+  JsonObject sensors = doc.createNestedObject("sensors");
+  sensors["iaq_score"] = a.iaq_score;
+  sensors["co2_equiv"] = a.co2_equiv;
+  JsonObject meta = doc.createNestedObject("meta");
+  meta["boot_id"] = bootId;
+  meta["seq"] = a.seq;
+  meta["alert"] = a.reason;
+
+  String payload;
+  serializeJson(doc, payload);
+#if ENABLE_HMAC
+  doc["signature"] = hmacSHA256(payload, deviceKey);
+  payload = "";
+  serializeJson(doc, payload);
+#endif
+
+  Serial.println("[ALERT] Sending " + payload);
+  return sendPayload(payload);
+}
+
+// Drain the priority queue; a failed alert stays at the head and is retried first
+void sendAlerts() {
+  if (alertCount == 0 || backoffActive() || (alertRetryAt && (long)(millis() - alertRetryAt) < 0)) return;
+  while (alertCount > 0 && !backoffActive()) {
+    if (!transmitAlert(alertQueue[0])) {
+      alertRetryAt = millis() + ALERT_RETRY_MS;
+      return;
+    }
+    memmove(alertQueue, alertQueue + 1, (alertCount - 1) * sizeof(AlertReading));
+    alertCount--;
+  }
+  alertRetryAt = 0;
+}
+
 // ============================================================================
 // OFFLINE BUFFER MANAGEMENT
 // ============================================================================
@@ -312,21 +609,30 @@ void bufferData(SensorData &data) {
 }
 
 void flushBuffer() {
-  if (bufferCount == 0) return;
+  if (bufferCount == 0 || backoffActive()) return;
   Serial.println("[BUFFER] Flushing " + String(bufferCount) + " records...");
-  
+
+  // Send oldest first; stop on the first failure or server backoff and keep the rest
   int flushed = 0;
-  for (int i = 0; i < bufferCount; i++) {
-    int idx = (bufferHead - bufferCount + i + OFFLINE_BUFFER_SIZE) % OFFLINE_BUFFER_SIZE;
-    if (transmitData(offlineBuffer[idx])) {
-      flushed++;
+  while (bufferCount > 0 && !backoffActive()) {
+    // Alerts raised during a long flush go out before the next buffered record
+    checkAlerts(millis());
+    sendAlerts();
+    int idx = (bufferHead - bufferCount + OFFLINE_BUFFER_SIZE) % OFFLINE_BUFFER_SIZE;
+    if (!transmitData(offlineBuffer[idx])) break;
+    bufferCount--;
+    flushed++;
+
+    // Rate limit, still answering alerts in the meantime
+    unsigned long spacingStart = millis();
+    while (millis() - spacingStart < 500) {
+      checkAlerts(millis());
+      sendAlerts();
+      delay(50);
     }
-    delay(500);  // Rate limit
   }
-  
-  bufferCount = 0;
-  bufferHead = 0;
-  Serial.println("[BUFFER] Flushed " + String(flushed) + " records");
+
+  Serial.println("[BUFFER] Flushed " + String(flushed) + " records, " + String(bufferCount) + " pending");
 }
 
 // ============================================================================
@@ -348,7 +654,9 @@ void setupWiFi() {
 
 void setupMQTT() {
 #if USE_MQTT
+  wifiClient.setInsecure();  // For demo; use cert pinning in production
   mqttClient.setServer(MQTT_BROKER, MQTT_PORT);
+  mqttClient.setBufferSize(MQTT_BUFFER_SIZE);  // Signed readings exceed the 256-byte default
   mqttClient.setKeepAlive(60);
   mqttClient.setSocketTimeout(10);
   
@@ -414,6 +722,26 @@ void setup() {
   Serial.println("   Device: " + String(DEVICE_ID));
   Serial.println("========================================\n");
 
+  // Boot identity: (DEVICE_ID, bootId, seq) uniquely names every reading
+  snprintf(bootId, sizeof(bootId), "%08x", esp_random());
+
+#if TLS_POOL_ENABLE
+  // Before any TLS session so every mbedTLS allocation comes from the pools
+  if (tlsPoolBegin(TLS_POOL_INTERNAL)) {
+    Serial.println("[TLS] Allocation pools installed");
+  }
+#endif
+
+  // Crypto engines: verify hardware SHA/AES before anything signs with it
+  cryptoBegin();
+#if CRYPTO_BENCH
+  cryptoBench(Serial);
+#endif
+  loadDeviceKey();
+
+  // Parse trust anchors once; every HTTPS connection reuses them
+  tlsTrustBegin(TLS_CA_CERT, TLS_PIN_SHA256, TLS_PIN_SHA256_BACKUP);
+
   // GPIO Setup
   pinMode(PIN_STATUS_LED, OUTPUT);
   digitalWrite(PIN_STATUS_LED, HIGH);  // Indicate boot
@@ -426,6 +754,7 @@ void setup() {
   lcd.setCursor(0, 1);
   lcd.print("Booting...");
 
+#if !TRACE_RECORDER
   // WiFi
   setupWiFi();
 
@@ -434,6 +763,15 @@ void setup() {
   timeClient.update();
   Serial.println("[NTP] Time synced: " + timeClient.getFormattedTime());
 
+  // mbedTLS checks certificate validity against the system clock
+  struct timeval tv = { (time_t)(timeClient.getEpochTime() - GMT_OFFSET_SEC), 0 };
+  settimeofday(&tv, NULL);
+
+#if TLS_HANDSHAKE_BENCH && !USE_MQTT
+  benchTlsHandshakes();
+#endif
+#endif
+
   // I2C Sensors
   Wire.begin(PIN_SDA, PIN_SCL);
   
@@ -448,6 +786,14 @@ void setup() {
   dht.begin();
   Serial.println("[DHT22] Initialized");
 
+#if TRACE_RECORDER
+  // Record from power-on so the MQ135 warm-up curve is in the trace (no network needed)
+  Serial.println("[TRACE] Recording raw samples, binary frames follow");
+  lcd.setCursor(0, 1);
+  lcd.print("Trace recording");
+  return;
+#endif
+
   // MQ135 Warmup
   Serial.println("[MQ135] Warming up for " + String(MQ135_WARMUP_MS / 1000) + " seconds...");
   lcd.setCursor(0, 1);
@@ -485,6 +831,14 @@ void setup() {
 void loop() {
   unsigned long now = millis();
 
+#if TRACE_RECORDER
+  recordTrace(now);
+  return;
+#endif
+
+  // Key provisioning over serial
+  checkKeyProvisioning();
+
   // Keep MQTT alive
 #if USE_MQTT
   if (!mqttClient.connected()) {
@@ -496,6 +850,10 @@ void loop() {
   // Time sync
   timeClient.update();
 
+  // Priority alerts between samples
+  checkAlerts(now);
+  sendAlerts();
+
   // Sample sensors at interval
   if (now - lastSampleTime >= SAMPLING_INTERVAL_MS) {
     lastSampleTime = now;
@@ -504,6 +862,7 @@ void loop() {
     digitalWrite(PIN_STATUS_LED, HIGH);
     
     currentReading = readSensors();
+    currentReading.seq = nextSeq++;
     
     if (currentReading.valid) {
       Serial.println("[SAMPLE] Valid reading:");
@@ -515,8 +874,12 @@ void loop() {
       
       updateLCD(currentReading);
 
-      // Transmit
-      bool success = transmitData(currentReading);
+      // An alert-grade reading goes out first as a compact alert
+      evaluateAlert(currentReading.iaq_score, currentReading.co2_equiv, now);
+      sendAlerts();
+
+      // Transmit (buffer directly while the server has asked us to back off)
+      bool success = !backoffActive() && transmitData(currentReading);
       if (success) {
         failedTransmissions = 0;
         flushBuffer();  // Send any buffered data
@@ -524,6 +887,7 @@ void loop() {
         failedTransmissions++;
         bufferData(currentReading);
       }
+      logHeap();
     } else {
       Serial.println("[SAMPLE] Invalid reading, skipped");
     }
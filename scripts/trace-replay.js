@@ -0,0 +1,462 @@
+/**
+ * AeroGuard AI - Sensor Trace Replay
+ * Decodes binary sensor traces recorded by the firmware (TRACE_RECORDER, see
+ * firmware/lib/SensorTrace) and runs them through the same processing as the
+ * node's readSensors(): median of the last 5 MQ135 samples, IAQ/CO2 model,
+ * DHT/BMP validity checks, one reading per SAMPLING_INTERVAL_MS of trace time.
+ * Replays as fast as it can decode (a month of samples in seconds) or paced.
+ *
+ *   node scripts/trace-replay.js trace.bin                 Stats: noise, failure rates, drift, readings
+ *   node scripts/trace-replay.js trace.bin --post          POST the readings to API_URL/ingest (signed)
+ *   node scripts/trace-replay.js trace.bin --jsonl out     Write firmware-shape readings, one per line
+ *   node scripts/trace-replay.js --synthesize out.bin [days]   Generate a synthetic trace
+ *
+ * Capture from a node: stty -F /dev/ttyUSB0 115200 raw && cat /dev/ttyUSB0 > trace.bin
+ * (log text between frames is skipped; frames are CRC-checked).
+ */
+
+const fs = require('fs');
+const crypto = require('crypto');
+
+// Configuration (mirrors firmware/include/config.h)
+const API_URL = process.env.API_URL || 'http://localhost:3000/api/v1';
+const DEVICE_ID = process.env.DEVICE_ID || 'SIMULATOR-001';
+const DEVICE_KEY = process.env.DEVICE_KEY || 'simulator-test-key-12345678';
+const REPLAY_SPEED = parseFloat(process.env.REPLAY_SPEED || '0'); // 0 = as fast as possible, N = N x real time
+const TRACE_START_EPOCH = parseInt(process.env.TRACE_START_EPOCH || '0'); // 0 = trace ends now
+const SAMPLING_INTERVAL_MS = parseInt(process.env.SAMPLING_INTERVAL_MS || '60000');
+const MQ135_WARMUP_MS = parseInt(process.env.MQ135_WARMUP_MS || '180000');
+const MQ135_RL = 10.0;
+const MQ135_R0 = parseFloat(process.env.MQ135_R0 || '76.63');
+const MEDIAN_FILTER_SIZE = 5;
+const LIMITS = { iaq: [10, 500], temp: [-40, 80], hum: [0, 100], pressure: [800, 1100] };
+
+// Trace format (firmware/lib/SensorTrace/SensorTrace.h)
+const MAGIC = 0x52544741; // "AGTR" read as u32 LE
+const VERSION = 1;
+const HEADER_BYTES = 13;
+const MISSING = 0x80;
+const PAYLOAD_MAX = 480;
+const CH_ADC = 0;
+const CH_TEMP = 1;
+const CH_HUM = 2;
+const CH_PRESSURE = 3;
+const CHANNEL_NAMES = ['mq135_adc', 'dht_temp', 'dht_hum', 'bmp_pressure'];
+
+const CRC_TABLE = new Int32Array(256);
+for (let n = 0; n < 256; n++) {
+  let c = n;
+  for (let k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >>> 1) : c >>> 1;
+  CRC_TABLE[n] = c;
+}
+
+function crc32(buf, start, end) {
+  let c = -1;
+  for (let i = start; i < end; i++) c = CRC_TABLE[(c ^ buf[i]) & 0xff] ^ (c >>> 8);
+  return (c ^ -1) >>> 0;
+}
+
+/**
+ * Walk every valid frame, calling onSample(channel, ms, value, missing).
+ * Bytes that are not a CRC-valid frame (serial log text, line noise) are skipped.
+ * Time is made monotonic across reboots and millis() wrap.
+ */
+function decodeTrace(buf, onSample) {
+  const stats = { frames: 0, corrupt: 0, skippedBytes: 0 };
+  const prev = new Int32Array(4);
+  let offset = 0; // Added to device millis so time keeps increasing after a reboot
+  let lastMs = -1;
+  let pos = 0;
+
+  while (pos + HEADER_BYTES + 4 <= buf.length) {
+    if (buf.readUInt32LE(pos) !== MAGIC || buf[pos + 4] !== VERSION) {
+      pos++;
+      stats.skippedBytes++;
+      continue;
+    }
+    const count = buf.readUInt16LE(pos + 5);
+    const base = buf.readUInt32LE(pos + 7);
+    const len = buf.readUInt16LE(pos + 11);
+    const end = pos + HEADER_BYTES + len;
+    if (len > PAYLOAD_MAX || end + 4 > buf.length || crc32(buf, pos, end) !== buf.readUInt32LE(end)) {
+      stats.corrupt++;
+      pos++;
+      stats.skippedBytes++;
+      continue;
+    }
+
+    if (lastMs >= 0 && base + offset < lastMs - 1000) offset = lastMs - base; // Reboot or wrap
+    let ms = base + offset;
+    prev.fill(0);
+    let i = pos + HEADER_BYTES;
+    for (let s = 0; s < count; s++) {
+      const tag = buf[i++];
+      let b = buf[i++];
+      let dt = b & 0x7f;
+      for (let shift = 7; b & 0x80; shift += 7) {
+        b = buf[i++];
+        dt += (b & 0x7f) * 2 ** shift;
+      }
+      ms += dt;
+      const channel = tag & 0x7f;
+      if (tag & MISSING) {
+        onSample(channel, ms, 0, true);
+        continue;
+      }
+      b = buf[i++];
+      let z = b & 0x7f;
+      for (let shift = 7; b & 0x80; shift += 7) {
+        b = buf[i++];
+        z += (b & 0x7f) * 2 ** shift;
+      }
+      const value = (prev[channel] += z % 2 ? -(z + 1) / 2 : z / 2);
+      onSample(channel, ms, value, false);
+    }
+    lastMs = ms;
+    stats.frames++;
+    pos = end + 4;
+  }
+  stats.skippedBytes += buf.length - pos;
+  return stats;
+}
+
+// ----------------------------------------------------------------------------
+// readSensors() emulation (firmware/src/main.cpp)
+// ----------------------------------------------------------------------------
+function rsFromAdc(raw) {
+  const voltage = (raw / 4095.0) * 3.3;
+  return (5.0 * MQ135_RL) / voltage - MQ135_RL;
+}
+
+function calculateIAQ(ratio, temp, hum) {
+  const tempFactor = 1.0 + 0.02 * (temp - 20.0);
+  const humFactor = 1.0 + 0.01 * (hum - 33.0);
+  const iaq = 50.0 + (1.0 - ratio / (tempFactor * humFactor)) * 200.0;
+  return Math.min(LIMITS.iaq[1], Math.max(LIMITS.iaq[0], iaq));
+}
+
+function estimateCO2(ratio) {
+  return Math.min(5000, Math.max(300, 116.6020682 * Math.pow(ratio, -2.769034857)));
+}
+
+const round = (v, digits) => Math.round(v * 10 ** digits) / 10 ** digits;
+
+class ReadingEmulator {
+  constructor() {
+    this.adc = new Float64Array(MEDIAN_FILTER_SIZE);
+    this.adcCount = 0;
+    this.temp = null;
+    this.hum = null;
+    this.pressurePa = null;
+    this.nextReadingMs = -1;
+    this.readings = [];
+    this.invalid = { dht: 0, pressure: 0, range: 0 };
+    this.channel = CHANNEL_NAMES.map(() => ({ samples: 0, missing: 0 }));
+    // ADC noise from successive differences; BMP drift from a least-squares slope
+    this.adcPrev = null;
+    this.diffSq = 0;
+    this.diffCount = 0;
+    this.bmp = { n: 0, sx: 0, sy: 0, sxx: 0, sxy: 0, x0: null };
+  }
+
+  sample(channel, ms, value, missing) {
+    const c = this.channel[channel];
+    if (!c) return;
+    c.samples++;
+    if (missing) c.missing++;
+
+    // The node takes a reading every interval once warm; emit any that fall before this sample
+    if (this.nextReadingMs < 0) this.nextReadingMs = ms + MQ135_WARMUP_MS;
+    while (ms >= this.nextReadingMs) {
+      this.emit(this.nextReadingMs);
+      this.nextReadingMs += SAMPLING_INTERVAL_MS;
+    }
+
+    switch (channel) {
+      case CH_ADC:
+        this.adc[this.adcCount++ % MEDIAN_FILTER_SIZE] = value;
+        if (this.adcPrev !== null) {
+          const d = value - this.adcPrev;
+          this.diffSq += d * d;
+          this.diffCount++;
+        }
+        this.adcPrev = value;
+        break;
+      case CH_TEMP:
+        this.temp = missing ? null : value / 100;
+        break;
+      case CH_HUM:
+        this.hum = missing ? null : value / 100;
+        break;
+      case CH_PRESSURE: {
+        if (missing) break;
+        this.pressurePa = value;
+        const b = this.bmp;
+        if (b.x0 === null) b.x0 = ms;
+        const x = (ms - b.x0) / 3_600_000;
+        b.n++;
+        b.sx += x;
+        b.sy += value;
+        b.sxx += x * x;
+        b.sxy += x * value;
+        break;
+      }
+    }
+  }
+
+  emit(ms) {
+    if (this.adcCount < MEDIAN_FILTER_SIZE || this.pressurePa === null) return;
+    const sorted = Array.from(this.adc).sort((a, b) => a - b);
+    const rs = rsFromAdc(sorted[MEDIAN_FILTER_SIZE >> 1]);
+
+    let valid = true;
+    let temperature = this.temp;
+    let humidity = this.hum;
+    if (temperature === null || humidity === null) {
+      this.invalid.dht++;
+      valid = false;
+      temperature = 0;
+      humidity = 0;
+    }
+    const pressure = this.pressurePa / 100;
+    if (pressure < LIMITS.pressure[0] || pressure > LIMITS.pressure[1]) {
+      if (valid) this.invalid.pressure++;
+      valid = false;
+    }
+    if (valid && (temperature < LIMITS.temp[0] || temperature > LIMITS.temp[1] || humidity < LIMITS.hum[0] || humidity > LIMITS.hum[1])) {
+      this.invalid.range++;
+      valid = false;
+    }
+    // Invalid readings are dropped on the node, never transmitted
+    if (!valid) return;
+
+    const ratio = rs / MQ135_R0;
+    this.readings.push({
+      ms,
+      sensors: {
+        mq135_raw: round(rs, 2),
+        iaq_score: round(calculateIAQ(ratio, temperature, humidity), 2),
+        co2_equiv: round(estimateCO2(ratio), 2),
+        temperature: round(temperature, 2),
+        humidity: round(humidity, 2),
+        pressure_hpa: round(pressure, 2),
+        altitude_m: round(44330 * (1 - Math.pow(this.pressurePa / 101325, 1 / 5.255)), 2),
+      },
+    });
+  }
+
+  get adcNoise() {
+    return this.diffCount ? Math.sqrt(this.diffSq / this.diffCount / 2) : 0;
+  }
+
+  get bmpDriftPaPerDay() {
+    const b = this.bmp;
+    const denom = b.n * b.sxx - b.sx * b.sx;
+    return b.n > 1 && denom > 0 ? ((b.n * b.sxy - b.sx * b.sy) / denom) * 24 : 0;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Output
+// ----------------------------------------------------------------------------
+function toPayload(reading, startEpoch, bootId, seq) {
+  const payload = {
+    device_id: DEVICE_ID,
+    firmware_version: 'TRACE-REPLAY',
+    timestamp: startEpoch + Math.floor(reading.ms / 1000),
+    sensors: reading.sensors,
+    meta: { uptime_ms: reading.ms, rssi: -60, free_heap: 180000, boot_id: bootId, seq },
+  };
+  payload.signature = crypto.createHmac('sha256', DEVICE_KEY).update(JSON.stringify(payload)).digest('hex');
+  return payload;
+}
+
+async function postReadings(readings, startEpoch) {
+  const bootId = crypto.randomBytes(4).toString('hex');
+  const wallStart = Date.now();
+  const traceStart = readings.length ? readings[0].ms : 0;
+  let sent = 0;
+  let failed = 0;
+
+  for (let seq = 0; seq < readings.length; seq++) {
+    const reading = readings[seq];
+    if (REPLAY_SPEED > 0) {
+      const due = wallStart + (reading.ms - traceStart) / REPLAY_SPEED;
+      if (due > Date.now()) await new Promise((r) => setTimeout(r, due - Date.now()));
+    }
+    try {
+      const res = await fetch(`${API_URL}/ingest`, {
+        method: 'POST',
+        headers: { 'Content-Type': 'application/json', 'X-API-Key': DEVICE_KEY },
+        body: JSON.stringify(toPayload(reading, startEpoch, bootId, seq)),
+      });
+      if (res.ok) sent++;
+      else {
+        failed++;
+        if (failed <= 5) console.error(`❌ API Error: ${res.status} ${await res.text()}`);
+      }
+    } catch (error) {
+      console.error(`❌ Network Error: Cannot reach ${API_URL} (${error.message})`);
+      break;
+    }
+    if ((seq + 1) % 500 === 0) console.log(`   ${seq + 1}/${readings.length} posted`);
+  }
+  console.log(`📤 Posted ${sent} readings (${failed} rejected) in ${((Date.now() - wallStart) / 1000).toFixed(1)}s`);
+}
+
+// ----------------------------------------------------------------------------
+// Synthetic traces (same framing as the firmware encoder)
+// ----------------------------------------------------------------------------
+class TraceWriter {
+  constructor(fd) {
+    this.fd = fd;
+    this.out = Buffer.allocUnsafe(1 << 20);
+    this.outLen = 0;
+    this.frame = Buffer.allocUnsafe(HEADER_BYTES + PAYLOAD_MAX + 4);
+    this.len = 0;
+    this.count = 0;
+    this.prev = new Int32Array(4);
+  }
+
+  varint(v) {
+    while (v >= 0x80) {
+      this.frame[HEADER_BYTES + this.len++] = (v & 0x7f) | 0x80;
+      v = Math.floor(v / 128);
+    }
+    this.frame[HEADER_BYTES + this.len++] = v;
+  }
+
+  record(channel, ms, value, missing = false) {
+    if (this.count > 0 && this.len + 11 > PAYLOAD_MAX) this.flush();
+    if (this.count === 0) {
+      this.base = ms;
+      this.last = ms;
+      this.prev.fill(0);
+    }
+    this.frame[HEADER_BYTES + this.len++] = channel | (missing ? MISSING : 0);
+    this.varint(ms - this.last);
+    if (!missing) {
+      const delta = value - this.prev[channel];
+      this.varint(delta < 0 ? -2 * delta - 1 : 2 * delta);
+      this.prev[channel] = value;
+    }
+    this.last = ms;
+    this.count++;
+  }
+
+  flush() {
+    if (this.count === 0) return;
+    const f = this.frame;
+    f.writeUInt32LE(MAGIC, 0);
+    f[4] = VERSION;
+    f.writeUInt16LE(this.count, 5);
+    f.writeUInt32LE(this.base >>> 0, 7);
+    f.writeUInt16LE(this.len, 11);
+    const body = HEADER_BYTES + this.len;
+    f.writeUInt32LE(crc32(f, 0, body), body);
+    if (this.outLen + body + 4 > this.out.length) this.drain();
+    f.copy(this.out, this.outLen, 0, body + 4);
+    this.outLen += body + 4;
+    this.count = 0;
+    this.len = 0;
+  }
+
+  drain() {
+    fs.writeSync(this.fd, this.out, 0, this.outLen);
+    this.outLen = 0;
+  }
+
+  close() {
+    this.flush();
+    this.drain();
+    fs.closeSync(this.fd);
+  }
+}
+
+function synthesize(file, days) {
+  const w = new TraceWriter(fs.openSync(file, 'w'));
+  const endMs = Math.round(days * 86_400_000);
+  let samples = 0;
+  let adcDrift = 0;
+  for (let ms = 1000; ms < endMs; ms += 100) {
+    const hour = (ms / 3_600_000) % 24;
+    // MQ135: diurnal pollution cycle, slow wander, ADC noise of a few counts
+    adcDrift += (Math.random() - 0.5) * 0.2;
+    const adc = 1900 + 250 * Math.sin(((hour - 8) * Math.PI) / 12) + adcDrift + (Math.random() + Math.random() + Math.random() - 1.5) * 6;
+    w.record(CH_ADC, ms, Math.max(1, Math.min(4095, Math.round(adc))));
+    samples++;
+    if (ms % 2000 === 0) {
+      // DHT22: ~2% failed reads, occasionally in bursts
+      const fail = Math.random() < 0.02;
+      const temp = 2500 + 600 * Math.sin(((hour - 9) * Math.PI) / 12) + Math.round((Math.random() - 0.5) * 20);
+      const hum = 5500 - 1500 * Math.sin(((hour - 9) * Math.PI) / 12) + Math.round((Math.random() - 0.5) * 60);
+      w.record(CH_TEMP, ms, Math.round(temp), fail);
+      w.record(CH_HUM, ms, Math.round(hum), fail);
+      samples += 2;
+    }
+    if (ms % 1000 === 0) {
+      // BMP180: weather swing plus slow sensor drift
+      const pa = 100870 + 300 * Math.sin((ms / 86_400_000) * Math.PI * 0.7) + (ms / 86_400_000) * 4 + Math.round((Math.random() - 0.5) * 6);
+      w.record(CH_PRESSURE, ms, Math.round(pa));
+      samples++;
+    }
+  }
+  w.close();
+  const bytes = fs.statSync(file).size;
+  console.log(`🧪 Wrote ${samples} samples over ${days} days to ${file} (${(bytes / 1024 / 1024).toFixed(1)} MB, ${(bytes / samples).toFixed(2)} B/sample)`);
+}
+
+// ----------------------------------------------------------------------------
+// Main
+// ----------------------------------------------------------------------------
+async function main() {
+  const args = process.argv.slice(2);
+  if (args[0] === '--synthesize') {
+    synthesize(args[1] || 'trace.bin', parseFloat(args[2] || '7'));
+    return;
+  }
+  const file = args[0];
+  if (!file) {
+    console.error('Usage: node scripts/trace-replay.js <trace.bin> [--post | --jsonl out.jsonl] | --synthesize <out.bin> [days]');
+    process.exit(1);
+  }
+
+  const buf = fs.readFileSync(file);
+  const emu = new ReadingEmulator();
+  const started = process.hrtime.bigint();
+  let firstMs = -1;
+  let lastMs = 0;
+  const stats = decodeTrace(buf, (channel, ms, value, missing) => {
+    if (firstMs < 0) firstMs = ms;
+    lastMs = ms;
+    emu.sample(channel, ms, value, missing);
+  });
+  const seconds = Number(process.hrtime.bigint() - started) / 1e9;
+  const samples = emu.channel.reduce((n, c) => n + c.samples, 0);
+  const traceHours = (lastMs - firstMs) / 3_600_000;
+
+  console.log(`🎞️  ${file}: ${(buf.length / 1024 / 1024).toFixed(1)} MB, ${stats.frames} frames, ${stats.corrupt} corrupt, ${stats.skippedBytes} bytes skipped`);
+  console.log(`⏱️  ${samples} samples over ${traceHours.toFixed(1)} h replayed in ${seconds.toFixed(2)}s: ${(samples / seconds / 1e6).toFixed(1)}M samples/s, ${Math.round((traceHours * 3600) / seconds)}x real time`);
+  emu.channel.forEach((c, i) => {
+    if (c.samples) console.log(`   ${CHANNEL_NAMES[i].padEnd(13)} ${String(c.samples).padStart(10)} samples, ${((100 * c.missing) / c.samples).toFixed(2)}% failed`);
+  });
+  console.log(`📈 MQ135 ADC noise ${emu.adcNoise.toFixed(2)} counts (rms), BMP drift ${emu.bmpDriftPaPerDay.toFixed(1)} Pa/day`);
+  console.log(`📊 Readings: ${emu.readings.length} valid, dropped ${emu.invalid.dht} (DHT failed) ${emu.invalid.pressure} (pressure) ${emu.invalid.range} (out of range)`);
+
+  const startEpoch = TRACE_START_EPOCH || Math.floor(Date.now() / 1000 - (lastMs - Math.max(firstMs, 0)) / 1000);
+  const jsonl = args.indexOf('--jsonl');
+  if (jsonl >= 0) {
+    const bootId = crypto.randomBytes(4).toString('hex');
+    fs.writeFileSync(args[jsonl + 1], emu.readings.map((r, seq) => JSON.stringify(toPayload(r, startEpoch, bootId, seq))).join('\n') + '\n');
+    console.log(`💾 Wrote ${emu.readings.length} readings to ${args[jsonl + 1]}`);
+  }
+  if (args.includes('--post')) {
+    console.log(`🔗 Posting to ${API_URL} as ${DEVICE_ID} (${REPLAY_SPEED > 0 ? `${REPLAY_SPEED}x real time` : 'max speed'})`);
+    await postReadings(emu.readings, startEpoch);
+  }
+}
+
+main().catch((err) => {
+  console.error(err);
+  process.exit(1);
+});